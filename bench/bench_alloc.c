@@ -0,0 +1,97 @@
+/**
+ * Heap allocations per operation on the hot paths.
+ *
+ * Point lookups (hits and misses) and updates should report 0 allocations
+ * per operation: cursors live on the stack and page frames come from the
+ * pager's arena.
+ */
+#include "bench_common.h"
+#include "../src/db_core.h"
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_DB "bench_alloc.db"
+#define NUM_KEYS 120
+#define ROUNDS 50
+
+static void report(const char* name, uint64_t ops, uint64_t allocs, uint64_t elapsed_ns) {
+    if (bench_alloc_counting()) {
+        printf("%-16s %8llu ops  %6.2f allocs/op  %8.1f ns/op\n", name,
+               (unsigned long long)ops, (double)allocs / ops, (double)elapsed_ns / ops);
+    } else {
+        printf("%-16s %8llu ops  %6s allocs/op  %8.1f ns/op\n", name,
+               (unsigned long long)ops, "n/a", (double)elapsed_ns / ops);
+    }
+}
+
+int main(void) {
+    bench_remove_db(BENCH_DB);
+    Database* db = db_open(BENCH_DB);
+    if (!db) {
+        fprintf(stderr, "Failed to open %s\n", BENCH_DB);
+        return 1;
+    }
+
+    char key[32];
+    char value[32];
+    for (int i = 0; i < NUM_KEYS; i++) {
+        snprintf(key, sizeof(key), "key-%05d", i);
+        snprintf(value, sizeof(value), "value-%05d", i);
+        if (db_insert(db, key, value) != STATUS_OK) {
+            fprintf(stderr, "Insert failed for %s\n", key);
+            db_close(db);
+            return 1;
+        }
+    }
+
+    printf("Allocation profile (%d keys)\n", NUM_KEYS);
+
+    // Point lookups that hit
+    uint64_t allocs = bench_alloc_count();
+    uint64_t start = bench_now_ns();
+    uint64_t found = 0;
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int i = 0; i < NUM_KEYS; i++) {
+            snprintf(key, sizeof(key), "key-%05d", i);
+            found += db_get(db, key) != NULL;
+        }
+    }
+    report("get (hit)", (uint64_t)ROUNDS * NUM_KEYS, bench_alloc_count() - allocs, bench_now_ns() - start);
+
+    // Point lookups that miss
+    allocs = bench_alloc_count();
+    start = bench_now_ns();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int i = 0; i < NUM_KEYS; i++) {
+            snprintf(key, sizeof(key), "nokey-%05d", i);
+            found += db_get(db, key) != NULL;
+        }
+    }
+    report("get (miss)", (uint64_t)ROUNDS * NUM_KEYS, bench_alloc_count() - allocs, bench_now_ns() - start);
+
+    // Existence check on insert of a present key
+    allocs = bench_alloc_count();
+    start = bench_now_ns();
+    for (int i = 0; i < NUM_KEYS; i++) {
+        snprintf(key, sizeof(key), "key-%05d", i);
+        db_insert(db, key, "dup");
+    }
+    report("insert (exists)", NUM_KEYS, bench_alloc_count() - allocs, bench_now_ns() - start);
+
+    // Updates (one WAL frame each)
+    allocs = bench_alloc_count();
+    start = bench_now_ns();
+    for (int i = 0; i < NUM_KEYS; i++) {
+        snprintf(key, sizeof(key), "key-%05d", i);
+        db_update(db, key, "updated");
+    }
+    report("update", NUM_KEYS, bench_alloc_count() - allocs, bench_now_ns() - start);
+
+    if (found != (uint64_t)ROUNDS * NUM_KEYS) {
+        fprintf(stderr, "Unexpected lookup results: %llu\n", (unsigned long long)found);
+    }
+
+    db_close(db);
+    bench_remove_db(BENCH_DB);
+    return 0;
+}
@@ -0,0 +1,68 @@
+/**
+ * Tree statistics: an exact analysis on one thread and on several, against
+ * estimates from random descents.
+ *
+ * Fills a database, then runs db_analyze reading every page on 1 and 4
+ * threads, and sampling 100 and 1000 descents. Reports time and pages read
+ * per analysis, and how far the estimated leaf pages and records are from
+ * the exact counts.
+ */
+#include "bench_common.h"
+#include "../src/db_core.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_DB "bench_analyze.db"
+#define NUM_RECORDS 50000
+
+static double error_percent(uint64_t estimate, uint64_t exact) {
+    return exact ? 100.0 * ((double)estimate - (double)exact) / (double)exact : 0.0;
+}
+
+int main(void) {
+    bench_remove_db(BENCH_DB);
+    DbOptions options = {0};
+    options.pager.cache_frames = 4096;
+    Database *db = db_open_with_options(BENCH_DB, &options);
+    if (!db) {
+        fprintf(stderr, "Failed to open %s\n", BENCH_DB);
+        return 1;
+    }
+    char key[MAX_KEY_LEN];
+    for (uint32_t i = 0; i < NUM_RECORDS; i++) {
+        snprintf(key, sizeof(key), "user:%08u", i * 7919u % NUM_RECORDS);
+        db_insert(db, key, "v");
+    }
+    printf("Analyze: %d records\n", NUM_RECORDS);
+
+    DbAnalyzeOptions runs[] = { { 0, 1 }, { 0, 4 }, { 100, 0 }, { 1000, 0 } };
+    DbAnalysis exact;
+    for (size_t i = 0; i < sizeof(runs) / sizeof(runs[0]); i++) {
+        DbAnalysis analysis;
+        uint64_t start = bench_now_ns();
+        if (db_analyze(db, &runs[i], &analysis) != STATUS_OK) {
+            fprintf(stderr, "Analysis failed\n");
+            return 1;
+        }
+        double ms = (double)(bench_now_ns() - start) / 1e6;
+        if (i == 0) {
+            exact = analysis;
+        }
+        const TreeAnalysis *tree = &analysis.tree;
+        uint64_t leaves = tree->level_pages[tree->height - 1];
+        if (runs[i].samples == 0) {
+            printf("exact   %u thread(s)   %8.2f ms  %7llu pages read  %llu leaves, %llu records\n", runs[i].threads,
+                   ms, (unsigned long long)tree->pages_read, (unsigned long long)leaves,
+                   (unsigned long long)tree->records);
+        } else {
+            printf("sampled %4u descents %8.2f ms  %7llu pages read  leaves %+.1f%%, records %+.1f%%\n",
+                   runs[i].samples, ms, (unsigned long long)tree->pages_read,
+                   error_percent(leaves, exact.tree.level_pages[exact.tree.height - 1]),
+                   error_percent(tree->records, exact.tree.records));
+        }
+    }
+
+    db_close(db);
+    bench_remove_db(BENCH_DB);
+    return 0;
+}
@@ -0,0 +1,104 @@
+/**
+ * Negative lookups with and without the Bloom filter.
+ *
+ * Builds one database, then looks up keys that do not exist (and, for
+ * comparison, keys that do) with db_get_into(), opening it without a
+ * filter and with 6, 10 and 16 bits per key. Reports time and pages
+ * requested per lookup, the filter's memory and its expected and observed
+ * false positive rates, in two settings:
+ *   cached - the whole tree is in the pager cache
+ *   small  - a small pager cache, so most absent-key descents miss
+ */
+#include "bench_common.h"
+#include "../src/db_core.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_DB "bench_bloom.db"
+#define NUM_KEYS 20000
+#define LOOKUPS 200000
+#define SMALL_CACHE 64
+
+static char keys[NUM_KEYS][32];
+
+static void build_db(void) {
+    bench_remove_db(BENCH_DB);
+    remove(BENCH_DB ".bloom");
+    DbOptions options = {0};
+    options.pager.cache_frames = 4096;
+    Database* db = db_open_with_options(BENCH_DB, &options);
+    unsigned int seed = 11;
+    for (int i = 0; i < NUM_KEYS; i++) {
+        seed = seed * 1103515245u + 12345u;
+        snprintf(keys[i], sizeof(keys[i]), "user:%08u", (seed >> 4) % 100000000u);
+        db_insert(db, keys[i], "value");
+    }
+    db_close(db);
+}
+
+// ns per lookup and pages requested per lookup
+static void time_lookups(Database* db, bool absent, double* ns, double* pages) {
+    char key[32];
+    char value[MAX_VALUE_LEN];
+    PagerStats stats;
+    unsigned int seed = 77;
+    pager_reset_stats(db->pager);
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < LOOKUPS; i++) {
+        seed = seed * 1103515245u + 12345u;
+        const char* lookup = keys[(seed >> 8) % NUM_KEYS];
+        if (absent) {
+            // Same shape as the real keys, outside their range
+            snprintf(key, sizeof(key), "user:9%07u", (seed >> 4) % 10000000u);
+            lookup = key;
+        }
+        if (db_get_into(db, lookup, value, sizeof(value)) < 0 && !absent) {
+            fprintf(stderr, "Lookup failed\n");
+            exit(1);
+        }
+    }
+    *ns = (double)(bench_now_ns() - start) / LOOKUPS;
+    pager_get_stats(db->pager, &stats);
+    *pages = (double)(stats.hits + stats.misses) / LOOKUPS;
+}
+
+static void run(uint32_t cache_frames, const char* name, uint32_t bits_per_key) {
+    remove(BENCH_DB ".bloom"); // Built from the tree at every open
+    DbOptions options = {0};
+    options.pager.cache_frames = cache_frames;
+    options.bloom_bits_per_key = bits_per_key;
+    Database* db = db_open_with_options(BENCH_DB, &options);
+    if (!db) {
+        fprintf(stderr, "Failed to open %s\n", BENCH_DB);
+        exit(1);
+    }
+    double absent_ns, absent_pages, present_ns, present_pages;
+    time_lookups(db, false, &present_ns, &present_pages); // Warms the cache
+    time_lookups(db, true, &absent_ns, &absent_pages);
+    time_lookups(db, false, &present_ns, &present_pages);
+
+    printf("%-7s %2u bits/key  absent %7.1f ns %5.2f pages  present %7.1f ns %5.2f pages", name, bits_per_key,
+           absent_ns, absent_pages, present_ns, present_pages);
+    DbBloomStats stats;
+    if (db_bloom_stats(db, &stats) == STATUS_OK && stats.enabled) {
+        printf("  %6.1f KB  fp expected %5.2f%% observed %5.2f%%", stats.memory_bytes / 1024.0,
+               100.0 * stats.expected_fp_rate, 100.0 * stats.observed_fp_rate);
+    }
+    printf("\n");
+    db_close(db);
+}
+
+int main(void) {
+    build_db();
+    printf("Lookups of absent and present keys: %d keys, %d lookups each\n", NUM_KEYS, LOOKUPS);
+    const uint32_t bits[] = { 0, 6, 10, 16 };
+    for (size_t i = 0; i < sizeof(bits) / sizeof(bits[0]); i++) {
+        run(4096, "cached", bits[i]);
+    }
+    for (size_t i = 0; i < sizeof(bits) / sizeof(bits[0]); i++) {
+        run(SMALL_CACHE, "small", bits[i]);
+    }
+    bench_remove_db(BENCH_DB);
+    remove(BENCH_DB ".bloom");
+    return 0;
+}
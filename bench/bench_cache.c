@@ -0,0 +1,102 @@
+/**
+ * Mixed scan + point-lookup workload against a cache smaller than the tree.
+ *
+ * A hot set of keys is looked up repeatedly while full-table scans run in
+ * between. Reports the hit rate seen by the point lookups for each
+ * replacement policy, with scans fetching leaves normally and as use-once.
+ */
+#include "bench_common.h"
+#include "../src/db_core.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_DB "bench_cache.db"
+#define NUM_KEYS 400
+#define HOT_KEYS 6
+#define CACHE_FRAMES 16
+#define ROUNDS 200
+#define LOOKUPS_PER_ROUND 50
+
+static void build_db(void) {
+    bench_remove_db(BENCH_DB);
+    Database* db = db_open(BENCH_DB);
+    char key[32];
+    char value[32];
+    for (int i = 0; i < NUM_KEYS; i++) {
+        snprintf(key, sizeof(key), "key-%05d", i);
+        snprintf(value, sizeof(value), "value-%05d", i);
+        db_insert(db, key, value);
+    }
+    db_close(db);
+}
+
+static uint64_t full_scan(Database* db, bool use_once) {
+    Cursor* cursor = table_start(db->pager, 0);
+    uint64_t rows = 0;
+    if (!cursor) {
+        return 0;
+    }
+    cursor->use_once = use_once;
+    while (!cursor->end_of_table) {
+        rows += cursor_value(cursor) != NULL;
+        cursor_advance(cursor);
+    }
+    free(cursor);
+    return rows;
+}
+
+static void run(const PagerPolicyOps* policy, bool use_once) {
+    DbOptions options = {0};
+    options.pager.cache_frames = CACHE_FRAMES;
+    options.pager.policy = policy;
+    Database* db = db_open_with_options(BENCH_DB, &options);
+    if (!db) {
+        fprintf(stderr, "Failed to open %s\n", BENCH_DB);
+        exit(1);
+    }
+
+    char key[32];
+    uint64_t lookup_hits = 0;
+    uint64_t lookup_misses = 0;
+    uint64_t scanned = 0;
+    unsigned int seed = 42;
+    uint64_t start = bench_now_ns();
+
+    for (int round = 0; round < ROUNDS; round++) {
+        PagerStats before;
+        PagerStats after;
+        pager_get_stats(db->pager, &before);
+        for (int i = 0; i < LOOKUPS_PER_ROUND; i++) {
+            seed = seed * 1103515245u + 12345u;
+            // Hot keys are spread over the whole key space, one per leaf
+            snprintf(key, sizeof(key), "key-%05d", (int)((seed >> 16) % HOT_KEYS) * (NUM_KEYS / HOT_KEYS));
+            db_get(db, key);
+        }
+        pager_get_stats(db->pager, &after);
+        lookup_hits += after.hits - before.hits;
+        lookup_misses += after.misses - before.misses;
+
+        scanned += full_scan(db, use_once);
+    }
+
+    uint64_t elapsed = bench_now_ns() - start;
+    uint64_t lookups = (uint64_t)ROUNDS * LOOKUPS_PER_ROUND;
+    printf("%-4s %-9s  lookup page hit rate %6.2f%%  %5.3f misses/lookup  (%llu rows scanned, %.2f ms)\n",
+           policy->name, use_once ? "use-once" : "normal",
+           100.0 * lookup_hits / (double)(lookup_hits + lookup_misses),
+           (double)lookup_misses / lookups,
+           (unsigned long long)scanned, elapsed / 1e6);
+    db_close(db);
+}
+
+int main(void) {
+    build_db();
+    printf("Scan + point lookups: %d keys, %d hot keys, %d cache frames\n", NUM_KEYS, HOT_KEYS, CACHE_FRAMES);
+    run(&pager_policy_lru, false);
+    run(&pager_policy_lru, true);
+    run(&pager_policy_2q, false);
+    run(&pager_policy_2q, true);
+    bench_remove_db(BENCH_DB);
+    return 0;
+}
@@ -0,0 +1,85 @@
+/**
+ * Cost of page checksums.
+ *
+ * Measures raw CRC32C speed over a page, then the cost of a cache miss
+ * (page read from the DB file) with verification off, sampled and always.
+ * The cache is kept smaller than the file so most requests miss; the file
+ * itself stays in the OS page cache, which makes the checksum share of a
+ * miss as large as it gets.
+ */
+#include "bench_common.h"
+#include "../src/db_core.h"
+#include "../src/crc32c.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_DB "bench_checksum.db"
+#define NUM_KEYS 400
+#define CRC_ROUNDS 200000
+#define LOADS 200000
+
+static void build_db(void) {
+    bench_remove_db(BENCH_DB);
+    Database* db = db_open(BENCH_DB);
+    char key[32];
+    char value[32];
+    for (int i = 0; i < NUM_KEYS; i++) {
+        snprintf(key, sizeof(key), "key-%05d", i);
+        snprintf(value, sizeof(value), "value-%05d", i);
+        db_insert(db, key, value);
+    }
+    db_close(db);
+}
+
+static void bench_crc(void) {
+    static uint8_t page[PAGE_SIZE];
+    for (int i = 0; i < PAGE_SIZE; i++) {
+        page[i] = (uint8_t)(i * 31);
+    }
+    uint32_t sink = 0;
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < CRC_ROUNDS; i++) {
+        page[0] = (uint8_t)i;
+        sink += crc32c(0, page, PAGE_SIZE);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+    printf("crc32c (%s): %.1f ns/page, %.2f GB/s  [%08x]\n", crc32c_implementation(),
+           (double)elapsed / CRC_ROUNDS, (double)CRC_ROUNDS * PAGE_SIZE / elapsed, sink);
+}
+
+static void run(PagerChecksumMode mode, const char* name) {
+    PagerOptions options = { .cache_frames = PAGER_MIN_FRAMES, .checksum_mode = mode };
+    Pager* pager = pager_open_with_options(BENCH_DB, &options);
+    if (!pager) {
+        fprintf(stderr, "Failed to open %s\n", BENCH_DB);
+        exit(1);
+    }
+    uint32_t num_pages = pager->num_pages;
+    unsigned int seed = 42;
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < LOADS; i++) {
+        seed = seed * 1103515245u + 12345u;
+        if (!pager_get_page(pager, (seed >> 8) % num_pages)) {
+            fprintf(stderr, "Page load failed\n");
+            exit(1);
+        }
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+    PagerStats stats;
+    pager_get_stats(pager, &stats);
+    printf("%-8s %7.1f ns/request  %7.1f ns/miss  (%llu misses of %d)\n", name,
+           (double)elapsed / LOADS, (double)elapsed / stats.misses,
+           (unsigned long long)stats.misses, LOADS);
+    pager_close(pager);
+}
+
+int main(void) {
+    build_db();
+    bench_crc();
+    printf("Random page requests: %d keys, %d cache frames\n", NUM_KEYS, PAGER_MIN_FRAMES);
+    run(PAGER_CHECKSUM_OFF, "off");
+    run(PAGER_CHECKSUM_SAMPLED, "sampled");
+    run(PAGER_CHECKSUM_ALWAYS, "always");
+    bench_remove_db(BENCH_DB);
+    return 0;
+}
@@ -0,0 +1,80 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include "bench_common.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+#ifdef BENCH_COUNT_ALLOCS
+// Linked with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc
+static uint64_t alloc_calls = 0;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t nmemb, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    alloc_calls++;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t nmemb, size_t size) {
+    alloc_calls++;
+    return __real_calloc(nmemb, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    alloc_calls++;
+    return __real_realloc(ptr, size);
+}
+
+uint64_t bench_alloc_count(void) {
+    return alloc_calls;
+}
+
+bool bench_alloc_counting(void) {
+    return true;
+}
+#else
+uint64_t bench_alloc_count(void) {
+    return 0;
+}
+
+bool bench_alloc_counting(void) {
+    return false;
+}
+#endif
+
+void bench_remove_db(const char* filename) {
+    char wal[512];
+    snprintf(wal, sizeof(wal), "%s.wal", filename);
+    remove(filename);
+    remove(wal);
+}
+
+bool bench_drop_os_cache(const char* filename) {
+#if defined(POSIX_FADV_DONTNEED)
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    fdatasync(fd);
+    bool dropped = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(fd);
+    return dropped;
+#else
+    (void)filename;
+    return false;
+#endif
+}
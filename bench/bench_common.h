@@ -0,0 +1,41 @@
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Shared helpers for the micro-benchmarks in bench/.
+ * Build and run them with `make bench`.
+ */
+
+/**
+ * Monotonic clock in nanoseconds.
+ */
+uint64_t bench_now_ns(void);
+
+/**
+ * Number of malloc/calloc/realloc calls made by the process so far.
+ * Only available when linked with the allocator wrappers (GNU ld);
+ * see bench_alloc_counting().
+ */
+uint64_t bench_alloc_count(void);
+
+/**
+ * True if bench_alloc_count() reports real numbers on this build.
+ */
+bool bench_alloc_counting(void);
+
+/**
+ * Remove a database file and its WAL so every run starts clean.
+ */
+void bench_remove_db(const char* filename);
+
+/**
+ * Evict a file's pages from the OS page cache so the next reads go to the
+ * device (clean pages only; Linux/POSIX fadvise).
+ * @return false if not supported here
+ */
+bool bench_drop_os_cache(const char* filename);
+
+#endif // BENCH_COMMON_H
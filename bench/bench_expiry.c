@@ -0,0 +1,106 @@
+/**
+ * Reclaiming expired sessions: client-side scan and delete against the
+ * expiry sweeper.
+ *
+ * Fills a database with sessions of which every other one has expired.
+ * The client way stores the expiry time in the value, scans a snapshot for
+ * the expired ones and deletes them one by one: a WAL transaction and a
+ * leaf write each. The sweeper walks the leaves in steps of STEP_LEAVES
+ * and deletes each leaf's expired records in one write of the leaf, one
+ * transaction per step. Reports time and WAL frames per record reclaimed.
+ */
+#include "bench_common.h"
+#include "../src/db_core.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_DB "bench_expiry.db"
+#define SESSIONS 20000
+#define STEP_LEAVES 64
+
+// Keys of the sessions the client scan found expired
+typedef struct {
+    char (*keys)[MAX_KEY_LEN];
+    int count;
+    long long now;
+} ExpiredScan;
+
+static int find_expired(const char *key, const char *value, void *arg) {
+    ExpiredScan *scan = arg;
+    if (atoll(value) <= scan->now) {
+        snprintf(scan->keys[scan->count++], MAX_KEY_LEN, "%s", key);
+    }
+    return 0;
+}
+
+static Database *fill(bool client) {
+    bench_remove_db(BENCH_DB);
+    DbOptions options = {0};
+    options.pager.cache_frames = 8192;
+    Database *db = db_open_with_options(BENCH_DB, &options);
+    if (!db) {
+        fprintf(stderr, "Failed to open %s\n", BENCH_DB);
+        exit(1);
+    }
+    time_t now = time(NULL);
+    char key[MAX_KEY_LEN];
+    char value[MAX_VALUE_LEN];
+    for (int i = 0; i < SESSIONS; i++) {
+        snprintf(key, sizeof(key), "session:%06d", i);
+        time_t expires_at = i % 2 ? now + 3600 : now - 1;
+        int status;
+        if (client) {
+            snprintf(value, sizeof(value), "%lld;user%d", (long long)expires_at, i);
+            status = db_insert(db, key, value);
+        } else {
+            snprintf(value, sizeof(value), "user%d", i);
+            status = db_insert_expiring(db, key, value, expires_at);
+        }
+        if (status != STATUS_OK) {
+            fprintf(stderr, "Insert failed\n");
+            exit(1);
+        }
+    }
+    return db;
+}
+
+static void report(const char *name, Database *db, int reclaimed, uint64_t ns, uint32_t frames) {
+    BTreeFillStats fill;
+    db_fill_stats(db, &fill);
+    printf("%-8s %6d reclaimed  %7.1f us/record  %5.2f WAL frames/record  %llu records left\n", name, reclaimed,
+           (double)ns / 1000.0 / reclaimed, (double)frames / reclaimed, (unsigned long long)fill.cells);
+}
+
+int main(void) {
+    printf("Expired sessions: %d sessions, half expired\n", SESSIONS);
+
+    Database *db = fill(true);
+    ExpiredScan scan = { malloc(SESSIONS * sizeof(*scan.keys)), 0, (long long)time(NULL) };
+    uint32_t frames = db->wal->num_frames;
+    uint64_t start = bench_now_ns();
+    DbSnapshot snapshot;
+    db_snapshot(db, &snapshot);
+    db_snapshot_scan(&snapshot, NULL, find_expired, &scan);
+    db_snapshot_release(&snapshot);
+    for (int i = 0; i < scan.count; i++) {
+        db_delete(db, scan.keys[i]);
+    }
+    report("client", db, scan.count, bench_now_ns() - start, db->wal->num_frames - frames);
+    free(scan.keys);
+    db_close(db);
+
+    db = fill(false);
+    frames = db->wal->num_frames;
+    start = bench_now_ns();
+    int reclaimed = 0;
+    int removed;
+    do {
+        removed = db_expire_sweep(db, STEP_LEAVES);
+        reclaimed += removed > 0 ? removed : 0;
+    } while (db->expiry_sweep_page != 0 && removed >= 0);
+    report("sweeper", db, reclaimed, bench_now_ns() - start, db->wal->num_frames - frames);
+    db_close(db);
+    bench_remove_db(BENCH_DB);
+    return 0;
+}
@@ -0,0 +1,90 @@
+/**
+ * Point lookups with and without the hash index.
+ *
+ * Builds one database, then looks up keys with db_get_into() under a
+ * skewed workload (90% of lookups go to 10% of the keys), opening it
+ * without an index and with indexes that hold the hot set partly and
+ * fully. Reports time and pages requested per lookup and the index's
+ * hits, admissions and memory.
+ */
+#include "bench_common.h"
+#include "../src/db_core.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_DB "bench_hash_index.db"
+#define NUM_KEYS 100000
+#define HOT_KEYS (NUM_KEYS / 10)
+#define LOOKUPS 1000000
+
+static char keys[NUM_KEYS][32];
+
+static void build_db(void) {
+    bench_remove_db(BENCH_DB);
+    DbOptions options = {0};
+    options.pager.cache_frames = 16384;
+    Database* db = db_open_with_options(BENCH_DB, &options);
+    unsigned int seed = 5;
+    for (int i = 0; i < NUM_KEYS; i++) {
+        seed = seed * 1103515245u + 12345u;
+        snprintf(keys[i], sizeof(keys[i]), "user:%08u:%d", (seed >> 4) % 100000000u, i);
+        db_insert(db, keys[i], "value");
+    }
+    db_close(db);
+}
+
+// ns per lookup and pages requested per lookup
+static void time_lookups(Database* db, double* ns, double* pages) {
+    char value[MAX_VALUE_LEN];
+    PagerStats stats;
+    unsigned int seed = 99;
+    pager_reset_stats(db->pager);
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < LOOKUPS; i++) {
+        seed = seed * 1103515245u + 12345u;
+        uint32_t r = seed >> 8;
+        const char* key = (r % 10 != 0) ? keys[(r / 10) % HOT_KEYS] : keys[(r / 10) % NUM_KEYS];
+        if (db_get_into(db, key, value, sizeof(value)) < 0) {
+            fprintf(stderr, "Lookup failed\n");
+            exit(1);
+        }
+    }
+    *ns = (double)(bench_now_ns() - start) / LOOKUPS;
+    pager_get_stats(db->pager, &stats);
+    *pages = (double)(stats.hits + stats.misses) / LOOKUPS;
+}
+
+static void run(uint32_t entries) {
+    DbOptions options = {0};
+    options.pager.cache_frames = 16384; // The whole tree stays cached
+    options.hash_index_entries = entries;
+    Database* db = db_open_with_options(BENCH_DB, &options);
+    if (!db) {
+        fprintf(stderr, "Failed to open %s\n", BENCH_DB);
+        exit(1);
+    }
+    double ns, pages;
+    time_lookups(db, &ns, &pages); // Warms the cache and the index
+    time_lookups(db, &ns, &pages);
+
+    printf("%7u entries  %7.1f ns %5.2f pages", entries, ns, pages);
+    HashIndexStats stats;
+    if (db_hash_index_stats(db, &stats) == STATUS_OK && stats.capacity > 0) {
+        printf("  hits %5.1f%%  admitted %7llu rejected %7llu  %7.1f KB",
+               100.0 * stats.hits / (2.0 * LOOKUPS), (unsigned long long)stats.admitted,
+               (unsigned long long)stats.rejected, stats.memory_bytes / 1024.0);
+    }
+    printf("\n");
+    db_close(db);
+}
+
+int main(void) {
+    build_db();
+    printf("Skewed point lookups: %d keys, %d hot, %d lookups\n", NUM_KEYS, HOT_KEYS, LOOKUPS);
+    const uint32_t entries[] = { 0, HOT_KEYS / 4, HOT_KEYS, 2 * HOT_KEYS };
+    for (size_t i = 0; i < sizeof(entries) / sizeof(entries[0]); i++) {
+        run(entries[i]);
+    }
+    bench_remove_db(BENCH_DB);
+    return 0;
+}
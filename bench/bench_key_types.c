@@ -0,0 +1,105 @@
+/**
+ * Integer keys stored as decimal strings or as u64 keys.
+ *
+ * Builds one database keyed by the numbers as decimal strings and one with
+ * u64 keys, inserting the same random numbers in the same order, then
+ * looks them up in random order. Reports time per insert and per lookup
+ * and how many neighbouring keys a full scan returns out of numeric order.
+ */
+#include "bench_common.h"
+#include "../src/db_core.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_DB "bench_key_types.db"
+#define NUM_KEYS 50000
+#define LOOKUPS 500000
+
+static uint64_t numbers[NUM_KEYS];
+
+typedef struct {
+    KeyType type;
+    uint64_t last;
+    uint64_t count;
+    uint64_t out_of_order;
+} OrderScan;
+
+static int count_out_of_order(const char* key, const char* value, void* arg) {
+    (void)value;
+    OrderScan* scan = arg;
+    uint64_t number = 0;
+    if (scan->type == KEY_TYPE_U64) {
+        key_decode_u64(key, &number);
+    } else {
+        number = strtoull(key, NULL, 10);
+    }
+    if (scan->count > 0 && number < scan->last) {
+        scan->out_of_order++;
+    }
+    scan->last = number;
+    scan->count++;
+    return 0;
+}
+
+static void make_key(Database* db, uint64_t number, char* key) {
+    if (db->key_type == KEY_TYPE_U64) {
+        db_key_u64(db, number, key);
+    } else {
+        snprintf(key, MAX_KEY_LEN, "%llu", (unsigned long long)number);
+    }
+}
+
+static void run(KeyType type) {
+    bench_remove_db(BENCH_DB);
+    DbOptions options = {0};
+    options.pager.cache_frames = 16384;
+    options.key_type = type;
+    Database* db = db_open_with_options(BENCH_DB, &options);
+    if (!db) {
+        fprintf(stderr, "Failed to open %s\n", BENCH_DB);
+        exit(1);
+    }
+    char key[MAX_KEY_LEN];
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < NUM_KEYS; i++) {
+        make_key(db, numbers[i], key);
+        db_insert(db, key, "value");
+    }
+    double insert_ns = (double)(bench_now_ns() - start) / NUM_KEYS;
+
+    char value[MAX_VALUE_LEN];
+    unsigned int seed = 11;
+    start = bench_now_ns();
+    for (int i = 0; i < LOOKUPS; i++) {
+        seed = seed * 1103515245u + 12345u;
+        make_key(db, numbers[(seed >> 8) % NUM_KEYS], key);
+        if (db_get_into(db, key, value, sizeof(value)) < 0) {
+            fprintf(stderr, "Lookup failed\n");
+            exit(1);
+        }
+    }
+    double lookup_ns = (double)(bench_now_ns() - start) / LOOKUPS;
+
+    OrderScan scan = { type, 0, 0, 0 };
+    DbSnapshot snapshot;
+    db_snapshot(db, &snapshot);
+    db_snapshot_scan(&snapshot, NULL, count_out_of_order, &scan);
+    db_snapshot_release(&snapshot);
+
+    printf("%-7s %7.1f ns/insert  %7.1f ns/lookup  %6llu of %llu keys out of numeric order\n", key_type_name(type),
+           insert_ns, lookup_ns, (unsigned long long)scan.out_of_order, (unsigned long long)scan.count);
+    db_close(db);
+}
+
+int main(void) {
+    uint64_t seed = 7;
+    for (int i = 0; i < NUM_KEYS; i++) {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        numbers[i] = (seed >> 24) * NUM_KEYS + (uint64_t)i; // Distinct, spread over 40 bits
+    }
+    printf("Integer keys: %d inserts, %d lookups\n", NUM_KEYS, LOOKUPS);
+    run(KEY_TYPE_STRING);
+    run(KEY_TYPE_U64);
+    bench_remove_db(BENCH_DB);
+    return 0;
+}
@@ -0,0 +1,169 @@
+/**
+ * Point lookups with and without key heads.
+ *
+ * Builds a tree whose pages all stay in the cache, then times random
+ * lookups of existing keys two ways over the same pages:
+ *   heads - table_find_into(): searches the dense key-head array of each
+ *           node and compares full keys only on ties
+ *   full  - a binary search comparing the full key at every probe (the
+ *           search nodes used before key heads), reimplemented here from
+ *           the page layout
+ * Three key sets: short keys with a shared prefix, long keys with a long
+ * shared prefix, and long keys that differ early.
+ */
+#include "bench_common.h"
+#include "../src/btree.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_DB "bench_lookup.db"
+#define NUM_KEYS 20000
+#define LOOKUPS 1000000
+#define CACHE_FRAMES 8192
+#define MAX_KEY 128
+
+static char keys[NUM_KEYS][MAX_KEY];
+
+static uint32_t baseline_find_child(uint8_t* node, const char* key) {
+    uint32_t num_keys = *internal_node_num_keys(node);
+    uint32_t key_len = (uint32_t)strlen(key);
+    uint32_t prefix_len = *(uint16_t*)(node + INTERNAL_NODE_PREFIX_LEN_OFFSET);
+    const uint8_t* prefix = node + PAGE_USABLE_SIZE - prefix_len;
+    int cmp = memcmp(key, prefix, key_len < prefix_len ? key_len : prefix_len);
+    if (cmp < 0 || (cmp == 0 && key_len < prefix_len)) {
+        return 0;
+    }
+    if (cmp > 0) {
+        return num_keys;
+    }
+    const uint8_t* rest = (const uint8_t*)key + prefix_len;
+    uint32_t rest_len = key_len - prefix_len;
+    const uint8_t* slots = node + INTERNAL_NODE_HEADER_SIZE + num_keys * KEY_HEAD_SIZE;
+    uint32_t min_index = 0;
+    uint32_t max_index = num_keys;
+    while (min_index != max_index) {
+        uint32_t index = (min_index + max_index) / 2;
+        const uint16_t* slot =
+            (const uint16_t*)(slots + index * INTERNAL_NODE_SLOT_SIZE + INTERNAL_NODE_SLOT_SUFFIX_OFFSET);
+        uint32_t suffix_len = slot[1];
+        cmp = memcmp(rest, node + slot[0], rest_len < suffix_len ? rest_len : suffix_len);
+        if (cmp == 0) {
+            cmp = (rest_len > suffix_len) - (rest_len < suffix_len);
+        }
+        if (cmp >= 0) {
+            min_index = index + 1;
+        } else {
+            max_index = index;
+        }
+    }
+    return min_index;
+}
+
+static uint32_t baseline_find(Pager* pager, const char* key) {
+    void* node = pager_get_page(pager, 0);
+    while (get_node_type(node) == NODE_INTERNAL) {
+        node = pager_get_page(pager, *internal_node_child(node, baseline_find_child(node, key)));
+    }
+    uint32_t min_index = 0;
+    uint32_t max_index = *leaf_node_num_cells(node);
+    while (min_index != max_index) {
+        uint32_t index = (min_index + max_index) / 2;
+        int cmp = strcmp(key, leaf_node_key(node, index));
+        if (cmp == 0) {
+            return index;
+        }
+        if (cmp < 0) {
+            max_index = index;
+        } else {
+            min_index = index + 1;
+        }
+    }
+    return min_index;
+}
+
+static Pager* build_tree(void) {
+    bench_remove_db(BENCH_DB);
+    PagerOptions options = { .cache_frames = CACHE_FRAMES };
+    Pager* pager = pager_open_with_options(BENCH_DB, &options);
+    if (!pager) {
+        fprintf(stderr, "Failed to open %s\n", BENCH_DB);
+        exit(1);
+    }
+    void* root = pager_get_page(pager, 0);
+    leaf_node_init(root);
+    set_node_root(root, true);
+    // Insert in a shuffled order so nodes are not all half full
+    unsigned int seed = 7;
+    static int order[NUM_KEYS];
+    for (int i = 0; i < NUM_KEYS; i++) {
+        order[i] = i;
+    }
+    for (int i = NUM_KEYS - 1; i > 0; i--) {
+        seed = seed * 1103515245u + 12345u;
+        int j = (int)((seed >> 8) % (unsigned int)(i + 1));
+        int tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+    Cursor cursor;
+    for (int i = 0; i < NUM_KEYS; i++) {
+        const char* key = keys[order[i]];
+        if (table_find_into(pager, 0, key, &cursor) != 0) {
+            exit(1);
+        }
+        leaf_node_insert(&cursor, key, "v");
+    }
+    return pager;
+}
+
+static void run(const char* name) {
+    Pager* pager = build_tree();
+    Cursor cursor;
+    uint64_t sink = 0;
+
+    unsigned int seed = 42;
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < LOOKUPS; i++) {
+        seed = seed * 1103515245u + 12345u;
+        table_find_into(pager, 0, keys[(seed >> 8) % NUM_KEYS], &cursor);
+        sink += cursor.cell_num;
+    }
+    uint64_t heads_ns = bench_now_ns() - start;
+
+    seed = 42;
+    start = bench_now_ns();
+    for (int i = 0; i < LOOKUPS; i++) {
+        seed = seed * 1103515245u + 12345u;
+        sink += baseline_find(pager, keys[(seed >> 8) % NUM_KEYS]);
+    }
+    uint64_t full_ns = bench_now_ns() - start;
+
+    printf("%-14s heads %6.1f ns/lookup   full %6.1f ns/lookup   (%u pages) [%llu]\n", name,
+           (double)heads_ns / LOOKUPS, (double)full_ns / LOOKUPS, pager->num_pages,
+           (unsigned long long)sink);
+    pager_close(pager);
+}
+
+int main(void) {
+    printf("Random point lookups: %d keys, all pages cached, %s compares\n", NUM_KEYS,
+           key_head_implementation());
+
+    for (int i = 0; i < NUM_KEYS; i++) {
+        snprintf(keys[i], MAX_KEY, "user:%08d", i);
+    }
+    run("short");
+
+    for (int i = 0; i < NUM_KEYS; i++) {
+        snprintf(keys[i], MAX_KEY, "tenant/0042/objects/%060d/%08d", 0, i);
+    }
+    run("shared-prefix");
+
+    for (int i = 0; i < NUM_KEYS; i++) {
+        snprintf(keys[i], MAX_KEY, "%08x/%060d/%08d", (unsigned int)i * 2654435761u, 0, i);
+    }
+    run("random-long");
+
+    bench_remove_db(BENCH_DB);
+    return 0;
+}
@@ -0,0 +1,135 @@
+/**
+ * Concurrent point lookups: db_get_into() from 1, 2, 4 and 8 threads.
+ *
+ * Builds a tree whose pages all stay in the cache, then has every thread
+ * look up random existing keys for a fixed time through one shared handle.
+ * Reports lookups per second and the speedup over one thread, once with
+ * readers only and once with a writer updating random keys alongside. On
+ * a machine with fewer cores than threads the speedup is capped by the
+ * core count, which is printed first.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "bench_common.h"
+#include "../src/db_core.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_DB "bench_mt_read.db"
+#define NUM_KEYS 20000
+#define CACHE_FRAMES 8192
+#define RUN_MS 500
+#define MAX_THREADS 8
+
+static Database* db;
+static char keys[NUM_KEYS][32];
+static atomic_bool stop;
+
+typedef struct {
+    pthread_t thread;
+    unsigned int seed;
+    uint64_t ops;
+} Worker;
+
+static void* reader(void* arg) {
+    Worker* worker = arg;
+    char value[MAX_VALUE_LEN];
+    uint64_t ops = 0;
+    while (!atomic_load_explicit(&stop, memory_order_relaxed)) {
+        worker->seed = worker->seed * 1103515245u + 12345u;
+        if (db_get_into(db, keys[(worker->seed >> 8) % NUM_KEYS], value, sizeof(value)) < 0) {
+            fprintf(stderr, "Lookup failed\n");
+            exit(1);
+        }
+        ops++;
+    }
+    worker->ops = ops;
+    return NULL;
+}
+
+static void* writer(void* arg) {
+    Worker* worker = arg;
+    char value[32];
+    uint64_t ops = 0;
+    while (!atomic_load_explicit(&stop, memory_order_relaxed)) {
+        worker->seed = worker->seed * 1103515245u + 12345u;
+        snprintf(value, sizeof(value), "updated-%llu", (unsigned long long)ops);
+        db_update(db, keys[(worker->seed >> 8) % NUM_KEYS], value);
+        ops++;
+    }
+    worker->ops = ops;
+    return NULL;
+}
+
+// Lookups per second with threads readers (and a writer if with_writer)
+static double run(int threads, bool with_writer, uint64_t* writes) {
+    Worker workers[MAX_THREADS];
+    Worker writer_worker = { .seed = 99 };
+    atomic_store(&stop, false);
+    uint64_t start = bench_now_ns();
+    for (int t = 0; t < threads; t++) {
+        workers[t].seed = (unsigned int)t * 7919u + 1u;
+        pthread_create(&workers[t].thread, NULL, reader, &workers[t]);
+    }
+    if (with_writer) {
+        pthread_create(&writer_worker.thread, NULL, writer, &writer_worker);
+    }
+    struct timespec run_time = { RUN_MS / 1000, (RUN_MS % 1000) * 1000000L };
+    nanosleep(&run_time, NULL);
+    atomic_store(&stop, true);
+    uint64_t ops = 0;
+    for (int t = 0; t < threads; t++) {
+        pthread_join(workers[t].thread, NULL);
+        ops += workers[t].ops;
+    }
+    if (with_writer) {
+        pthread_join(writer_worker.thread, NULL);
+    }
+    uint64_t elapsed_ns = bench_now_ns() - start;
+    *writes = writer_worker.ops;
+    return ops * 1e9 / elapsed_ns;
+}
+
+int main(void) {
+    bench_remove_db(BENCH_DB);
+    DbOptions options = {0};
+    options.pager.cache_frames = CACHE_FRAMES;
+    db = db_open_with_options(BENCH_DB, &options);
+    if (!db) {
+        fprintf(stderr, "Failed to open %s\n", BENCH_DB);
+        return 1;
+    }
+    unsigned int seed = 5;
+    for (int i = 0; i < NUM_KEYS; i++) {
+        seed = seed * 1103515245u + 12345u;
+        snprintf(keys[i], sizeof(keys[i]), "user:%08u", (seed >> 4) % 100000000u);
+        db_insert(db, keys[i], "value");
+    }
+
+    printf("Random lookups from N threads: %d keys, all pages cached, %ld cores online\n", NUM_KEYS,
+           sysconf(_SC_NPROCESSORS_ONLN));
+    for (int mode = 0; mode < 2; mode++) {
+        bool with_writer = mode == 1;
+        double base = 0;
+        for (int threads = 1; threads <= MAX_THREADS; threads *= 2) {
+            uint64_t writes;
+            double rate = run(threads, with_writer, &writes);
+            if (threads == 1) {
+                base = rate;
+            }
+            printf("%-13s %d thread(s) %10.0f lookups/s  speedup %4.2fx", with_writer ? "with writer" : "readers only",
+                   threads, rate, rate / base);
+            if (with_writer) {
+                printf("  (%llu updates)", (unsigned long long)writes);
+            }
+            printf("\n");
+        }
+    }
+
+    db_close(db);
+    bench_remove_db(BENCH_DB);
+    return 0;
+}
@@ -0,0 +1,168 @@
+/**
+ * Batched lookups: db_multi_get() against db_get() in a loop.
+ *
+ * Looks up batches of random existing keys both ways and reports time and
+ * page requests per key in three settings:
+ *   cached - the whole tree is in the pager cache
+ *   warm   - a small pager cache, the DB file in the OS page cache: misses
+ *            cost a copy, and prefetch hints are pure overhead
+ *   cold   - every batch starts from a fresh open with the file dropped
+ *            from the OS page cache, so misses go to the device and the
+ *            prefetched leaf reads overlap
+ */
+#include "bench_common.h"
+#include "../src/db_core.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_DB "bench_multiget.db"
+#define NUM_KEYS 20000
+#define BATCH 200
+#define BATCHES 500
+#define COLD_BATCHES 20
+#define SMALL_CACHE 64
+
+static char keys[NUM_KEYS][32];
+static char out[BATCH][MAX_VALUE_LEN];
+
+static void build_db(void) {
+    bench_remove_db(BENCH_DB);
+    DbOptions options = {0};
+    options.pager.cache_frames = 4096;
+    Database* db = db_open_with_options(BENCH_DB, &options);
+    char value[32];
+    unsigned int seed = 3;
+    for (int i = 0; i < NUM_KEYS; i++) {
+        seed = seed * 1103515245u + 12345u;
+        snprintf(keys[i], sizeof(keys[i]), "user:%08u", (seed >> 4) % 100000000u);
+        snprintf(value, sizeof(value), "value-%d", i);
+        db_insert(db, keys[i], value);
+    }
+    db_close(db);
+}
+
+static Database* open_db(uint32_t cache_frames) {
+    DbOptions options = {0};
+    options.pager.cache_frames = cache_frames;
+    Database* db = db_open_with_options(BENCH_DB, &options);
+    if (!db) {
+        fprintf(stderr, "Failed to open %s\n", BENCH_DB);
+        exit(1);
+    }
+    return db;
+}
+
+// Batch b: BATCH keys spread over the whole key list
+static void fill_batch(int b, const char** batch) {
+    for (int i = 0; i < BATCH; i++) {
+        batch[i] = keys[((long)b * BATCH + (long)i * 7919) % NUM_KEYS];
+    }
+}
+
+static uint64_t get_loop(Database* db, const char** batch) {
+    uint64_t found = 0;
+    for (int i = 0; i < BATCH; i++) {
+        const char* value = db_get(db, batch[i]);
+        if (value) {
+            strcpy(out[i], value);
+            found++;
+        }
+    }
+    return found;
+}
+
+static uint64_t multi_get(Database* db, const char** batch) {
+    int hits = db_multi_get(db, batch, BATCH, out, NULL);
+    if (hits < 0) {
+        fprintf(stderr, "Multi-get failed\n");
+        exit(1);
+    }
+    return (uint64_t)hits;
+}
+
+static void report(const char* name, int batches, uint64_t loop_ns, uint64_t loop_requests,
+                   uint64_t multi_ns, uint64_t multi_requests, uint64_t found) {
+    double lookups = (double)BATCH * batches;
+    printf("%-7s db_get loop %8.1f ns/key %5.2f pages/key   db_multi_get %8.1f ns/key %5.2f pages/key  [%llu]\n",
+           name, loop_ns / lookups, loop_requests / lookups, multi_ns / lookups, multi_requests / lookups,
+           (unsigned long long)found);
+}
+
+static void run_resident(uint32_t cache_frames, const char* name) {
+    Database* db = open_db(cache_frames);
+    const char* batch[BATCH];
+    PagerStats stats;
+    uint64_t found = 0;
+
+    // Untimed pass so both variants start from the same cache state
+    for (int b = 0; b < BATCHES; b++) {
+        fill_batch(b, batch);
+        found += get_loop(db, batch);
+    }
+
+    pager_reset_stats(db->pager);
+    uint64_t start = bench_now_ns();
+    for (int b = 0; b < BATCHES; b++) {
+        fill_batch(b, batch);
+        found += get_loop(db, batch);
+    }
+    uint64_t loop_ns = bench_now_ns() - start;
+    pager_get_stats(db->pager, &stats);
+    uint64_t loop_requests = stats.hits + stats.misses;
+
+    pager_reset_stats(db->pager);
+    start = bench_now_ns();
+    for (int b = 0; b < BATCHES; b++) {
+        fill_batch(b, batch);
+        found += multi_get(db, batch);
+    }
+    uint64_t multi_ns = bench_now_ns() - start;
+    pager_get_stats(db->pager, &stats);
+
+    report(name, BATCHES, loop_ns, loop_requests, multi_ns, stats.hits + stats.misses, found);
+    db_close(db);
+}
+
+static void run_cold(void) {
+    const char* batch[BATCH];
+    PagerStats stats;
+    uint64_t found = 0;
+    uint64_t loop_ns = 0, loop_requests = 0, multi_ns = 0, multi_requests = 0;
+
+    for (int b = 0; b < COLD_BATCHES; b++) {
+        fill_batch(b, batch);
+
+        if (!bench_drop_os_cache(BENCH_DB)) {
+            printf("cold    (skipped: cannot drop the OS page cache here)\n");
+            return;
+        }
+        Database* db = open_db(SMALL_CACHE);
+        uint64_t start = bench_now_ns();
+        found += get_loop(db, batch);
+        loop_ns += bench_now_ns() - start;
+        pager_get_stats(db->pager, &stats);
+        loop_requests += stats.hits + stats.misses;
+        db_close(db);
+
+        bench_drop_os_cache(BENCH_DB);
+        db = open_db(SMALL_CACHE);
+        start = bench_now_ns();
+        found += multi_get(db, batch);
+        multi_ns += bench_now_ns() - start;
+        pager_get_stats(db->pager, &stats);
+        multi_requests += stats.hits + stats.misses;
+        db_close(db);
+    }
+    report("cold", COLD_BATCHES, loop_ns, loop_requests, multi_ns, multi_requests, found);
+}
+
+int main(void) {
+    build_db();
+    printf("Batches of %d random keys out of %d\n", BATCH, NUM_KEYS);
+    run_resident(4096, "cached");
+    run_resident(SMALL_CACHE, "warm");
+    run_cold();
+    bench_remove_db(BENCH_DB);
+    return 0;
+}
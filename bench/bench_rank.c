@@ -0,0 +1,177 @@
+/**
+ * Range counts and deep pagination: walking the leaves against the
+ * subtree counts of internal nodes.
+ *
+ * Fills a database, then counts the records of random key ranges and
+ * finds the first record of random pages of a full listing, once by
+ * scanning a snapshot (counting, or skipping the records before the page)
+ * and once with db_count and db_seek_rank, which descend the tree by the
+ * counts. Reports time and pages requested per query, and checks that
+ * both ways agree.
+ *
+ * Then the price the writes pay: every insert and delete changes the
+ * count in each internal node on its path, so it latches and logs the
+ * whole path, where an update in place still logs only its leaf. Reports
+ * time and WAL frames per insert, update and delete of keys spread over
+ * the tree.
+ */
+#include "bench_common.h"
+#include "../src/db_core.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_DB "bench_rank.db"
+#define NUM_RECORDS 50000
+#define QUERIES 200
+#define PAGE_RECORDS 20
+#define WRITES 5000
+
+// Scan state: counts records below high, or stops at the skip-th one
+typedef struct {
+    const char *high;
+    uint64_t skip;
+    uint64_t seen;
+    char key[MAX_KEY_LEN];
+} ScanState;
+
+static int count_below(const char *key, const char *value, void *arg) {
+    (void)value;
+    ScanState *state = arg;
+    if (strcmp(key, state->high) >= 0) {
+        return 1;
+    }
+    state->seen++;
+    return 0;
+}
+
+static int stop_at_rank(const char *key, const char *value, void *arg) {
+    (void)value;
+    ScanState *state = arg;
+    if (state->seen++ == state->skip) {
+        snprintf(state->key, sizeof(state->key), "%s", key);
+        return 1;
+    }
+    return 0;
+}
+
+static void make_key(uint32_t i, char *key) {
+    snprintf(key, MAX_KEY_LEN, "order:%08u", i);
+}
+
+int main(void) {
+    bench_remove_db(BENCH_DB);
+    DbOptions options = {0};
+    options.pager.cache_frames = 16384;
+    Database *db = db_open_with_options(BENCH_DB, &options);
+    if (!db) {
+        fprintf(stderr, "Failed to open %s\n", BENCH_DB);
+        return 1;
+    }
+    char key[MAX_KEY_LEN];
+    char value[MAX_VALUE_LEN];
+    for (uint32_t i = 0; i < NUM_RECORDS; i++) {
+        make_key(i * 7919u % NUM_RECORDS, key);
+        db_insert(db, key, "v");
+    }
+    printf("Counts and ranks: %d records, %d queries, pages of %d records\n", NUM_RECORDS, QUERIES, PAGE_RECORDS);
+
+    uint32_t lows[QUERIES];
+    uint32_t highs[QUERIES];
+    uint64_t scan_counts[QUERIES];
+    unsigned int seed = 11;
+    for (int i = 0; i < QUERIES; i++) {
+        seed = seed * 1103515245u + 12345u;
+        uint32_t a = (seed >> 8) % NUM_RECORDS;
+        seed = seed * 1103515245u + 12345u;
+        uint32_t b = (seed >> 8) % NUM_RECORDS;
+        lows[i] = a < b ? a : b;
+        highs[i] = a < b ? b : a;
+    }
+
+    PagerStats stats;
+    char low[MAX_KEY_LEN];
+    char high[MAX_KEY_LEN];
+    pager_reset_stats(db->pager);
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < QUERIES; i++) {
+        make_key(lows[i], low);
+        make_key(highs[i], high);
+        ScanState state = { high, 0, 0, "" };
+        DbSnapshot snapshot;
+        db_snapshot(db, &snapshot);
+        db_snapshot_scan(&snapshot, low, count_below, &state);
+        db_snapshot_release(&snapshot);
+        scan_counts[i] = state.seen;
+    }
+    double scan_ns = (double)(bench_now_ns() - start) / QUERIES;
+    pager_get_stats(db->pager, &stats);
+    double scan_pages = (double)(stats.hits + stats.misses) / QUERIES;
+
+    bool agree = true;
+    pager_reset_stats(db->pager);
+    start = bench_now_ns();
+    for (int i = 0; i < QUERIES; i++) {
+        make_key(lows[i], low);
+        make_key(highs[i], high);
+        agree &= db_count(db, low, high) == (int64_t)scan_counts[i];
+    }
+    double count_ns = (double)(bench_now_ns() - start) / QUERIES;
+    pager_get_stats(db->pager, &stats);
+    printf("count  %10.1f us by scan  %8.1f pages   %8.2f us by db_count  %5.1f pages\n", scan_ns / 1000.0,
+           scan_pages, count_ns / 1000.0, (double)(stats.hits + stats.misses) / QUERIES);
+
+    char scan_keys[QUERIES][MAX_KEY_LEN];
+    pager_reset_stats(db->pager);
+    start = bench_now_ns();
+    for (int i = 0; i < QUERIES; i++) {
+        ScanState state = { NULL, (uint64_t)lows[i] / PAGE_RECORDS * PAGE_RECORDS, 0, "" };
+        DbSnapshot snapshot;
+        db_snapshot(db, &snapshot);
+        db_snapshot_scan(&snapshot, NULL, stop_at_rank, &state);
+        db_snapshot_release(&snapshot);
+        memcpy(scan_keys[i], state.key, MAX_KEY_LEN);
+    }
+    scan_ns = (double)(bench_now_ns() - start) / QUERIES;
+    pager_get_stats(db->pager, &stats);
+    scan_pages = (double)(stats.hits + stats.misses) / QUERIES;
+
+    pager_reset_stats(db->pager);
+    start = bench_now_ns();
+    for (int i = 0; i < QUERIES; i++) {
+        uint64_t rank = (uint64_t)lows[i] / PAGE_RECORDS * PAGE_RECORDS;
+        agree &= db_seek_rank(db, rank, key, value, sizeof(value)) >= 0 && strcmp(key, scan_keys[i]) == 0;
+    }
+    double seek_ns = (double)(bench_now_ns() - start) / QUERIES;
+    pager_get_stats(db->pager, &stats);
+    printf("page   %10.1f us by scan  %8.1f pages   %8.2f us by rank      %5.1f pages\n", scan_ns / 1000.0,
+           scan_pages, seek_ns / 1000.0, (double)(stats.hits + stats.misses) / QUERIES);
+    printf("%s\n", agree ? "Both ways agree" : "MISMATCH between scan and counts");
+
+    // New keys fall between existing ones all over the tree
+    const char *write_names[] = { "insert", "update", "delete" };
+    BTreeFillStats fill;
+    btree_fill_stats(db->pager, 0, &fill);
+    printf("Writes: %d of each, tree height %u\n", WRITES, fill.depth);
+    bool written = true;
+    for (int op = 0; op < 3; op++) {
+        uint32_t frames = db->wal->num_frames;
+        start = bench_now_ns();
+        for (uint32_t i = 0; i < WRITES; i++) {
+            snprintf(key, sizeof(key), "order:%08u+", i * 7919u % NUM_RECORDS);
+            int status = op == 0 ? db_insert(db, key, "v") : op == 1 ? db_update(db, key, "w") : db_delete(db, key);
+            written &= status == STATUS_OK;
+        }
+        double write_ns = (double)(bench_now_ns() - start) / WRITES;
+        printf("%-6s %8.1f us  %5.2f WAL frames per write\n", write_names[op], write_ns / 1000.0,
+               (double)(db->wal->num_frames - frames) / WRITES);
+    }
+
+    if (!written) {
+        printf("A write failed\n");
+    }
+
+    db_close(db);
+    bench_remove_db(BENCH_DB);
+    return agree && written ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+/**
+ * Lookups by a field of the value, with and without a secondary index.
+ *
+ * Fills a database whose values hold an email address and a city, then
+ * finds records by email (one match) and by city (one record in a
+ * hundred) through an index on each field, and the same way without one:
+ * a full scan of a snapshot that splits every value. Also reports what the
+ * two indexes add to the cost of an insert.
+ */
+#include "bench_common.h"
+#include "../src/db_core.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_DB "bench_secondary_index.db"
+#define NUM_RECORDS 20000
+#define CITIES 100
+#define EMAIL_LOOKUPS 2000
+#define SCAN_LOOKUPS 20
+
+// Scan filter standing in for an index: field number field of each value
+// is compared with want
+typedef struct {
+    const char *want;
+    uint32_t field;
+    uint64_t matches;
+} FieldFilter;
+
+static int filter_record(const char *key, const char *value, void *arg) {
+    (void)key;
+    FieldFilter *filter = arg;
+    char field[INDEX_FIELD_MAX + 1];
+    if (index_field(value, ',', filter->field, field) && strcmp(field, filter->want) == 0) {
+        filter->matches++;
+    }
+    return 0;
+}
+
+static int count_record(const char *key, const char *value, void *arg) {
+    (void)key;
+    (void)value;
+    (*(uint64_t *)arg)++;
+    return 0;
+}
+
+static void make_value(int i, char *value) {
+    snprintf(value, MAX_VALUE_LEN, "user%d@example.com,city%03d", i, (i * 7919) % CITIES);
+}
+
+// Insert the records; returns ns per insert
+static double fill(Database *db) {
+    char key[MAX_KEY_LEN];
+    char value[MAX_VALUE_LEN];
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < NUM_RECORDS; i++) {
+        snprintf(key, sizeof(key), "id%08d", i);
+        make_value(i, value);
+        db_insert(db, key, value);
+    }
+    return (double)(bench_now_ns() - start) / NUM_RECORDS;
+}
+
+static Database *open_db(void) {
+    bench_remove_db(BENCH_DB);
+    DbOptions options = {0};
+    options.pager.cache_frames = 16384;
+    Database *db = db_open_with_options(BENCH_DB, &options);
+    if (!db) {
+        fprintf(stderr, "Failed to open %s\n", BENCH_DB);
+        exit(1);
+    }
+    return db;
+}
+
+int main(void) {
+    printf("Secondary index: %d records, %d cities\n", NUM_RECORDS, CITIES);
+    Database *db = open_db();
+    double plain_insert_ns = fill(db);
+    db_close(db);
+
+    db = open_db();
+    DbIndexOptions by_email = { NULL, ',', 0 };
+    DbIndexOptions by_city = { NULL, ',', 1 };
+    if (db_create_index(db, "email", &by_email) != STATUS_OK || db_create_index(db, "city", &by_city) != STATUS_OK) {
+        fprintf(stderr, "Failed to create the indexes\n");
+        exit(1);
+    }
+    double indexed_insert_ns = fill(db);
+    printf("insert  %9.1f us without indexes  %9.1f us with two\n", plain_insert_ns / 1000.0,
+           indexed_insert_ns / 1000.0);
+
+    char want[MAX_VALUE_LEN];
+    char found[MAX_KEY_LEN];
+    char value[MAX_VALUE_LEN];
+    unsigned int seed = 5;
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < EMAIL_LOOKUPS; i++) {
+        seed = seed * 1103515245u + 12345u;
+        snprintf(want, sizeof(want), "user%u@example.com", (seed >> 8) % NUM_RECORDS);
+        if (db_get_by_index(db, "email", want, found, value, sizeof(value)) < 0) {
+            fprintf(stderr, "Lookup of %s failed\n", want);
+            exit(1);
+        }
+    }
+    double email_index_ns = (double)(bench_now_ns() - start) / EMAIL_LOOKUPS;
+
+    start = bench_now_ns();
+    for (int i = 0; i < SCAN_LOOKUPS; i++) {
+        seed = seed * 1103515245u + 12345u;
+        snprintf(want, sizeof(want), "user%u@example.com", (seed >> 8) % NUM_RECORDS);
+        FieldFilter filter = { want, 0, 0 };
+        DbSnapshot snapshot;
+        db_snapshot(db, &snapshot);
+        db_snapshot_scan(&snapshot, NULL, filter_record, &filter);
+        db_snapshot_release(&snapshot);
+    }
+    double email_scan_ns = (double)(bench_now_ns() - start) / SCAN_LOOKUPS;
+
+    uint64_t city_matches = 0;
+    start = bench_now_ns();
+    for (int i = 0; i < SCAN_LOOKUPS; i++) {
+        snprintf(want, sizeof(want), "city%03d", i % CITIES);
+        char high[MAX_VALUE_LEN + 1];
+        snprintf(high, sizeof(high), "%s\x01", want); // Just past want
+        db_index_scan(db, "city", want, high, count_record, &city_matches);
+    }
+    double city_index_ns = (double)(bench_now_ns() - start) / SCAN_LOOKUPS;
+
+    start = bench_now_ns();
+    for (int i = 0; i < SCAN_LOOKUPS; i++) {
+        snprintf(want, sizeof(want), "city%03d", i % CITIES);
+        FieldFilter filter = { want, 1, 0 };
+        DbSnapshot snapshot;
+        db_snapshot(db, &snapshot);
+        db_snapshot_scan(&snapshot, NULL, filter_record, &filter);
+        db_snapshot_release(&snapshot);
+    }
+    double city_scan_ns = (double)(bench_now_ns() - start) / SCAN_LOOKUPS;
+
+    printf("email   %9.1f us by index         %9.1f us by scan  (%.0fx)\n", email_index_ns / 1000.0,
+           email_scan_ns / 1000.0, email_scan_ns / email_index_ns);
+    printf("city    %9.1f us by index         %9.1f us by scan  (%.0fx, %llu records per city)\n",
+           city_index_ns / 1000.0, city_scan_ns / 1000.0, city_scan_ns / city_index_ns,
+           (unsigned long long)(city_matches / SCAN_LOOKUPS));
+    db_close(db);
+    bench_remove_db(BENCH_DB);
+    return 0;
+}
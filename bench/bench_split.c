@@ -0,0 +1,93 @@
+/**
+ * Split policy under sequential and random insert orders.
+ *
+ * Inserts the same keys in ascending, random and descending order through
+ * db_insert(), then reports insert time, pages used, how full the leaves
+ * and internal nodes are, and the time of a full scan. Ascending inserts
+ * are what time-ordered keys (sequential ids, timestamps) look like.
+ */
+#include "bench_common.h"
+#include "../src/db_core.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_DB "bench_split.db"
+#define NUM_KEYS 20000
+#define CACHE_FRAMES 4096
+
+typedef enum { ORDER_ASCENDING, ORDER_RANDOM, ORDER_DESCENDING } InsertOrder;
+
+static int order[NUM_KEYS];
+
+static void make_order(InsertOrder kind) {
+    for (int i = 0; i < NUM_KEYS; i++) {
+        order[i] = kind == ORDER_DESCENDING ? NUM_KEYS - 1 - i : i;
+    }
+    if (kind == ORDER_RANDOM) {
+        unsigned int seed = 7;
+        for (int i = NUM_KEYS - 1; i > 0; i--) {
+            seed = seed * 1103515245u + 12345u;
+            int j = (int)((seed >> 8) % (unsigned int)(i + 1));
+            int tmp = order[i];
+            order[i] = order[j];
+            order[j] = tmp;
+        }
+    }
+}
+
+static void run(InsertOrder kind, const char* name) {
+    bench_remove_db(BENCH_DB);
+    DbOptions options = {0};
+    options.pager.cache_frames = CACHE_FRAMES;
+    Database* db = db_open_with_options(BENCH_DB, &options);
+    if (!db) {
+        fprintf(stderr, "Failed to open %s\n", BENCH_DB);
+        exit(1);
+    }
+
+    make_order(kind);
+    char key[32];
+    char value[32];
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < NUM_KEYS; i++) {
+        snprintf(key, sizeof(key), "event:%010d", order[i]);
+        snprintf(value, sizeof(value), "payload-%d", order[i]);
+        if (db_insert(db, key, value) != STATUS_OK) {
+            fprintf(stderr, "Insert failed\n");
+            exit(1);
+        }
+    }
+    uint64_t insert_ns = bench_now_ns() - start;
+
+    start = bench_now_ns();
+    Cursor* cursor = table_start(db->pager, 0);
+    uint64_t rows = 0;
+    while (cursor && !cursor->end_of_table) {
+        rows += cursor_value(cursor) != NULL;
+        cursor_advance(cursor);
+    }
+    free(cursor);
+    uint64_t scan_ns = bench_now_ns() - start;
+
+    BTreeFillStats stats;
+    if (db_fill_stats(db, &stats) != STATUS_OK || rows != NUM_KEYS) {
+        fprintf(stderr, "Tree check failed\n");
+        exit(1);
+    }
+    printf("%-10s %6.2f us/insert  %5u pages (%4.1f MB)  leaves %5.1f%% full  internal %5.1f%% full  scan %6.2f ms\n",
+           name, insert_ns / 1000.0 / NUM_KEYS, db->pager->num_pages,
+           db->pager->num_pages * (double)PAGE_SIZE / (1024 * 1024),
+           100.0 * stats.cells / ((double)stats.leaf_pages * LEAF_NODE_MAX_CELLS),
+           stats.internal_pages ? 100.0 * stats.internal_bytes / ((double)stats.internal_pages * PAGE_USABLE_SIZE) : 0.0,
+           scan_ns / 1e6);
+    db_close(db);
+}
+
+int main(void) {
+    printf("Insert order vs page fill: %d keys\n", NUM_KEYS);
+    run(ORDER_ASCENDING, "ascending");
+    run(ORDER_RANDOM, "random");
+    run(ORDER_DESCENDING, "descending");
+    bench_remove_db(BENCH_DB);
+    return 0;
+}
@@ -12,8 +12,8 @@ else {
     $CFLAGS = "-Wall -Wextra -std=c11 -g -Isrc"
 }
 
-# Use -mconsole on Windows, no special flags on Unix
-$LDFLAGS = if ($IsWindows) { "-mconsole" } else { "" }
+# Use -mconsole on Windows, link the math library on Unix
+$LDFLAGS = if ($IsWindows) { "-mconsole" } else { "-lm" }
 $SRC_DIR = "src"
 $BUILD_DIR = "build"
 $BIN_DIR = "bin"
@@ -99,7 +99,7 @@ function Run-Tests {
     $logFile = "$logDir/test_run_$timestamp.log"
     
     # Compile tests
-    & $CC $CFLAGS.Split() -o $testExe tests/test_main.c tests/test_utility.c tests/test_db.c tests/test_btree_split.c src/utility.c src/db_core.c src/pager.c src/btree.c src/wal.c
+    & $CC $CFLAGS.Split() -o $testExe tests/test_main.c tests/test_utility.c tests/test_db.c tests/test_btree_split.c tests/test_cache.c src/utility.c src/db_core.c src/pager.c src/btree.c src/wal.c src/frame_arena.c src/page_table.c src/pager_policy.c src/crc32c.c src/key_head.c src/latch.c src/page_versions.c src/bloom.c src/hash_index.c src/row_cache.c src/key_type.c src/index_key.c src/analyze.c -lm
     
     if ($LASTEXITCODE -ne 0) { 
         Write-Host "Test compilation failed!" -ForegroundColor Red
@@ -0,0 +1,322 @@
+#include "analyze.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+const uint32_t analyze_key_bucket_max[ANALYZE_KEY_BUCKETS] = { 8, 16, 32, 64, LEAF_NODE_KEY_SIZE - 1 };
+
+// Weighted totals of an analysis: an exact walk adds each page it reads
+// with weight 1, a sampled descent adds what it finds weighted by the
+// product of the fanouts above it
+typedef struct {
+    uint32_t height;
+    double level_pages[BTREE_MAX_DEPTH];
+    double records;
+    double key_bytes;
+    double key_lengths[ANALYZE_KEY_BUCKETS];
+    uint32_t key_min;
+    uint32_t key_max;
+    uint64_t pages_read;
+    uint32_t key_width; // Decoded length of the tree's typed keys, 0 for string keys
+} AnalyzeSums;
+
+static void analyze_sums_init(AnalyzeSums* sums, uint32_t key_width) {
+    memset(sums, 0, sizeof(*sums));
+    sums->key_min = UINT32_MAX;
+    sums->key_width = key_width;
+}
+
+// Length of the keys of a typed tree as its user gives them (the encoded
+// form is longer), from the copy of its root; 0 for string keys
+static uint32_t analyze_key_width(void* root) {
+    uint32_t width;
+    switch (root_node_key_type(root, &width)) {
+    case KEY_TYPE_U64:
+    case KEY_TYPE_I64:
+        return sizeof(uint64_t);
+    case KEY_TYPE_BINARY:
+        return width;
+    default:
+        return 0;
+    }
+}
+
+// Copy a page as the snapshot sees it into words (PAGE_SIZE bytes)
+static void* analyze_read(Pager* pager, uint32_t page_num, uint64_t epoch, uint32_t level, uint64_t* words,
+                          AnalyzeSums* sums) {
+    if (level >= BTREE_MAX_DEPTH) {
+        fprintf(stderr, "Error: Tree deeper than %d levels at page %u\n", BTREE_MAX_DEPTH, page_num);
+        return NULL;
+    }
+    if (pager_read_version(pager, page_num, epoch, PAGER_HINT_USE_ONCE, words) != 0) {
+        fprintf(stderr, "Failed to read page %u in tree_analyze\n", page_num);
+        return NULL;
+    }
+    sums->pages_read++;
+    return words;
+}
+
+static void analyze_add_leaf(AnalyzeSums* sums, void* node, uint32_t level, double weight) {
+    if (level + 1 > sums->height) {
+        sums->height = level + 1;
+    }
+    sums->level_pages[level] += weight;
+    uint32_t num_cells = *leaf_node_num_cells(node);
+    for (uint32_t i = 0; i < num_cells; i++) {
+        const char* key = leaf_node_key(node, i);
+        if (key[0] == ANALYZE_CATALOG_KEY_PREFIX) {
+            continue;
+        }
+        uint32_t length = sums->key_width ? sums->key_width : (uint32_t)strlen(key);
+        sums->records += weight;
+        sums->key_bytes += weight * length;
+        uint32_t bucket = 0;
+        while (bucket < ANALYZE_KEY_BUCKETS - 1 && length > analyze_key_bucket_max[bucket]) {
+            bucket++;
+        }
+        sums->key_lengths[bucket] += weight;
+        if (length < sums->key_min) {
+            sums->key_min = length;
+        }
+        if (length > sums->key_max) {
+            sums->key_max = length;
+        }
+    }
+}
+
+static void analyze_sums_merge(AnalyzeSums* into, const AnalyzeSums* from) {
+    if (from->height > into->height) {
+        into->height = from->height;
+    }
+    for (uint32_t level = 0; level < BTREE_MAX_DEPTH; level++) {
+        into->level_pages[level] += from->level_pages[level];
+    }
+    into->records += from->records;
+    into->key_bytes += from->key_bytes;
+    for (uint32_t i = 0; i < ANALYZE_KEY_BUCKETS; i++) {
+        into->key_lengths[i] += from->key_lengths[i];
+    }
+    if (from->key_min < into->key_min) {
+        into->key_min = from->key_min;
+    }
+    if (from->key_max > into->key_max) {
+        into->key_max = from->key_max;
+    }
+    into->pages_read += from->pages_read;
+}
+
+static uint64_t analyze_round(double total, double divisor) {
+    return (uint64_t)(total / divisor + 0.5);
+}
+
+// The sums divided by the number of descents (1 for an exact walk)
+static void analyze_finish(const AnalyzeSums* sums, double divisor, TreeAnalysis* out) {
+    memset(out, 0, sizeof(*out));
+    out->height = sums->height;
+    for (uint32_t level = 0; level < sums->height; level++) {
+        out->level_pages[level] = analyze_round(sums->level_pages[level], divisor);
+        out->pages += out->level_pages[level];
+    }
+    out->records = analyze_round(sums->records, divisor);
+    out->key_bytes = analyze_round(sums->key_bytes, divisor);
+    for (uint32_t i = 0; i < ANALYZE_KEY_BUCKETS; i++) {
+        out->key_lengths[i] = analyze_round(sums->key_lengths[i], divisor);
+    }
+    out->key_min = sums->key_min == UINT32_MAX ? 0 : sums->key_min;
+    out->key_max = sums->key_max;
+    out->pages_read = sums->pages_read;
+}
+
+// Read the subtree of page_num, which is at level (the root's is 0)
+static int analyze_walk(Pager* pager, uint32_t page_num, uint64_t epoch, uint32_t level, AnalyzeSums* sums) {
+    uint64_t words[PAGE_SIZE / sizeof(uint64_t)];
+    void* node = analyze_read(pager, page_num, epoch, level, words, sums);
+    if (!node) {
+        return -1;
+    }
+    if (get_node_type(node) == NODE_LEAF) {
+        analyze_add_leaf(sums, node, level, 1.0);
+        return 0;
+    }
+    sums->level_pages[level] += 1.0;
+    uint32_t num_keys = *internal_node_num_keys(node);
+    for (uint32_t i = 0; i <= num_keys; i++) {
+        if (analyze_walk(pager, *internal_node_child(node, i), epoch, level + 1, sums) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Children of the root, handed out one subtree at a time
+typedef struct {
+    Pager* pager;
+    uint64_t epoch;
+    uint32_t children[INTERNAL_NODE_MAX_CELLS + 1];
+    uint32_t num_children;
+    _Atomic uint32_t next;
+    _Atomic bool failed;
+} AnalyzeShared;
+
+typedef struct {
+    AnalyzeShared* shared;
+    AnalyzeSums sums; // This worker's, merged once all are done
+#ifndef _WIN32
+    pthread_t thread;
+#endif
+} AnalyzeWorker;
+
+static void* analyze_worker(void* arg) {
+    AnalyzeWorker* worker = arg;
+    AnalyzeShared* shared = worker->shared;
+    for (;;) {
+        uint32_t i = atomic_fetch_add(&shared->next, 1);
+        if (i >= shared->num_children || atomic_load(&shared->failed)) {
+            break;
+        }
+        if (analyze_walk(shared->pager, shared->children[i], shared->epoch, 1, &worker->sums) != 0) {
+            atomic_store(&shared->failed, true);
+        }
+    }
+    return NULL;
+}
+
+int tree_analyze(Pager* pager, uint32_t root_page_num, uint64_t epoch, uint32_t threads, TreeAnalysis* out) {
+    AnalyzeSums sums;
+    analyze_sums_init(&sums, 0);
+    uint64_t words[PAGE_SIZE / sizeof(uint64_t)];
+    void* root = analyze_read(pager, root_page_num, epoch, 0, words, &sums);
+    if (!root) {
+        return -1;
+    }
+    sums.key_width = analyze_key_width(root);
+    if (get_node_type(root) == NODE_LEAF) {
+        analyze_add_leaf(&sums, root, 0, 1.0);
+        analyze_finish(&sums, 1.0, out);
+        return 0;
+    }
+    sums.level_pages[0] += 1.0;
+    uint32_t num_keys = *internal_node_num_keys(root);
+    if (num_keys > INTERNAL_NODE_MAX_CELLS) {
+        fprintf(stderr, "Error: Root page %u holds %u keys\n", root_page_num, num_keys);
+        return -1;
+    }
+
+    AnalyzeShared* shared = malloc(sizeof(AnalyzeShared));
+    if (!shared) {
+        fprintf(stderr, "Error: Failed to allocate analysis state\n");
+        return -1;
+    }
+    shared->pager = pager;
+    shared->epoch = epoch;
+    shared->num_children = num_keys + 1;
+    for (uint32_t i = 0; i <= num_keys; i++) {
+        shared->children[i] = *internal_node_child(root, i);
+    }
+    atomic_init(&shared->next, 0);
+    atomic_init(&shared->failed, false);
+#ifdef _WIN32
+    threads = 1;
+#endif
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (threads > shared->num_children) {
+        threads = shared->num_children;
+    }
+    AnalyzeWorker* workers = calloc(threads, sizeof(AnalyzeWorker));
+    if (!workers) {
+        free(shared);
+        fprintf(stderr, "Error: Failed to allocate analysis workers\n");
+        return -1;
+    }
+    for (uint32_t t = 0; t < threads; t++) {
+        workers[t].shared = shared;
+        analyze_sums_init(&workers[t].sums, sums.key_width);
+    }
+    // The calling thread is worker 0; subtrees a thread failed to start
+    // for are taken by the others
+    uint32_t started = 1;
+#ifndef _WIN32
+    while (started < threads && pthread_create(&workers[started].thread, NULL, analyze_worker, &workers[started]) == 0) {
+        started++;
+    }
+#endif
+    analyze_worker(&workers[0]);
+    for (uint32_t t = 0; t < started; t++) {
+#ifndef _WIN32
+        if (t > 0) {
+            pthread_join(workers[t].thread, NULL);
+        }
+#endif
+        analyze_sums_merge(&sums, &workers[t].sums);
+    }
+    bool failed = atomic_load(&shared->failed);
+    free(workers);
+    free(shared);
+    if (failed) {
+        return -1;
+    }
+    analyze_finish(&sums, 1.0, out);
+    return 0;
+}
+
+// xorshift64*: plenty for picking children
+static uint64_t analyze_random(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 2685821657736338717ULL;
+}
+
+int tree_analyze_sampled(Pager* pager, uint32_t root_page_num, uint64_t epoch, uint32_t samples, uint64_t seed,
+                         TreeAnalysis* out) {
+    if (samples < 1) {
+        samples = 1;
+    }
+    AnalyzeSums sums;
+    analyze_sums_init(&sums, 0);
+    uint64_t root_words[PAGE_SIZE / sizeof(uint64_t)];
+    uint64_t words[PAGE_SIZE / sizeof(uint64_t)];
+    void* root = analyze_read(pager, root_page_num, epoch, 0, root_words, &sums);
+    if (!root) {
+        return -1;
+    }
+    sums.key_width = analyze_key_width(root);
+    uint64_t state = seed != 0 ? seed : 0x9E3779B97F4A7C15ULL;
+    for (uint32_t s = 0; s < samples; s++) {
+        // Each descent starts from the copy of the root read once
+        void* node = root;
+        double weight = 1.0;
+        for (uint32_t level = 0;; level++) {
+            if (get_node_type(node) == NODE_LEAF) {
+                analyze_add_leaf(&sums, node, level, weight);
+                break;
+            }
+            sums.level_pages[level] += weight;
+            uint32_t fanout = *internal_node_num_keys(node) + 1;
+            uint32_t child = *internal_node_child(node, (uint32_t)(analyze_random(&state) % fanout));
+            weight *= fanout;
+            node = analyze_read(pager, child, epoch, level + 1, words, &sums);
+            if (!node) {
+                return -1;
+            }
+        }
+    }
+    analyze_finish(&sums, (double)samples, out);
+    return 0;
+}
+
+double tree_analysis_leaf_fill(const TreeAnalysis* analysis) {
+    if (analysis->height == 0 || analysis->level_pages[analysis->height - 1] == 0) {
+        return 0.0;
+    }
+    return (double)analysis->records / ((double)analysis->level_pages[analysis->height - 1] * LEAF_NODE_MAX_CELLS);
+}
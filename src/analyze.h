@@ -0,0 +1,75 @@
+#ifndef ANALYZE_H
+#define ANALYZE_H
+
+#include <stdint.h>
+#include "pager.h"
+#include "btree.h"
+
+/**
+ * Tree shape statistics for capacity planning.
+ *
+ * A tree is analyzed as one snapshot sees it (pages are copied with
+ * pager_read_version), so the writer goes on while it is walked.
+ *   exact   - every page is read; the subtrees of the root's children are
+ *             shared out among worker threads
+ *   sampled - random descents from the root to a leaf. Each descent
+ *             weighs what it finds by the product of the fanouts it passed
+ *             (Knuth's estimator), so the mean over descents estimates the
+ *             pages of each level and the records and key sizes of all
+ *             leaves. Cost grows with the number of descents and the
+ *             height, not with the size of the tree.
+ * Records and key sizes are those of user records: cells whose key starts
+ * with ANALYZE_CATALOG_KEY_PREFIX (the catalog and metadata records of the
+ * default tree) are left out, and typed keys count at their decoded length
+ * (8 bytes for integers, the width for binary keys), not their encoding.
+ */
+
+// First byte of catalog keys (DB_CATALOG_KEY_PREFIX), which no user key has
+#define ANALYZE_CATALOG_KEY_PREFIX '\x01'
+
+
+// Key length histogram buckets: lengths up to 8, 16, 32, 64 and 127 bytes
+#define ANALYZE_KEY_BUCKETS 5
+
+// Upper bound of each key length bucket
+extern const uint32_t analyze_key_bucket_max[ANALYZE_KEY_BUCKETS];
+
+// Shape of one tree, from tree_analyze or tree_analyze_sampled (estimates
+// for the latter)
+typedef struct {
+    uint32_t height;                      // Levels, leaves included
+    uint64_t level_pages[BTREE_MAX_DEPTH]; // Pages per level, root first
+    uint64_t pages;                       // All levels
+    uint64_t records;                     // User records in leaves, expired ones included
+    uint64_t key_bytes;                   // Total decoded length of their keys
+    uint64_t key_lengths[ANALYZE_KEY_BUCKETS]; // Keys per length bucket
+    uint32_t key_min;                     // Shortest and longest key seen
+    uint32_t key_max;
+    uint64_t pages_read;                  // Cost of the analysis
+} TreeAnalysis;
+
+/**
+ * Read every page of a tree as of a snapshot.
+ * @param epoch Snapshot epoch from page_versions_acquire
+ * @param threads Worker threads (1 or 0: the calling thread only; on
+ *                Windows always the calling thread)
+ * @return 0 on success, -1 if a page could not be read
+ */
+int tree_analyze(Pager* pager, uint32_t root_page_num, uint64_t epoch, uint32_t threads, TreeAnalysis* out);
+
+/**
+ * Estimate the shape of a tree from random root-to-leaf descents.
+ * @param samples Descents to make (at least 1)
+ * @param seed Seed of the choice of children
+ * @return 0 on success, -1 if a page could not be read
+ */
+int tree_analyze_sampled(Pager* pager, uint32_t root_page_num, uint64_t epoch, uint32_t samples, uint64_t seed,
+                         TreeAnalysis* out);
+
+/**
+ * Average leaf fill: records / (leaf pages * LEAF_NODE_MAX_CELLS), 0 for
+ * an empty analysis.
+ */
+double tree_analysis_leaf_fill(const TreeAnalysis* analysis);
+
+#endif // ANALYZE_H
@@ -0,0 +1,176 @@
+#include "bloom.h"
+#include "crc32c.h"
+#include "key_head.h" // For key_hash
+#include "utility.h" // For MAX_FILENAME_LEN
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+static BloomFilter* bloom_alloc(uint32_t num_blocks, uint32_t num_hashes, uint64_t capacity) {
+    BloomFilter* filter = calloc(1, sizeof(BloomFilter));
+    if (!filter) {
+        fprintf(stderr, "Failed to allocate Bloom filter\n");
+        return NULL;
+    }
+    filter->words = calloc((size_t)num_blocks * BLOOM_BLOCK_WORDS, sizeof(uint64_t));
+    if (!filter->words) {
+        fprintf(stderr, "Failed to allocate Bloom filter bits\n");
+        free(filter);
+        return NULL;
+    }
+    filter->num_blocks = num_blocks;
+    filter->num_hashes = num_hashes;
+    filter->capacity = capacity;
+    return filter;
+}
+
+BloomFilter* bloom_create(uint64_t capacity, uint32_t bits_per_key) {
+    if (bits_per_key == 0) {
+        bits_per_key = 1;
+    }
+    uint64_t bits = (capacity > 0 ? capacity : 1) * bits_per_key;
+    uint64_t num_blocks = (bits + BLOOM_BLOCK_BITS - 1) / BLOOM_BLOCK_BITS;
+    if (num_blocks > UINT32_MAX) {
+        fprintf(stderr, "Bloom filter for %llu keys is too large\n", (unsigned long long)capacity);
+        return NULL;
+    }
+    // k = bits per key * ln 2 minimizes the false positive rate
+    uint32_t num_hashes = (bits_per_key * 693u + 500u) / 1000u;
+    if (num_hashes < 1) {
+        num_hashes = 1;
+    } else if (num_hashes > BLOOM_MAX_HASHES) {
+        num_hashes = BLOOM_MAX_HASHES;
+    }
+    return bloom_alloc((uint32_t)num_blocks, num_hashes, capacity);
+}
+
+void bloom_destroy(BloomFilter* filter) {
+    while (filter) {
+        BloomFilter* replaced = filter->replaced;
+        free(filter->words);
+        free(filter);
+        filter = replaced;
+    }
+}
+
+// The block of a key and the seed of its bit positions inside it
+static _Atomic uint64_t* bloom_block(const BloomFilter* filter, uint64_t hash) {
+    uint32_t block = (uint32_t)(((hash >> 32) * filter->num_blocks) >> 32);
+    return filter->words + (size_t)block * BLOOM_BLOCK_WORDS;
+}
+
+void bloom_add(BloomFilter* filter, const void* key, size_t len) {
+    uint64_t hash = key_hash(key, len);
+    _Atomic uint64_t* block = bloom_block(filter, hash);
+    uint32_t position = (uint32_t)hash;
+    uint32_t step = (position >> 17) | (position << 15) | 1;
+    for (uint32_t i = 0; i < filter->num_hashes; i++) {
+        uint32_t bit = position % BLOOM_BLOCK_BITS;
+        atomic_fetch_or_explicit(&block[bit / 64], 1ull << (bit % 64), memory_order_relaxed);
+        position += step;
+    }
+    filter->keys++;
+}
+
+bool bloom_may_contain(const BloomFilter* filter, const void* key, size_t len) {
+    uint64_t hash = key_hash(key, len);
+    _Atomic uint64_t* block = bloom_block(filter, hash);
+    uint32_t position = (uint32_t)hash;
+    uint32_t step = (position >> 17) | (position << 15) | 1;
+    for (uint32_t i = 0; i < filter->num_hashes; i++) {
+        uint32_t bit = position % BLOOM_BLOCK_BITS;
+        if (!(atomic_load_explicit(&block[bit / 64], memory_order_relaxed) & (1ull << (bit % 64)))) {
+            return false;
+        }
+        position += step;
+    }
+    return true;
+}
+
+void bloom_assign(BloomFilter* filter, const BloomFilter* from) {
+    size_t num_words = (size_t)filter->num_blocks * BLOOM_BLOCK_WORDS;
+    for (size_t i = 0; i < num_words; i++) {
+        atomic_store_explicit(&filter->words[i], atomic_load_explicit(&from->words[i], memory_order_relaxed),
+                              memory_order_relaxed);
+    }
+    filter->keys = from->keys;
+}
+
+size_t bloom_memory(const BloomFilter* filter) {
+    return (size_t)filter->num_blocks * BLOOM_BLOCK_WORDS * sizeof(uint64_t);
+}
+
+double bloom_expected_fp_rate(const BloomFilter* filter) {
+    double bits = (double)filter->num_blocks * BLOOM_BLOCK_BITS;
+    double k = filter->num_hashes;
+    return pow(1.0 - exp(-k * (double)filter->keys / bits), k);
+}
+
+int bloom_save(const BloomFilter* filter, const char* path, uint32_t tag) {
+    char tmp_path[MAX_FILENAME_LEN + 16];
+    int written = snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    if (written < 0 || written >= (int)sizeof(tmp_path)) {
+        fprintf(stderr, "Bloom filter filename too long\n");
+        return -1;
+    }
+    FILE* file = fopen(tmp_path, "wb");
+    if (!file) {
+        fprintf(stderr, "Failed to create Bloom filter file '%s': %d\n", tmp_path, errno);
+        return -1;
+    }
+    size_t num_words = (size_t)filter->num_blocks * BLOOM_BLOCK_WORDS;
+    BloomFileHeader header = {
+        .magic = BLOOM_MAGIC,
+        .num_blocks = filter->num_blocks,
+        .num_hashes = filter->num_hashes,
+        .tag = tag,
+        .capacity = filter->capacity,
+        .keys = filter->keys,
+        .checksum = crc32c(0, (const void*)filter->words, num_words * sizeof(uint64_t)),
+    };
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite((const void*)filter->words, sizeof(uint64_t), num_words, file) == num_words;
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) {
+        fprintf(stderr, "Failed to write Bloom filter file '%s'\n", tmp_path);
+        remove(tmp_path);
+        return -1;
+    }
+#ifdef _WIN32
+    remove(path); // rename() does not replace existing files on Windows
+#endif
+    if (rename(tmp_path, path) != 0) {
+        fprintf(stderr, "Failed to replace Bloom filter file '%s': %d\n", path, errno);
+        remove(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+BloomFilter* bloom_load(const char* path, uint32_t tag) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+    BloomFileHeader header;
+    BloomFilter* filter = NULL;
+    if (fread(&header, sizeof(header), 1, file) == 1 && header.magic == BLOOM_MAGIC && header.tag == tag &&
+        header.num_blocks > 0 && header.num_hashes >= 1 && header.num_hashes <= BLOOM_MAX_HASHES) {
+        filter = bloom_alloc(header.num_blocks, header.num_hashes, header.capacity);
+    }
+    if (filter) {
+        size_t num_words = (size_t)filter->num_blocks * BLOOM_BLOCK_WORDS;
+        if (fread((void*)filter->words, sizeof(uint64_t), num_words, file) != num_words ||
+            crc32c(0, (const void*)filter->words, num_words * sizeof(uint64_t)) != header.checksum) {
+            fprintf(stderr, "Warning: Ignoring damaged Bloom filter file '%s'\n", path);
+            bloom_destroy(filter);
+            filter = NULL;
+        } else {
+            filter->keys = header.keys;
+        }
+    }
+    fclose(file);
+    return filter;
+}
@@ -0,0 +1,103 @@
+#ifndef BLOOM_H
+#define BLOOM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/**
+ * Bloom filter over keys, for answering "certainly absent" without
+ * touching the tree. Blocked: all the bits of one key fall in a single
+ * 64-byte block, so a check costs one cache miss however many hash
+ * functions there are, for a slightly higher false positive rate than a
+ * plain filter of the same size.
+ * Keys are added one at a time and only dropped in bulk (bloom_assign).
+ * One thread may add while any number check:
+ * bits are set with atomic ORs, so a check after bloom_add returns sees
+ * the key.
+ */
+
+#define BLOOM_BLOCK_BITS 512
+#define BLOOM_BLOCK_WORDS (BLOOM_BLOCK_BITS / 64)
+#define BLOOM_MAX_HASHES 16
+
+// Saved filter file: BloomFileHeader, then the blocks
+#define BLOOM_MAGIC 0x4D4C424Fu // "OBLM"
+
+typedef struct BloomFilter {
+    _Atomic uint64_t* words; // num_blocks * BLOOM_BLOCK_WORDS
+    uint32_t num_blocks;
+    uint32_t num_hashes;
+    uint64_t capacity; // Keys the filter was sized for
+    uint64_t keys;     // Keys added (with repeats), by the adding thread
+    // The filter this one replaced. Checks may still be reading it, so it
+    // lives until this one is destroyed.
+    struct BloomFilter* replaced;
+} BloomFilter;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t num_blocks;
+    uint32_t num_hashes;
+    uint32_t tag;      // Caller's check that the file belongs to its data
+    uint64_t capacity;
+    uint64_t keys;
+    uint32_t checksum; // CRC32C of the blocks
+    uint32_t reserved;
+} BloomFileHeader;
+
+/**
+ * Create an empty filter for capacity keys at bits_per_key bits each
+ * (rounded up to whole blocks).
+ * @return The filter, or NULL on allocation failure
+ */
+BloomFilter* bloom_create(uint64_t capacity, uint32_t bits_per_key);
+
+/**
+ * Free a filter and every filter it replaced.
+ */
+void bloom_destroy(BloomFilter* filter);
+
+void bloom_add(BloomFilter* filter, const void* key, size_t len);
+
+/**
+ * @return false if key was certainly never added, true if it may have been
+ */
+bool bloom_may_contain(const BloomFilter* filter, const void* key, size_t len);
+
+/**
+ * Overwrite the bits of filter with those of from, a filter of the same
+ * size and hashes, one word at a time. Safe next to checks when every key
+ * of from was added to filter too (a rebuild without deleted keys): each
+ * word then holds either its old bits or a subset of them that still
+ * covers every key of from.
+ */
+void bloom_assign(BloomFilter* filter, const BloomFilter* from);
+
+/**
+ * Bytes of bit array.
+ */
+size_t bloom_memory(const BloomFilter* filter);
+
+/**
+ * False positive rate expected from the fill: (1 - e^(-k n / m))^k for k
+ * hashes, n keys and m bits.
+ */
+double bloom_expected_fp_rate(const BloomFilter* filter);
+
+/**
+ * Write the filter to path (through a temporary file and a rename).
+ * @param tag Stored with the filter; bloom_load only accepts the same tag
+ * @return 0 on success, -1 on error
+ */
+int bloom_save(const BloomFilter* filter, const char* path, uint32_t tag);
+
+/**
+ * Read a filter written by bloom_save.
+ * @return The filter, or NULL if the file is missing, damaged or has
+ *         another tag
+ */
+BloomFilter* bloom_load(const char* path, uint32_t tag);
+
+#endif // BLOOM_H
@@ -2,21 +2,33 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 
 // Forward declarations
 Cursor* leaf_node_find(Pager* pager, uint32_t page_num, const char* key);
-void leaf_node_split_and_insert(Cursor* cursor, const char* key, const char* value);
-void create_new_root(Pager* pager, uint32_t right_child_page_num);
-void internal_node_insert(Pager* pager, uint32_t parent_page_num, uint32_t child_page_num, const char* key);
-void internal_node_split_and_insert(Pager* pager, uint32_t parent_page_num, uint32_t child_page_num, const char* key);
+int leaf_node_find_into(Pager* pager, uint32_t page_num, const char* key, Cursor* cursor);
+void leaf_node_split_and_insert(Cursor* cursor, const char* key, const char* value, uint64_t expires_at);
+void create_new_root(Pager* pager, uint32_t root_page_num, uint32_t right_child_page_num);
+void internal_node_insert(Pager* pager, const uint32_t* path, uint32_t depth, uint32_t left_count,
+                          uint32_t child_page_num, uint32_t child_count, const char* key, uint32_t key_len,
+                          bool append);
+static void leaf_node_insert_cell(Cursor* cursor, const char* key, const char* value, uint64_t expires_at);
 
 // Helper functions to access node fields
 uint32_t* leaf_node_num_cells(void* node) {
     return (uint32_t*)(node + LEAF_NODE_NUM_CELLS_OFFSET);
 }
 
+uint32_t* leaf_node_next_leaf(void* node) {
+    return (uint32_t*)(node + LEAF_NODE_NEXT_LEAF_OFFSET);
+}
+
+uint32_t* leaf_node_heads(void* node) {
+    return (uint32_t*)(node + LEAF_NODE_HEADS_OFFSET);
+}
+
 void* leaf_node_cell(void* node, uint32_t cell_num) {
-    return node + LEAF_NODE_HEADER_SIZE + cell_num * LEAF_NODE_CELL_SIZE;
+    return node + LEAF_NODE_CELLS_OFFSET + cell_num * LEAF_NODE_CELL_SIZE;
 }
 
 char* leaf_node_key(void* node, uint32_t cell_num) {
@@ -27,6 +39,15 @@ char* leaf_node_value(void* node, uint32_t cell_num) {
     return leaf_node_cell(node, cell_num) + LEAF_NODE_KEY_SIZE;
 }
 
+uint64_t* leaf_node_expiry(void* node, uint32_t cell_num) {
+    return (uint64_t*)(node + LEAF_NODE_EXPIRY_OFFSET) + cell_num;
+}
+
+bool leaf_node_expired(void* node, uint32_t cell_num) {
+    uint64_t expires_at = *leaf_node_expiry(node, cell_num);
+    return expires_at != 0 && expires_at <= (uint64_t)time(NULL);
+}
+
 NodeType get_node_type(void* node) {
     uint8_t value = *((uint8_t*)(node + NODE_TYPE_OFFSET));
     return (NodeType)value;
@@ -47,15 +68,38 @@ void set_node_root(void* node, bool is_root) {
     *((uint8_t*)(node + IS_ROOT_OFFSET)) = value;
 }
 
-uint32_t* node_parent(void* node) {
-    return (uint32_t*)(node + PARENT_POINTER_OFFSET);
+static void clear_node_reserved(void* node) {
+    memset(node + NODE_RESERVED_OFFSET, 0, NODE_RESERVED_SIZE);
+}
+
+KeyType root_node_key_type(void* root, uint32_t* width) {
+    *width = *((uint8_t*)(root + ROOT_KEY_WIDTH_OFFSET));
+    uint8_t type = *((uint8_t*)(root + ROOT_KEY_TYPE_OFFSET));
+    return (KeyType)type;
+}
+
+void set_root_node_key_type(void* root, KeyType type, uint32_t width) {
+    *((uint8_t*)(root + ROOT_KEY_TYPE_OFFSET)) = (uint8_t)type;
+    *((uint8_t*)(root + ROOT_KEY_WIDTH_OFFSET)) = (uint8_t)width;
+}
+
+uint16_t root_node_format(void* root) {
+    uint16_t format;
+    memcpy(&format, (uint8_t*)root + ROOT_FORMAT_OFFSET, sizeof(format));
+    return format;
+}
+
+void set_root_node_format(void* root, uint16_t format) {
+    memcpy((uint8_t*)root + ROOT_FORMAT_OFFSET, &format, sizeof(format));
 }
 
 void leaf_node_init(void* node) {
     set_node_type(node, NODE_LEAF);
     set_node_root(node, false);
     *leaf_node_num_cells(node) = 0;
-    *node_parent(node) = 0;
+    *leaf_node_next_leaf(node) = 0; // 0 = rightmost leaf (page 0 is always the root)
+    clear_node_reserved(node);
+    memset(leaf_node_expiry(node, 0), 0, LEAF_NODE_MAX_CELLS * LEAF_NODE_EXPIRY_SIZE);
 }
 
 uint32_t* internal_node_num_keys(void* node) {
@@ -66,8 +110,52 @@ uint32_t* internal_node_right_child(void* node) {
     return (uint32_t*)(node + INTERNAL_NODE_RIGHT_CHILD_OFFSET);
 }
 
+static uint32_t* internal_node_right_count(void* node) {
+    return (uint32_t*)(node + INTERNAL_NODE_RIGHT_COUNT_OFFSET);
+}
+
+uint16_t* internal_node_prefix_len(void* node) {
+    return (uint16_t*)(node + INTERNAL_NODE_PREFIX_LEN_OFFSET);
+}
+
+uint16_t* internal_node_heap_start(void* node) {
+    return (uint16_t*)(node + INTERNAL_NODE_HEAP_START_OFFSET);
+}
+
+// The prefix shared by every separator in the node
+uint8_t* internal_node_prefix(void* node) {
+    return (uint8_t*)node + PAGE_USABLE_SIZE - *internal_node_prefix_len(node);
+}
+
+// Heads of the separator suffixes, one per key
+static uint32_t* internal_node_heads(void* node) {
+    return (uint32_t*)(node + INTERNAL_NODE_HEADER_SIZE);
+}
+
+// Slot layout: child page (4), subtree count (4), separator offset (2),
+// separator length (2).
+// The slot array starts after the head array, so its position depends on num_keys.
 uint32_t* internal_node_cell(void* node, uint32_t cell_num) {
-    return (uint32_t*)(node + INTERNAL_NODE_HEADER_SIZE + cell_num * INTERNAL_NODE_CELL_SIZE);
+    uint32_t num_keys = *internal_node_num_keys(node);
+    return (uint32_t*)(node + INTERNAL_NODE_HEADER_SIZE + num_keys * KEY_HEAD_SIZE +
+                       cell_num * INTERNAL_NODE_SLOT_SIZE);
+}
+
+static uint32_t* internal_node_count(void* node, uint32_t cell_num) {
+    return internal_node_cell(node, cell_num) + 1;
+}
+
+static uint16_t* internal_node_suffix_offset(void* node, uint32_t cell_num) {
+    return (uint16_t*)((uint8_t*)internal_node_cell(node, cell_num) + INTERNAL_NODE_SLOT_SUFFIX_OFFSET);
+}
+
+static uint16_t* internal_node_suffix_len(void* node, uint32_t cell_num) {
+    return internal_node_suffix_offset(node, cell_num) + 1;
+}
+
+// Separator bytes following the node prefix
+static uint8_t* internal_node_suffix(void* node, uint32_t cell_num) {
+    return (uint8_t*)node + *internal_node_suffix_offset(node, cell_num);
 }
 
 /**
@@ -87,15 +175,185 @@ uint32_t* internal_node_child(void* node, uint32_t child_num) {
     return internal_node_cell(node, child_num);
 }
 
-char* internal_node_key(void* node, uint32_t key_num) {
-    return (char*)((void*)internal_node_cell(node, key_num) + INTERNAL_NODE_CHILD_SIZE);
+uint32_t* internal_node_child_count(void* node, uint32_t child_num) {
+    uint32_t num_keys = *internal_node_num_keys(node);
+    if (child_num > num_keys) {
+        fprintf(stderr, "Tried to access count of child_num %d > num_keys %d\n", child_num, num_keys);
+        abort();
+    }
+    if (child_num == num_keys) {
+        return internal_node_right_count(node);
+    }
+    return internal_node_count(node, child_num);
+}
+
+// Records under the children [0, end) of an internal node
+static uint64_t internal_node_count_below(void* node, uint32_t end) {
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < end; i++) {
+        total += *internal_node_child_count(node, i);
+    }
+    return total;
+}
+
+uint32_t internal_node_key_copy(void* node, uint32_t key_num, char* out) {
+    uint32_t prefix_len = *internal_node_prefix_len(node);
+    uint32_t suffix_len = *internal_node_suffix_len(node, key_num);
+    memcpy(out, internal_node_prefix(node), prefix_len);
+    memcpy(out + prefix_len, internal_node_suffix(node, key_num), suffix_len);
+    out[prefix_len + suffix_len] = '\0';
+    return prefix_len + suffix_len;
+}
+
+// memcmp order, a proper prefix sorting first (the order strcmp gives keys)
+static int separator_compare(const uint8_t* a, uint32_t a_len, const uint8_t* b, uint32_t b_len) {
+    int cmp = memcmp(a, b, a_len < b_len ? a_len : b_len);
+    if (cmp != 0) {
+        return cmp;
+    }
+    return (a_len > b_len) - (a_len < b_len);
+}
+
+uint32_t internal_node_find_child(void* node, const char* key) {
+    uint32_t num_keys = *internal_node_num_keys(node);
+    uint32_t key_len = (uint32_t)strlen(key);
+    uint32_t prefix_len = *internal_node_prefix_len(node);
+
+    // Every separator starts with the node prefix, so compare it only once
+    int cmp = memcmp(key, internal_node_prefix(node), key_len < prefix_len ? key_len : prefix_len);
+    if (cmp < 0 || (cmp == 0 && key_len < prefix_len)) {
+        return 0;
+    }
+    if (cmp > 0) {
+        return num_keys;
+    }
+
+    const uint8_t* rest = (const uint8_t*)key + prefix_len;
+    uint32_t rest_len = key_len - prefix_len;
+    // Separators whose head differs from the key's are ordered by the head
+    // alone; only those sharing it need a full comparison
+    uint32_t min_index;
+    uint32_t max_index;
+    key_head_range(internal_node_heads(node), num_keys, key_head(rest, rest_len), &min_index, &max_index);
+    while (min_index != max_index) {
+        uint32_t index = (min_index + max_index) / 2;
+        cmp = separator_compare(rest, rest_len, internal_node_suffix(node, index),
+                                *internal_node_suffix_len(node, index));
+        if (cmp >= 0) {
+            min_index = index + 1;
+        } else {
+            max_index = index;
+        }
+    }
+    return min_index;
+}
+
+// A separator being laid out into a node: the bytes of head followed by
+// those of tail. This lets a node be rebuilt straight from its old image
+// (node prefix + stored suffix) plus one new key, without decoding.
+typedef struct {
+    uint32_t child; // Child left of the separator
+    uint32_t count; // Records in its subtree
+    const uint8_t* head;
+    uint32_t head_len;
+    const uint8_t* tail;
+    uint32_t tail_len;
+} Separator;
+
+static uint32_t separator_len(const Separator* sep) {
+    return sep->head_len + sep->tail_len;
+}
+
+static uint8_t separator_byte(const Separator* sep, uint32_t i) {
+    return i < sep->head_len ? sep->head[i] : sep->tail[i - sep->head_len];
+}
+
+// Copy bytes [from, from + len) of a separator to dest
+static void separator_copy(const Separator* sep, uint32_t from, uint32_t len, uint8_t* dest) {
+    for (uint32_t i = 0; i < len; i++) {
+        dest[i] = separator_byte(sep, from + i);
+    }
+}
+
+// Read the separators of an internal node; seps must hold num_keys entries
+static uint32_t internal_node_separators(void* node, Separator* seps) {
+    uint32_t num_keys = *internal_node_num_keys(node);
+    const uint8_t* prefix = internal_node_prefix(node);
+    uint32_t prefix_len = *internal_node_prefix_len(node);
+    for (uint32_t i = 0; i < num_keys; i++) {
+        seps[i].child = *internal_node_cell(node, i);
+        seps[i].count = *internal_node_count(node, i);
+        seps[i].head = prefix;
+        seps[i].head_len = prefix_len;
+        seps[i].tail = internal_node_suffix(node, i);
+        seps[i].tail_len = *internal_node_suffix_len(node, i);
+    }
+    return num_keys;
+}
+
+/**
+ * Lay out sorted separators and the rightmost child (with right_count
+ * records) into node, replacing its contents but keeping its common header
+ * (root flag, parent).
+ * @return false, leaving node untouched, if they do not fit in one page
+ */
+static bool internal_node_encode(void* node, const Separator* seps, uint32_t num_keys, uint32_t right_child,
+                                 uint32_t right_count) {
+    // Sorted, so the prefix common to all is the one shared by the first and last
+    uint32_t prefix_len = 0;
+    if (num_keys > 1) {
+        uint32_t first_len = separator_len(&seps[0]);
+        uint32_t last_len = separator_len(&seps[num_keys - 1]);
+        while (prefix_len < first_len && prefix_len < last_len &&
+               separator_byte(&seps[0], prefix_len) == separator_byte(&seps[num_keys - 1], prefix_len)) {
+            prefix_len++;
+        }
+    }
+
+    uint32_t size = INTERNAL_NODE_HEADER_SIZE + num_keys * (KEY_HEAD_SIZE + INTERNAL_NODE_SLOT_SIZE) + prefix_len;
+    for (uint32_t i = 0; i < num_keys; i++) {
+        size += separator_len(&seps[i]) - prefix_len;
+    }
+    if (size > PAGE_USABLE_SIZE) {
+        return false;
+    }
+
+    // Build the new image aside: seps may point into node
+    uint8_t image[PAGE_USABLE_SIZE];
+    memset(image, 0, sizeof(image));
+    memcpy(image, node, COMMON_NODE_HEADER_SIZE);
+    set_node_type(image, NODE_INTERNAL);
+    *internal_node_num_keys(image) = num_keys;
+    *internal_node_right_child(image) = right_child;
+    *internal_node_right_count(image) = right_count;
+    *internal_node_prefix_len(image) = (uint16_t)prefix_len;
+    uint32_t heap = PAGE_USABLE_SIZE - prefix_len;
+    if (num_keys > 0) {
+        separator_copy(&seps[0], 0, prefix_len, image + heap);
+    }
+    for (uint32_t i = 0; i < num_keys; i++) {
+        uint32_t suffix_len = separator_len(&seps[i]) - prefix_len;
+        heap -= suffix_len;
+        separator_copy(&seps[i], prefix_len, suffix_len, image + heap);
+        internal_node_heads(image)[i] = key_head(image + heap, suffix_len);
+        *internal_node_cell(image, i) = seps[i].child;
+        *internal_node_count(image, i) = seps[i].count;
+        *internal_node_suffix_offset(image, i) = (uint16_t)heap;
+        *internal_node_suffix_len(image, i) = (uint16_t)suffix_len;
+    }
+    *internal_node_heap_start(image) = (uint16_t)heap;
+    memcpy(node, image, PAGE_USABLE_SIZE);
+    return true;
 }
 
 void internal_node_init(void* node) {
     set_node_type(node, NODE_INTERNAL);
     set_node_root(node, false);
     *internal_node_num_keys(node) = 0;
-    *node_parent(node) = 0;
+    *internal_node_right_count(node) = 0;
+    *internal_node_prefix_len(node) = 0;
+    *internal_node_heap_start(node) = PAGE_USABLE_SIZE;
+    clear_node_reserved(node);
 }
 
 // Cursor operations
@@ -108,73 +366,550 @@ Cursor* table_start(Pager* pager, uint32_t root_page_num) {
     cursor->pager = pager;
     cursor->page_num = root_page_num;
     cursor->cell_num = 0;
+    cursor->use_once = true;
+    cursor->path_depth = 0;
     
-    void* root_node = pager_get_page(pager, root_page_num);
-    if (!root_node) {
-        fprintf(stderr, "Failed to get root page in table_start\n");
+    // Descend along the leftmost children to the first leaf
+    void* node = pager_get_page(pager, root_page_num);
+    while (node && get_node_type(node) == NODE_INTERNAL && cursor->path_depth < BTREE_MAX_DEPTH) {
+        cursor->path[cursor->path_depth++] = cursor->page_num;
+        cursor->page_num = *internal_node_child(node, 0);
+        node = pager_get_page(pager, cursor->page_num);
+    }
+    if (!node || get_node_type(node) != NODE_LEAF) {
+        fprintf(stderr, "Failed to reach the first leaf in table_start\n");
         free(cursor);
         return NULL;
     }
-    uint32_t num_cells = *leaf_node_num_cells(root_node);
+
+    // Skip leaves emptied by deletes
+    while (*leaf_node_num_cells(node) == 0 && *leaf_node_next_leaf(node) != 0) {
+        cursor->page_num = *leaf_node_next_leaf(node);
+        node = pager_get_page_hint(pager, cursor->page_num, PAGER_HINT_USE_ONCE);
+        if (!node) {
+            fprintf(stderr, "Failed to get page %d in table_start\n", cursor->page_num);
+            free(cursor);
+            return NULL;
+        }
+    }
+    uint32_t num_cells = *leaf_node_num_cells(node);
     cursor->end_of_table = (num_cells == 0);
     
     return cursor;
 }
 
 Cursor* table_find(Pager* pager, uint32_t root_page_num, const char* key) {
-    void* root_node = pager_get_page(pager, root_page_num);
-    if (!root_node) {
-        fprintf(stderr, "Failed to get root page in table_find\n");
+    Cursor* cursor = malloc(sizeof(Cursor));
+    if (!cursor) {
+        fprintf(stderr, "Failed to allocate memory for cursor\n");
         return NULL;
     }
-    
-    if (get_node_type(root_node) == NODE_LEAF) {
-        return leaf_node_find(pager, root_page_num, key);
-    } else {
-        // Internal node search
-        uint32_t num_keys = *internal_node_num_keys(root_node);
-        uint32_t min_index = 0;
-        uint32_t max_index = num_keys;
-        
-        while (min_index != max_index) {
-            uint32_t index = (min_index + max_index) / 2;
-            char* key_at_index = internal_node_key(root_node, index);
-            int cmp = strcmp(key, key_at_index);
-            
-            if (cmp >= 0) {
-                min_index = index + 1;
+    if (table_find_into(pager, root_page_num, key, cursor) != 0) {
+        free(cursor);
+        return NULL;
+    }
+    return cursor;
+}
+
+int table_find_into(Pager* pager, uint32_t root_page_num, const char* key, Cursor* cursor) {
+    uint32_t page_num = root_page_num;
+    cursor->path_depth = 0;
+    void* node = pager_get_page(pager, page_num);
+    while (node && get_node_type(node) == NODE_INTERNAL) {
+        if (cursor->path_depth == BTREE_MAX_DEPTH) {
+            fprintf(stderr, "Error: Tree deeper than %d levels in table_find\n", BTREE_MAX_DEPTH);
+            return -1;
+        }
+        cursor->path[cursor->path_depth++] = page_num;
+        page_num = *internal_node_child(node, internal_node_find_child(node, key));
+        node = pager_get_page(pager, page_num);
+    }
+    if (!node) {
+        fprintf(stderr, "Failed to get page %d in table_find\n", page_num);
+        return -1;
+    }
+    return leaf_node_find_into(pager, page_num, key, cursor);
+}
+
+int table_find_leaves(Pager* pager, uint32_t root_page_num, const char* const* keys, uint32_t count,
+                      uint32_t* leaf_pages) {
+    // The pages on the path to the previous key, root first, with the
+    // exclusive upper bound of the keys each one covers
+    uint32_t pages[BTREE_MAX_DEPTH + 1];
+    char bounds[BTREE_MAX_DEPTH + 1][INTERNAL_NODE_KEY_SIZE];
+    bool bounded[BTREE_MAX_DEPTH + 1];
+    uint32_t valid = 0;      // Levels of the path whose range holds the current key
+    uint32_t leaf_level = 0; // Level of the leaves, once leaf_level_known
+    bool leaf_level_known = false;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (i > 0 && strcmp(keys[i], keys[i - 1]) < 0) {
+            fprintf(stderr, "Error: Keys passed to table_find_leaves are not sorted\n");
+            return -1;
+        }
+        // Keys ascend, so only the upper bounds can exclude them: climb until
+        // the subtree holds the key
+        while (valid > 1 && bounded[valid - 1] && strcmp(keys[i], bounds[valid - 1]) >= 0) {
+            valid--;
+        }
+        if (valid == 0) {
+            pages[0] = root_page_num;
+            bounded[0] = false;
+            valid = 1;
+        }
+        // Descend to the leaf level. Leaves themselves are not read here
+        // once their level is known, so the caller can prefetch them.
+        pager_scope_begin(pager);
+        while (!leaf_level_known || valid - 1 < leaf_level) {
+            uint32_t level = valid - 1;
+            uint32_t frame;
+            void* node = pager_latch_page(pager, pages[level], PAGER_LATCH_SHARED, &frame);
+            if (!node) {
+                fprintf(stderr, "Failed to get page %d in table_find_leaves\n", pages[level]);
+                pager_scope_end(pager);
+                return -1;
+            }
+            if (get_node_type(node) == NODE_LEAF) {
+                pager_unlatch_frame(pager, frame, PAGER_LATCH_SHARED);
+                leaf_level = level;
+                leaf_level_known = true;
+                break;
+            }
+            if (valid == BTREE_MAX_DEPTH + 1) {
+                fprintf(stderr, "Error: Tree deeper than %d levels in table_find_leaves\n", BTREE_MAX_DEPTH);
+                pager_unlatch_frame(pager, frame, PAGER_LATCH_SHARED);
+                pager_scope_end(pager);
+                return -1;
+            }
+            uint32_t child_num = internal_node_find_child(node, keys[i]);
+            pages[valid] = *internal_node_child(node, child_num);
+            if (child_num < *internal_node_num_keys(node)) {
+                internal_node_key_copy(node, child_num, bounds[valid]);
+                bounded[valid] = true;
             } else {
-                max_index = index;
+                // The rightmost child ends where its parent does
+                memcpy(bounds[valid], bounds[level], INTERNAL_NODE_KEY_SIZE);
+                bounded[valid] = bounded[level];
             }
+            pager_unlatch_frame(pager, frame, PAGER_LATCH_SHARED);
+            valid++;
         }
-        
-        uint32_t child_num = min_index;
-        uint32_t child_page_num = *internal_node_child(root_node, child_num);
-        
-        return table_find(pager, child_page_num, key);
+        pager_scope_end(pager);
+        leaf_pages[i] = pages[valid - 1];
     }
+    return 0;
 }
 
-// Find key in a leaf node
-Cursor* leaf_node_find(Pager* pager, uint32_t page_num, const char* key) {
-    void* node = pager_get_page(pager, page_num);
+int table_find_latched(Pager* pager, uint32_t root_page_num, const char* key, Cursor* cursor,
+                       uint32_t* leaf_frame) {
+    uint32_t page_num = root_page_num;
+    uint32_t frame;
+    cursor->path_depth = 0;
+    void* node = pager_latch_page(pager, page_num, PAGER_LATCH_SHARED, &frame);
+    while (node && get_node_type(node) == NODE_INTERNAL) {
+        if (cursor->path_depth == BTREE_MAX_DEPTH) {
+            fprintf(stderr, "Error: Tree deeper than %d levels in table_find\n", BTREE_MAX_DEPTH);
+            pager_unlatch_frame(pager, frame, PAGER_LATCH_SHARED);
+            return -1;
+        }
+        cursor->path[cursor->path_depth++] = page_num;
+        page_num = *internal_node_child(node, internal_node_find_child(node, key));
+        // Latch the child before letting go of the parent
+        uint32_t child_frame;
+        void* child = pager_latch_page(pager, page_num, PAGER_LATCH_SHARED, &child_frame);
+        pager_unlatch_frame(pager, frame, PAGER_LATCH_SHARED);
+        node = child;
+        frame = child_frame;
+    }
     if (!node) {
-        fprintf(stderr, "Failed to get page %d in leaf_node_find\n", page_num);
-        return NULL;
+        fprintf(stderr, "Failed to get page %d in table_find\n", page_num);
+        return -1;
     }
-    uint32_t num_cells = *leaf_node_num_cells(node);
-    
+    cursor->pager = pager;
+    cursor->page_num = page_num;
+    cursor->end_of_table = false;
+    cursor->use_once = false;
+    cursor->cell_num = leaf_node_find_cell(node, key);
+    *leaf_frame = frame;
+    return 0;
+}
+
+int64_t table_rank_latched(Pager* pager, uint32_t root_page_num, const char* key) {
+    uint32_t page_num = root_page_num;
+    uint32_t frame;
+    uint32_t depth = 0;
+    uint64_t rank = 0;
+    void* node = pager_latch_page(pager, page_num, PAGER_LATCH_SHARED, &frame);
+    while (node && get_node_type(node) == NODE_INTERNAL) {
+        if (++depth > BTREE_MAX_DEPTH) {
+            fprintf(stderr, "Error: Tree deeper than %d levels in table_rank\n", BTREE_MAX_DEPTH);
+            pager_unlatch_frame(pager, frame, PAGER_LATCH_SHARED);
+            return -1;
+        }
+        // Every child left of the one key descends to sorts below it
+        uint32_t child_num = key ? internal_node_find_child(node, key) : *internal_node_num_keys(node) + 1;
+        rank += internal_node_count_below(node, child_num);
+        if (!key) {
+            pager_unlatch_frame(pager, frame, PAGER_LATCH_SHARED);
+            return (int64_t)rank;
+        }
+        page_num = *internal_node_child(node, child_num);
+        uint32_t child_frame;
+        void* child = pager_latch_page(pager, page_num, PAGER_LATCH_SHARED, &child_frame);
+        pager_unlatch_frame(pager, frame, PAGER_LATCH_SHARED);
+        node = child;
+        frame = child_frame;
+    }
+    if (!node) {
+        fprintf(stderr, "Failed to get page %d in table_rank\n", page_num);
+        return -1;
+    }
+    rank += key ? leaf_node_find_cell(node, key) : *leaf_node_num_cells(node);
+    pager_unlatch_frame(pager, frame, PAGER_LATCH_SHARED);
+    return (int64_t)rank;
+}
+
+int table_seek_rank_latched(Pager* pager, uint32_t root_page_num, uint64_t rank, Cursor* cursor,
+                            uint32_t* leaf_frame) {
+    uint32_t page_num = root_page_num;
+    uint32_t frame;
+    cursor->path_depth = 0;
+    void* node = pager_latch_page(pager, page_num, PAGER_LATCH_SHARED, &frame);
+    while (node && get_node_type(node) == NODE_INTERNAL) {
+        if (cursor->path_depth == BTREE_MAX_DEPTH) {
+            fprintf(stderr, "Error: Tree deeper than %d levels in table_seek_rank\n", BTREE_MAX_DEPTH);
+            pager_unlatch_frame(pager, frame, PAGER_LATCH_SHARED);
+            return -1;
+        }
+        cursor->path[cursor->path_depth++] = page_num;
+        // Skip whole subtrees until the one holding the rank
+        uint32_t num_keys = *internal_node_num_keys(node);
+        uint32_t child_num = 0;
+        while (child_num <= num_keys && rank >= *internal_node_child_count(node, child_num)) {
+            rank -= *internal_node_child_count(node, child_num);
+            child_num++;
+        }
+        if (child_num > num_keys) {
+            pager_unlatch_frame(pager, frame, PAGER_LATCH_SHARED);
+            return 0;
+        }
+        page_num = *internal_node_child(node, child_num);
+        uint32_t child_frame;
+        void* child = pager_latch_page(pager, page_num, PAGER_LATCH_SHARED, &child_frame);
+        pager_unlatch_frame(pager, frame, PAGER_LATCH_SHARED);
+        node = child;
+        frame = child_frame;
+    }
+    if (!node) {
+        fprintf(stderr, "Failed to get page %d in table_seek_rank\n", page_num);
+        return -1;
+    }
+    if (rank >= *leaf_node_num_cells(node)) {
+        pager_unlatch_frame(pager, frame, PAGER_LATCH_SHARED);
+        return 0;
+    }
+    cursor->pager = pager;
+    cursor->page_num = page_num;
+    cursor->end_of_table = false;
+    cursor->use_once = false;
+    cursor->cell_num = (uint32_t)rank;
+    *leaf_frame = frame;
+    return 1;
+}
+
+int table_get_optimistic(Pager* pager, uint32_t root_page_num, const char* key, char* buf, size_t cap,
+                         size_t* length, uint32_t* leaf_page, uint32_t* leaf_cell, uint64_t* expires_at) {
+    // Nodes are searched in private copies: a validated copy is consistent
+    // even if the page changes right after
+    uint64_t copy_words[PAGE_SIZE / sizeof(uint64_t)];
+    void* copy = copy_words;
+
+    for (uint32_t attempt = 0; attempt < BTREE_OPTIMISTIC_RETRIES; attempt++) {
+        const void* node;
+        uint32_t frame;
+        uint64_t version;
+        uint32_t page_num = root_page_num;
+        int status = pager_optimistic_begin(pager, page_num, &node, &frame, &version);
+        uint32_t depth = 0;
+        while (status == 0) {
+            memcpy(copy, node, PAGE_SIZE);
+            if (!pager_optimistic_validate(pager, frame, version)) {
+                status = 1;
+                break;
+            }
+            if (get_node_type(copy) == NODE_LEAF) {
+                uint32_t cell_num = leaf_node_find_cell(copy, key);
+                if (cell_num >= *leaf_node_num_cells(copy) || strcmp(key, leaf_node_key(copy, cell_num)) != 0 ||
+                    leaf_node_expired(copy, cell_num)) {
+                    return 0;
+                }
+                if (expires_at) {
+                    *expires_at = *leaf_node_expiry(copy, cell_num);
+                }
+                const char* value = leaf_node_value(copy, cell_num);
+                *length = strlen(value);
+                if (cap > 0) {
+                    size_t copied = *length < cap ? *length : cap - 1;
+                    memcpy(buf, value, copied);
+                    buf[copied] = '\0';
+                }
+                if (leaf_page) {
+                    *leaf_page = page_num;
+                    *leaf_cell = cell_num;
+                }
+                return 1;
+            }
+            if (++depth > BTREE_MAX_DEPTH) {
+                return -1;
+            }
+            uint32_t child_page = *internal_node_child(copy, internal_node_find_child(copy, key));
+            const void* child;
+            uint32_t child_frame;
+            uint64_t child_version;
+            status = pager_optimistic_begin(pager, child_page, &child, &child_frame, &child_version);
+            // The parent unchanged since its copy: the child is still the
+            // right one and no split of it has begun
+            if (status == 0 && !pager_optimistic_validate(pager, frame, version)) {
+                status = 1;
+            }
+            node = child;
+            frame = child_frame;
+            version = child_version;
+            page_num = child_page;
+        }
+        if (status < 0) {
+            return -1; // Not cached: the caller loads it
+        }
+    }
+    return -1;
+}
+
+int leaf_node_get_optimistic(Pager* pager, uint32_t page_num, uint32_t cell_num, const char* key, char* buf,
+                             size_t cap, size_t* length, uint64_t* expires_at) {
+    if (cell_num >= LEAF_NODE_MAX_CELLS) {
+        return 0;
+    }
+    // Only the header and the one cell with its expiry time are copied, at
+    // their page offsets
+    uint64_t copy_words[PAGE_SIZE / sizeof(uint64_t)];
+    void* copy = copy_words;
+    for (uint32_t attempt = 0; attempt < BTREE_OPTIMISTIC_RETRIES; attempt++) {
+        const void* node;
+        uint32_t frame;
+        uint64_t version;
+        if (pager_optimistic_begin(pager, page_num, &node, &frame, &version) != 0) {
+            return -1;
+        }
+        memcpy(copy, node, LEAF_NODE_HEADER_SIZE);
+        memcpy(leaf_node_cell(copy, cell_num), (const char*)node + LEAF_NODE_CELLS_OFFSET +
+               cell_num * LEAF_NODE_CELL_SIZE, LEAF_NODE_CELL_SIZE);
+        memcpy(leaf_node_expiry(copy, cell_num), (const char*)node + LEAF_NODE_EXPIRY_OFFSET +
+               cell_num * LEAF_NODE_EXPIRY_SIZE, LEAF_NODE_EXPIRY_SIZE);
+        if (!pager_optimistic_validate(pager, frame, version)) {
+            continue;
+        }
+        // Terminated in case the cell was never written as a record
+        leaf_node_key(copy, cell_num)[LEAF_NODE_KEY_SIZE - 1] = '\0';
+        leaf_node_value(copy, cell_num)[LEAF_NODE_VALUE_SIZE - 1] = '\0';
+        if (get_node_type(copy) != NODE_LEAF || cell_num >= *leaf_node_num_cells(copy) ||
+            strcmp(key, leaf_node_key(copy, cell_num)) != 0 || leaf_node_expired(copy, cell_num)) {
+            return 0;
+        }
+        if (expires_at) {
+            *expires_at = *leaf_node_expiry(copy, cell_num);
+        }
+        const char* value = leaf_node_value(copy, cell_num);
+        *length = strlen(value);
+        if (cap > 0) {
+            size_t copied = *length < cap ? *length : cap - 1;
+            memcpy(buf, value, copied);
+            buf[copied] = '\0';
+        }
+        return 1;
+    }
+    return -1;
+}
+
+// Copy the leaf a snapshot reads for key into node
+static int leaf_node_read_version(Pager* pager, uint32_t root_page_num, uint64_t epoch, const char* key,
+                                  PagerHint hint, void* node) {
+    uint32_t page_num = root_page_num;
+    for (uint32_t depth = 0;; depth++) {
+        if (depth > BTREE_MAX_DEPTH) {
+            fprintf(stderr, "Error: Tree deeper than %d levels in snapshot read\n", BTREE_MAX_DEPTH);
+            return -1;
+        }
+        if (pager_read_version(pager, page_num, epoch, depth == 0 ? PAGER_HINT_NORMAL : hint, node) != 0) {
+            return -1;
+        }
+        if (get_node_type(node) == NODE_LEAF) {
+            return 0;
+        }
+        page_num = *internal_node_child(node, internal_node_find_child(node, key));
+    }
+}
+
+int table_get_version(Pager* pager, uint32_t root_page_num, uint64_t epoch, const char* key, char* buf,
+                      size_t cap, size_t* length) {
+    uint64_t copy_words[PAGE_SIZE / sizeof(uint64_t)];
+    void* node = copy_words;
+    if (leaf_node_read_version(pager, root_page_num, epoch, key, PAGER_HINT_NORMAL, node) != 0) {
+        return -1;
+    }
+    uint32_t cell_num = leaf_node_find_cell(node, key);
+    if (cell_num >= *leaf_node_num_cells(node) || strcmp(key, leaf_node_key(node, cell_num)) != 0 ||
+        leaf_node_expired(node, cell_num)) {
+        return 0;
+    }
+    const char* value = leaf_node_value(node, cell_num);
+    *length = strlen(value);
+    if (cap > 0) {
+        size_t copied = *length < cap ? *length : cap - 1;
+        memcpy(buf, value, copied);
+        buf[copied] = '\0';
+    }
+    return 1;
+}
+
+int64_t table_scan_version(Pager* pager, uint32_t root_page_num, uint64_t epoch, const char* start,
+                           BTreeScanFn fn, void* arg) {
+    uint64_t copy_words[PAGE_SIZE / sizeof(uint64_t)];
+    void* node = copy_words;
+    if (!start) {
+        start = "";
+    }
+    if (leaf_node_read_version(pager, root_page_num, epoch, start, PAGER_HINT_USE_ONCE, node) != 0) {
+        return -1;
+    }
+    // The leaf chain of the snapshot is consistent: follow it to the end
+    int64_t visited = 0;
+    uint32_t cell_num = leaf_node_find_cell(node, start);
+    for (;;) {
+        uint32_t num_cells = *leaf_node_num_cells(node);
+        for (; cell_num < num_cells; cell_num++) {
+            if (leaf_node_expired(node, cell_num)) {
+                continue;
+            }
+            visited++;
+            if (fn(leaf_node_key(node, cell_num), leaf_node_value(node, cell_num), arg) != 0) {
+                return visited;
+            }
+        }
+        uint32_t next_page = *leaf_node_next_leaf(node);
+        if (next_page == 0) {
+            return visited;
+        }
+        if (pager_read_version(pager, next_page, epoch, PAGER_HINT_USE_ONCE, node) != 0) {
+            return -1;
+        }
+        cell_num = 0;
+    }
+}
+
+void* leaf_node_seek_latched(Pager* pager, void* node, uint32_t* page_num, uint32_t* frame,
+                             const char* key, uint32_t* cell_num) {
+    uint32_t depth = 0;
+    while (get_node_type(node) == NODE_INTERNAL) {
+        if (++depth > BTREE_MAX_DEPTH) {
+            fprintf(stderr, "Error: Tree deeper than %d levels in leaf_node_seek_latched\n", BTREE_MAX_DEPTH);
+            pager_unlatch_frame(pager, *frame, PAGER_LATCH_SHARED);
+            return NULL;
+        }
+        uint32_t child_page = *internal_node_child(node, internal_node_find_child(node, key));
+        uint32_t child_frame;
+        void* child = pager_latch_page(pager, child_page, PAGER_LATCH_SHARED, &child_frame);
+        pager_unlatch_frame(pager, *frame, PAGER_LATCH_SHARED);
+        pager_scope_unpin(pager, *frame);
+        if (!child) {
+            return NULL;
+        }
+        node = child;
+        *page_num = child_page;
+        *frame = child_frame;
+    }
+
+    for (;;) {
+        uint32_t num_cells = *leaf_node_num_cells(node);
+        *cell_num = leaf_node_find_cell(node, key);
+        uint32_t next_page = *leaf_node_next_leaf(node);
+        if (*cell_num < num_cells || next_page == 0) {
+            return node;
+        }
+        // Past the last key: the key may have moved to a right sibling
+        uint32_t next_frame;
+        void* next = pager_latch_page(pager, next_page, PAGER_LATCH_SHARED, &next_frame);
+        if (!next) {
+            pager_unlatch_frame(pager, *frame, PAGER_LATCH_SHARED);
+            return NULL;
+        }
+        if (*leaf_node_num_cells(next) > 0 && strcmp(key, leaf_node_key(next, 0)) < 0) {
+            pager_unlatch_frame(pager, next_frame, PAGER_LATCH_SHARED);
+            return node;
+        }
+        pager_unlatch_frame(pager, *frame, PAGER_LATCH_SHARED);
+        pager_scope_unpin(pager, *frame);
+        node = next;
+        *page_num = next_page;
+        *frame = next_frame;
+    }
+}
+
+int btree_latch_path(Pager* pager, const Cursor* cursor, uint32_t* frames) {
+    int count = 0;
+    for (uint32_t i = 0; i <= cursor->path_depth; i++) {
+        uint32_t page_num = i < cursor->path_depth ? cursor->path[i] : cursor->page_num;
+        if (!pager_latch_page(pager, page_num, PAGER_LATCH_EXCLUSIVE, &frames[count])) {
+            btree_unlatch_all(pager, frames, count);
+            return -1;
+        }
+        count++;
+    }
+    return count;
+}
+
+void btree_unlatch_all(Pager* pager, const uint32_t* frames, int count) {
+    for (int i = count; i-- > 0;) {
+        pager_unlatch_frame(pager, frames[i], PAGER_LATCH_EXCLUSIVE);
+    }
+}
+
+// Find key in a leaf node
+Cursor* leaf_node_find(Pager* pager, uint32_t page_num, const char* key) {
     Cursor* cursor = malloc(sizeof(Cursor));
     if (!cursor) {
         fprintf(stderr, "Failed to allocate memory for cursor\n");
         return NULL;
     }
+    if (leaf_node_find_into(pager, page_num, key, cursor) != 0) {
+        free(cursor);
+        return NULL;
+    }
+    return cursor;
+}
+
+// Position cursor within one leaf; the cursor's path is left as it is
+int leaf_node_find_into(Pager* pager, uint32_t page_num, const char* key, Cursor* cursor) {
+    void* node = pager_get_page(pager, page_num);
+    if (!node) {
+        fprintf(stderr, "Failed to get page %d in leaf_node_find\n", page_num);
+        return -1;
+    }
     cursor->pager = pager;
     cursor->page_num = page_num;
+    cursor->end_of_table = false;
+    cursor->use_once = false;
+    cursor->cell_num = leaf_node_find_cell(node, key);
+    return 0;
+}
+
+uint32_t leaf_node_find_cell(void* node, const char* key) {
+    uint32_t num_cells = *leaf_node_num_cells(node);
     
-    // Binary search
-    uint32_t min_index = 0;
-    uint32_t max_index = num_cells;
+    // Narrow the search with the key heads, then binary search the cells
+    // sharing the key's head
+    uint32_t min_index;
+    uint32_t max_index;
+    key_head_range(leaf_node_heads(node), num_cells, key_head(key, LEAF_NODE_KEY_SIZE), &min_index, &max_index);
     
     while (min_index != max_index) {
         uint32_t index = (min_index + max_index) / 2;
@@ -182,8 +917,7 @@ Cursor* leaf_node_find(Pager* pager, uint32_t page_num, const char* key) {
         int cmp = strcmp(key, key_at_index);
         
         if (cmp == 0) {
-            cursor->cell_num = index;
-            return cursor;
+            return index;
         }
         if (cmp < 0) {
             max_index = index;
@@ -191,13 +925,50 @@ Cursor* leaf_node_find(Pager* pager, uint32_t page_num, const char* key) {
             min_index = index + 1;
         }
     }
-    
-    cursor->cell_num = min_index;
-    return cursor;
+    return min_index;
 }
 
 void leaf_node_insert(Cursor* cursor, const char* key, const char* value) {
-    void* node = pager_get_page(cursor->pager, cursor->page_num);
+    leaf_node_insert_expiring(cursor, key, value, 0);
+}
+
+// Add delta to the subtree count of the cursor's leaf in its parent, and
+// of each ancestor in its own parent, up to the root. Flushes the nodes.
+static int btree_add_to_counts(Pager* pager, const Cursor* cursor, int32_t delta) {
+    for (uint32_t i = cursor->path_depth; i-- > 0;) {
+        uint32_t child = i + 1 < cursor->path_depth ? cursor->path[i + 1] : cursor->page_num;
+        void* node = pager_get_page_for_write(pager, cursor->path[i]);
+        if (!node) {
+            fprintf(stderr, "Failed to get page %d in btree_add_to_counts\n", cursor->path[i]);
+            return -1;
+        }
+        uint32_t num_keys = *internal_node_num_keys(node);
+        uint32_t child_num = 0;
+        while (child_num <= num_keys && *internal_node_child(node, child_num) != child) {
+            child_num++;
+        }
+        if (child_num > num_keys) {
+            fprintf(stderr, "Error: Page %d is not a child of page %d on the path\n", child, cursor->path[i]);
+            return -1;
+        }
+        *internal_node_child_count(node, child_num) += (uint32_t)delta;
+        pager_flush(pager, cursor->path[i]);
+    }
+    return 0;
+}
+
+void leaf_node_insert_expiring(Cursor* cursor, const char* key, const char* value, uint64_t expires_at) {
+    // Counted before a split, which then sets the counts of the halves
+    if (btree_add_to_counts(cursor->pager, cursor, 1) != 0) {
+        return;
+    }
+    leaf_node_insert_cell(cursor, key, value, expires_at);
+}
+
+// Insert into the cursor's leaf, splitting it if full, without touching
+// the counts of the ancestors
+static void leaf_node_insert_cell(Cursor* cursor, const char* key, const char* value, uint64_t expires_at) {
+    void* node = pager_get_page_for_write(cursor->pager, cursor->page_num);
     if (!node) {
         fprintf(stderr, "Failed to get page %d in leaf_node_insert\n", cursor->page_num);
         return;
@@ -205,7 +976,7 @@ void leaf_node_insert(Cursor* cursor, const char* key, const char* value) {
     uint32_t num_cells = *leaf_node_num_cells(node);
     
     if (num_cells >= LEAF_NODE_MAX_CELLS) {
-        leaf_node_split_and_insert(cursor, key, value);
+        leaf_node_split_and_insert(cursor, key, value, expires_at);
         return;
     }
     
@@ -214,6 +985,11 @@ void leaf_node_insert(Cursor* cursor, const char* key, const char* value) {
         for (uint32_t i = num_cells; i > cursor->cell_num; i--) {
             memcpy(leaf_node_cell(node, i), leaf_node_cell(node, i - 1), LEAF_NODE_CELL_SIZE);
         }
+        uint32_t* heads = leaf_node_heads(node);
+        memmove(&heads[cursor->cell_num + 1], &heads[cursor->cell_num],
+                (num_cells - cursor->cell_num) * KEY_HEAD_SIZE);
+        memmove(leaf_node_expiry(node, cursor->cell_num + 1), leaf_node_expiry(node, cursor->cell_num),
+                (num_cells - cursor->cell_num) * LEAF_NODE_EXPIRY_SIZE);
     }
     
     *(leaf_node_num_cells(node)) += 1;
@@ -223,127 +999,301 @@ void leaf_node_insert(Cursor* cursor, const char* key, const char* value) {
     
     strncpy(key_at, key, LEAF_NODE_KEY_SIZE - 1);
     key_at[LEAF_NODE_KEY_SIZE - 1] = '\0';
+    leaf_node_heads(node)[cursor->cell_num] = key_head(key_at, LEAF_NODE_KEY_SIZE);
     
     strncpy(value_at, value, LEAF_NODE_VALUE_SIZE - 1);
     value_at[LEAF_NODE_VALUE_SIZE - 1] = '\0';
+    *leaf_node_expiry(node, cursor->cell_num) = expires_at;
     
     pager_flush(cursor->pager, cursor->page_num);
 }
 
-void internal_node_insert(Pager* pager, uint32_t parent_page_num, uint32_t child_page_num, const char* key) {
-#ifdef DEBUG    
-    printf("DEBUG: internal_node_insert parent=%d child=%d key=%s\n", parent_page_num, child_page_num, key); 
-    fflush(stdout);
-#endif
-    void* node = pager_get_page(pager, parent_page_num);
+void leaf_node_remove(void* node, uint32_t cell_num) {
+    uint32_t* num_cells = leaf_node_num_cells(node);
+    for (uint32_t i = cell_num; i + 1 < *num_cells; i++) {
+        memcpy(leaf_node_cell(node, i), leaf_node_cell(node, i + 1), LEAF_NODE_CELL_SIZE);
+    }
+    uint32_t* heads = leaf_node_heads(node);
+    memmove(&heads[cell_num], &heads[cell_num + 1], (*num_cells - cell_num - 1) * KEY_HEAD_SIZE);
+    memmove(leaf_node_expiry(node, cell_num), leaf_node_expiry(node, cell_num + 1),
+            (*num_cells - cell_num - 1) * LEAF_NODE_EXPIRY_SIZE);
+    (*num_cells)--;
+}
+
+uint32_t leaf_node_remove_expired(void* node, uint64_t now) {
+    uint32_t num_cells = *leaf_node_num_cells(node);
+    uint32_t* heads = leaf_node_heads(node);
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < num_cells; i++) {
+        uint64_t expires_at = *leaf_node_expiry(node, i);
+        if (expires_at != 0 && expires_at <= now) {
+            continue;
+        }
+        if (kept != i) {
+            memcpy(leaf_node_cell(node, kept), leaf_node_cell(node, i), LEAF_NODE_CELL_SIZE);
+            heads[kept] = heads[i];
+            *leaf_node_expiry(node, kept) = expires_at;
+        }
+        kept++;
+    }
+    *leaf_node_num_cells(node) = kept;
+    return num_cells - kept;
+}
+
+int leaf_node_delete(Cursor* cursor) {
+    void* node = pager_get_page_for_write(cursor->pager, cursor->page_num);
+    if (!node || cursor->cell_num >= *leaf_node_num_cells(node)) {
+        fprintf(stderr, "Failed to get cell %d of page %d in leaf_node_delete\n", cursor->cell_num,
+                cursor->page_num);
+        return -1;
+    }
+    leaf_node_remove(node, cursor->cell_num);
+    pager_flush(cursor->pager, cursor->page_num);
+    return btree_add_to_counts(cursor->pager, cursor, -1);
+}
+
+int leaf_node_delete_expired(Cursor* cursor, uint64_t now) {
+    void* node = pager_get_page_for_write(cursor->pager, cursor->page_num);
     if (!node) {
-        fprintf(stderr, "Failed to get parent page %d in internal_node_insert\n", parent_page_num);
+        fprintf(stderr, "Failed to get page %d in leaf_node_delete_expired\n", cursor->page_num);
+        return -1;
+    }
+    uint32_t removed = leaf_node_remove_expired(node, now);
+    if (removed == 0) {
+        return 0;
+    }
+    pager_flush(cursor->pager, cursor->page_num);
+    if (btree_add_to_counts(cursor->pager, cursor, -(int32_t)removed) != 0) {
+        return -1;
+    }
+    return (int)removed;
+}
+
+// Move cells [from, num_cells) of a full leaf, with their heads and expiry
+// times, to the start of an empty one
+static void leaf_node_move_upper(void* src, uint32_t from, void* dest) {
+    uint32_t num_cells = *leaf_node_num_cells(src);
+    for (uint32_t i = from; i < num_cells; i++) {
+        memcpy(leaf_node_cell(dest, i - from), leaf_node_cell(src, i), LEAF_NODE_CELL_SIZE);
+    }
+    memcpy(leaf_node_heads(dest), &leaf_node_heads(src)[from], (num_cells - from) * KEY_HEAD_SIZE);
+    memcpy(leaf_node_expiry(dest, 0), leaf_node_expiry(src, from), (num_cells - from) * LEAF_NODE_EXPIRY_SIZE);
+    *leaf_node_num_cells(src) = from;
+    *leaf_node_num_cells(dest) = num_cells - from;
+}
+
+/**
+ * Split internal node path[depth - 1], which cannot hold seps (num_keys
+ * entries, the new one included), and push the middle separator up to
+ * path[depth - 2]. The split point is chosen by bytes rather than by count
+ * so both halves fit. Children keep their pages, so none of them is touched;
+ * their counts move with them and each half's total goes to the parent.
+ * With append (the new separator is the node's last, coming from a split of
+ * the rightmost child on an append) the left half keeps all but the last
+ * two separators and the right half starts nearly empty.
+ */
+static void internal_node_split_and_insert(Pager* pager, const uint32_t* path, uint32_t depth,
+                                           const Separator* seps, uint32_t num_keys, uint32_t right_child,
+                                           uint32_t right_count, bool append) {
+    uint32_t page_num = path[depth - 1];
+    uint32_t split_index;
+    if (append) {
+        split_index = num_keys - 2;
+    } else {
+        uint32_t total = 0;
+        for (uint32_t i = 0; i < num_keys; i++) {
+            total += INTERNAL_NODE_SLOT_SIZE + separator_len(&seps[i]);
+        }
+        split_index = 1;
+        uint32_t left_size = INTERNAL_NODE_SLOT_SIZE + separator_len(&seps[0]);
+        while (split_index < num_keys - 1 && left_size < total / 2) {
+            left_size += INTERNAL_NODE_SLOT_SIZE + separator_len(&seps[split_index]);
+            split_index++;
+        }
+    }
+
+    // Left keeps [0, split_index), the separator at split_index moves up
+    // and right takes the rest. Both halves are built aside first, as seps
+    // points into the node being split.
+    char up_key[INTERNAL_NODE_KEY_SIZE];
+    uint32_t up_len = separator_len(&seps[split_index]);
+    separator_copy(&seps[split_index], 0, up_len, (uint8_t*)up_key);
+    uint32_t left_total = 0;
+    uint32_t right_total = right_count;
+    for (uint32_t i = 0; i < num_keys; i++) {
+        if (i <= split_index) {
+            left_total += seps[i].count;
+        } else {
+            right_total += seps[i].count;
+        }
+    }
+
+    uint8_t left_image[PAGE_USABLE_SIZE];
+    uint8_t right_image[PAGE_USABLE_SIZE];
+    memset(left_image, 0, COMMON_NODE_HEADER_SIZE);
+    memset(right_image, 0, COMMON_NODE_HEADER_SIZE);
+    if (!internal_node_encode(left_image, seps, split_index, seps[split_index].child, seps[split_index].count) ||
+        !internal_node_encode(right_image, &seps[split_index + 1], num_keys - split_index - 1, right_child,
+                              right_count)) {
+        fprintf(stderr, "Error: Internal node split halves do not fit in a page\n");
         return;
     }
-    
-    uint32_t num_keys = *internal_node_num_keys(node);
-#ifdef DEBUG
-    printf("DEBUG: num_keys=%d MAX=%d\n", num_keys, INTERNAL_NODE_MAX_CELLS); 
+
+    void* node = pager_get_page_for_write(pager, page_num);
+    if (!node) {
+        fprintf(stderr, "Failed to get page %d in internal_node_split_and_insert\n", page_num);
+        return;
+    }
+
+    if (is_node_root(node)) {
+        // The root stays on its page: both halves move to new pages
+        uint32_t left_page_num = pager_allocate_pages(pager, 2);
+        uint32_t right_page_num = left_page_num + 1;
+
+        Separator root_sep = { left_page_num, left_total, (const uint8_t*)up_key, up_len, NULL, 0 };
+        internal_node_encode(node, &root_sep, 1, right_page_num, right_total);
+        pager_flush(pager, page_num);
+
+        void* left = pager_get_page_for_write(pager, left_page_num);
+        if (!left) {
+            fprintf(stderr, "Failed to allocate left page %d in root split\n", left_page_num);
+            return;
+        }
+        memcpy(left, left_image, PAGE_USABLE_SIZE);
+        pager_flush(pager, left_page_num);
+
+        void* right = pager_get_page_for_write(pager, right_page_num);
+        if (!right) {
+            fprintf(stderr, "Failed to allocate right page %d in root split\n", right_page_num);
+            return;
+        }
+        memcpy(right, right_image, PAGE_USABLE_SIZE);
+        pager_flush(pager, right_page_num);
+        return;
+    }
+    if (depth < 2) {
+        fprintf(stderr, "Error: No parent on the path of internal node %d\n", page_num);
+        return;
+    }
+
+    memcpy(node, left_image, PAGE_USABLE_SIZE);
+    pager_flush(pager, page_num);
+
+    uint32_t right_page_num = pager_allocate_pages(pager, 1);
+    void* right = pager_get_page_for_write(pager, right_page_num);
+    if (!right) {
+        fprintf(stderr, "Failed to allocate right page %d in internal split\n", right_page_num);
+        return;
+    }
+    memcpy(right, right_image, PAGE_USABLE_SIZE);
+    pager_flush(pager, right_page_num);
+
+    internal_node_insert(pager, path, depth - 1, left_total, right_page_num, right_total, up_key, up_len, append);
+}
+
+/**
+ * Insert separator key (key_len bytes) into internal node path[depth - 1];
+ * path[0 .. depth - 1) are its ancestors, root first. child_page_num is the
+ * new right neighbour of the child whose range the key splits; they are
+ * left holding left_count and child_count records. append is set when
+ * that child was split for a sequential append (see
+ * leaf_node_split_index()), so a split of this node should favour the left.
+ */
+void internal_node_insert(Pager* pager, const uint32_t* path, uint32_t depth, uint32_t left_count,
+                          uint32_t child_page_num, uint32_t child_count, const char* key, uint32_t key_len,
+                          bool append) {
+    uint32_t parent_page_num = path[depth - 1];
+#ifdef DEBUG    
+    printf("DEBUG: internal_node_insert parent=%d child=%d key=%.*s\n", parent_page_num, child_page_num, (int)key_len, key); 
     fflush(stdout);
 #endif
-    if (num_keys >= INTERNAL_NODE_MAX_CELLS) {
-#ifdef DEBUG
-        printf("DEBUG: Calling internal_node_split_and_insert\n");
-        fflush(stdout);
-#endif        
-        internal_node_split_and_insert(pager, parent_page_num, child_page_num, key);
+    void* node = pager_get_page_for_write(pager, parent_page_num);
+    if (!node) {
+        fprintf(stderr, "Failed to get parent page %d in internal_node_insert\n", parent_page_num);
         return;
     }
     
-    uint32_t right_child_page_num = *internal_node_right_child(node);
-    
-    // Find the index of the child that we are splitting (it's the left child of the new key)
-    // We are inserting (Key, NewChild) effectively.
-    // But we need to find WHERE.
-    // We search for the child_page_num that matches the *left* child of the split.
-    // Wait, the caller passes 'child_page_num' which is the RIGHT child of the split.
-    // The LEFT child is already in the node.
-    // We need to find the index where the LEFT child is.
-    
-    // Actually, simpler: Find the index where the key should go.
-    // Since internal nodes are sorted, we can search for the key.
-    // But wait, the key is the separator.
-    // It's guaranteed to be > all keys in left child and <= all keys in right child.
-    
-    // Let's find the index i such that internal_node_child(node, i) == left_child_page_num?
-    // No, we don't have left_child_page_num passed in.
-    // But we know that 'key' is the smallest key in 'child_page_num' (the new right child).
-    // So we can just search for 'key'.
-    
-    uint32_t index = 0;
-    while (index < num_keys) {
-        char* key_at_index = internal_node_key(node, index);
-#ifdef DEBUG
-        printf("DEBUG: checking index %d key_at=%p\n", index, key_at_index); 
-        fflush(stdout);
-#endif
-        if (strcmp(key, key_at_index) < 0) {
-            break;
-        }
-        index++;
+    Separator seps[INTERNAL_NODE_MAX_CELLS + 1];
+    uint32_t num_keys = internal_node_separators(node, seps);
+    uint32_t right_child = *internal_node_right_child(node);
+    uint32_t right_count = *internal_node_right_count(node);
+
+    // The key goes in front of the first separator greater than it
+    char key_str[INTERNAL_NODE_KEY_SIZE];
+    memcpy(key_str, key, key_len);
+    key_str[key_len] = '\0';
+    uint32_t index = internal_node_find_child(node, key_str);
+
+    // The child at index stays left of the new key; the new child goes right of it
+    for (uint32_t i = num_keys; i > index; i--) {
+        seps[i] = seps[i - 1];
     }
-    
-    // Insert at 'index'
-    // If index == num_keys, we are appending.
-    
-    if (index == num_keys) {
-        // Append
-        // New Cell at num_keys: (Old Right Child, Key)
-        // New Right Child: child_page_num
-        
-        *internal_node_cell(node, num_keys) = right_child_page_num;
-        char* key_at = internal_node_key(node, num_keys);
-        strncpy(key_at, key, INTERNAL_NODE_KEY_SIZE - 1);
-        key_at[INTERNAL_NODE_KEY_SIZE - 1] = '\0';
-        
-        *internal_node_right_child(node) = child_page_num;
+    seps[index].head = (const uint8_t*)key_str;
+    seps[index].head_len = key_len;
+    seps[index].tail = NULL;
+    seps[index].tail_len = 0;
+    seps[index].count = left_count;
+    if (index < num_keys) {
+        seps[index + 1].child = child_page_num;
+        seps[index + 1].count = child_count;
     } else {
-        // Insert in middle
-        // Shift cells from index to num_keys-1 to index+1
-        for (uint32_t i = num_keys; i > index; i--) {
-            void* dest = internal_node_cell(node, i);
-            void* src = internal_node_cell(node, i - 1);
-            memcpy(dest, src, INTERNAL_NODE_CELL_SIZE);
-        }
-        
-        // Update the child pointer of the shifted cell (index+1) to be the new child
-        *internal_node_cell(node, index + 1) = child_page_num;
-        
-        // Set the key at index
-        char* key_at = internal_node_key(node, index);
-        strncpy(key_at, key, INTERNAL_NODE_KEY_SIZE - 1);
-        key_at[INTERNAL_NODE_KEY_SIZE - 1] = '\0';
+        seps[index].child = right_child;
+        right_child = child_page_num;
+        right_count = child_count;
+    }
+    num_keys++;
+
+    if (num_keys > INTERNAL_NODE_MAX_CELLS || !internal_node_encode(node, seps, num_keys, right_child, right_count)) {
+        internal_node_split_and_insert(pager, path, depth, seps, num_keys, right_child, right_count,
+                                       append && index == num_keys - 1);
+        return;
     }
-    
-    *internal_node_num_keys(node) += 1;
     pager_flush(pager, parent_page_num);
 }
 
-void internal_node_split_and_insert(Pager* pager, uint32_t parent_page_num, uint32_t child_page_num, const char* key) {
-    fprintf(stderr, "Error: Internal node split not implemented. Database full.\n");
-    abort();
-    (void)pager; (void)parent_page_num; (void)child_page_num; (void)key;
+// Length of the shortest prefix of right_first that sorts above left_last.
+// Keys are distinct and left_last < right_first, so they differ at a
+// position where right_first has not ended.
+static uint32_t leaf_separator_len(const char* left_last, const char* right_first) {
+    uint32_t i = 0;
+    while (left_last[i] == right_first[i]) {
+        i++;
+    }
+    return i + 1;
 }
 
-void leaf_node_split_and_insert(Cursor* cursor, const char* key, const char* value) {
+/**
+ * Where a full leaf splits when key is inserted at cell insert_at: cells
+ * from the returned index on move to the new right leaf.
+ * Inserts past the last key of the rightmost leaf are taken to be
+ * time-ordered (sequential ids, timestamps): the leaf is left full and the
+ * new key starts a fresh right leaf. Halving would leave every leaf behind
+ * the insert point half empty for good.
+ */
+static uint32_t leaf_node_split_index(void* node, uint32_t insert_at) {
+    uint32_t num_cells = *leaf_node_num_cells(node);
+    if (insert_at == num_cells && *leaf_node_next_leaf(node) == 0) {
+        return num_cells;
+    }
+    return (num_cells + 1) / 2;
+}
+
+void leaf_node_split_and_insert(Cursor* cursor, const char* key, const char* value, uint64_t expires_at) {
 #ifdef DEBUG
     printf("DEBUG: leaf_node_split_and_insert page=%d key=%s\n", cursor->page_num, key); fflush(stdout);
 #endif
-    void* old_node = pager_get_page(cursor->pager, cursor->page_num);
+    void* old_node = pager_get_page_for_write(cursor->pager, cursor->page_num);
     if (!old_node) {
         fprintf(stderr, "Failed to get page %d in leaf_node_split_and_insert\n", cursor->page_num);
         return;
     }
     
     if (is_node_root(old_node)) {
-        create_new_root(cursor->pager, cursor->pager->num_pages + 1); // We will allocate two pages
+        // The root keeps its page number: both halves move to new pages
+        uint32_t root_page_num = cursor->page_num;
+        create_new_root(cursor->pager, root_page_num, cursor->pager->num_pages + 1); // We will allocate two pages
         // Re-read root because create_new_root modified it
-        void* root = pager_get_page(cursor->pager, 0);
+        void* root = pager_get_page_for_write(cursor->pager, root_page_num);
         if (!root) {
             fprintf(stderr, "Failed to get root page after split\n");
             return;
@@ -351,79 +1301,76 @@ void leaf_node_split_and_insert(Cursor* cursor, const char* key, const char* val
         uint32_t left_child_page_num = *internal_node_child(root, 0);
         uint32_t right_child_page_num = *internal_node_right_child(root);
         
-        void* left_child = pager_get_page(cursor->pager, left_child_page_num);
+        void* left_child = pager_get_page_for_write(cursor->pager, left_child_page_num);
         if (!left_child) {
             fprintf(stderr, "Failed to get left child page %d\n", left_child_page_num);
             return;
         }
-        void* right_child = pager_get_page(cursor->pager, right_child_page_num);
+        void* right_child = pager_get_page_for_write(cursor->pager, right_child_page_num);
         if (!right_child) {
             fprintf(stderr, "Failed to get right child page %d\n", right_child_page_num);
             return;
         }
         
         // Left child is a copy of old root, so it is full.
-        // We need to move the upper half of cells to the right child.
+        // We need to move the upper cells to the right child.
         uint32_t num_cells = *leaf_node_num_cells(left_child);
-        uint32_t split_index = (num_cells + 1) / 2;
+        uint32_t split_index = leaf_node_split_index(left_child, cursor->cell_num);
         
         leaf_node_init(right_child);
         
         // Move cells
-        for (uint32_t i = split_index; i < num_cells; i++) {
-            void* dest = leaf_node_cell(right_child, i - split_index);
-            void* src = leaf_node_cell(left_child, i);
-            memcpy(dest, src, LEAF_NODE_CELL_SIZE);
-        }
-        
-        *leaf_node_num_cells(left_child) = split_index;
-        *leaf_node_num_cells(right_child) = num_cells - split_index;
+        leaf_node_move_upper(left_child, split_index, right_child);
+        *leaf_node_next_leaf(left_child) = right_child_page_num;
         
-        // Update parent pointers
-        *node_parent(left_child) = 0; // Root is always page 0
-        *node_parent(right_child) = 0;
+        // Root key: the shortest string above every key of the left child
+        // and not above the first key of the right child (the new key if
+        // the right child starts empty).
+        char right_first_key[LEAF_NODE_KEY_SIZE];
+        strcpy(right_first_key, split_index < num_cells ? leaf_node_key(right_child, 0) : key);
+        uint32_t separator_length = leaf_separator_len(leaf_node_key(left_child, split_index - 1), right_first_key);
+        bool goes_left = strncmp(key, right_first_key, separator_length) < 0;
+        Separator root_sep = { left_child_page_num, split_index + goes_left, (const uint8_t*)right_first_key,
+                               separator_length, NULL, 0 };
+        internal_node_encode(root, &root_sep, 1, right_child_page_num, num_cells - split_index + !goes_left);
         
-        // Update root key (first key of right child)
-        // Internal node keys are the maximum key of the left child? 
-        // Or the first key of the right child?
-        // B+Tree: Internal nodes contain keys that separate children.
-        // Usually: Key[i] <= Child[i] < Key[i+1] ...
-        // Or: Child[i] <= Key[i] < Child[i+1]
-        // Let's use: Key[i] is the smallest key in Child[i+1] (Right child).
-        // So Key[0] should be the first key of the Right Child.
-        
-        char* right_first_key = leaf_node_key(right_child, 0);
-        char* root_key = internal_node_key(root, 0);
-        strncpy(root_key, right_first_key, INTERNAL_NODE_KEY_SIZE - 1);
-        root_key[INTERNAL_NODE_KEY_SIZE - 1] = '\0';
+        pager_flush(cursor->pager, root_page_num);
+        pager_flush(cursor->pager, left_child_page_num);
+        pager_flush(cursor->pager, right_child_page_num);
         
         // Now insert the new key into the appropriate child
         // We need to find which child to insert into.
-        // Since we just split, we can check the key against the split key.
+        // Since we just split, we can check the key against the separator
+        // (not the right child's first key: the separator may be shorter).
         
-        if (strcmp(key, right_first_key) < 0) {
+        if (goes_left) {
             // Insert into left child
             // We need a new cursor for the left child
             
             // Re-find in left child
-            Cursor* left_cursor = leaf_node_find(cursor->pager, left_child_page_num, key);
-            leaf_node_insert(left_cursor, key, value);
-            free(left_cursor);
+            Cursor left_cursor;
+            if (leaf_node_find_into(cursor->pager, left_child_page_num, key, &left_cursor) == 0) {
+                leaf_node_insert_cell(&left_cursor, key, value, expires_at);
+            }
         } else {
             // Insert into right child
-            Cursor* right_cursor = leaf_node_find(cursor->pager, right_child_page_num, key);
-            leaf_node_insert(right_cursor, key, value);
-            free(right_cursor);
+            Cursor right_cursor;
+            if (leaf_node_find_into(cursor->pager, right_child_page_num, key, &right_cursor) == 0) {
+                leaf_node_insert_cell(&right_cursor, key, value, expires_at);
+            }
         }
         
         return;
     }
     
-    // Non-root leaf node split
-    uint32_t right_child_page_num = cursor->pager->num_pages;
-    cursor->pager->num_pages++;
+    // Non-root leaf node split: the parent is the last page on the path
+    if (cursor->path_depth == 0) {
+        fprintf(stderr, "Error: No path to split leaf %d\n", cursor->page_num);
+        return;
+    }
+    uint32_t right_child_page_num = pager_allocate_pages(cursor->pager, 1);
     
-    void* right_child = pager_get_page(cursor->pager, right_child_page_num);
+    void* right_child = pager_get_page_for_write(cursor->pager, right_child_page_num);
     if (!right_child) {
         fprintf(stderr, "Failed to allocate right child page %d\n", right_child_page_num);
         return;
@@ -431,85 +1378,93 @@ void leaf_node_split_and_insert(Cursor* cursor, const char* key, const char* val
     
     leaf_node_init(right_child);
     
-    // Move upper half of cells to right child
+    // Move the upper cells to the right child
     uint32_t num_cells = *leaf_node_num_cells(old_node);
-    uint32_t split_index = (num_cells + 1) / 2;
+    uint32_t split_index = leaf_node_split_index(old_node, cursor->cell_num);
     
-    for (uint32_t i = split_index; i < num_cells; i++) {
-        void* dest = leaf_node_cell(right_child, i - split_index);
-        void* src = leaf_node_cell(old_node, i);
-        memcpy(dest, src, LEAF_NODE_CELL_SIZE);
-    }
+    leaf_node_move_upper(old_node, split_index, right_child);
     
-    *leaf_node_num_cells(old_node) = split_index;
-    *leaf_node_num_cells(right_child) = num_cells - split_index;
+    // Link the new leaf into the sibling chain
+    *leaf_node_next_leaf(right_child) = *leaf_node_next_leaf(old_node);
+    *leaf_node_next_leaf(old_node) = right_child_page_num;
     
-    // Update parent pointers
-    // Right child shares the same parent as the old node (left child)
-    uint32_t parent_page_num = *node_parent(old_node);
-    *node_parent(right_child) = parent_page_num;
+    pager_flush(cursor->pager, cursor->page_num);
+    pager_flush(cursor->pager, right_child_page_num);
     
-    // Insert the new key into the parent
-    // The key is the first key of the right child
-    char* right_first_key = leaf_node_key(right_child, 0);
+    // Insert the separator into the parent: the shortest prefix of the
+    // right child's first key that still sorts above the left child's last.
+    // Copied out, as splitting the parent may evict the leaf pages.
+    char right_first_key[LEAF_NODE_KEY_SIZE];
+    strcpy(right_first_key, split_index < num_cells ? leaf_node_key(right_child, 0) : key);
+    uint32_t separator_length = leaf_separator_len(leaf_node_key(old_node, split_index - 1), right_first_key);
+    bool goes_left = strncmp(key, right_first_key, separator_length) < 0;
     
-    internal_node_insert(cursor->pager, parent_page_num, right_child_page_num, right_first_key);
+    internal_node_insert(cursor->pager, cursor->path, cursor->path_depth, split_index + goes_left,
+                         right_child_page_num, num_cells - split_index + !goes_left, right_first_key,
+                         separator_length, split_index == num_cells);
     
-    // Insert the new key/value into the appropriate child
-    if (strcmp(key, right_first_key) < 0) {
+    // Insert the new key/value into the child the separator routes it to
+    if (goes_left) {
         // Insert into left child (old_node)
         // We need to re-find the position because we modified the node
         // But we can just use the existing cursor?
         // No, the cursor might be invalid if we moved cells?
         // Actually, leaf_node_insert handles finding position if we pass a cursor.
         // But we should probably re-find to be safe and simple.
-        Cursor* left_cursor = leaf_node_find(cursor->pager, cursor->page_num, key);
-        leaf_node_insert(left_cursor, key, value);
-        free(left_cursor);
+        Cursor left_cursor;
+        if (leaf_node_find_into(cursor->pager, cursor->page_num, key, &left_cursor) == 0) {
+            leaf_node_insert_cell(&left_cursor, key, value, expires_at);
+        }
     } else {
         // Insert into right child
-        Cursor* right_cursor = leaf_node_find(cursor->pager, right_child_page_num, key);
-        leaf_node_insert(right_cursor, key, value);
-        free(right_cursor);
+        Cursor right_cursor;
+        if (leaf_node_find_into(cursor->pager, right_child_page_num, key, &right_cursor) == 0) {
+            leaf_node_insert_cell(&right_cursor, key, value, expires_at);
+        }
     }
 }
 
-void create_new_root(Pager* pager, uint32_t right_child_page_num) {
-    void* root = pager_get_page(pager, 0);
+void create_new_root(Pager* pager, uint32_t root_page_num, uint32_t right_child_page_num) {
+    void* root = pager_get_page_for_write(pager, root_page_num);
     if (!root) {
         fprintf(stderr, "Failed to get root page in create_new_root\n");
         return;
     }
     
-    uint32_t left_child_page_num = pager->num_pages; // Allocate new page for left child
-    pager->num_pages++; // Increment manually since we are "allocating"
+    uint32_t left_child_page_num = pager_allocate_pages(pager, 1); // Allocate new page for left child
     
     // We expect right_child_page_num to be passed in as the next available page
     // So we should ensure we allocate it too if it wasn't already.
     if (right_child_page_num >= pager->num_pages) {
-        pager->num_pages = right_child_page_num + 1;
+        pager_allocate_pages(pager, right_child_page_num + 1 - pager->num_pages);
     }
     
-    void* left_child = pager_get_page(pager, left_child_page_num);
+    void* left_child = pager_get_page_for_write(pager, left_child_page_num);
     if (!left_child) {
         fprintf(stderr, "Failed to get left child page %d in create_new_root\n", left_child_page_num);
         return;
     }
     
-    // Copy root to left child
+    // Copy root to left child; the key type and format stay with the root
     memcpy(left_child, root, PAGE_SIZE);
     set_node_root(left_child, false);
+    clear_node_reserved(left_child);
     
-    // Initialize root as internal node
+    // Initialize root as internal node; the caller sets the separator
+    uint32_t key_width;
+    KeyType key_type = root_node_key_type(root, &key_width);
+    uint16_t format = root_node_format(root);
     internal_node_init(root);
     set_node_root(root, true);
-    *internal_node_num_keys(root) = 1;
-    *internal_node_right_child(root) = right_child_page_num;
-    *internal_node_child(root, 0) = left_child_page_num;
+    set_root_node_key_type(root, key_type, key_width);
+    set_root_node_format(root, format);
+    Separator placeholder = { left_child_page_num, 0, NULL, 0, NULL, 0 };
+    internal_node_encode(root, &placeholder, 1, right_child_page_num, 0);
 }
 
 void* cursor_value(Cursor* cursor) {
-    void* page = pager_get_page(cursor->pager, cursor->page_num);
+    void* page = pager_get_page_hint(cursor->pager, cursor->page_num,
+                                     cursor->use_once ? PAGER_HINT_USE_ONCE : PAGER_HINT_NORMAL);
     if (!page) {
         fprintf(stderr, "Failed to get page %d in cursor_value\n", cursor->page_num);
         return NULL;
@@ -518,31 +1473,36 @@ void* cursor_value(Cursor* cursor) {
 }
 
 /**
- * Advances the cursor to the next cell in the current leaf node.
- * 
- * LIMITATION: This function only handles advancing within a single leaf node.
- * When the cursor reaches the end of the current leaf node, it sets end_of_table
- * to true rather than navigating to the next sibling leaf node. This means that
- * iteration using cursor_advance() will stop at the end of each leaf node, even
- * if there are more records in sibling leaf nodes after a B-tree split.
+ * Advances the cursor to the next cell.
  * 
- * To properly support multi-node traversal, the leaf nodes would need to maintain
- * sibling pointers (next_leaf field), or the cursor would need to track the path
- * through internal nodes.
+ * When the current leaf is exhausted the cursor follows the leaf's
+ * next_leaf pointer, skipping leaves left empty by deletes, and sets
+ * end_of_table once the rightmost leaf has been consumed.
  */
 void cursor_advance(Cursor* cursor) {
-    void* node = pager_get_page(cursor->pager, cursor->page_num);
+    PagerHint hint = cursor->use_once ? PAGER_HINT_USE_ONCE : PAGER_HINT_NORMAL;
+    void* node = pager_get_page_hint(cursor->pager, cursor->page_num, hint);
     if (!node) {
         fprintf(stderr, "Failed to get page %d in cursor_advance\n", cursor->page_num);
         cursor->end_of_table = true;
         return;
     }
-    uint32_t num_cells = *leaf_node_num_cells(node);
     
     cursor->cell_num += 1;
-    if (cursor->cell_num >= num_cells) {
-        // NOTE: Does not navigate to next leaf node - see function documentation
-        cursor->end_of_table = true;
+    while (cursor->cell_num >= *leaf_node_num_cells(node)) {
+        uint32_t next_page_num = *leaf_node_next_leaf(node);
+        if (next_page_num == 0) {
+            cursor->end_of_table = true;
+            return;
+        }
+        node = pager_get_page_hint(cursor->pager, next_page_num, hint);
+        if (!node) {
+            fprintf(stderr, "Failed to get page %d in cursor_advance\n", next_page_num);
+            cursor->end_of_table = true;
+            return;
+        }
+        cursor->page_num = next_page_num;
+        cursor->cell_num = 0;
     }
 }
 
@@ -581,7 +1541,9 @@ void print_tree(Pager* pager, uint32_t page_num, uint32_t indentation_level) {
                 for (j = 0; j < indentation_level + 1; j++) {
                     printf("  ");
                 }
-                printf("%s\n", internal_node_key(node, i));
+                char separator[INTERNAL_NODE_KEY_SIZE];
+                internal_node_key_copy(node, i, separator);
+                printf("%s\n", separator);
             }
             // Print rightmost child
             uint32_t right_child_page_num = *internal_node_right_child(node);
@@ -590,3 +1552,37 @@ void print_tree(Pager* pager, uint32_t page_num, uint32_t indentation_level) {
         }
     }
 }
+
+static int btree_fill_walk(Pager* pager, uint32_t page_num, uint32_t level, BTreeFillStats* stats) {
+    void* node = pager_get_page(pager, page_num);
+    if (!node) {
+        fprintf(stderr, "Failed to get page %d in btree_fill_stats\n", page_num);
+        return -1;
+    }
+    if (level > stats->depth) {
+        stats->depth = level;
+    }
+    if (get_node_type(node) == NODE_LEAF) {
+        stats->leaf_pages++;
+        stats->cells += *leaf_node_num_cells(node);
+        return 0;
+    }
+    uint32_t num_keys = *internal_node_num_keys(node);
+    stats->internal_pages++;
+    stats->separators += num_keys;
+    stats->internal_bytes += INTERNAL_NODE_HEADER_SIZE + num_keys * (KEY_HEAD_SIZE + INTERNAL_NODE_SLOT_SIZE) +
+                             PAGE_USABLE_SIZE - *internal_node_heap_start(node);
+    for (uint32_t i = 0; i <= num_keys; i++) {
+        // Walking a child may evict this node: fetch it again for each child
+        node = pager_get_page(pager, page_num);
+        if (!node || btree_fill_walk(pager, *internal_node_child(node, i), level + 1, stats) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int btree_fill_stats(Pager* pager, uint32_t root_page_num, BTreeFillStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    return btree_fill_walk(pager, root_page_num, 1, stats);
+}
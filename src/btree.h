@@ -3,6 +3,8 @@
 
 #include <stdint.h>
 #include "pager.h"
+#include "key_head.h"
+#include "key_type.h"
 
 // Node Types
 typedef enum { 
@@ -15,35 +17,79 @@ typedef enum {
 #define NODE_TYPE_OFFSET 0
 #define IS_ROOT_SIZE sizeof(uint8_t)
 #define IS_ROOT_OFFSET (NODE_TYPE_SIZE)
-#define PARENT_POINTER_SIZE sizeof(uint32_t)
-#define PARENT_POINTER_OFFSET (IS_ROOT_OFFSET + IS_ROOT_SIZE)
-#define COMMON_NODE_HEADER_SIZE (NODE_TYPE_SIZE + IS_ROOT_SIZE + PARENT_POINTER_SIZE)
+// Formerly the parent page number. Splits now follow the path recorded by
+// the cursor, so the field is unused (written as 0) except on the root,
+// where it holds the key type of the tree (see root_node_key_type) and,
+// on page 0, the format version of the file (see root_node_format).
+#define NODE_RESERVED_SIZE sizeof(uint32_t)
+#define NODE_RESERVED_OFFSET (IS_ROOT_OFFSET + IS_ROOT_SIZE)
+#define ROOT_KEY_TYPE_OFFSET NODE_RESERVED_OFFSET          // uint8_t KeyType
+#define ROOT_KEY_WIDTH_OFFSET (NODE_RESERVED_OFFSET + 1)   // uint8_t width of binary keys
+#define ROOT_FORMAT_OFFSET (NODE_RESERVED_OFFSET + 2)      // uint16_t format version
+#define COMMON_NODE_HEADER_SIZE (NODE_TYPE_SIZE + IS_ROOT_SIZE + NODE_RESERVED_SIZE)
 
 // Leaf Node Header Layout
 #define LEAF_NODE_NUM_CELLS_SIZE sizeof(uint32_t)
 #define LEAF_NODE_NUM_CELLS_OFFSET COMMON_NODE_HEADER_SIZE
-#define LEAF_NODE_HEADER_SIZE (COMMON_NODE_HEADER_SIZE + LEAF_NODE_NUM_CELLS_SIZE)
+#define LEAF_NODE_NEXT_LEAF_SIZE sizeof(uint32_t)
+#define LEAF_NODE_NEXT_LEAF_OFFSET (LEAF_NODE_NUM_CELLS_OFFSET + LEAF_NODE_NUM_CELLS_SIZE)
+#define LEAF_NODE_HEADER_SIZE (COMMON_NODE_HEADER_SIZE + LEAF_NODE_NUM_CELLS_SIZE + LEAF_NODE_NEXT_LEAF_SIZE)
 
 // Leaf Node Body Layout
+// An array of LEAF_NODE_MAX_CELLS key heads (see key_head.h) follows the
+// header, then the fixed-size cells.
 #define LEAF_NODE_KEY_SIZE 128
 #define LEAF_NODE_VALUE_SIZE 256
 #define LEAF_NODE_CELL_SIZE (LEAF_NODE_KEY_SIZE + LEAF_NODE_VALUE_SIZE)
-#define LEAF_NODE_SPACE_FOR_CELLS (PAGE_SIZE - LEAF_NODE_HEADER_SIZE)
-#define LEAF_NODE_MAX_CELLS (LEAF_NODE_SPACE_FOR_CELLS / LEAF_NODE_CELL_SIZE)
+#define LEAF_NODE_HEADER_PADDING 2 // Keeps the head array 4-byte aligned
+#define LEAF_NODE_HEADS_OFFSET (LEAF_NODE_HEADER_SIZE + LEAF_NODE_HEADER_PADDING)
+#define LEAF_NODE_SPACE_FOR_CELLS (PAGE_USABLE_SIZE - LEAF_NODE_HEADS_OFFSET)
+#define LEAF_NODE_MAX_CELLS (LEAF_NODE_SPACE_FOR_CELLS / (LEAF_NODE_CELL_SIZE + KEY_HEAD_SIZE))
+#define LEAF_NODE_CELLS_OFFSET (LEAF_NODE_HEADS_OFFSET + LEAF_NODE_MAX_CELLS * KEY_HEAD_SIZE)
+// After the cells, one expiry time per cell (seconds since the Unix epoch,
+// 0 = never), in the space the fixed-size cells leave at the end of the
+// page. Leaves written before expiry existed have zeros there.
+#define LEAF_NODE_EXPIRY_SIZE sizeof(uint64_t)
+#define LEAF_NODE_EXPIRY_OFFSET (LEAF_NODE_CELLS_OFFSET + LEAF_NODE_MAX_CELLS * LEAF_NODE_CELL_SIZE)
+_Static_assert(LEAF_NODE_EXPIRY_OFFSET + LEAF_NODE_MAX_CELLS * LEAF_NODE_EXPIRY_SIZE <= PAGE_USABLE_SIZE,
+               "leaf expiry times do not fit in the page");
 
 // Internal Node Header Layout
 #define INTERNAL_NODE_NUM_KEYS_SIZE sizeof(uint32_t)
 #define INTERNAL_NODE_NUM_KEYS_OFFSET COMMON_NODE_HEADER_SIZE
 #define INTERNAL_NODE_RIGHT_CHILD_SIZE sizeof(uint32_t)
 #define INTERNAL_NODE_RIGHT_CHILD_OFFSET (INTERNAL_NODE_NUM_KEYS_OFFSET + INTERNAL_NODE_NUM_KEYS_SIZE)
-#define INTERNAL_NODE_HEADER_SIZE (COMMON_NODE_HEADER_SIZE + INTERNAL_NODE_NUM_KEYS_SIZE + INTERNAL_NODE_RIGHT_CHILD_SIZE)
+#define INTERNAL_NODE_RIGHT_COUNT_SIZE sizeof(uint32_t)
+#define INTERNAL_NODE_RIGHT_COUNT_OFFSET (INTERNAL_NODE_RIGHT_CHILD_OFFSET + INTERNAL_NODE_RIGHT_CHILD_SIZE)
+#define INTERNAL_NODE_PREFIX_LEN_SIZE sizeof(uint16_t)
+#define INTERNAL_NODE_PREFIX_LEN_OFFSET (INTERNAL_NODE_RIGHT_COUNT_OFFSET + INTERNAL_NODE_RIGHT_COUNT_SIZE)
+#define INTERNAL_NODE_HEAP_START_SIZE sizeof(uint16_t)
+#define INTERNAL_NODE_HEAP_START_OFFSET (INTERNAL_NODE_PREFIX_LEN_OFFSET + INTERNAL_NODE_PREFIX_LEN_SIZE)
+#define INTERNAL_NODE_HEADER_PADDING 2 // Keeps the slot array 4-byte aligned
+#define INTERNAL_NODE_HEADER_SIZE (INTERNAL_NODE_HEAP_START_OFFSET + INTERNAL_NODE_HEAP_START_SIZE + INTERNAL_NODE_HEADER_PADDING)
 
 // Internal Node Body Layout
-#define INTERNAL_NODE_KEY_SIZE 128
+// An array of separator heads (see key_head.h, taken after the node
+// prefix) follows the header, then a slot array (child page, separator
+// offset, separator length); both have one entry per key. Separators are the shortest strings that divide their
+// children and are stored without the prefix common to the whole node; the
+// prefix is stored once at the end of the usable area and the separator
+// bytes grow down below it.
+// Each slot also holds the number of records in its child's subtree (the
+// header holds the rightmost child's), so ranks and range counts are found
+// in one descent (see table_rank_latched).
+#define INTERNAL_NODE_KEY_SIZE 128 // Longest separator, including a terminating NUL
 #define INTERNAL_NODE_CHILD_SIZE sizeof(uint32_t)
-#define INTERNAL_NODE_CELL_SIZE (INTERNAL_NODE_CHILD_SIZE + INTERNAL_NODE_KEY_SIZE)
-#define INTERNAL_NODE_SPACE_FOR_CELLS (PAGE_SIZE - INTERNAL_NODE_HEADER_SIZE)
-#define INTERNAL_NODE_MAX_CELLS (INTERNAL_NODE_SPACE_FOR_CELLS / INTERNAL_NODE_CELL_SIZE)
+#define INTERNAL_NODE_COUNT_SIZE sizeof(uint32_t)
+#define INTERNAL_NODE_SLOT_SUFFIX_OFFSET (INTERNAL_NODE_CHILD_SIZE + INTERNAL_NODE_COUNT_SIZE)
+#define INTERNAL_NODE_SLOT_SIZE (INTERNAL_NODE_SLOT_SUFFIX_OFFSET + 2 * sizeof(uint16_t))
+#define INTERNAL_NODE_SPACE_FOR_CELLS (PAGE_USABLE_SIZE - INTERNAL_NODE_HEADER_SIZE)
+// Upper bound on keys per node; the real limit depends on separator lengths
+#define INTERNAL_NODE_MAX_CELLS (INTERNAL_NODE_SPACE_FOR_CELLS / (INTERNAL_NODE_SLOT_SIZE + KEY_HEAD_SIZE))
+
+// Deepest tree a cursor can descend. Even with the longest separators an
+// internal node holds over a dozen children, so this is never reached.
+#define BTREE_MAX_DEPTH 16
 
 // Cursor for iterating
 typedef struct {
@@ -51,31 +97,290 @@ typedef struct {
     uint32_t page_num;
     uint32_t cell_num;
     bool end_of_table; // Indicates we are past the last element
+    bool use_once; // Scan cursor: pages are fetched with PAGER_HINT_USE_ONCE
+    // Internal pages passed on the way down, root first: path[path_depth - 1]
+    // is the parent of page_num. Splits walk it back up. Valid until the
+    // tree is next modified.
+    uint32_t path[BTREE_MAX_DEPTH];
+    uint32_t path_depth;
 } Cursor;
 
 // Function Declarations
 void leaf_node_init(void* node);
 void internal_node_init(void* node);
 
+// Called for every record of a scan, in key order; return nonzero to stop
+typedef int (*BTreeScanFn)(const char* key, const char* value, void* arg);
+
+// Lookups and scans pass over records whose expiry time has come (see
+// leaf_node_expired); they stay in their leaf until deleted.
+
+// Optimistic lookups restart from the root at most this many times
+#define BTREE_OPTIMISTIC_RETRIES 8
+
 // Cursor operations
+// Cursors and the functions below them read pages without latches: they
+// are for single-threaded use, or for the one writer thread, which reads
+// pages no other thread modifies. Concurrent readers use the *_latched
+// functions inside a pager pin scope.
+/**
+ * Returns a scan cursor at the first record of the tree.
+ * Leaf pages are fetched as use-once so a full scan does not flush the cache.
+ */
 Cursor* table_start(Pager* pager, uint32_t root_page_num);
 Cursor* table_find(Pager* pager, uint32_t root_page_num, const char* key);
 /**
- * Advances cursor to the next cell. NOTE: Only traverses within a single leaf node.
- * Does not navigate to sibling leaf nodes. See btree.c for full documentation.
+ * Like table_find(), but positions a caller-provided cursor (typically on the
+ * stack) instead of allocating one. Performs no heap allocation.
+ * The descent is iterative and records its path in the cursor.
+ * @return 0 on success, -1 on error
+ */
+int table_find_into(Pager* pager, uint32_t root_page_num, const char* key, Cursor* cursor);
+/**
+ * Find the leaf page that holds or would hold each of count keys, which
+ * must be sorted in ascending order. The descent is shared between
+ * neighbouring keys: only the internal nodes not already on the path to the
+ * previous key are read. After the first key the leaves themselves are not
+ * read, so the caller can prefetch them before probing.
+ * Each internal node is latched shared while it is searched, in a pin
+ * scope of its own per key, so this is safe next to a writer. But as the
+ * leaves are reached without holding latches, a concurrent split may have
+ * moved a key right by the time its leaf is read: probe the leaves with
+ * leaf_node_seek_latched().
+ * @return 0 on success, -1 on error (including unsorted keys)
+ */
+int table_find_leaves(Pager* pager, uint32_t root_page_num, const char* const* keys, uint32_t count,
+                      uint32_t* leaf_pages);
+/**
+ * table_find_into() with latch coupling for concurrent readers: each node
+ * is latched shared before its parent is released, so the descent never
+ * sees a node in the middle of a change. Call inside a pager pin scope.
+ * @param leaf_frame Set to the frame of the leaf, which is left latched
+ *        shared; release it with pager_unlatch_frame()
+ * @return 0 on success, -1 on error (nothing is left latched)
+ */
+int table_find_latched(Pager* pager, uint32_t root_page_num, const char* key, Cursor* cursor,
+                       uint32_t* leaf_frame);
+/**
+ * Number of records of the tree whose keys sort below key (NULL for all
+ * of them), from the subtree counts of the internal nodes on the way to
+ * key's leaf: one descent with latch coupling, as table_find_latched().
+ * Records that have expired count until they are deleted. Call inside a
+ * pager pin scope.
+ * @return The rank, or -1 on error
+ */
+int64_t table_rank_latched(Pager* pager, uint32_t root_page_num, const char* key);
+/**
+ * Position cursor at the record of rank rank (0 for the first in key
+ * order), descending with latch coupling by the subtree counts. Call
+ * inside a pager pin scope.
+ * @param leaf_frame Set to the frame of the leaf, which is left latched
+ *        shared when found; release it with pager_unlatch_frame()
+ * @return 1 if found, 0 if the tree holds no more than rank records, -1 on
+ *         error (nothing is left latched unless found)
+ */
+int table_seek_rank_latched(Pager* pager, uint32_t root_page_num, uint64_t rank, Cursor* cursor,
+                            uint32_t* leaf_frame);
+/**
+ * Look up key and copy its value without taking any latch or pin
+ * (optimistic lock coupling). Each node is copied out and its version
+ * validated before the copy is searched, and a parent is validated again
+ * after its child's version is read, so a lookup never follows a pointer
+ * a concurrent split has made stale. Retries from the root when a
+ * validation fails; gives up after BTREE_OPTIMISTIC_RETRIES attempts or
+ * at the first page that is not cached.
+ * @param buf Receives the value like snprintf (cap may be 0)
+ * @param length Set to the length of the value when found
+ * @param leaf_page, leaf_cell Optional (may be NULL): set to where the
+ *        record was found
+ * @param expires_at Optional (may be NULL): set to the record's expiry
+ *        time when found (0 = never)
+ * @return 1 if found, 0 if not, -1 to fall back to table_find_latched()
+ */
+int table_get_optimistic(Pager* pager, uint32_t root_page_num, const char* key, char* buf, size_t cap,
+                         size_t* length, uint32_t* leaf_page, uint32_t* leaf_cell, uint64_t* expires_at);
+/**
+ * Copy the value of key if one cell of one page holds it, without latches
+ * or pins, checking only the page header and that cell (for lookups
+ * through a hint of where the record was, see hash_index.h).
+ * @param expires_at Optional (may be NULL): set as by table_get_optimistic()
+ * @return 1 if the cell holds key, 0 if not (the hint is stale, or the
+ *         record has expired), -1 if the page is not cached or kept changing
+ */
+int leaf_node_get_optimistic(Pager* pager, uint32_t page_num, uint32_t cell_num, const char* key, char* buf,
+                             size_t cap, size_t* length, uint64_t* expires_at);
+/**
+ * Look up key in the tree as a snapshot sees it (see pager_read_version).
+ * Every node is copied out, so nothing stays latched or pinned.
+ * @param epoch Snapshot epoch from page_versions_acquire
+ * @param buf Receives the value like snprintf (cap may be 0)
+ * @param length Set to the length of the value when found
+ * @return 1 if found, 0 if not, -1 on error
+ */
+int table_get_version(Pager* pager, uint32_t root_page_num, uint64_t epoch, const char* key, char* buf,
+                      size_t cap, size_t* length);
+/**
+ * Call fn for every record of a snapshot from the first key >= start
+ * (NULL or "" for the first record) to the end, in key order. Leaves are
+ * copied one at a time as the snapshot sees them, with
+ * PAGER_HINT_USE_ONCE, so a long scan neither blocks the writer nor
+ * flushes the cache.
+ * @return Number of records passed to fn, or -1 on error
+ */
+int64_t table_scan_version(Pager* pager, uint32_t root_page_num, uint64_t epoch, const char* start,
+                           BTreeScanFn fn, void* arg);
+/**
+ * Find key starting from a page the caller holds latched shared, for
+ * leaves located without latch coupling. Descends if the page has since
+ * become an internal node (the root) and moves right along the leaf chain
+ * while key sorts after every key of the leaf and the next leaf does not
+ * start above it: splits only ever move keys right. Pages left behind are
+ * unlatched and unpinned (pager_scope_unpin). Call inside a pager pin scope.
+ * @param page_num In: the latched page; out: the latched leaf
+ * @param frame In/out: its frame
+ * @param cell_num Set to the cell holding key, or where it would go
+ * @return The latched leaf, or NULL on error (nothing is left latched)
+ */
+void* leaf_node_seek_latched(Pager* pager, void* node, uint32_t* page_num, uint32_t* frame,
+                             const char* key, uint32_t* cell_num);
+/**
+ * Latch exclusively, root side first, every page that inserting or
+ * deleting at the cursor modifies: the leaf and each ancestor on the
+ * cursor's path, all of which hold a subtree count that changes (and some
+ * of which a split may change further). For the single writer thread,
+ * inside a pager pin scope, with the cursor from table_find_into(). Pages
+ * a split allocates need no latch: no reader can reach them before their
+ * parent or left sibling changes.
+ * @param frames Receives the latched frames (BTREE_MAX_DEPTH + 1 entries)
+ * @return Number of frames latched, or -1 on error (nothing is left latched)
+ */
+int btree_latch_path(Pager* pager, const Cursor* cursor, uint32_t* frames);
+/**
+ * Release count exclusive latches taken by btree_latch_path().
+ */
+void btree_unlatch_all(Pager* pager, const uint32_t* frames, int count);
+/**
+ * Advances cursor to the next cell, following the leaf sibling chain
+ * when the current leaf is exhausted.
  */
 void cursor_advance(Cursor* cursor);
 void* cursor_value(Cursor* cursor);
 
 // Modification operations
+/**
+ * Insert key/value at the cursor position. The cursor must come from
+ * table_find()/table_find_into() on the tree's root: the subtree counts
+ * of the ancestors on the cursor's path go up by one and, if the leaf is
+ * full, the split propagates up the path.
+ */
 void leaf_node_insert(Cursor* cursor, const char* key, const char* value);
+/**
+ * leaf_node_insert() of a record that expires at expires_at (seconds since
+ * the Unix epoch, 0 = never)
+ */
+void leaf_node_insert_expiring(Cursor* cursor, const char* key, const char* value, uint64_t expires_at);
+/**
+ * Remove cell cell_num from a leaf, shifting the cells after it left.
+ * Does not flush the page, nor change the subtree counts of the leaf's
+ * ancestors: see leaf_node_delete().
+ */
+void leaf_node_remove(void* node, uint32_t cell_num);
+/**
+ * Remove every cell of a leaf whose expiry time is at or before now, in
+ * one pass. Does not flush the page, nor change the subtree counts of the
+ * leaf's ancestors: see leaf_node_delete_expired().
+ * @return Number of cells removed
+ */
+uint32_t leaf_node_remove_expired(void* node, uint64_t now);
+/**
+ * Delete the record at the cursor, which must come from table_find_into()
+ * on the tree's root, and take it off the subtree counts of the ancestors
+ * on the cursor's path. Flushes every page it changes.
+ * @return 0 on success, -1 on error
+ */
+int leaf_node_delete(Cursor* cursor);
+/**
+ * leaf_node_remove_expired() on the cursor's leaf, with the subtree counts
+ * of its ancestors brought down by the number removed, as by
+ * leaf_node_delete().
+ * @return Number of records deleted, or -1 on error
+ */
+int leaf_node_delete_expired(Cursor* cursor, uint64_t now);
 void print_tree(Pager* pager, uint32_t page_num, uint32_t indentation_level);
 
+/**
+ * Key type of the tree whose root this is (KEY_TYPE_STRING for trees
+ * created before key types existed). Kept by root splits.
+ * @param width Set to the width of binary keys (0 for other types)
+ */
+KeyType root_node_key_type(void* root, uint32_t* width);
+void set_root_node_key_type(void* root, KeyType type, uint32_t width);
+
+/**
+ * Format version stamped on a root (0 where none was). Kept by root
+ * splits like the key type.
+ */
+uint16_t root_node_format(void* root);
+void set_root_node_format(void* root, uint16_t format);
+
+// How full the pages of a tree are, from btree_fill_stats()
+typedef struct {
+    uint32_t depth;          // Levels, leaves included
+    uint32_t leaf_pages;
+    uint32_t internal_pages;
+    uint64_t cells;          // Records in leaves
+    uint64_t separators;     // Keys in internal nodes
+    uint64_t internal_bytes; // Bytes used in internal nodes, headers included
+} BTreeFillStats;
+
+/**
+ * Walk the whole tree and count its pages and records.
+ * Leaf fill factor is cells / (leaf_pages * LEAF_NODE_MAX_CELLS); internal
+ * fill factor is internal_bytes / (internal_pages * PAGE_USABLE_SIZE).
+ * @return 0 on success, -1 if a page could not be read
+ */
+int btree_fill_stats(Pager* pager, uint32_t root_page_num, BTreeFillStats* stats);
+
 // Accessor functions
 uint32_t* leaf_node_num_cells(void* node);
+uint32_t* leaf_node_next_leaf(void* node);
 void* leaf_node_cell(void* node, uint32_t cell_num);
 char* leaf_node_key(void* node, uint32_t cell_num);
 char* leaf_node_value(void* node, uint32_t cell_num);
+/**
+ * Expiry time of a cell: seconds since the Unix epoch, 0 = never.
+ */
+uint64_t* leaf_node_expiry(void* node, uint32_t cell_num);
+/**
+ * Whether a cell's expiry time has come. Reads the clock only for cells
+ * that have one.
+ */
+bool leaf_node_expired(void* node, uint32_t cell_num);
+/**
+ * Index of the cell holding key in a leaf, or of the cell it would be
+ * inserted before if the leaf does not hold it.
+ */
+uint32_t leaf_node_find_cell(void* node, const char* key);
+/**
+ * Key heads of a leaf, one per cell, in key order.
+ */
+uint32_t* leaf_node_heads(void* node);
+uint32_t* internal_node_num_keys(void* node);
+uint32_t* internal_node_child(void* node, uint32_t child_num);
+/**
+ * Number of records in the subtree of child child_num of an internal node.
+ */
+uint32_t* internal_node_child_count(void* node, uint32_t child_num);
+/**
+ * Index of the child of an internal node whose subtree may hold key.
+ */
+uint32_t internal_node_find_child(void* node, const char* key);
+/**
+ * Copy separator key_num of an internal node, prefix included, into out
+ * (INTERNAL_NODE_KEY_SIZE bytes) as a NUL-terminated string.
+ * @return Length of the separator
+ */
+uint32_t internal_node_key_copy(void* node, uint32_t key_num, char* out);
 void set_node_root(void* node, bool is_root);
 bool is_node_root(void* node);
 NodeType get_node_type(void* node);
@@ -0,0 +1,222 @@
+#include "crc32c.h"
+#include <string.h>
+#include <stdatomic.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define CRC32C_X86 1
+#include <nmmintrin.h>
+#include <cpuid.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#define CRC32C_ARM 1
+#include <arm_acle.h>
+#endif
+
+#define CRC32C_POLY 0x82F63B78u // Reflected Castagnoli polynomial
+
+// The hardware paths checksum three lanes of CRC32C_LANE bytes at once to
+// hide the latency of the crc instruction; three lanes cover a 4 KiB page.
+#define CRC32C_LANE 1360
+
+// Tables are built on first use; threads may race to it (see crc32c_once)
+enum { CRC32C_UNBUILT, CRC32C_BUILDING, CRC32C_BUILT };
+
+static uint32_t crc32c_table[8][256];
+static _Atomic int crc32c_table_state = CRC32C_UNBUILT;
+// crc32c_lane_shift[k][b]: effect on the CRC register of byte k being b,
+// followed by CRC32C_LANE zero bytes
+static uint32_t crc32c_lane_shift[4][256];
+static _Atomic int crc32c_lane_shift_state = CRC32C_UNBUILT;
+
+// Run build once: the first caller builds, the others wait until it is done
+static void crc32c_once(_Atomic int* state, void (*build)(void)) {
+    if (atomic_load_explicit(state, memory_order_acquire) == CRC32C_BUILT) {
+        return;
+    }
+    int expected = CRC32C_UNBUILT;
+    if (atomic_compare_exchange_strong(state, &expected, CRC32C_BUILDING)) {
+        build();
+        atomic_store_explicit(state, CRC32C_BUILT, memory_order_release);
+        return;
+    }
+    while (atomic_load_explicit(state, memory_order_acquire) != CRC32C_BUILT) {
+        // A few microseconds of table building
+    }
+}
+
+static void crc32c_init_table(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (CRC32C_POLY & (0u - (crc & 1)));
+        }
+        crc32c_table[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int slice = 1; slice < 8; slice++) {
+            uint32_t prev = crc32c_table[slice - 1][i];
+            crc32c_table[slice][i] = (prev >> 8) ^ crc32c_table[0][prev & 0xFF];
+        }
+    }
+}
+
+// Slicing-by-8: eight table lookups per 8 input bytes
+static uint32_t crc32c_sw(uint32_t crc, const uint8_t* p, size_t len) {
+    crc32c_once(&crc32c_table_state, crc32c_init_table);
+    while (len >= 8) {
+        uint32_t lo;
+        uint32_t hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+        lo ^= crc; // Little-endian byte order assumed, as for the file format
+        crc = crc32c_table[7][lo & 0xFF] ^ crc32c_table[6][(lo >> 8) & 0xFF] ^
+              crc32c_table[5][(lo >> 16) & 0xFF] ^ crc32c_table[4][lo >> 24] ^
+              crc32c_table[3][hi & 0xFF] ^ crc32c_table[2][(hi >> 8) & 0xFF] ^
+              crc32c_table[1][(hi >> 16) & 0xFF] ^ crc32c_table[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = crc32c_table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if defined(CRC32C_X86) || defined(CRC32C_ARM)
+// The register is linear in its input, so the CRC of A followed by B is
+// shift(crc(A), |B|) ^ crc_from_zero(B). Build the shift for one lane.
+static void crc32c_init_lane_shift(void) {
+    static const uint8_t zeros[CRC32C_LANE];
+    uint32_t column[32];
+    for (int bit = 0; bit < 32; bit++) {
+        column[bit] = crc32c_sw(1u << bit, zeros, CRC32C_LANE);
+    }
+    for (int k = 0; k < 4; k++) {
+        for (uint32_t b = 0; b < 256; b++) {
+            uint32_t value = 0;
+            for (int bit = 0; bit < 8; bit++) {
+                if (b & (1u << bit)) {
+                    value ^= column[k * 8 + bit];
+                }
+            }
+            crc32c_lane_shift[k][b] = value;
+        }
+    }
+}
+
+static uint32_t crc32c_shift_lane(uint32_t crc) {
+    return crc32c_lane_shift[0][crc & 0xFF] ^ crc32c_lane_shift[1][(crc >> 8) & 0xFF] ^
+           crc32c_lane_shift[2][(crc >> 16) & 0xFF] ^ crc32c_lane_shift[3][crc >> 24];
+}
+#endif
+
+#if defined(CRC32C_X86)
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hw(uint32_t crc, const uint8_t* p, size_t len) {
+#if defined(__x86_64__)
+    if (len >= 3 * CRC32C_LANE) {
+        crc32c_once(&crc32c_lane_shift_state, crc32c_init_lane_shift);
+        do {
+            uint64_t a = crc;
+            uint64_t b = 0;
+            uint64_t c = 0;
+            for (size_t i = 0; i < CRC32C_LANE; i += 8) {
+                uint64_t wa;
+                uint64_t wb;
+                uint64_t wc;
+                memcpy(&wa, p + i, 8);
+                memcpy(&wb, p + CRC32C_LANE + i, 8);
+                memcpy(&wc, p + 2 * CRC32C_LANE + i, 8);
+                a = _mm_crc32_u64(a, wa);
+                b = _mm_crc32_u64(b, wb);
+                c = _mm_crc32_u64(c, wc);
+            }
+            crc = crc32c_shift_lane(crc32c_shift_lane((uint32_t)a) ^ (uint32_t)b) ^ (uint32_t)c;
+            p += 3 * CRC32C_LANE;
+            len -= 3 * CRC32C_LANE;
+        } while (len >= 3 * CRC32C_LANE);
+    }
+    uint64_t crc64 = crc;
+    while (len >= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+        p += 8;
+        len -= 8;
+    }
+    crc = (uint32_t)crc64;
+#endif
+    while (len--) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+
+static int crc32c_hw_available(void) {
+    static _Atomic int available = -1; // Threads may race to set it: same value
+    if (available < 0) {
+        unsigned int eax, ebx, ecx, edx;
+        available = __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_2) ? 1 : 0;
+    }
+    return available;
+}
+#elif defined(CRC32C_ARM)
+static uint32_t crc32c_hw(uint32_t crc, const uint8_t* p, size_t len) {
+    if (len >= 3 * CRC32C_LANE) {
+        crc32c_once(&crc32c_lane_shift_state, crc32c_init_lane_shift);
+        do {
+            uint32_t a = crc;
+            uint32_t b = 0;
+            uint32_t c = 0;
+            for (size_t i = 0; i < CRC32C_LANE; i += 8) {
+                uint64_t wa;
+                uint64_t wb;
+                uint64_t wc;
+                memcpy(&wa, p + i, 8);
+                memcpy(&wb, p + CRC32C_LANE + i, 8);
+                memcpy(&wc, p + 2 * CRC32C_LANE + i, 8);
+                a = __crc32cd(a, wa);
+                b = __crc32cd(b, wb);
+                c = __crc32cd(c, wc);
+            }
+            crc = crc32c_shift_lane(crc32c_shift_lane(a) ^ b) ^ c;
+            p += 3 * CRC32C_LANE;
+            len -= 3 * CRC32C_LANE;
+        } while (len >= 3 * CRC32C_LANE);
+    }
+    while (len >= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        crc = __crc32cd(crc, word);
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = __crc32cb(crc, *p++);
+    }
+    return crc;
+}
+
+static int crc32c_hw_available(void) {
+    return 1; // Compiled for a CPU with the CRC extension
+}
+#endif
+
+uint32_t crc32c(uint32_t crc, const void* data, size_t len) {
+    crc = ~crc;
+#if defined(CRC32C_X86) || defined(CRC32C_ARM)
+    if (crc32c_hw_available()) {
+        return ~crc32c_hw(crc, data, len);
+    }
+#endif
+    return ~crc32c_sw(crc, data, len);
+}
+
+const char* crc32c_implementation(void) {
+#if defined(CRC32C_X86)
+    return crc32c_hw_available() ? "sse4.2" : "table";
+#elif defined(CRC32C_ARM)
+    return "armv8";
+#else
+    return "table";
+#endif
+}
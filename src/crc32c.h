@@ -0,0 +1,23 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * CRC-32C (Castagnoli polynomial), as used by iSCSI, ext4 and many storage
+ * engines. Uses the SSE4.2 / ARMv8 CRC instructions when the CPU has them
+ * and a slicing-by-8 table otherwise; both give identical results.
+ *
+ * @param crc Previous result to continue a running checksum, 0 to start
+ * @return Checksum of data
+ */
+uint32_t crc32c(uint32_t crc, const void* data, size_t len);
+
+/**
+ * Name of the implementation crc32c() uses on this machine ("sse4.2",
+ * "armv8" or "table"), for benchmark output.
+ */
+const char* crc32c_implementation(void);
+
+#endif // CRC32C_H
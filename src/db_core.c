@@ -11,22 +11,577 @@
 #include <limits.h>
 #endif
 
-static Database db_instance;
+// Save the warm list if the save interval has elapsed. Checked every
+// DB_WARM_CHECK_OPS operations to keep time() off the lookup path.
+static void db_warm_tick(Database *db) {
+    if (!db->warm_restart || db->warm_save_interval == 0 ||
+        atomic_fetch_add_explicit(&db->warm_ops, 1, memory_order_relaxed) + 1 < DB_WARM_CHECK_OPS) {
+        return;
+    }
+    // One thread checks the timer; the others carry on
+    if (!latch_try_lock_exclusive(&db->warm_latch)) {
+        return;
+    }
+    atomic_store_explicit(&db->warm_ops, 0, memory_order_relaxed);
+    time_t now = time(NULL);
+    if (now - db->warm_saved_at >= (time_t)db->warm_save_interval) {
+        db->warm_saved_at = now;
+        pager_save_warm_list(db->pager, db->warm_path);
+    }
+    latch_unlock_exclusive(&db->warm_latch);
+}
+
+static int db_expiry_sweep_locked(Database *db, uint32_t max_leaves);
+
+// Take a step of the expiry sweep if a second has passed since the last
+// one. Checked every DB_EXPIRY_CHECK_OPS operations like the warm list
+// timer; the step is skipped while a write is in progress.
+static void db_expiry_tick(Database *db) {
+    if (db->expiry_sweep_leaves == 0 ||
+        atomic_fetch_add_explicit(&db->expiry_ops, 1, memory_order_relaxed) + 1 < DB_EXPIRY_CHECK_OPS) {
+        return;
+    }
+    if (!latch_try_lock_exclusive(&db->write_latch)) {
+        return;
+    }
+    atomic_store_explicit(&db->expiry_ops, 0, memory_order_relaxed);
+    time_t now = time(NULL);
+    if (now != db->expiry_swept_at) {
+        db->expiry_swept_at = now;
+        db_expiry_sweep_locked(db, db->expiry_sweep_leaves);
+    }
+    latch_unlock_exclusive(&db->write_latch);
+}
+
+// Timers checked on the way into every operation
+static void db_tick(Database *db) {
+    db_warm_tick(db);
+    db_expiry_tick(db);
+}
+
+// Whether the Bloom filter rules key out, so it need not be looked up
+static bool db_bloom_rules_out(Database *db, const char *key) {
+    BloomFilter *filter = atomic_load_explicit(&db->bloom, memory_order_acquire);
+    // A pending merge may be about to insert the key
+    if (!filter || bloom_may_contain(filter, key, strlen(key)) ||
+        atomic_load_explicit(&db->num_pending_merges, memory_order_acquire) > 0) {
+        return false;
+    }
+    atomic_fetch_add_explicit(&db->bloom_negatives, 1, memory_order_relaxed);
+    return true;
+}
+
+// Count a lookup of an absent key that the filter let through
+static void db_bloom_false_positive(Database *db) {
+    if (atomic_load_explicit(&db->bloom, memory_order_relaxed)) {
+        atomic_fetch_add_explicit(&db->bloom_false_positives, 1, memory_order_relaxed);
+    }
+}
+
+static int db_bloom_add_record(const char *key, const char *value, void *arg) {
+    (void)value;
+    bloom_add(arg, key, strlen(key));
+    return 0;
+}
+
+// Build a filter for capacity keys from the tree. For the writer between
+// two writes, or at open. A filter of the current size is refreshed in
+// place (its live keys are a subset of what it holds); a larger one
+// replaces it, and the old one stays allocated for readers still in it.
+static int db_bloom_rebuild(Database *db, uint64_t capacity) {
+    BloomFilter *filter = bloom_create(capacity, db->bloom_bits_per_key);
+    if (!filter) {
+        return -1;
+    }
+    if (table_scan_version(db->pager, 0, db->pager->versions.epoch, NULL, db_bloom_add_record, filter) < 0) {
+        bloom_destroy(filter);
+        return -1;
+    }
+    BloomFilter *current = atomic_load_explicit(&db->bloom, memory_order_relaxed);
+    if (current && current->num_blocks == filter->num_blocks && current->num_hashes == filter->num_hashes) {
+        bloom_assign(current, filter);
+        bloom_destroy(filter);
+    } else {
+        filter->replaced = current;
+        atomic_store_explicit(&db->bloom, filter, memory_order_release);
+    }
+    db->bloom_deletes = 0;
+    return 0;
+}
+
+// Rebuild the filter once it holds more keys than it was sized for, or
+// enough deleted keys to raise its false positive rate. Writer only.
+static void db_bloom_maintain(Database *db) {
+    BloomFilter *filter = atomic_load_explicit(&db->bloom, memory_order_relaxed);
+    if (!filter) {
+        return;
+    }
+    if (filter->keys > filter->capacity) {
+        db_bloom_rebuild(db, filter->capacity * 2);
+    } else if (db->bloom_deletes > filter->capacity / 2) {
+        db_bloom_rebuild(db, filter->capacity);
+    }
+}
+
+// Load the saved filter, or build one from the tree
+static void db_bloom_open(Database *db) {
+    BloomFilter *filter = bloom_load(db->bloom_path, db->pager->num_pages);
+    // Until close the file would miss new keys: a crash must not leave it behind
+    remove(db->bloom_path);
+    if (filter) {
+        atomic_store_explicit(&db->bloom, filter, memory_order_release);
+        return;
+    }
+    uint64_t capacity = (uint64_t)db->pager->num_pages * LEAF_NODE_MAX_CELLS;
+    if (db_bloom_rebuild(db, capacity > DB_BLOOM_MIN_KEYS ? capacity : DB_BLOOM_MIN_KEYS) != 0) {
+        fprintf(stderr, "Warning: Failed to build the Bloom filter; lookups go to the tree\n");
+    }
+}
+
+int db_bloom_stats(Database *db, DbBloomStats *stats) {
+    if (!db || !stats) {
+        return STATUS_ERROR;
+    }
+    memset(stats, 0, sizeof(*stats));
+    // The key count belongs to the writer
+    latch_lock_exclusive(&db->write_latch);
+    BloomFilter *filter = atomic_load_explicit(&db->bloom, memory_order_relaxed);
+    if (filter) {
+        stats->enabled = true;
+        stats->keys = filter->keys;
+        stats->capacity = filter->capacity;
+        stats->hashes = filter->num_hashes;
+        stats->memory_bytes = bloom_memory(filter);
+        stats->expected_fp_rate = bloom_expected_fp_rate(filter);
+    }
+    latch_unlock_exclusive(&db->write_latch);
+    stats->negatives = atomic_load_explicit(&db->bloom_negatives, memory_order_relaxed);
+    stats->false_positives = atomic_load_explicit(&db->bloom_false_positives, memory_order_relaxed);
+    uint64_t absent = stats->negatives + stats->false_positives;
+    stats->observed_fp_rate = absent ? (double)stats->false_positives / absent : 0.0;
+    return STATUS_OK;
+}
+
+// Hash of key for the hash index and the row cache, 0 if both are off
+static uint64_t db_key_hash(Database *db, const char *key) {
+    return (db->hash_index || db->row_cache) ? key_hash(key, strlen(key)) : 0;
+}
+
+// Look up where the hash index last saw key
+static bool db_hash_index_find(Database *db, uint64_t hash, uint32_t *page_num, uint32_t *cell_num) {
+    return db->hash_index && hash_index_find(db->hash_index, hash, page_num, cell_num);
+}
+
+// Remember where a lookup that descended the tree found key
+static void db_hash_index_record(Database *db, uint64_t hash, uint32_t page_num, uint32_t cell_num, bool stale) {
+    if (db->hash_index) {
+        hash_index_record(db->hash_index, hash, page_num, cell_num, stale);
+    }
+}
+
+// Latch shared the leaf the hash index points to for key, if its cell still
+// holds key. Call inside a pager pin scope. On a miss nothing stays latched
+// and *stale tells whether an entry was followed.
+static void *db_hash_index_latch(Database *db, const char *key, uint64_t hash, bool *stale, uint32_t *page_num,
+                                 uint32_t *cell_num, uint32_t *frame) {
+    *stale = false;
+    if (!db_hash_index_find(db, hash, page_num, cell_num)) {
+        return NULL;
+    }
+    void *page = pager_latch_page(db->pager, *page_num, PAGER_LATCH_SHARED, frame);
+    if (!page) {
+        return NULL;
+    }
+    if (get_node_type(page) == NODE_LEAF && *cell_num < *leaf_node_num_cells(page) &&
+        strcmp(key, leaf_node_key(page, *cell_num)) == 0 && !leaf_node_expired(page, *cell_num)) {
+        hash_index_hit(db->hash_index);
+        return page;
+    }
+    pager_unlatch_frame(db->pager, *frame, PAGER_LATCH_SHARED);
+    pager_scope_unpin(db->pager, *frame);
+    *stale = true;
+    return NULL;
+}
+
+// Copy key's value from the row cache. On a miss *generation is set for
+// db_row_cache_fill.
+static bool db_row_cache_get(Database *db, uint64_t hash, const char *key, char *buf, size_t cap, size_t *length,
+                             uint64_t *generation) {
+    *generation = 0;
+    return db->row_cache && row_cache_get(db->row_cache, hash, key, buf, cap, length, generation);
+}
+
+// Cache a value a lookup read from the tree after a row cache miss
+static void db_row_cache_fill(Database *db, uint64_t hash, const char *key, const char *value,
+                              uint64_t generation) {
+    if (db->row_cache) {
+        row_cache_put(db->row_cache, hash, key, value, generation);
+    }
+}
+
+// Drop key from the row cache after a write to it. Writer only, once the
+// write has ended, whatever its status: one that failed may still have
+// changed the tree for a while, and readers cached what they found.
+static void db_row_cache_invalidate(Database *db, const char *key) {
+    if (db->row_cache) {
+        row_cache_invalidate(db->row_cache, key_hash(key, strlen(key)), key);
+    }
+}
+
+int db_cache_stats(Database *db, DbCacheStats *stats) {
+    if (!db || !stats) {
+        return STATUS_ERROR;
+    }
+    memset(stats, 0, sizeof(*stats));
+    pager_get_stats(db->pager, &stats->pages);
+    stats->page_frames = db->pager->num_frames;
+    stats->page_bytes = (size_t)db->pager->num_frames * PAGE_SIZE;
+    if (db->row_cache) {
+        row_cache_get_stats(db->row_cache, &stats->rows);
+    }
+    return STATUS_OK;
+}
+
+int db_hash_index_stats(Database *db, HashIndexStats *stats) {
+    if (!db || !stats) {
+        return STATUS_ERROR;
+    }
+    memset(stats, 0, sizeof(*stats));
+    if (db->hash_index) {
+        hash_index_get_stats(db->hash_index, stats);
+    }
+    return STATUS_OK;
+}
+
+int db_save_warm_list(Database *db) {
+    if (!db || !db->warm_restart) {
+        return STATUS_ERROR;
+    }
+    db->warm_saved_at = time(NULL);
+    int saved = pager_save_warm_list(db->pager, db->warm_path);
+    return saved < 0 ? STATUS_ERROR : saved;
+}
+
+// Give a new database the key type of the options and the format version,
+// or check that an existing one has this version and that the options
+// agree with the type it was created with
+static int db_open_key_type(Database *db, const DbOptions *options, bool created) {
+    KeyType type = options ? options->key_type : KEY_TYPE_STRING;
+    uint32_t width = type == KEY_TYPE_BINARY ? options->key_width : 0;
+    if (type > KEY_TYPE_BINARY || (type == KEY_TYPE_BINARY && (width == 0 || width > KEY_BINARY_MAX_WIDTH))) {
+        fprintf(stderr, "Error: Invalid key type %d (binary keys are 1 to %d bytes)\n", (int)type,
+                KEY_BINARY_MAX_WIDTH);
+        return -1;
+    }
+    void *root = pager_get_page(db->pager, 0);
+    if (!root) {
+        return -1;
+    }
+    if (created) {
+        set_root_node_key_type(root, type, width);
+        set_root_node_format(root, DB_FORMAT_VERSION);
+    } else {
+        uint16_t format = root_node_format(root);
+        if (format != DB_FORMAT_VERSION) {
+            fprintf(stderr, "Error: Database '%s' has format version %u, this build reads %u\n", db->filename,
+                    (unsigned)format, (unsigned)DB_FORMAT_VERSION);
+            return -1;
+        }
+        uint32_t stored_width;
+        KeyType stored = root_node_key_type(root, &stored_width);
+        // Default options open a database of any type
+        if (type != KEY_TYPE_STRING && (type != stored || width != stored_width)) {
+            fprintf(stderr, "Error: Database '%s' has %s keys\n", db->filename, key_type_name(stored));
+            return -1;
+        }
+        type = stored;
+        width = stored_width;
+    }
+    db->key_type = type;
+    db->key_width = width;
+    return 0;
+}
+
+int db_key_u64(const Database *db, uint64_t value, char key[MAX_KEY_LEN]) {
+    if (!db || !key || db->key_type != KEY_TYPE_U64) {
+        return STATUS_ERROR;
+    }
+    key_encode_u64(value, key);
+    return STATUS_OK;
+}
+
+int db_key_i64(const Database *db, int64_t value, char key[MAX_KEY_LEN]) {
+    if (!db || !key || db->key_type != KEY_TYPE_I64) {
+        return STATUS_ERROR;
+    }
+    key_encode_i64(value, key);
+    return STATUS_OK;
+}
+
+int db_key_binary(const Database *db, const void *data, size_t len, char key[MAX_KEY_LEN]) {
+    if (!db || !data || !key || db->key_type != KEY_TYPE_BINARY || len != db->key_width) {
+        return STATUS_ERROR;
+    }
+    key_encode_binary(data, len, key);
+    return STATUS_OK;
+}
+
+int db_key_parse(const Database *db, const char *text, char key[MAX_KEY_LEN]) {
+    if (!db || !text || !key) {
+        return STATUS_ERROR;
+    }
+    return key_parse(db->key_type, db->key_width, text, key) ? STATUS_OK : STATUS_ERROR;
+}
+
+void db_key_format(const Database *db, const char *key, char *buf, size_t cap) {
+    if (db && key && buf) {
+        key_format(db->key_type, db->key_width, key, buf, cap);
+    }
+}
+
+// Whether key belongs to the table catalog, which lives in the default
+// tree; such keys are refused to callers of the default tree's functions
+static bool db_catalog_key(const char *key) {
+    if (key[0] == DB_CATALOG_KEY_PREFIX) {
+        fprintf(stderr, "Error: Keys starting with byte 0x%02x are reserved for the table catalog\n",
+                DB_CATALOG_KEY_PREFIX);
+        return true;
+    }
+    return false;
+}
+
+// Catalog key of a table: the prefix byte, then its name
+static void db_catalog_key_of(const char *name, char key[MAX_KEY_LEN]) {
+    key[0] = DB_CATALOG_KEY_PREFIX;
+    strcpy(key + 1, name);
+}
+
+// Add a table read from the catalog or just created to db->tables
+static int db_tables_add(Database *db, const char *name, uint32_t root_page) {
+    void *root = pager_get_page(db->pager, root_page);
+    if (!root || !is_node_root(root)) {
+        fprintf(stderr, "Error: Table '%s' has no root at page %u\n", name, root_page);
+        return -1;
+    }
+    // Grown under the latch: readers may be in the old list
+    latch_lock_exclusive(&db->tables_latch);
+    DbTable *tables = realloc(db->tables, (db->num_tables + 1) * sizeof(DbTable));
+    if (!tables) {
+        latch_unlock_exclusive(&db->tables_latch);
+        fprintf(stderr, "Error: Failed to allocate table list\n");
+        return -1;
+    }
+    DbTable *table = &tables[db->num_tables];
+    memset(table, 0, sizeof(*table));
+    strncpy(table->name, name, DB_TABLE_NAME_MAX);
+    table->root_page = root_page;
+    table->key_type = root_node_key_type(root, &table->key_width);
+    db->tables = tables;
+    db->num_tables++;
+    latch_unlock_exclusive(&db->tables_latch);
+    return 0;
+}
+
+// Add an index read from the catalog or just created to db->indexes
+static int db_indexes_add(Database *db, const DbIndex *index) {
+    void *root = pager_get_page(db->pager, index->root_page);
+    if (!root || !is_node_root(root)) {
+        fprintf(stderr, "Error: Index '%s' has no root at page %u\n", index->name, index->root_page);
+        return -1;
+    }
+    latch_lock_exclusive(&db->tables_latch);
+    DbIndex *indexes = realloc(db->indexes, (db->num_indexes + 1) * sizeof(DbIndex));
+    if (!indexes) {
+        latch_unlock_exclusive(&db->tables_latch);
+        fprintf(stderr, "Error: Failed to allocate index list\n");
+        return -1;
+    }
+    indexes[db->num_indexes] = *index;
+    db->indexes = indexes;
+    db->num_indexes++;
+    latch_unlock_exclusive(&db->tables_latch);
+    return 0;
+}
+
+// Take an index out of db->indexes. Scans that copied its entry keep
+// reading its pages, which nothing reuses.
+static void db_indexes_remove(Database *db, const char *name) {
+    latch_lock_exclusive(&db->tables_latch);
+    for (uint32_t i = 0; i < db->num_indexes; i++) {
+        if (strcmp(db->indexes[i].name, name) == 0) {
+            memmove(&db->indexes[i], &db->indexes[i + 1], (db->num_indexes - i - 1) * sizeof(DbIndex));
+            db->num_indexes--;
+            break;
+        }
+    }
+    latch_unlock_exclusive(&db->tables_latch);
+}
+
+// Copy the entry of an index, if there is one
+static bool db_indexes_find(Database *db, const char *name, DbIndex *index) {
+    bool found = false;
+    latch_lock_shared(&db->tables_latch);
+    for (uint32_t i = 0; i < db->num_indexes && !found; i++) {
+        if (strcmp(db->indexes[i].name, name) == 0) {
+            *index = db->indexes[i];
+            found = true;
+        }
+    }
+    latch_unlock_shared(&db->tables_latch);
+    return found;
+}
+
+// Copy the entry of a table, if there is one
+static bool db_tables_find(Database *db, const char *name, DbTable *table) {
+    bool found = false;
+    latch_lock_shared(&db->tables_latch);
+    for (uint32_t i = 0; i < db->num_tables && !found; i++) {
+        if (strcmp(db->tables[i].name, name) == 0) {
+            *table = db->tables[i];
+            found = true;
+        }
+    }
+    latch_unlock_shared(&db->tables_latch);
+    return found;
+}
+
+// db_tables_find() for the table functions, which report a missing table
+static bool db_table_lookup(Database *db, const char *name, DbTable *table) {
+    if (!name || !db_tables_find(db, name, table)) {
+        fprintf(stderr, "Error: No table '%s'\n", name ? name : "(null)");
+        return false;
+    }
+    return true;
+}
+
+// Read the catalog record of an index: "<root> <delimiter> <field> <table>",
+// the delimiter as a byte value and the table empty for the default tree
+static bool db_catalog_parse_index(const char *name, const char *value, DbIndex *index) {
+    unsigned int root_page, delimiter, field;
+    int table_at;
+    if (sscanf(value, "%u %u %u %n", &root_page, &delimiter, &field, &table_at) != 3 || delimiter > 0xFF ||
+        strlen(value + table_at) > DB_TABLE_NAME_MAX) {
+        return false;
+    }
+    memset(index, 0, sizeof(*index));
+    strncpy(index->name, name, DB_TABLE_NAME_MAX);
+    index->root_page = root_page;
+    index->delimiter = (char)delimiter;
+    index->field = field;
+    strcpy(index->table, value + table_at);
+    return true;
+}
+
+static bool db_analysis_parse(const char *value, DbAnalysis *analysis);
+
+// Catalog records are the first keys of the default tree; stop after them.
+// Indexes are added with table_root unset, see db_catalog_load.
+static int db_catalog_load_record(const char *key, const char *value, void *arg) {
+    if (key[0] != DB_CATALOG_KEY_PREFIX) {
+        return 1;
+    }
+    Database *db = arg;
+    if (key[1] == DB_CATALOG_KEY_PREFIX) {
+        // Metadata of the database itself; unknown kinds are left alone
+        if (strcmp(key, DB_ANALYSIS_KEY) == 0) {
+            db->has_analysis = db_analysis_parse(value, &db->analysis);
+            if (!db->has_analysis) {
+                fprintf(stderr, "Warning: Stored analysis is damaged; run ANALYZE again\n");
+            }
+        }
+        return 0;
+    }
+    char *end;
+    unsigned long root_page = strtoul(value, &end, 10);
+    if (*end == ' ') {
+        DbIndex index;
+        if (!db_catalog_parse_index(key + 1, value, &index) || index.root_page == 0 ||
+            index.root_page >= db->pager->num_pages) {
+            fprintf(stderr, "Warning: Catalog record of index '%s' is damaged; index skipped\n", key + 1);
+        } else if (db_indexes_add(db, &index) != 0) {
+            fprintf(stderr, "Warning: Index '%s' skipped\n", key + 1);
+        }
+        return 0;
+    }
+    if (*end != '\0' || root_page == 0 || root_page >= db->pager->num_pages) {
+        fprintf(stderr, "Warning: Catalog record of table '%s' is damaged; table skipped\n", key + 1);
+        return 0;
+    }
+    if (db_tables_add(db, key + 1, (uint32_t)root_page) != 0) {
+        fprintf(stderr, "Warning: Table '%s' skipped\n", key + 1);
+    }
+    return 0;
+}
+
+// Read the table catalog into db->tables
+static int db_catalog_load(Database *db) {
+    uint64_t epoch = page_versions_acquire(&db->pager->versions, db->pager->num_pages);
+    if (epoch == UINT64_MAX) {
+        return -1;
+    }
+    const char start[2] = { DB_CATALOG_KEY_PREFIX, '\0' };
+    int64_t visited = table_scan_version(db->pager, 0, epoch, start, db_catalog_load_record, db);
+    page_versions_release(&db->pager->versions, epoch);
+    if (visited < 0) {
+        return -1;
+    }
+    // Now that every table is known, find the roots the indexes cover
+    for (uint32_t i = 0; i < db->num_indexes;) {
+        DbIndex *index = &db->indexes[i];
+        DbTable table;
+        if (index->table[0] == '\0') {
+            index->table_root = 0;
+        } else if (db_tables_find(db, index->table, &table)) {
+            index->table_root = table.root_page;
+        } else {
+            fprintf(stderr, "Warning: Index '%s' is of missing table '%s'; index skipped\n", index->name,
+                    index->table);
+            db_indexes_remove(db, index->name);
+            continue;
+        }
+        i++;
+    }
+    return 0;
+}
+
+// Deferred merges, with db_incr below
+static void db_merges_fold(Database *db);
+static void db_merges_settle(Database *db);
+static void db_merges_recover(Database *db);
+static void db_merges_relog(Database *db);
 
 // Open or create a database
 Database* db_open(const char *filename) {
+    return db_open_with_options(filename, NULL);
+}
+
+Database* db_open_with_options(const char *filename, const DbOptions *options) {
     if (!filename) {
         fprintf(stderr, "Error: Filename is NULL in db_open\n");
         return NULL;
     }
 
-    Database *db = &db_instance;
+    Database *db = calloc(1, sizeof(Database));
+    if (!db) {
+        fprintf(stderr, "Error: Failed to allocate database handle\n");
+        return NULL;
+    }
     strncpy(db->filename, filename, MAX_FILENAME_LEN - 1);
     db->filename[MAX_FILENAME_LEN - 1] = '\0';
+    db->warm_restart = options && options->warm_restart;
+    db->warm_save_interval = options ? options->warm_save_interval : 0;
+    atomic_init(&db->warm_ops, 0);
+    db->warm_saved_at = time(NULL);
+    latch_init(&db->warm_latch);
+    latch_init(&db->write_latch);
+    latch_init(&db->tables_latch);
+    latch_init(&db->merge_sync_latch);
+    snprintf(db->warm_path, sizeof(db->warm_path), "%.*s.warm", MAX_FILENAME_LEN - 1, db->filename);
 
     // Open Pager
-    db->pager = pager_open(filename);
+    db->pager = pager_open_with_options(filename, options ? &options->pager : NULL);
     if (!db->pager) {
+        free(db);
         return NULL;
     }
 
@@ -35,245 +590,2411 @@ Database* db_open(const char *filename) {
     if (db->wal) {
         pager_set_wal(db->pager, db->wal);
         
-        // Checkpoint WAL on startup to recover any unsaved changes
+        // Checkpoint WAL on startup to recover any unsaved changes. Merge
+        // operands not yet folded are kept across it.
+        db_merges_recover(db);
         wal_checkpoint(db->wal, db->pager);
+        db_merges_relog(db);
     }
+    db->deferred_merges = options && options->deferred_merges;
+    db->expiry_sweep_leaves = options ? options->expiry_sweep_leaves : 0;
+    db->expiry_swept_at = time(NULL);
+    atomic_init(&db->expiry_ops, 0);
 
-    // Initialize root page if new database
-    if (db->pager->num_pages == 0) {
+    // Initialize root page if new database. Only after recovery: a file
+    // left empty by a crash may have its whole tree in the WAL.
+    bool created = db->pager->num_pages == 0;
+    if (created) {
         void* root_node = pager_get_page(db->pager, 0);
         if (!root_node) {
             fprintf(stderr, "Error: Failed to initialize root page\n");
             pager_close(db->pager);
             if (db->wal) wal_close(db->wal);
+            free(db);
             return NULL;
         }
         leaf_node_init(root_node);
         set_node_root(root_node, true);
+    } else if (db->warm_restart) {
+        // After recovery, so pages come from the checkpointed file
+        pager_load_warm_list(db->pager, db->warm_path);
+    }
+    if (db_open_key_type(db, options, created) != 0 || (!created && db_catalog_load(db) != 0)) {
+        db->warm_restart = false;
+        db_close(db);
+        return NULL;
+    }
+
+    db->bloom_bits_per_key = options ? options->bloom_bits_per_key : 0;
+    snprintf(db->bloom_path, sizeof(db->bloom_path), "%.*s.bloom", MAX_FILENAME_LEN - 1, db->filename);
+    if (db->bloom_bits_per_key > 0) {
+        db_bloom_open(db);
+    } else {
+        // Writes made without the filter would not reach a saved copy,
+        // and inserts into existing leaves leave its page count tag
+        // matching: drop it
+        remove(db->bloom_path);
+    }
+
+    if (options && options->row_cache_bytes > 0) {
+        db->row_cache = row_cache_create(options->row_cache_bytes);
+        if (!db->row_cache) {
+            fprintf(stderr, "Warning: Row cache is off; values are read from pages\n");
+        }
+    }
+
+    if (options && options->hash_index_entries > 0) {
+        db->hash_index = hash_index_create(options->hash_index_entries);
+        if (!db->hash_index) {
+            fprintf(stderr, "Warning: Hash index is off; lookups descend the tree\n");
+        }
     }
 
     return db;
 }
 
-// Close database and save to disk
+// Close database, save to disk and free the handle
 void db_close(Database *db) {
     if (!db) return;
 
+    if (db->warm_restart) {
+        db_save_warm_list(db);
+    }
+
     if (db->wal) {
+        // The checkpoint drops merge operands: fold them first
+        db_merges_settle(db);
         wal_checkpoint(db->wal, db->pager);
         wal_close(db->wal);
         // Clear the WAL pointer to prevent pager_close from trying to flush to a closed WAL
         pager_set_wal(db->pager, NULL);
     }
 
+    BloomFilter *filter = atomic_load_explicit(&db->bloom, memory_order_relaxed);
+    if (filter) {
+        // Tagged with the page count so a copy that outlived changes made
+        // without it is not trusted
+        bloom_save(filter, db->bloom_path, db->pager->num_pages);
+        bloom_destroy(filter);
+    }
+    hash_index_destroy(db->hash_index);
+    row_cache_destroy(db->row_cache);
+    free(db->tables);
+    free(db->indexes);
+    free(db->pending_merges);
+
     if (db->pager) {
         pager_close(db->pager);
     }
+    free(db);
 }
 
-// Insert a new key-value pair
-int db_insert(Database *db, const char *key, const char *value) {
-    if (!db || !key || !value) {
+// Open the WAL transaction that every page a write changes is logged in,
+// so recovery finds all of them (a record, its index entries, the pages of
+// a split) or none. With the write latch held; pair with db_write_end.
+static int db_txn_begin(Database *db) {
+    if (pager_txn_begin(db->pager) != 0) {
         return STATUS_ERROR;
     }
+    // Pending merges go first and commit with the write: recovery takes
+    // the operands logged before a committed page transaction as folded
+    db_merges_fold(db);
+    return STATUS_OK;
+}
 
-    // Validate key and value lengths to prevent buffer overflows
-    if (strlen(key) >= MAX_KEY_LEN) {
-        fprintf(stderr, "Error: Key too long (max %d chars)\n", MAX_KEY_LEN - 1);
+// Start a write: take the write latch and open its transaction. Pair with
+// db_write_end.
+static int db_write_begin(Database *db) {
+    latch_lock_exclusive(&db->write_latch);
+    if (db_txn_begin(db) != STATUS_OK) {
+        latch_unlock_exclusive(&db->write_latch);
         return STATUS_ERROR;
     }
-    if (strlen(value) >= MAX_VALUE_LEN) {
-        fprintf(stderr, "Error: Value too long (max %d chars)\n", MAX_VALUE_LEN - 1);
-        return STATUS_ERROR;
+    return STATUS_OK;
+}
+
+// Commit the write's WAL transaction with one sync and let snapshots see
+// it. A write that failed (STATUS_ERROR) may have changed some of its
+// pages (its record, say, but not its index entry): its transaction is
+// aborted instead, pages folded from pending merges included, so the
+// merges stay pending. The write latch stays held.
+// @return status, or STATUS_ERROR if the commit failed
+static int db_write_end(Database *db, int status) {
+    if (status == STATUS_ERROR) {
+        if (db->wal && pager_txn_abort(db->pager) != 0) {
+            fprintf(stderr, "Error: Failed to roll back a failed write\n");
+        }
+        // Readers may have cached a value the write folded and took back
+        uint32_t count = atomic_load_explicit(&db->num_pending_merges, memory_order_relaxed);
+        for (uint32_t i = 0; i < count; i++) {
+            db_row_cache_invalidate(db, db->pending_merges[i].key);
+        }
+    } else {
+        if (pager_txn_commit(db->pager) != 0) {
+            fprintf(stderr, "Error: Failed to commit the write to the WAL\n");
+            status = STATUS_ERROR;
+        }
+        // The cached pages hold the folded merges either way
+        atomic_store_explicit(&db->num_pending_merges, 0, memory_order_release);
     }
+    page_versions_commit(&db->pager->versions);
+    return status;
+}
 
-    Cursor* cursor = table_find(db->pager, 0, key);
-    if (!cursor) {
-        return STATUS_ERROR;
+// Copy the value of key in the tree rooted at root_page into buf
+// (MAX_VALUE_LEN bytes). For the writer, inside a pin scope: no other
+// thread changes pages under it.
+static bool db_read_locked(Database *db, uint32_t root_page, const char *key, char *buf) {
+    Cursor cursor;
+    if (table_find_into(db->pager, root_page, key, &cursor) != 0) {
+        return false;
     }
-    
-    void* page = pager_get_page(db->pager, cursor->page_num);
+    void *page = pager_get_page(db->pager, cursor.page_num);
+    if (!page || cursor.cell_num >= *leaf_node_num_cells(page) ||
+        strcmp(key, leaf_node_key(page, cursor.cell_num)) != 0 || leaf_node_expired(page, cursor.cell_num)) {
+        return false;
+    }
+    snprintf(buf, MAX_VALUE_LEN, "%s", leaf_node_value(page, cursor.cell_num));
+    return true;
+}
+
+// Overwrite the value of a cell in place: only the leaf changes. With the
+// write latch held, inside a pin scope.
+static int db_leaf_set_value(Database *db, uint32_t page_num, uint32_t cell_num, const char *value) {
+    uint32_t frame;
+    void *page = pager_latch_page(db->pager, page_num, PAGER_LATCH_EXCLUSIVE, &frame);
     if (!page) {
-        free(cursor);
         return STATUS_ERROR;
     }
-    
-    // Check if key already exists
-    if (cursor->cell_num < *leaf_node_num_cells(page)) {
-        char* key_at_index = leaf_node_key(page, cursor->cell_num);
-        if (strcmp(key, key_at_index) == 0) {
-            free(cursor);
-            return STATUS_EXISTS;
+    char* value_at = leaf_node_value(page, cell_num);
+    strncpy(value_at, value, LEAF_NODE_VALUE_SIZE - 1);
+    value_at[LEAF_NODE_VALUE_SIZE - 1] = '\0';
+    pager_flush(db->pager, page_num);
+    pager_unlatch_frame(db->pager, frame, PAGER_LATCH_EXCLUSIVE);
+    return STATUS_OK;
+}
+
+// Whether the tree rooted at root_page has indexes. Writer only: the
+// writer is the one to change the index list.
+static bool db_tree_indexed(Database *db, uint32_t root_page) {
+    for (uint32_t i = 0; i < db->num_indexes; i++) {
+        if (db->indexes[i].table_root == root_page) {
+            return true;
         }
     }
-
-    leaf_node_insert(cursor, key, value);
-    free(cursor);
-    return STATUS_OK;
+    return false;
 }
 
-// Get value by key
-const char* db_get(Database *db, const char *key) {
-    if (!db || !key) {
-        return NULL;
+static int db_indexes_update(Database *db, uint32_t root_page, const char *key, const char *old_value,
+                             const char *new_value);
+
+// Put a new record in place of an expired one at cell_num: the leaf is
+// the only page that changes. The expired record's index entries go, and
+// the caller adds the new record's as for an insert. With the write latch
+// held, inside a pin scope.
+static int db_expired_replace(Database *db, uint32_t root_page, uint32_t page_num, uint32_t cell_num,
+                              const char *value, uint64_t expires_at) {
+    void *page = pager_get_page(db->pager, page_num);
+    if (!page) {
+        return STATUS_ERROR;
+    }
+    char key[MAX_KEY_LEN];
+    char old_value[MAX_VALUE_LEN];
+    snprintf(key, sizeof(key), "%s", leaf_node_key(page, cell_num));
+    snprintf(old_value, sizeof(old_value), "%s", leaf_node_value(page, cell_num));
+    uint32_t frame;
+    page = pager_latch_page(db->pager, page_num, PAGER_LATCH_EXCLUSIVE, &frame);
+    if (!page) {
+        return STATUS_ERROR;
     }
+    char* value_at = leaf_node_value(page, cell_num);
+    strncpy(value_at, value, LEAF_NODE_VALUE_SIZE - 1);
+    value_at[LEAF_NODE_VALUE_SIZE - 1] = '\0';
+    *leaf_node_expiry(page, cell_num) = expires_at;
+    pager_flush(db->pager, page_num);
+    pager_unlatch_frame(db->pager, frame, PAGER_LATCH_EXCLUSIVE);
 
-    Cursor* cursor = table_find(db->pager, 0, key);
-    if (!cursor) {
-        return NULL;
+    // Filters rebuilt since it expired may have left the key out
+    BloomFilter *filter = atomic_load_explicit(&db->bloom, memory_order_relaxed);
+    if (filter && root_page == 0) {
+        bloom_add(filter, key, strlen(key));
+    }
+    return db_indexes_update(db, root_page, key, old_value, NULL);
+}
+
+// Insert into the tree rooted at root_page with the write latch held,
+// inside a pin scope. A record that has expired is replaced.
+static int db_insert_expiring_locked(Database *db, uint32_t root_page, const char *key, const char *value,
+                                     uint64_t expires_at) {
+    Cursor cursor;
+    if (table_find_into(db->pager, root_page, key, &cursor) != 0) {
+        return STATUS_ERROR;
     }
     
-    void* page = pager_get_page(db->pager, cursor->page_num);
+    void* page = pager_get_page(db->pager, cursor.page_num);
     if (!page) {
-        free(cursor);
-        return NULL;
+        return STATUS_ERROR;
     }
     
-    uint32_t num_cells = *leaf_node_num_cells(page);
-    
-    if (cursor->cell_num < num_cells) {
-        char* key_at_index = leaf_node_key(page, cursor->cell_num);
+    // Check if key already exists
+    if (cursor.cell_num < *leaf_node_num_cells(page)) {
+        char* key_at_index = leaf_node_key(page, cursor.cell_num);
         if (strcmp(key, key_at_index) == 0) {
-            char* value = leaf_node_value(page, cursor->cell_num);
-            free(cursor);
-            return value;
+            if (!leaf_node_expired(page, cursor.cell_num)) {
+                return STATUS_EXISTS;
+            }
+            return db_expired_replace(db, root_page, cursor.page_num, cursor.cell_num, value, expires_at);
         }
     }
-    
-    free(cursor);
-    return NULL;
+
+    // Before the key can be found, so the filter never rules out a key
+    // that exists. It covers the default tree only.
+    BloomFilter *filter = atomic_load_explicit(&db->bloom, memory_order_relaxed);
+    if (filter && root_page == 0) {
+        bloom_add(filter, key, strlen(key));
+    }
+
+    // Keep readers off the pages the insert (and any split) changes
+    uint32_t frames[BTREE_MAX_DEPTH + 1];
+    int latched = btree_latch_path(db->pager, &cursor, frames);
+    if (latched < 0) {
+        return STATUS_ERROR;
+    }
+    leaf_node_insert_expiring(&cursor, key, value, expires_at);
+    btree_unlatch_all(db->pager, frames, latched);
+    return STATUS_OK;
 }
-// Delete a key-value pair
-int db_delete(Database *db, const char *key) {
-    if (!db || !key) {
+
+static int db_insert_locked(Database *db, uint32_t root_page, const char *key, const char *value) {
+    return db_insert_expiring_locked(db, root_page, key, value, 0);
+}
+
+// Insert a new key-value pair
+int db_insert(Database *db, const char *key, const char *value) {
+    return db_insert_expiring(db, key, value, 0);
+}
+
+// Insert a key-value pair with an expiry time
+int db_insert_expiring(Database *db, const char *key, const char *value, time_t expires_at) {
+    if (!db || !key || !value || expires_at < 0) {
         return STATUS_ERROR;
     }
+    db_tick(db);
 
-    // Find the key in the B-tree
-    Cursor* cursor = table_find(db->pager, 0, key);
-    if (!cursor) {
+    // Validate key and value lengths to prevent buffer overflows
+    if (strlen(key) >= MAX_KEY_LEN) {
+        fprintf(stderr, "Error: Key too long (max %d chars)\n", MAX_KEY_LEN - 1);
         return STATUS_ERROR;
     }
-    
-    void* page = pager_get_page(db->pager, cursor->page_num);
-    if (!page) {
-        free(cursor);
+    if (!key_type_check(db->key_type, db->key_width, key)) {
+        fprintf(stderr, "Error: Not a %s key (see db_key_%s)\n", key_type_name(db->key_type),
+                key_type_name(db->key_type));
+        return STATUS_ERROR;
+    }
+    if (db_catalog_key(key)) {
+        return STATUS_ERROR;
+    }
+    if (strlen(value) >= MAX_VALUE_LEN) {
+        fprintf(stderr, "Error: Value too long (max %d chars)\n", MAX_VALUE_LEN - 1);
+        return STATUS_ERROR;
+    }
+
+    if (db_write_begin(db) != STATUS_OK) {
+        return STATUS_ERROR;
+    }
+    pager_scope_begin(db->pager);
+    int status = db_insert_expiring_locked(db, 0, key, value, (uint64_t)expires_at);
+    if (status == STATUS_OK) {
+        status = db_indexes_update(db, 0, key, NULL, value);
+    }
+    pager_scope_end(db->pager);
+    status = db_write_end(db, status);
+    db_row_cache_invalidate(db, key);
+    db_bloom_maintain(db);
+    latch_unlock_exclusive(&db->write_latch);
+    return status;
+}
+
+// Get value by key
+const char* db_get(Database *db, const char *key) {
+    if (!db || !key) {
+        return NULL;
+    }
+    db_tick(db);
+    db_merges_settle(db);
+    if (db_bloom_rules_out(db, key)) {
+        return NULL;
+    }
+
+    Cursor cursor;
+    uint32_t frame;
+    uint64_t hash = db_key_hash(db, key);
+    bool stale;
+    pager_scope_begin(db->pager);
+    void* page = db_hash_index_latch(db, key, hash, &stale, &cursor.page_num, &cursor.cell_num, &frame);
+    if (page) {
+        char* value = leaf_node_value(page, cursor.cell_num);
+        pager_unlatch_frame(db->pager, frame, PAGER_LATCH_SHARED);
+        pager_scope_end(db->pager);
+        return value;
+    }
+    if (table_find_latched(db->pager, 0, key, &cursor, &frame) != 0) {
+        pager_scope_end(db->pager);
+        return NULL;
+    }
+    
+    page = pager_get_page(db->pager, cursor.page_num);
+    char* value = NULL;
+    uint32_t num_cells = *leaf_node_num_cells(page);
+    
+    if (cursor.cell_num < num_cells) {
+        char* key_at_index = leaf_node_key(page, cursor.cell_num);
+        if (strcmp(key, key_at_index) == 0 && !leaf_node_expired(page, cursor.cell_num)) {
+            value = leaf_node_value(page, cursor.cell_num);
+        }
+    }
+    if (value) {
+        db_hash_index_record(db, hash, cursor.page_num, cursor.cell_num, stale);
+    } else {
+        db_bloom_false_positive(db);
+    }
+    
+    pager_unlatch_frame(db->pager, frame, PAGER_LATCH_SHARED);
+    pager_scope_end(db->pager);
+    return value;
+}
+
+// Look key up in the tree rooted at root_page, latching each page shared
+// on the way down, and copy its value into buf like snprintf. Sets
+// page_num and cell_num to where the record was found, and expires_at to
+// its expiry time.
+static int db_tree_get_into(Database *db, uint32_t root_page, const char *key, char *buf, size_t cap,
+                            uint32_t *page_num, uint32_t *cell_num, uint64_t *expires_at) {
+    Cursor cursor;
+    uint32_t frame;
+    pager_scope_begin(db->pager);
+    if (table_find_latched(db->pager, root_page, key, &cursor, &frame) != 0) {
+        pager_scope_end(db->pager);
+        return STATUS_ERROR;
+    }
+    void* page = pager_get_page(db->pager, cursor.page_num);
+    int result = STATUS_NOT_FOUND;
+    if (cursor.cell_num < *leaf_node_num_cells(page) &&
+        strcmp(key, leaf_node_key(page, cursor.cell_num)) == 0 && !leaf_node_expired(page, cursor.cell_num)) {
+        const char* value = leaf_node_value(page, cursor.cell_num);
+        size_t length = strlen(value);
+        if (cap > 0) {
+            size_t copied = length < cap ? length : cap - 1;
+            memcpy(buf, value, copied);
+            buf[copied] = '\0';
+        }
+        result = (int)length;
+        *page_num = cursor.page_num;
+        *cell_num = cursor.cell_num;
+        *expires_at = *leaf_node_expiry(page, cursor.cell_num);
+    }
+    pager_unlatch_frame(db->pager, frame, PAGER_LATCH_SHARED);
+    pager_scope_end(db->pager);
+    return result;
+}
+
+// Copy the value of key into buf
+int db_get_into(Database *db, const char *key, char *buf, size_t cap) {
+    if (!db || !key || (!buf && cap > 0)) {
+        return STATUS_ERROR;
+    }
+    db_tick(db);
+    db_merges_settle(db);
+    if (db_bloom_rules_out(db, key)) {
+        return STATUS_NOT_FOUND;
+    }
+
+    // A hot key: its value may be cached, or the hash index may point to
+    // the one cell to check
+    uint64_t hash = db_key_hash(db, key);
+    uint64_t generation;
+    size_t found_length;
+    if (db_row_cache_get(db, hash, key, buf, cap, &found_length, &generation)) {
+        return (int)found_length;
+    }
+    // Records that expire are not cached: the cache would outlive them
+    uint32_t leaf_page, leaf_cell;
+    uint64_t expires_at;
+    bool stale = false;
+    if (db_hash_index_find(db, hash, &leaf_page, &leaf_cell)) {
+        int found = leaf_node_get_optimistic(db->pager, leaf_page, leaf_cell, key, buf, cap, &found_length,
+                                             &expires_at);
+        if (found > 0) {
+            hash_index_hit(db->hash_index);
+            if (found_length < cap && expires_at == 0) {
+                db_row_cache_fill(db, hash, key, buf, generation);
+            }
+            return (int)found_length;
+        }
+        stale = found == 0;
+    }
+
+    // Latch-free while every page on the way is cached
+    int found = table_get_optimistic(db->pager, 0, key, buf, cap, &found_length, &leaf_page, &leaf_cell,
+                                     &expires_at);
+    if (found >= 0) {
+        if (!found) {
+            db_bloom_false_positive(db);
+            return STATUS_NOT_FOUND;
+        }
+        db_hash_index_record(db, hash, leaf_page, leaf_cell, stale);
+        if (found_length < cap && expires_at == 0) {
+            db_row_cache_fill(db, hash, key, buf, generation);
+        }
+        return (int)found_length;
+    }
+
+    int result = db_tree_get_into(db, 0, key, buf, cap, &leaf_page, &leaf_cell, &expires_at);
+    if (result == STATUS_NOT_FOUND) {
+        db_bloom_false_positive(db);
+    } else if (result >= 0) {
+        db_hash_index_record(db, hash, leaf_page, leaf_cell, stale);
+        if ((size_t)result < cap && expires_at == 0) {
+            db_row_cache_fill(db, hash, key, buf, generation);
+        }
+    }
+    return result;
+}
+
+// Look up key and pin the leaf holding its value
+int db_get_pinned(Database *db, const char *key, DbPinnedValue *pinned) {
+    if (!db || !key || !pinned) {
+        return STATUS_ERROR;
+    }
+    pinned->db = NULL;
+    pinned->value = NULL;
+    pinned->length = 0;
+    db_tick(db);
+    db_merges_settle(db);
+    if (db_bloom_rules_out(db, key)) {
+        return STATUS_NOT_FOUND;
+    }
+
+    Cursor cursor;
+    uint32_t latched;
+    uint64_t hash = db_key_hash(db, key);
+    bool stale;
+    pager_scope_begin(db->pager);
+    bool indexed =
+        db_hash_index_latch(db, key, hash, &stale, &cursor.page_num, &cursor.cell_num, &latched) != NULL;
+    if (!indexed && table_find_latched(db->pager, 0, key, &cursor, &latched) != 0) {
+        pager_scope_end(db->pager);
+        return STATUS_ERROR;
+    }
+    // Pin under the shared latch so no write slips in between
+    uint32_t frame;
+    void* page = pager_pin_page(db->pager, cursor.page_num, &frame);
+    pager_unlatch_frame(db->pager, latched, PAGER_LATCH_SHARED);
+    pager_scope_end(db->pager);
+    if (!page) {
+        return STATUS_ERROR;
+    }
+    if (cursor.cell_num >= *leaf_node_num_cells(page) ||
+        strcmp(key, leaf_node_key(page, cursor.cell_num)) != 0 || leaf_node_expired(page, cursor.cell_num)) {
+        pager_unpin_frame(db->pager, frame);
+        db_bloom_false_positive(db);
+        return STATUS_NOT_FOUND;
+    }
+    if (!indexed) {
+        db_hash_index_record(db, hash, cursor.page_num, cursor.cell_num, stale);
+    }
+
+    pinned->db = db;
+    pinned->frame = frame;
+    pinned->value = leaf_node_value(page, cursor.cell_num);
+    pinned->length = strlen(pinned->value);
+    return STATUS_OK;
+}
+
+// Drop the pin taken by db_get_pinned
+void db_pinned_release(DbPinnedValue *pinned) {
+    if (!pinned || !pinned->db) {
+        return;
+    }
+    pager_unpin_frame(pinned->db->pager, pinned->frame);
+    pinned->db = NULL;
+    pinned->value = NULL;
+    pinned->length = 0;
+}
+
+// Take a snapshot between two writes
+int db_snapshot(Database *db, DbSnapshot *snapshot) {
+    if (!db || !snapshot) {
+        return STATUS_ERROR;
+    }
+    snapshot->db = NULL;
+    db_merges_settle(db);
+    latch_lock_exclusive(&db->write_latch);
+    uint64_t epoch = page_versions_acquire(&db->pager->versions, db->pager->num_pages);
+    latch_unlock_exclusive(&db->write_latch);
+    if (epoch == UINT64_MAX) {
+        return STATUS_ERROR;
+    }
+    snapshot->db = db;
+    snapshot->epoch = epoch;
+    return STATUS_OK;
+}
+
+// Drop a snapshot and the page images only it needed
+void db_snapshot_release(DbSnapshot *snapshot) {
+    if (!snapshot || !snapshot->db) {
+        return;
+    }
+    page_versions_release(&snapshot->db->pager->versions, snapshot->epoch);
+    snapshot->db = NULL;
+}
+
+// Copy the value key had when the snapshot was taken into buf
+int db_snapshot_get(const DbSnapshot *snapshot, const char *key, char *buf, size_t cap) {
+    if (!snapshot || !snapshot->db || !key || (!buf && cap > 0)) {
+        return STATUS_ERROR;
+    }
+    size_t length;
+    int found = table_get_version(snapshot->db->pager, 0, snapshot->epoch, key, buf, cap, &length);
+    if (found < 0) {
+        return STATUS_ERROR;
+    }
+    return found ? (int)length : STATUS_NOT_FOUND;
+}
+
+// A scan of the default tree, which passes over the catalog records
+typedef struct {
+    DbScanCallback callback;
+    void *arg;
+    int64_t skipped;
+} DbDefaultScan;
+
+static int db_default_scan_record(const char *key, const char *value, void *arg) {
+    DbDefaultScan *scan = arg;
+    if (key[0] == DB_CATALOG_KEY_PREFIX) {
+        scan->skipped++;
+        return 0;
+    }
+    return scan->callback(key, value, scan->arg);
+}
+
+// Visit the records of a snapshot in key order
+int64_t db_snapshot_scan(const DbSnapshot *snapshot, const char *start, DbScanCallback callback, void *arg) {
+    if (!snapshot || !snapshot->db || !callback) {
+        return STATUS_ERROR;
+    }
+    DbDefaultScan scan = { callback, arg, 0 };
+    int64_t visited = table_scan_version(snapshot->db->pager, 0, snapshot->epoch, start, db_default_scan_record, &scan);
+    return visited < 0 ? STATUS_ERROR : visited - scan.skipped;
+}
+
+// A key of a db_multi_get batch and its position in the caller's arrays
+typedef struct {
+    const char *key;
+    uint32_t index;
+    uint64_t generation; // Row cache generation at the miss
+} MultiGetKey;
+
+static int compare_multi_get_keys(const void *a, const void *b) {
+    const MultiGetKey *x = a;
+    const MultiGetKey *y = b;
+    int cmp = strcmp(x->key, y->key);
+    if (cmp != 0) {
+        return cmp;
+    }
+    return (x->index > y->index) - (x->index < y->index);
+}
+
+// Get many values at once
+int db_multi_get(Database *db, const char *const keys[], size_t n, char (*out)[MAX_VALUE_LEN], bool found[]) {
+    if (!db || (n > 0 && (!keys || !out)) || n > UINT32_MAX) {
+        return STATUS_ERROR;
+    }
+    db_tick(db);
+    db_merges_settle(db);
+    if (n == 0) {
+        return 0;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (!keys[i]) {
+            return STATUS_ERROR;
+        }
+        out[i][0] = '\0';
+        if (found) {
+            found[i] = false;
+        }
+    }
+
+    // One block: the sorted keys, the same as plain pointers, and the leaf
+    // of each, then the distinct leaves in key order
+    size_t block_size = n * (sizeof(MultiGetKey) + sizeof(const char *) + 2 * sizeof(uint32_t));
+    uint8_t *block = malloc(block_size);
+    if (!block) {
+        fprintf(stderr, "Failed to allocate memory for multi-get\n");
+        return STATUS_ERROR;
+    }
+    MultiGetKey *sorted = (MultiGetKey *)block;
+    const char **sorted_keys = (const char **)(sorted + n);
+    uint32_t *leaves = (uint32_t *)(sorted_keys + n);
+    uint32_t *distinct = leaves + n;
+
+    // Keys the Bloom filter rules out or the row cache holds are left out
+    // of the descent
+    bool in_order = true;
+    size_t num_probed = 0;
+    int hits = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (db_bloom_rules_out(db, keys[i])) {
+            continue;
+        }
+        uint64_t generation = 0;
+        size_t length;
+        if (db->row_cache && row_cache_get(db->row_cache, key_hash(keys[i], strlen(keys[i])), keys[i], out[i],
+                                           MAX_VALUE_LEN, &length, &generation)) {
+            if (found) {
+                found[i] = true;
+            }
+            hits++;
+            continue;
+        }
+        sorted[num_probed].key = keys[i];
+        sorted[num_probed].index = (uint32_t)i;
+        sorted[num_probed].generation = generation;
+        in_order = in_order && (num_probed == 0 || strcmp(sorted[num_probed - 1].key, keys[i]) <= 0);
+        num_probed++;
+    }
+    if (num_probed == 0) {
+        free(block);
+        return hits;
+    }
+    if (!in_order) {
+        qsort(sorted, num_probed, sizeof(MultiGetKey), compare_multi_get_keys);
+    }
+    for (size_t i = 0; i < num_probed; i++) {
+        sorted_keys[i] = sorted[i].key;
+    }
+
+    // Shared descent to the leaves, then announce every leaf before probing
+    if (table_find_leaves(db->pager, 0, sorted_keys, (uint32_t)num_probed, leaves) != 0) {
+        free(block);
+        return STATUS_ERROR;
+    }
+    uint32_t num_distinct = 0;
+    for (size_t i = 0; i < num_probed; i++) {
+        if (num_distinct == 0 || distinct[num_distinct - 1] != leaves[i]) {
+            distinct[num_distinct++] = leaves[i];
+        }
+    }
+    pager_prefetch(db->pager, distinct, num_distinct);
+
+    // Probe leaf by leaf, pulling the next leaf towards the CPU while
+    // searching the current one. A split since the descent may have moved
+    // keys to a right sibling, which the seek follows.
+    size_t i = 0;
+    for (uint32_t d = 0; d < num_distinct; d++) {
+        uint32_t page_num = distinct[d];
+        uint32_t frame;
+        pager_scope_begin(db->pager);
+        void *page = pager_latch_page(db->pager, page_num, PAGER_LATCH_SHARED, &frame);
+        if (!page) {
+            pager_scope_end(db->pager);
+            free(block);
+            return STATUS_ERROR;
+        }
+        if (d + 1 < num_distinct) {
+            pager_prefetch(db->pager, &distinct[d + 1], 1);
+        }
+        for (; i < num_probed && leaves[i] == distinct[d]; i++) {
+            uint32_t cell_num;
+            page = leaf_node_seek_latched(db->pager, page, &page_num, &frame, sorted[i].key, &cell_num);
+            if (!page) {
+                pager_scope_end(db->pager);
+                free(block);
+                return STATUS_ERROR;
+            }
+            if (cell_num < *leaf_node_num_cells(page) &&
+                strcmp(sorted[i].key, leaf_node_key(page, cell_num)) == 0 && !leaf_node_expired(page, cell_num)) {
+                strcpy(out[sorted[i].index], leaf_node_value(page, cell_num));
+                if (found) {
+                    found[sorted[i].index] = true;
+                }
+                hits++;
+                if (db->row_cache && *leaf_node_expiry(page, cell_num) == 0) {
+                    row_cache_put(db->row_cache, key_hash(sorted[i].key, strlen(sorted[i].key)), sorted[i].key,
+                                  out[sorted[i].index], sorted[i].generation);
+                }
+            } else {
+                db_bloom_false_positive(db);
+            }
+        }
+        pager_unlatch_frame(db->pager, frame, PAGER_LATCH_SHARED);
+        pager_scope_end(db->pager);
+    }
+
+    free(block);
+    return hits;
+}
+
+// Delete from the tree rooted at root_page with the write latch held,
+// inside a pin scope
+static int db_delete_locked(Database *db, uint32_t root_page, const char *key) {
+    // Find the key in the B-tree
+    Cursor cursor;
+    if (table_find_into(db->pager, root_page, key, &cursor) != 0) {
+        return STATUS_ERROR;
+    }
+    
+    void* page = pager_get_page(db->pager, cursor.page_num);
+    if (!page) {
         return STATUS_ERROR;
     }
     
     // Defensive check: verify we're operating on a leaf node
     if (get_node_type(page) != NODE_LEAF) {
         fprintf(stderr, "Error: Expected leaf node but got internal node in db_delete\n");
-        free(cursor);
         return STATUS_ERROR;
     }
-    
-    
-    uint32_t* num_cells = leaf_node_num_cells(page);
-    
-    // Check if key exists at cursor position
-    if (cursor->cell_num >= *num_cells) {
-        free(cursor);
-        return STATUS_NOT_FOUND;
+    
+    
+    uint32_t* num_cells = leaf_node_num_cells(page);
+    
+    // Check if key exists at cursor position
+    if (cursor.cell_num >= *num_cells) {
+        return STATUS_NOT_FOUND;
+    }
+    
+    // An expired record is left to the sweeper, which drops its index
+    // entries with it
+    char* key_at_index = leaf_node_key(page, cursor.cell_num);
+    if (strcmp(key, key_at_index) != 0 || leaf_node_expired(page, cursor.cell_num)) {
+        return STATUS_NOT_FOUND;
+    }
+    
+    // Key found, now delete it by shifting cells left. Leaves never
+    // merge, so the leaf and the subtree counts above it are all that
+    // change.
+    uint32_t frames[BTREE_MAX_DEPTH + 1];
+    int latched = btree_latch_path(db->pager, &cursor, frames);
+    if (latched < 0) {
+        return STATUS_ERROR;
+    }
+    int result = leaf_node_delete(&cursor);
+    btree_unlatch_all(db->pager, frames, latched);
+    
+    return result == 0 ? STATUS_OK : STATUS_ERROR;
+}
+
+// Change one index for a write to key of the tree it covers: old_value is
+// the record's value before (NULL if it is new) and new_value after (NULL
+// if it is deleted). With the write latch held, inside a pin scope.
+static int db_index_update(Database *db, const DbIndex *index, const char *key, const char *old_value,
+                           const char *new_value) {
+    char old_field[INDEX_FIELD_MAX + 1];
+    char new_field[INDEX_FIELD_MAX + 1];
+    bool had = old_value && index_field(old_value, index->delimiter, index->field, old_field);
+    bool has = new_value && index_field(new_value, index->delimiter, index->field, new_field);
+    if (had && has && strcmp(old_field, new_field) == 0) {
+        return STATUS_OK;
+    }
+    char entry[MAX_KEY_LEN];
+    if (had) {
+        index_entry_key(old_field, key, entry);
+        if (db_delete_locked(db, index->root_page, entry) == STATUS_ERROR) {
+            return STATUS_ERROR;
+        }
+    }
+    if (has) {
+        index_entry_key(new_field, key, entry);
+        int status = db_insert_locked(db, index->root_page, entry, key);
+        if (status != STATUS_OK) {
+            fprintf(stderr, "Error: Failed to add an entry to index '%s'\n", index->name);
+            return STATUS_ERROR;
+        }
+    }
+    return STATUS_OK;
+}
+
+// Change every index of the tree rooted at root_page for a write to key
+// (see db_index_update)
+static int db_indexes_update(Database *db, uint32_t root_page, const char *key, const char *old_value,
+                             const char *new_value) {
+    for (uint32_t i = 0; i < db->num_indexes; i++) {
+        if (db->indexes[i].table_root == root_page &&
+            db_index_update(db, &db->indexes[i], key, old_value, new_value) != STATUS_OK) {
+            return STATUS_ERROR;
+        }
+    }
+    return STATUS_OK;
+}
+
+// Kinds of merge operand, as logged in WAL operand frames
+enum {
+    DB_MERGE_INCR = 1,     // Decimal delta
+    DB_MERGE_APPEND = 2,   // Suffix
+    DB_MERGE_OPERATOR = 3  // Operand of the registered merge operator
+};
+
+// Longest WAL operand record: the kind, then the key and the operand, both
+// NUL-terminated
+#define DB_MERGE_RECORD_MAX (1 + MAX_KEY_LEN + MAX_VALUE_LEN)
+
+// Parse a whole decimal int64
+static bool db_parse_int64(const char *text, int64_t *value) {
+    char *end;
+    errno = 0;
+    long long parsed = strtoll(text, &end, 10);
+    if (*text == '\0' || *end != '\0' || errno == ERANGE) {
+        return false;
+    }
+    *value = (int64_t)parsed;
+    return true;
+}
+
+// Combine the value of key (NULL if there is no record) with one operand
+// into out (MAX_VALUE_LEN bytes)
+static int db_merge_apply(Database *db, uint8_t kind, const char *key, const char *existing, const char *operand,
+                          char *out) {
+    switch (kind) {
+    case DB_MERGE_INCR: {
+        int64_t value = 0;
+        int64_t delta;
+        if ((existing && !db_parse_int64(existing, &value)) || !db_parse_int64(operand, &delta)) {
+            fprintf(stderr, "Error: Value of key '%s' is not an integer\n", key);
+            return STATUS_ERROR;
+        }
+        if ((delta > 0 && value > INT64_MAX - delta) || (delta < 0 && value < INT64_MIN - delta)) {
+            fprintf(stderr, "Error: Increment of key '%s' overflows\n", key);
+            return STATUS_ERROR;
+        }
+        snprintf(out, MAX_VALUE_LEN, "%lld", (long long)(value + delta));
+        return STATUS_OK;
+    }
+    case DB_MERGE_APPEND:
+        if ((existing ? strlen(existing) : 0) + strlen(operand) >= MAX_VALUE_LEN) {
+            fprintf(stderr, "Error: Value of key '%s' would be too long (max %d chars)\n", key, MAX_VALUE_LEN - 1);
+            return STATUS_ERROR;
+        }
+        snprintf(out, MAX_VALUE_LEN, "%s%s", existing ? existing : "", operand);
+        return STATUS_OK;
+    case DB_MERGE_OPERATOR:
+        if (!db->merge_operator) {
+            fprintf(stderr, "Error: No merge operator registered\n");
+            return STATUS_ERROR;
+        }
+        if (db->merge_operator(key, existing, operand, out, db->merge_arg) != STATUS_OK) {
+            return STATUS_ERROR;
+        }
+        if (!memchr(out, '\0', MAX_VALUE_LEN)) {
+            fprintf(stderr, "Error: Merge operator result for key '%s' is too long\n", key);
+            return STATUS_ERROR;
+        }
+        return STATUS_OK;
+    }
+    return STATUS_ERROR;
+}
+
+// Computes a record's new value from its current one (existing is NULL if
+// there is none) into out, MAX_VALUE_LEN bytes; the record is written only
+// if it returns STATUS_OK
+typedef int (*DbModifyFn)(Database *db, const char *key, const char *existing, char *out, void *arg);
+
+// Read, change and write back one record of the default tree in a single
+// descent; only a missing key takes a second one, to insert it. With the
+// write latch held, inside a pin scope.
+static int db_modify_locked(Database *db, const char *key, DbModifyFn modify, void *arg) {
+    Cursor cursor;
+    if (table_find_into(db->pager, 0, key, &cursor) != 0) {
+        return STATUS_ERROR;
+    }
+    void *page = pager_get_page(db->pager, cursor.page_num);
+    if (!page) {
+        return STATUS_ERROR;
+    }
+    // An expired record counts as missing, and the insert replaces it
+    bool exists = cursor.cell_num < *leaf_node_num_cells(page) &&
+                  strcmp(key, leaf_node_key(page, cursor.cell_num)) == 0 && !leaf_node_expired(page, cursor.cell_num);
+    char old_value[MAX_VALUE_LEN];
+    char new_value[MAX_VALUE_LEN];
+    if (exists) {
+        snprintf(old_value, sizeof(old_value), "%s", leaf_node_value(page, cursor.cell_num));
+    }
+    int status = modify(db, key, exists ? old_value : NULL, new_value, arg);
+    if (status != STATUS_OK) {
+        return status;
+    }
+    if (exists) {
+        status = db_leaf_set_value(db, cursor.page_num, cursor.cell_num, new_value);
+    } else {
+        status = db_insert_locked(db, 0, key, new_value);
+    }
+    if (status == STATUS_OK) {
+        status = db_indexes_update(db, 0, key, exists ? old_value : NULL, new_value);
+    }
+    return status;
+}
+
+// Run db_modify_locked as a write of its own
+static int db_modify(Database *db, const char *key, DbModifyFn modify, void *arg) {
+    if (db_write_begin(db) != STATUS_OK) {
+        return STATUS_ERROR;
+    }
+    pager_scope_begin(db->pager);
+    int status = db_modify_locked(db, key, modify, arg);
+    pager_scope_end(db->pager);
+    status = db_write_end(db, status);
+    db_row_cache_invalidate(db, key);
+    db_bloom_maintain(db);
+    latch_unlock_exclusive(&db->write_latch);
+    return status;
+}
+
+// One merge applied at once
+typedef struct {
+    uint8_t kind;
+    const char *operand;
+    char *value; // Receives the new value; may be NULL
+} DbMergeOp;
+
+static int db_merge_modify(Database *db, const char *key, const char *existing, char *out, void *arg) {
+    DbMergeOp *op = arg;
+    int status = db_merge_apply(db, op->kind, key, existing, op->operand, out);
+    if (status == STATUS_OK && op->value) {
+        strcpy(op->value, out);
+    }
+    return status;
+}
+
+// The pending merges of one key, in the order they were made
+typedef struct {
+    const DbPendingMerge *merges;
+    uint32_t count;
+} DbMergeRun;
+
+static int db_fold_modify(Database *db, const char *key, const char *existing, char *out, void *arg) {
+    const DbMergeRun *run = arg;
+    char values[2][MAX_VALUE_LEN];
+    const char *current = existing;
+    bool changed = false;
+    for (uint32_t i = 0; i < run->count; i++) {
+        // Alternate buffers so current is never the one written
+        char *next = values[i % 2];
+        if (db_merge_apply(db, run->merges[i].kind, key, current, run->merges[i].operand, next) != STATUS_OK) {
+            fprintf(stderr, "Warning: Dropped a deferred merge of key '%s'\n", key);
+            continue;
+        }
+        current = next;
+        changed = true;
+    }
+    if (!changed) {
+        return STATUS_NOT_FOUND; // Nothing to write
+    }
+    strcpy(out, current);
+    return STATUS_OK;
+}
+
+static int compare_pending_merges(const void *a, const void *b) {
+    const DbPendingMerge *left = a;
+    const DbPendingMerge *right = b;
+    int cmp = strcmp(left->key, right->key);
+    if (cmp != 0) {
+        return cmp;
+    }
+    return left->order < right->order ? -1 : left->order > right->order;
+}
+
+// Fold the pending merges into their records: sorted by key, so each key
+// takes one descent however many operands it has. In the write section
+// the writer has just begun; db_write_end clears them.
+static void db_merges_fold(Database *db) {
+    uint32_t count = atomic_load_explicit(&db->num_pending_merges, memory_order_relaxed);
+    if (count == 0) {
+        return;
+    }
+    DbPendingMerge *merges = db->pending_merges;
+    qsort(merges, count, sizeof(DbPendingMerge), compare_pending_merges);
+    for (uint32_t i = 0; i < count;) {
+        uint32_t end = i + 1;
+        while (end < count && strcmp(merges[end].key, merges[i].key) == 0) {
+            end++;
+        }
+        DbMergeRun run = { &merges[i], end - i };
+        pager_scope_begin(db->pager);
+        int status = db_modify_locked(db, merges[i].key, db_fold_modify, &run);
+        pager_scope_end(db->pager);
+        if (status == STATUS_OK) {
+            db_row_cache_invalidate(db, merges[i].key);
+        } else if (status == STATUS_ERROR) {
+            fprintf(stderr, "Error: Failed to fold deferred merges into key '%s'\n", merges[i].key);
+        }
+        i = end;
+    }
+}
+
+// Fold the pending merges before a read, so it sees every merge that
+// returned before it began
+static void db_merges_settle(Database *db) {
+    if (atomic_load_explicit(&db->num_pending_merges, memory_order_acquire) == 0) {
+        return;
+    }
+    if (db_write_begin(db) == STATUS_OK) {
+        db_write_end(db, STATUS_OK);
+        db_bloom_maintain(db);
+        latch_unlock_exclusive(&db->write_latch);
+    }
+}
+
+// Room for one more pending merge. Writer only.
+static bool db_merges_reserve(Database *db) {
+    uint32_t count = atomic_load_explicit(&db->num_pending_merges, memory_order_relaxed);
+    if (count < db->pending_merges_cap) {
+        return true;
+    }
+    uint32_t cap = db->pending_merges_cap ? 2 * db->pending_merges_cap : 64;
+    DbPendingMerge *merges = realloc(db->pending_merges, cap * sizeof(DbPendingMerge));
+    if (!merges) {
+        fprintf(stderr, "Error: Failed to allocate pending merges\n");
+        return false;
+    }
+    db->pending_merges = merges;
+    db->pending_merges_cap = cap;
+    return true;
+}
+
+// Add a merge to the pending ones (after db_merges_reserve)
+static void db_merges_push(Database *db, uint8_t kind, const char *key, const char *operand) {
+    uint32_t count = atomic_load_explicit(&db->num_pending_merges, memory_order_relaxed);
+    DbPendingMerge *merge = &db->pending_merges[count];
+    snprintf(merge->key, sizeof(merge->key), "%s", key);
+    snprintf(merge->operand, sizeof(merge->operand), "%s", operand);
+    merge->kind = kind;
+    merge->order = count;
+    atomic_store_explicit(&db->num_pending_merges, count + 1, memory_order_release);
+}
+
+// Lay out a WAL operand record (DB_MERGE_RECORD_MAX bytes); returns its length
+static uint32_t db_merge_record(uint8_t kind, const char *key, const char *operand, uint8_t *record) {
+    size_t key_size = strlen(key) + 1;
+    size_t operand_size = strlen(operand) + 1;
+    record[0] = kind;
+    memcpy(record + 1, key, key_size);
+    memcpy(record + 1 + key_size, operand, operand_size);
+    return (uint32_t)(1 + key_size + operand_size);
+}
+
+// Make the operands logged up to seq durable. One thread syncs at a time,
+// for every operand logged when it starts; the others wait for it rather
+// than for the latch, and find theirs covered once it is done, so
+// concurrent merges share a frame and a sync.
+static int db_merges_sync(Database *db, uint64_t seq) {
+    uint32_t spins = 0;
+    while (!latch_try_lock_exclusive(&db->merge_sync_latch)) {
+        if (wal_operands_synced(db->wal) >= seq) {
+            return STATUS_OK;
+        }
+        latch_pause(&spins);
+    }
+    int status = STATUS_OK;
+    if (wal_operands_synced(db->wal) < seq) {
+        // Written with no transaction open; synced outside the write latch
+        // so other merges go on being logged meanwhile
+        uint64_t through = 0;
+        latch_lock_exclusive(&db->write_latch);
+        int result = pager_flush_operands(db->pager, &through);
+        latch_unlock_exclusive(&db->write_latch);
+        if (result != 0 || wal_sync_operands(db->wal, through) != 0) {
+            status = STATUS_ERROR;
+        }
+    }
+    latch_unlock_exclusive(&db->merge_sync_latch);
+    return status;
+}
+
+// Log a blind merge to the WAL and leave it pending; returns once the
+// operand is synced
+static int db_merge_defer(Database *db, const char *key, uint8_t kind, const char *operand) {
+    uint8_t record[DB_MERGE_RECORD_MAX];
+    uint32_t length = db_merge_record(kind, key, operand, record);
+    uint64_t seq = 0;
+    latch_lock_exclusive(&db->write_latch);
+    int status = STATUS_ERROR;
+    if (db_merges_reserve(db) && pager_append_operand(db->pager, record, length, &seq) == 0) {
+        db_merges_push(db, kind, key, operand);
+        status = STATUS_OK;
+    }
+    uint32_t count = atomic_load_explicit(&db->num_pending_merges, memory_order_relaxed);
+    latch_unlock_exclusive(&db->write_latch);
+    if (status == STATUS_OK) {
+        status = db_merges_sync(db, seq);
+    }
+    if (count >= DB_MERGE_PENDING_MAX) {
+        db_merges_settle(db);
+    }
+    return status;
+}
+
+// Take back an operand record found in the WAL at open
+static int db_merge_recover(const void *data, uint32_t length, void *arg) {
+    Database *db = arg;
+    const uint8_t *record = data;
+    const char *key = (const char *)record + 1;
+    const char *key_end = length > 1 ? memchr(key, '\0', length - 1) : NULL;
+    const char *operand = key_end ? key_end + 1 : NULL;
+    size_t operand_room = operand ? length - (size_t)((const uint8_t *)operand - record) : 0;
+    if (record[0] < DB_MERGE_INCR || record[0] > DB_MERGE_OPERATOR || !key_end || key_end - key >= MAX_KEY_LEN ||
+        operand_room == 0 || operand_room > MAX_VALUE_LEN || operand[operand_room - 1] != '\0') {
+        fprintf(stderr, "Warning: Damaged merge operand in the WAL skipped\n");
+        return 0;
+    }
+    if (db_merges_reserve(db)) {
+        db_merges_push(db, record[0], key, operand);
+    }
+    return 0;
+}
+
+// Recover the merges logged but not yet folded before the checkpoint at
+// open drops their frames, then log them again
+static void db_merges_recover(Database *db) {
+    if (wal_read_operands(db->wal, db_merge_recover, db) < 0) {
+        fprintf(stderr, "Warning: Failed to read merge operands from the WAL\n");
+    }
+}
+
+static void db_merges_relog(Database *db) {
+    uint32_t count = atomic_load_explicit(&db->num_pending_merges, memory_order_relaxed);
+    if (count == 0) {
+        return;
+    }
+    uint8_t record[DB_MERGE_RECORD_MAX];
+    uint64_t seq;
+    for (uint32_t i = 0; i < count; i++) {
+        const DbPendingMerge *merge = &db->pending_merges[i];
+        uint32_t length = db_merge_record(merge->kind, merge->key, merge->operand, record);
+        if (wal_append_operand(db->wal, record, length, &seq) != 0) {
+            fprintf(stderr, "Warning: Failed to log merge operands again\n");
+            return;
+        }
+    }
+    if (wal_flush_operands(db->wal, &seq) != 0 || wal_sync_operands(db->wal, seq) != 0) {
+        fprintf(stderr, "Warning: Failed to log merge operands again\n");
+    }
+}
+
+// Check a key for the functions that write the default tree
+static bool db_key_writable(Database *db, const char *key) {
+    if (strlen(key) >= MAX_KEY_LEN) {
+        fprintf(stderr, "Error: Key too long (max %d chars)\n", MAX_KEY_LEN - 1);
+        return false;
+    }
+    if (!key_type_check(db->key_type, db->key_width, key)) {
+        fprintf(stderr, "Error: Not a %s key (see db_key_%s)\n", key_type_name(db->key_type),
+                key_type_name(db->key_type));
+        return false;
+    }
+    return !db_catalog_key(key);
+}
+
+// Apply a merge to key: now, or logged and deferred when it is blind
+static int db_merge_key(Database *db, const char *key, uint8_t kind, const char *operand, char *value) {
+    db_tick(db);
+    if (!db_key_writable(db, key)) {
+        return STATUS_ERROR;
+    }
+    if (db->deferred_merges && db->wal && !value) {
+        return db_merge_defer(db, key, kind, operand);
+    }
+    DbMergeOp op = { kind, operand, value };
+    return db_modify(db, key, db_merge_modify, &op);
+}
+
+// Add delta to an integer value
+int db_incr(Database *db, const char *key, int64_t delta, int64_t *result) {
+    if (!db || !key) {
+        return STATUS_ERROR;
+    }
+    char operand[24];
+    char value[MAX_VALUE_LEN];
+    snprintf(operand, sizeof(operand), "%lld", (long long)delta);
+    int status = db_merge_key(db, key, DB_MERGE_INCR, operand, result ? value : NULL);
+    if (status == STATUS_OK && result) {
+        db_parse_int64(value, result);
+    }
+    return status;
+}
+
+// Append to a value
+int db_append(Database *db, const char *key, const char *suffix) {
+    if (!db || !key || !suffix) {
+        return STATUS_ERROR;
+    }
+    if (strlen(suffix) >= MAX_VALUE_LEN) {
+        fprintf(stderr, "Error: Value too long (max %d chars)\n", MAX_VALUE_LEN - 1);
+        return STATUS_ERROR;
+    }
+    return db_merge_key(db, key, DB_MERGE_APPEND, suffix, NULL);
+}
+
+// Register the merge operator
+int db_set_merge_operator(Database *db, DbMergeOperator merge, void *arg) {
+    if (!db) {
+        return STATUS_ERROR;
+    }
+    latch_lock_exclusive(&db->write_latch);
+    db->merge_operator = merge;
+    db->merge_arg = arg;
+    latch_unlock_exclusive(&db->write_latch);
+    return STATUS_OK;
+}
+
+// Combine an operand with a value through the merge operator
+int db_merge(Database *db, const char *key, const char *operand) {
+    if (!db || !key || !operand) {
+        return STATUS_ERROR;
+    }
+    if (strlen(operand) >= MAX_VALUE_LEN) {
+        fprintf(stderr, "Error: Operand too long (max %d chars)\n", MAX_VALUE_LEN - 1);
+        return STATUS_ERROR;
+    }
+    if (!db->merge_operator) {
+        fprintf(stderr, "Error: No merge operator registered\n");
+        return STATUS_ERROR;
+    }
+    return db_merge_key(db, key, DB_MERGE_OPERATOR, operand, NULL);
+}
+
+// Values db_compare_and_swap expects and stores
+typedef struct {
+    const char *expected;
+    const char *value;
+} DbSwap;
+
+static int db_swap_modify(Database *db, const char *key, const char *existing, char *out, void *arg) {
+    (void)db;
+    (void)key;
+    const DbSwap *swap = arg;
+    if (existing ? !swap->expected || strcmp(existing, swap->expected) != 0 : swap->expected != NULL) {
+        return STATUS_CONFLICT;
+    }
+    strcpy(out, swap->value);
+    return STATUS_OK;
+}
+
+// Replace a value only if it is still the expected one
+int db_compare_and_swap(Database *db, const char *key, const char *expected, const char *value) {
+    if (!db || !key || !value) {
+        return STATUS_ERROR;
+    }
+    db_tick(db);
+    if (!db_key_writable(db, key)) {
+        return STATUS_ERROR;
+    }
+    if (strlen(value) >= MAX_VALUE_LEN) {
+        fprintf(stderr, "Error: Value too long (max %d chars)\n", MAX_VALUE_LEN - 1);
+        return STATUS_ERROR;
+    }
+    DbSwap swap = { expected, value };
+    return db_modify(db, key, db_swap_modify, &swap);
+}
+
+// Delete a key-value pair
+int db_delete(Database *db, const char *key) {
+    if (!db || !key) {
+        return STATUS_ERROR;
+    }
+    db_tick(db);
+    if (db_catalog_key(key)) {
+        return STATUS_ERROR;
+    }
+    if (db_bloom_rules_out(db, key)) {
+        return STATUS_NOT_FOUND;
+    }
+
+    if (db_write_begin(db) != STATUS_OK) {
+        return STATUS_ERROR;
+    }
+    pager_scope_begin(db->pager);
+    char old_value[MAX_VALUE_LEN];
+    bool indexed = db_tree_indexed(db, 0) && db_read_locked(db, 0, key, old_value);
+    int status = db_delete_locked(db, 0, key);
+    if (status == STATUS_OK && indexed) {
+        status = db_indexes_update(db, 0, key, old_value, NULL);
+    }
+    pager_scope_end(db->pager);
+    status = db_write_end(db, status);
+    db_row_cache_invalidate(db, key);
+    if (status == STATUS_OK) {
+        db->bloom_deletes++;
+        db_bloom_maintain(db);
+        if (db->hash_index) {
+            hash_index_remove(db->hash_index, key_hash(key, strlen(key)));
+        }
+    }
+    latch_unlock_exclusive(&db->write_latch);
+    return status;
+}
+
+
+// Set or clear the expiry time of a record in place
+int db_expire(Database *db, const char *key, time_t expires_at) {
+    if (!db || !key || expires_at < 0) {
+        return STATUS_ERROR;
+    }
+    db_tick(db);
+    if (db_catalog_key(key)) {
+        return STATUS_ERROR;
+    }
+    if (db_bloom_rules_out(db, key)) {
+        return STATUS_NOT_FOUND;
+    }
+
+    if (db_write_begin(db) != STATUS_OK) {
+        return STATUS_ERROR;
+    }
+    pager_scope_begin(db->pager);
+    int status = STATUS_ERROR;
+    Cursor cursor;
+    void *page = NULL;
+    if (table_find_into(db->pager, 0, key, &cursor) == 0) {
+        page = pager_get_page(db->pager, cursor.page_num);
+    }
+    if (page) {
+        status = STATUS_NOT_FOUND;
+        if (cursor.cell_num < *leaf_node_num_cells(page) &&
+            strcmp(key, leaf_node_key(page, cursor.cell_num)) == 0 && !leaf_node_expired(page, cursor.cell_num)) {
+            uint32_t frame;
+            page = pager_latch_page(db->pager, cursor.page_num, PAGER_LATCH_EXCLUSIVE, &frame);
+            status = STATUS_ERROR;
+            if (page) {
+                *leaf_node_expiry(page, cursor.cell_num) = (uint64_t)expires_at;
+                pager_flush(db->pager, cursor.page_num);
+                pager_unlatch_frame(db->pager, frame, PAGER_LATCH_EXCLUSIVE);
+                status = STATUS_OK;
+            }
+        }
+    }
+    pager_scope_end(db->pager);
+    status = db_write_end(db, status);
+    // A record that expires may no longer be cached
+    db_row_cache_invalidate(db, key);
+    latch_unlock_exclusive(&db->write_latch);
+    return status;
+}
+
+// Read the expiry time of a record
+int db_get_expiry(Database *db, const char *key, time_t *expires_at) {
+    if (!db || !key || !expires_at) {
+        return STATUS_ERROR;
+    }
+    db_tick(db);
+    db_merges_settle(db);
+    if (db_bloom_rules_out(db, key)) {
+        return STATUS_NOT_FOUND;
+    }
+    Cursor cursor;
+    uint32_t frame;
+    pager_scope_begin(db->pager);
+    if (table_find_latched(db->pager, 0, key, &cursor, &frame) != 0) {
+        pager_scope_end(db->pager);
+        return STATUS_ERROR;
+    }
+    void *page = pager_get_page(db->pager, cursor.page_num);
+    int status = STATUS_NOT_FOUND;
+    if (cursor.cell_num < *leaf_node_num_cells(page) &&
+        strcmp(key, leaf_node_key(page, cursor.cell_num)) == 0 && !leaf_node_expired(page, cursor.cell_num)) {
+        *expires_at = (time_t)*leaf_node_expiry(page, cursor.cell_num);
+        status = STATUS_OK;
+    }
+    pager_unlatch_frame(db->pager, frame, PAGER_LATCH_SHARED);
+    pager_scope_end(db->pager);
+    return status;
+}
+
+// A record the sweeper deletes, copied out for its index entries
+typedef struct {
+    char key[MAX_KEY_LEN];
+    char value[MAX_VALUE_LEN];
+} DbExpiredRecord;
+
+// Delete the records of one leaf that expired by now, all in one write of
+// the leaf (and of each ancestor, for its subtree count). With the write
+// latch held, inside a pin scope.
+// @return Number deleted, or STATUS_ERROR
+static int db_expiry_sweep_leaf(Database *db, uint32_t page_num, void *page, uint64_t now) {
+    DbExpiredRecord expired[LEAF_NODE_MAX_CELLS];
+    uint32_t count = 0;
+    uint32_t num_cells = *leaf_node_num_cells(page);
+    for (uint32_t i = 0; i < num_cells; i++) {
+        uint64_t expires_at = *leaf_node_expiry(page, i);
+        if (expires_at != 0 && expires_at <= now) {
+            snprintf(expired[count].key, MAX_KEY_LEN, "%s", leaf_node_key(page, i));
+            snprintf(expired[count].value, MAX_VALUE_LEN, "%s", leaf_node_value(page, i));
+            count++;
+        }
+    }
+    if (count == 0) {
+        return 0;
+    }
+    // The leaf was reached along the leaf chain: descend to it by its
+    // first key for the path its ancestors' counts are on
+    Cursor cursor;
+    if (table_find_into(db->pager, 0, leaf_node_key(page, 0), &cursor) != 0 || cursor.page_num != page_num) {
+        return STATUS_ERROR;
+    }
+    uint32_t frames[BTREE_MAX_DEPTH + 1];
+    int latched = btree_latch_path(db->pager, &cursor, frames);
+    if (latched < 0) {
+        return STATUS_ERROR;
+    }
+    int removed = leaf_node_delete_expired(&cursor, now);
+    btree_unlatch_all(db->pager, frames, latched);
+    if (removed < 0) {
+        return STATUS_ERROR;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (db_indexes_update(db, 0, expired[i].key, expired[i].value, NULL) != STATUS_OK) {
+            return STATUS_ERROR;
+        }
+        if (db->hash_index) {
+            hash_index_remove(db->hash_index, key_hash(expired[i].key, strlen(expired[i].key)));
+        }
+    }
+    db->bloom_deletes += count;
+    return (int)count;
+}
+
+// One step of the expiry sweep, as a write of its own: up to max_leaves
+// leaves of the default tree from the one the last step stopped at. With
+// the write latch held. Expired records are never in the row cache, so it
+// is left alone.
+// @return Number of records deleted, or STATUS_ERROR
+static int db_expiry_sweep_locked(Database *db, uint32_t max_leaves) {
+    if (db_txn_begin(db) != STATUS_OK) {
+        return STATUS_ERROR;
+    }
+    uint64_t now = (uint64_t)time(NULL);
+    uint32_t page_num = db->expiry_sweep_page;
+    int removed = 0;
+    int status = STATUS_OK;
+    for (uint32_t walked = 0; walked < max_leaves; walked++) {
+        pager_scope_begin(db->pager);
+        void *page = page_num != 0 ? pager_get_page_hint(db->pager, page_num, PAGER_HINT_USE_ONCE) : NULL;
+        if (!page || get_node_type(page) != NODE_LEAF) {
+            // From the first leaf: the root may be a leaf or not
+            Cursor cursor;
+            page = NULL;
+            if (table_find_into(db->pager, 0, "", &cursor) == 0) {
+                page_num = cursor.page_num;
+                page = pager_get_page(db->pager, page_num);
+            }
+        }
+        uint32_t next_page = page ? *leaf_node_next_leaf(page) : 0;
+        int count = page ? db_expiry_sweep_leaf(db, page_num, page, now) : STATUS_ERROR;
+        pager_scope_end(db->pager);
+        if (count < 0) {
+            status = STATUS_ERROR;
+            break;
+        }
+        removed += count;
+        page_num = next_page;
+        if (page_num == 0) {
+            break; // Past the last leaf: the next step starts over
+        }
+    }
+    db->expiry_sweep_page = page_num;
+    status = db_write_end(db, status);
+    db_bloom_maintain(db);
+    return status == STATUS_OK ? removed : STATUS_ERROR;
+}
+
+// Walk some leaves deleting expired records
+int db_expire_sweep(Database *db, uint32_t max_leaves) {
+    if (!db || max_leaves == 0) {
+        return STATUS_ERROR;
+    }
+    latch_lock_exclusive(&db->write_latch);
+    int removed = db_expiry_sweep_locked(db, max_leaves);
+    latch_unlock_exclusive(&db->write_latch);
+    return removed;
+}
+
+// Catalog records sort before every other key of the default tree, which
+// cannot start with a byte at or below the catalog prefix: ranks of
+// records start after the rank of this key
+static const char db_first_record_key[2] = { DB_CATALOG_KEY_PREFIX + 1, '\0' };
+
+// Count the records in a key range by rank
+int64_t db_count(Database *db, const char *low, const char *high) {
+    if (!db) {
+        return STATUS_ERROR;
     }
-    
-    char* key_at_index = leaf_node_key(page, cursor->cell_num);
-    if (strcmp(key, key_at_index) != 0) {
-        free(cursor);
-        return STATUS_NOT_FOUND;
+    db_tick(db);
+    db_merges_settle(db);
+    if (!low || strcmp(low, db_first_record_key) < 0) {
+        low = db_first_record_key;
     }
-    
-    // Key found, now delete it by shifting cells left
-    // Shift all cells after the deleted cell one position to the left
-    for (uint32_t i = cursor->cell_num; i < *num_cells - 1; i++) {
-        void* dest_cell = leaf_node_cell(page, i);
-        void* src_cell = leaf_node_cell(page, i + 1);
-        memcpy(dest_cell, src_cell, LEAF_NODE_CELL_SIZE);
+    pager_scope_begin(db->pager);
+    int64_t below_low = table_rank_latched(db->pager, 0, low);
+    int64_t below_high = below_low < 0 ? -1 : table_rank_latched(db->pager, 0, high);
+    pager_scope_end(db->pager);
+    if (below_low < 0 || below_high < 0) {
+        return STATUS_ERROR;
     }
-    
-    // Decrement the number of cells
-    (*num_cells)--;
-    
-    // Flush the modified page to disk
-    pager_flush(db->pager, cursor->page_num);
-    
-    free(cursor);
-    return STATUS_OK;
+    return below_high > below_low ? below_high - below_low : 0;
 }
 
+// Find the record at a position in key order
+int db_seek_rank(Database *db, uint64_t rank, char *key, char *buf, size_t cap) {
+    if (!db || !key || (!buf && cap > 0)) {
+        return STATUS_ERROR;
+    }
+    db_tick(db);
+    db_merges_settle(db);
+    Cursor cursor;
+    uint32_t frame;
+    pager_scope_begin(db->pager);
+    int64_t catalog = table_rank_latched(db->pager, 0, db_first_record_key);
+    int found = catalog < 0 ? -1 : table_seek_rank_latched(db->pager, 0, rank + (uint64_t)catalog, &cursor, &frame);
+    int result = found < 0 ? STATUS_ERROR : STATUS_NOT_FOUND;
+    void *page = found > 0 ? pager_get_page(db->pager, cursor.page_num) : NULL;
+    // Past records that have expired, hand over hand along the leaf chain
+    while (page) {
+        if (cursor.cell_num < *leaf_node_num_cells(page)) {
+            if (leaf_node_expired(page, cursor.cell_num)) {
+                cursor.cell_num++;
+                continue;
+            }
+            snprintf(key, MAX_KEY_LEN, "%s", leaf_node_key(page, cursor.cell_num));
+            const char *value = leaf_node_value(page, cursor.cell_num);
+            size_t length = strlen(value);
+            if (cap > 0) {
+                snprintf(buf, cap, "%s", value);
+            }
+            result = (int)length;
+            pager_unlatch_frame(db->pager, frame, PAGER_LATCH_SHARED);
+            break;
+        }
+        uint32_t next_page = *leaf_node_next_leaf(page);
+        if (next_page == 0) {
+            pager_unlatch_frame(db->pager, frame, PAGER_LATCH_SHARED);
+            break;
+        }
+        uint32_t next_frame;
+        void *next = pager_latch_page(db->pager, next_page, PAGER_LATCH_SHARED, &next_frame);
+        pager_unlatch_frame(db->pager, frame, PAGER_LATCH_SHARED);
+        pager_scope_unpin(db->pager, frame);
+        if (!next) {
+            result = STATUS_ERROR;
+        }
+        page = next;
+        frame = next_frame;
+        cursor.page_num = next_page;
+        cursor.cell_num = 0;
+    }
+    pager_scope_end(db->pager);
+    return result;
+}
 
 // List all keys
 void db_list(Database *db) {
     if (!db) return;
+    db_merges_settle(db);
     
     printf("Keys in database:\n");
     printf("----------------------------------------\n");
     
-    Cursor* cursor = table_start(db->pager, 0);
-    if (!cursor) {
+    // Walk the leaf chain hand over hand: latch the next leaf before
+    // letting go of the current one
+    Cursor cursor;
+    uint32_t frame;
+    pager_scope_begin(db->pager);
+    if (table_find_latched(db->pager, 0, "", &cursor, &frame) != 0) {
+        pager_scope_end(db->pager);
         printf("Error: Failed to create cursor\n");
         return;
     }
+    void* page = pager_get_page(db->pager, cursor.page_num);
     
     int count = 0;
     
-    while (!cursor->end_of_table) {
-        void* page = pager_get_page(db->pager, cursor->page_num);
-        if (!page) {
-            printf("Error: Failed to read page %d\n", cursor->page_num);
+    while (page) {
+        uint32_t num_cells = *leaf_node_num_cells(page);
+        for (uint32_t i = 0; i < num_cells; i++) {
+            if (leaf_node_key(page, i)[0] == DB_CATALOG_KEY_PREFIX || leaf_node_expired(page, i)) {
+                continue;
+            }
+            char key[2 * KEY_BINARY_MAX_WIDTH + 1];
+            db_key_format(db, leaf_node_key(page, i), key, sizeof(key));
+            printf("  %s -> %s\n", key, leaf_node_value(page, i));
+            count++;
+        }
+        uint32_t next_page = *leaf_node_next_leaf(page);
+        if (next_page == 0) {
+            pager_unlatch_frame(db->pager, frame, PAGER_LATCH_SHARED);
             break;
         }
-        char* key = leaf_node_key(page, cursor->cell_num);
-        char* value = leaf_node_value(page, cursor->cell_num);
-        printf("  %s -> %s\n", key, value);
-        count++;
-        cursor_advance(cursor);
+        uint32_t next_frame;
+        void* next = pager_latch_page_hint(db->pager, next_page, PAGER_HINT_USE_ONCE, PAGER_LATCH_SHARED,
+                                           &next_frame);
+        pager_unlatch_frame(db->pager, frame, PAGER_LATCH_SHARED);
+        pager_scope_unpin(db->pager, frame);
+        if (!next) {
+            printf("Error: Failed to read page %d\n", next_page);
+        }
+        page = next;
+        frame = next_frame;
     }
+    pager_scope_end(db->pager);
     
     printf("----------------------------------------\n");
     printf("Total: %d active record(s)\n", count);
-    free(cursor);
 }
 
-// Update the value of an existing key
-int db_update(Database *db, const char *key, const char *value) {
-    if (!db || !key || !value) {
-        return STATUS_ERROR;
-    }
-
-    if (strlen(value) >= LEAF_NODE_VALUE_SIZE) {
-        return STATUS_ERROR;
-    }
+// Page fill factors of the tree
+int db_fill_stats(Database *db, BTreeFillStats *stats) {
+    if (!db || !stats) return STATUS_ERROR;
+    return btree_fill_stats(db->pager, 0, stats) == 0 ? STATUS_OK : STATUS_ERROR;
+}
 
-    Cursor* cursor = table_find(db->pager, 0, key);
-    if (!cursor) {
+// Update in the tree rooted at root_page with the write latch held,
+// inside a pin scope
+static int db_update_locked(Database *db, uint32_t root_page, const char *key, const char *value) {
+    Cursor cursor;
+    if (table_find_into(db->pager, root_page, key, &cursor) != 0) {
         return STATUS_ERROR;
     }
     
-    void* page = pager_get_page(db->pager, cursor->page_num);
+    void* page = pager_get_page(db->pager, cursor.page_num);
     if (!page) {
-        free(cursor);
         return STATUS_ERROR;
     }
     
     uint32_t num_cells = *leaf_node_num_cells(page);
     
-    if (cursor->cell_num < num_cells) {
-        char* key_at_index = leaf_node_key(page, cursor->cell_num);
-        if (strcmp(key, key_at_index) == 0) {
-            // Found, update value
+    if (cursor.cell_num < num_cells) {
+        char* key_at_index = leaf_node_key(page, cursor.cell_num);
+        if (strcmp(key, key_at_index) == 0 && !leaf_node_expired(page, cursor.cell_num)) {
+            // Found, update value in place
             // Note: This is a simplified update that assumes value length fits.
             // In our fixed-size cell design, it always fits (256 bytes).
-            char* value_at = leaf_node_value(page, cursor->cell_num);
-            strncpy(value_at, value, LEAF_NODE_VALUE_SIZE - 1);
-            value_at[LEAF_NODE_VALUE_SIZE - 1] = '\0';
-            
-            pager_flush(db->pager, cursor->page_num);
-            free(cursor);
-            return STATUS_OK;
+            return db_leaf_set_value(db, cursor.page_num, cursor.cell_num, value);
         }
     }
     
-    free(cursor);
     return STATUS_NOT_FOUND;
-}
\ No newline at end of file
+}
+
+// Update the value of an existing key
+int db_update(Database *db, const char *key, const char *value) {
+    if (!db || !key || !value) {
+        return STATUS_ERROR;
+    }
+    db_tick(db);
+
+    if (strlen(value) >= LEAF_NODE_VALUE_SIZE || db_catalog_key(key)) {
+        return STATUS_ERROR;
+    }
+    if (db_bloom_rules_out(db, key)) {
+        return STATUS_NOT_FOUND;
+    }
+
+    if (db_write_begin(db) != STATUS_OK) {
+        return STATUS_ERROR;
+    }
+    pager_scope_begin(db->pager);
+    char old_value[MAX_VALUE_LEN];
+    bool indexed = db_tree_indexed(db, 0) && db_read_locked(db, 0, key, old_value);
+    int status = db_update_locked(db, 0, key, value);
+    if (status == STATUS_OK && indexed) {
+        status = db_indexes_update(db, 0, key, old_value, value);
+    }
+    pager_scope_end(db->pager);
+    status = db_write_end(db, status);
+    db_row_cache_invalidate(db, key);
+    latch_unlock_exclusive(&db->write_latch);
+    return status;
+}
+
+// Catalog record of an analysis: decimals separated by spaces, the format
+// version first, then taken_at, sampled, the height, the pages of each
+// level, records, key bytes, the key length buckets, the shortest and
+// longest key, pages read, tree pages, file pages, free pages and WAL bytes
+#define DB_ANALYSIS_VERSION 1
+#define DB_ANALYSIS_FIELDS_MAX (4 + BTREE_MAX_DEPTH + 2 + ANALYZE_KEY_BUCKETS + 7)
+
+static size_t db_analysis_fields(const DbAnalysis *analysis, uint64_t *fields) {
+    const TreeAnalysis *tree = &analysis->tree;
+    size_t n = 0;
+    fields[n++] = DB_ANALYSIS_VERSION;
+    fields[n++] = (uint64_t)analysis->taken_at;
+    fields[n++] = analysis->sampled ? 1 : 0;
+    fields[n++] = tree->height;
+    for (uint32_t level = 0; level < tree->height; level++) {
+        fields[n++] = tree->level_pages[level];
+    }
+    fields[n++] = tree->records;
+    fields[n++] = tree->key_bytes;
+    for (uint32_t i = 0; i < ANALYZE_KEY_BUCKETS; i++) {
+        fields[n++] = tree->key_lengths[i];
+    }
+    fields[n++] = tree->key_min;
+    fields[n++] = tree->key_max;
+    fields[n++] = tree->pages_read;
+    fields[n++] = analysis->tree_pages;
+    fields[n++] = analysis->file_pages;
+    fields[n++] = analysis->free_pages;
+    fields[n++] = analysis->wal_bytes;
+    return n;
+}
+
+static bool db_analysis_parse(const char *value, DbAnalysis *analysis) {
+    uint64_t fields[DB_ANALYSIS_FIELDS_MAX];
+    size_t n = 0;
+    while (*value != '\0') {
+        char *end;
+        if (n == DB_ANALYSIS_FIELDS_MAX) {
+            return false;
+        }
+        fields[n++] = strtoull(value, &end, 10);
+        if (end == value || (*end != ' ' && *end != '\0')) {
+            return false;
+        }
+        value = *end == ' ' ? end + 1 : end;
+    }
+    if (n < 4 || fields[0] != DB_ANALYSIS_VERSION || fields[3] > BTREE_MAX_DEPTH ||
+        n != 4 + fields[3] + 2 + ANALYZE_KEY_BUCKETS + 7) {
+        return false;
+    }
+    memset(analysis, 0, sizeof(*analysis));
+    TreeAnalysis *tree = &analysis->tree;
+    size_t i = 1;
+    analysis->taken_at = (time_t)fields[i++];
+    analysis->sampled = fields[i++] != 0;
+    tree->height = (uint32_t)fields[i++];
+    for (uint32_t level = 0; level < tree->height; level++) {
+        tree->level_pages[level] = fields[i++];
+        tree->pages += tree->level_pages[level];
+    }
+    tree->records = fields[i++];
+    tree->key_bytes = fields[i++];
+    for (uint32_t bucket = 0; bucket < ANALYZE_KEY_BUCKETS; bucket++) {
+        tree->key_lengths[bucket] = fields[i++];
+    }
+    tree->key_min = (uint32_t)fields[i++];
+    tree->key_max = (uint32_t)fields[i++];
+    tree->pages_read = fields[i++];
+    analysis->tree_pages = fields[i++];
+    analysis->file_pages = fields[i++];
+    analysis->free_pages = fields[i++];
+    analysis->wal_bytes = fields[i++];
+    return true;
+}
+
+// Write the summary to the catalog and keep it for db_analysis
+static int db_analysis_store(Database *db, const DbAnalysis *analysis) {
+    uint64_t fields[DB_ANALYSIS_FIELDS_MAX];
+    size_t n = db_analysis_fields(analysis, fields);
+    char value[LEAF_NODE_VALUE_SIZE];
+    size_t length = 0;
+    for (size_t i = 0; i < n; i++) {
+        int written = snprintf(value + length, sizeof(value) - length, i == 0 ? "%llu" : " %llu",
+                               (unsigned long long)fields[i]);
+        if (written < 0 || (size_t)written >= sizeof(value) - length) {
+            fprintf(stderr, "Error: Analysis summary does not fit in a record\n");
+            return STATUS_ERROR;
+        }
+        length += (size_t)written;
+    }
+
+    if (db_write_begin(db) != STATUS_OK) {
+        return STATUS_ERROR;
+    }
+    pager_scope_begin(db->pager);
+    int status = db_update_locked(db, 0, DB_ANALYSIS_KEY, value);
+    if (status == STATUS_NOT_FOUND) {
+        status = db_insert_locked(db, 0, DB_ANALYSIS_KEY, value);
+    }
+    pager_scope_end(db->pager);
+    status = db_write_end(db, status);
+    if (status == STATUS_OK) {
+        latch_lock_exclusive(&db->tables_latch);
+        db->analysis = *analysis;
+        db->has_analysis = true;
+        latch_unlock_exclusive(&db->tables_latch);
+    }
+    latch_unlock_exclusive(&db->write_latch);
+    return status;
+}
+
+static int db_analyze_tree(Database *db, uint32_t root_page, uint64_t epoch, const DbAnalyzeOptions *options,
+                           uint64_t seed, TreeAnalysis *tree) {
+    if (options && options->samples > 0) {
+        return tree_analyze_sampled(db->pager, root_page, epoch, options->samples,
+                                    seed + root_page * 0x9E3779B97F4A7C15ULL, tree);
+    }
+    return tree_analyze(db->pager, root_page, epoch, options ? options->threads : 1, tree);
+}
+
+// Analyze the default tree in full and the other trees for their pages
+int db_analyze(Database *db, const DbAnalyzeOptions *options, DbAnalysis *analysis) {
+    if (!db) {
+        return STATUS_ERROR;
+    }
+    db_tick(db);
+    db_merges_settle(db);
+
+    // The snapshot, the list of trees and the file size all as of one write
+    DbAnalysis result;
+    memset(&result, 0, sizeof(result));
+    latch_lock_exclusive(&db->write_latch);
+    uint64_t epoch = page_versions_acquire(&db->pager->versions, db->pager->num_pages);
+    result.file_pages = db->pager->num_pages;
+    result.wal_bytes = db->wal ? (uint64_t)db->wal->num_frames * WAL_FRAME_SIZE : 0;
+    latch_lock_shared(&db->tables_latch);
+    uint32_t num_roots = db->num_tables + db->num_indexes;
+    uint32_t *roots = malloc((num_roots + 1) * sizeof(uint32_t));
+    if (roots) {
+        for (uint32_t i = 0; i < db->num_tables; i++) {
+            roots[i] = db->tables[i].root_page;
+        }
+        for (uint32_t i = 0; i < db->num_indexes; i++) {
+            roots[db->num_tables + i] = db->indexes[i].root_page;
+        }
+    }
+    latch_unlock_shared(&db->tables_latch);
+    latch_unlock_exclusive(&db->write_latch);
+    if (epoch == UINT64_MAX || !roots) {
+        if (epoch != UINT64_MAX) {
+            page_versions_release(&db->pager->versions, epoch);
+        }
+        free(roots);
+        return STATUS_ERROR;
+    }
+
+    result.taken_at = time(NULL);
+    result.sampled = options && options->samples > 0;
+    uint64_t seed = (uint64_t)result.taken_at ^ (epoch << 32);
+    int status = db_analyze_tree(db, 0, epoch, options, seed, &result.tree) == 0 ? STATUS_OK : STATUS_ERROR;
+    result.tree_pages = result.tree.pages;
+    for (uint32_t i = 0; i < num_roots && status == STATUS_OK; i++) {
+        TreeAnalysis tree;
+        if (db_analyze_tree(db, roots[i], epoch, options, seed, &tree) != 0) {
+            status = STATUS_ERROR;
+        } else {
+            result.tree_pages += tree.pages;
+        }
+    }
+    page_versions_release(&db->pager->versions, epoch);
+    free(roots);
+    if (status != STATUS_OK) {
+        return status;
+    }
+    result.free_pages = result.file_pages > result.tree_pages ? result.file_pages - result.tree_pages : 0;
+
+    status = db_analysis_store(db, &result);
+    if (status == STATUS_OK && analysis) {
+        *analysis = result;
+    }
+    return status;
+}
+
+// The last analysis, as stored
+int db_analysis(Database *db, DbAnalysis *analysis) {
+    if (!db || !analysis) {
+        return STATUS_ERROR;
+    }
+    latch_lock_shared(&db->tables_latch);
+    bool found = db->has_analysis;
+    if (found) {
+        *analysis = db->analysis;
+    }
+    latch_unlock_shared(&db->tables_latch);
+    return found ? STATUS_OK : STATUS_NOT_FOUND;
+}
+
+// Create a named table with a root page of its own
+int db_create_table(Database *db, const char *name, const DbTableOptions *options) {
+    if (!db || !name) {
+        return STATUS_ERROR;
+    }
+    size_t name_length = strlen(name);
+    if (name_length == 0 || name_length > DB_TABLE_NAME_MAX) {
+        fprintf(stderr, "Error: Table names are 1 to %d characters\n", DB_TABLE_NAME_MAX);
+        return STATUS_ERROR;
+    }
+    if (name[0] == DB_CATALOG_KEY_PREFIX) {
+        fprintf(stderr, "Error: Names starting with byte 0x%02x are reserved\n", DB_CATALOG_KEY_PREFIX);
+        return STATUS_ERROR;
+    }
+    KeyType key_type = options ? options->key_type : KEY_TYPE_STRING;
+    uint32_t key_width = key_type == KEY_TYPE_BINARY ? options->key_width : 0;
+    if (key_type > KEY_TYPE_BINARY || (key_type == KEY_TYPE_BINARY &&
+                                       (key_width == 0 || key_width > KEY_BINARY_MAX_WIDTH))) {
+        fprintf(stderr, "Error: Invalid key type for table '%s'\n", name);
+        return STATUS_ERROR;
+    }
+
+    if (db_write_begin(db) != STATUS_OK) {
+        return STATUS_ERROR;
+    }
+    DbTable existing;
+    DbIndex index;
+    if (db_tables_find(db, name, &existing) || db_indexes_find(db, name, &index)) {
+        db_write_end(db, STATUS_OK);
+        latch_unlock_exclusive(&db->write_latch);
+        return STATUS_EXISTS;
+    }
+    // The root and the catalog record commit together
+    pager_scope_begin(db->pager);
+    uint32_t root_page = pager_allocate_pages(db->pager, 1);
+    void *root = pager_get_page_for_write(db->pager, root_page);
+    int status = STATUS_ERROR;
+    if (root) {
+        leaf_node_init(root);
+        set_node_root(root, true);
+        set_root_node_key_type(root, key_type, key_width);
+        pager_flush(db->pager, root_page);
+        char key[MAX_KEY_LEN];
+        char value[16];
+        db_catalog_key_of(name, key);
+        snprintf(value, sizeof(value), "%u", root_page);
+        status = db_insert_locked(db, 0, key, value);
+    }
+    pager_scope_end(db->pager);
+    status = db_write_end(db, status);
+    if (status == STATUS_OK && db_tables_add(db, name, root_page) != 0) {
+        status = STATUS_ERROR;
+    }
+    latch_unlock_exclusive(&db->write_latch);
+    return status;
+}
+
+// Drop a named table: its catalog record goes, and those of its indexes;
+// their pages are left unused
+int db_drop_table(Database *db, const char *name) {
+    if (!db || !name || strlen(name) > DB_TABLE_NAME_MAX) {
+        return STATUS_ERROR;
+    }
+    if (db_write_begin(db) != STATUS_OK) {
+        return STATUS_ERROR;
+    }
+    DbTable table;
+    if (!db_tables_find(db, name, &table)) {
+        db_write_end(db, STATUS_OK);
+        latch_unlock_exclusive(&db->write_latch);
+        return STATUS_NOT_FOUND;
+    }
+    char key[MAX_KEY_LEN];
+    db_catalog_key_of(name, key);
+    pager_scope_begin(db->pager);
+    int status = db_delete_locked(db, 0, key);
+    for (uint32_t i = 0; i < db->num_indexes && status == STATUS_OK; i++) {
+        if (db->indexes[i].table_root == table.root_page) {
+            db_catalog_key_of(db->indexes[i].name, key);
+            status = db_delete_locked(db, 0, key);
+        }
+    }
+    pager_scope_end(db->pager);
+    status = db_write_end(db, status);
+    if (status == STATUS_OK) {
+        for (uint32_t i = 0; i < db->num_indexes;) {
+            if (db->indexes[i].table_root == table.root_page) {
+                db_indexes_remove(db, db->indexes[i].name);
+            } else {
+                i++;
+            }
+        }
+        // Lookups that found the table before keep reading its pages,
+        // which nothing reuses
+        latch_lock_exclusive(&db->tables_latch);
+        for (uint32_t i = 0; i < db->num_tables; i++) {
+            if (strcmp(db->tables[i].name, name) == 0) {
+                memmove(&db->tables[i], &db->tables[i + 1], (db->num_tables - i - 1) * sizeof(DbTable));
+                db->num_tables--;
+                break;
+            }
+        }
+        latch_unlock_exclusive(&db->tables_latch);
+    }
+    latch_unlock_exclusive(&db->write_latch);
+    return status;
+}
+
+// Look up a named table
+int db_table_info(Database *db, const char *name, DbTable *table) {
+    if (!db || !name || !table) {
+        return STATUS_ERROR;
+    }
+    return db_tables_find(db, name, table) ? STATUS_OK : STATUS_NOT_FOUND;
+}
+
+// List the named tables
+uint32_t db_tables(Database *db, DbTable *tables, uint32_t max) {
+    if (!db) {
+        return 0;
+    }
+    latch_lock_shared(&db->tables_latch);
+    uint32_t count = db->num_tables;
+    for (uint32_t i = 0; i < count && i < max; i++) {
+        tables[i] = db->tables[i];
+    }
+    latch_unlock_shared(&db->tables_latch);
+    return count;
+}
+
+// Insert or replace a record of a named table
+int db_table_put(Database *db, const char *table, const char *key, const char *value) {
+    if (!db || !key || !value) {
+        return STATUS_ERROR;
+    }
+    DbTable info;
+    if (!db_table_lookup(db, table, &info)) {
+        return STATUS_ERROR;
+    }
+    if (strlen(key) >= MAX_KEY_LEN || strlen(value) >= MAX_VALUE_LEN) {
+        fprintf(stderr, "Error: Key or value too long (max %d and %d chars)\n", MAX_KEY_LEN - 1,
+                MAX_VALUE_LEN - 1);
+        return STATUS_ERROR;
+    }
+    if (!key_type_check(info.key_type, info.key_width, key)) {
+        fprintf(stderr, "Error: Not a %s key of table '%s'\n", key_type_name(info.key_type), info.name);
+        return STATUS_ERROR;
+    }
+    db_tick(db);
+
+    if (db_write_begin(db) != STATUS_OK) {
+        return STATUS_ERROR;
+    }
+    pager_scope_begin(db->pager);
+    char old_value[MAX_VALUE_LEN];
+    bool indexed = db_tree_indexed(db, info.root_page);
+    bool existed = indexed && db_read_locked(db, info.root_page, key, old_value);
+    int status = db_update_locked(db, info.root_page, key, value);
+    if (status == STATUS_NOT_FOUND) {
+        status = db_insert_locked(db, info.root_page, key, value);
+    }
+    if (status == STATUS_OK && indexed) {
+        status = db_indexes_update(db, info.root_page, key, existed ? old_value : NULL, value);
+    }
+    pager_scope_end(db->pager);
+    status = db_write_end(db, status);
+    latch_unlock_exclusive(&db->write_latch);
+    return status;
+}
+
+// Copy the value of a key of a named table into buf
+int db_table_get_into(Database *db, const char *table, const char *key, char *buf, size_t cap) {
+    if (!db || !key || (!buf && cap > 0)) {
+        return STATUS_ERROR;
+    }
+    DbTable info;
+    if (!db_table_lookup(db, table, &info)) {
+        return STATUS_ERROR;
+    }
+    db_tick(db);
+    size_t length;
+    uint32_t page_num, cell_num;
+    uint64_t expires_at;
+    int found = table_get_optimistic(db->pager, info.root_page, key, buf, cap, &length, NULL, NULL, NULL);
+    if (found >= 0) {
+        return found ? (int)length : STATUS_NOT_FOUND;
+    }
+    return db_tree_get_into(db, info.root_page, key, buf, cap, &page_num, &cell_num, &expires_at);
+}
+
+// Delete a key of a named table
+int db_table_delete(Database *db, const char *table, const char *key) {
+    if (!db || !key) {
+        return STATUS_ERROR;
+    }
+    DbTable info;
+    if (!db_table_lookup(db, table, &info)) {
+        return STATUS_ERROR;
+    }
+    db_tick(db);
+    if (db_write_begin(db) != STATUS_OK) {
+        return STATUS_ERROR;
+    }
+    pager_scope_begin(db->pager);
+    char old_value[MAX_VALUE_LEN];
+    bool indexed = db_tree_indexed(db, info.root_page) && db_read_locked(db, info.root_page, key, old_value);
+    int status = db_delete_locked(db, info.root_page, key);
+    if (status == STATUS_OK && indexed) {
+        status = db_indexes_update(db, info.root_page, key, old_value, NULL);
+    }
+    pager_scope_end(db->pager);
+    status = db_write_end(db, status);
+    latch_unlock_exclusive(&db->write_latch);
+    return status;
+}
+
+// Visit the records of a named table through a snapshot
+int64_t db_table_scan(Database *db, const char *table, const char *start, DbScanCallback callback, void *arg) {
+    if (!db || !callback) {
+        return STATUS_ERROR;
+    }
+    DbTable info;
+    if (!db_table_lookup(db, table, &info)) {
+        return STATUS_ERROR;
+    }
+    DbSnapshot snapshot;
+    if (db_snapshot(db, &snapshot) != STATUS_OK) {
+        return STATUS_ERROR;
+    }
+    int64_t visited = table_scan_version(db->pager, info.root_page, snapshot.epoch, start, callback, arg);
+    db_snapshot_release(&snapshot);
+    return visited < 0 ? STATUS_ERROR : visited;
+}
+
+// Filling a new index from the records of the tree it covers
+typedef struct {
+    Database *db;
+    const DbIndex *index;
+    int status;
+} DbIndexBuild;
+
+static int db_index_build_record(const char *key, const char *value, void *arg) {
+    DbIndexBuild *build = arg;
+    if (build->index->table_root == 0 && key[0] == DB_CATALOG_KEY_PREFIX) {
+        return 0;
+    }
+    // A scope per record, as one for the whole tree would pin too much
+    pager_scope_begin(build->db->pager);
+    build->status = db_index_update(build->db, build->index, key, NULL, value);
+    pager_scope_end(build->db->pager);
+    return build->status != STATUS_OK;
+}
+
+// Create a secondary index and fill it from the existing records
+int db_create_index(Database *db, const char *name, const DbIndexOptions *options) {
+    if (!db || !name) {
+        return STATUS_ERROR;
+    }
+    size_t name_length = strlen(name);
+    if (name_length == 0 || name_length > DB_TABLE_NAME_MAX) {
+        fprintf(stderr, "Error: Index names are 1 to %d characters\n", DB_TABLE_NAME_MAX);
+        return STATUS_ERROR;
+    }
+    if (name[0] == DB_CATALOG_KEY_PREFIX) {
+        fprintf(stderr, "Error: Names starting with byte 0x%02x are reserved\n", DB_CATALOG_KEY_PREFIX);
+        return STATUS_ERROR;
+    }
+    DbIndex index;
+    memset(&index, 0, sizeof(index));
+    strcpy(index.name, name);
+    if (options) {
+        index.delimiter = options->delimiter;
+        index.field = options->field;
+    }
+    if (options && options->table) {
+        DbTable table;
+        if (!db_table_lookup(db, options->table, &table)) {
+            return STATUS_ERROR;
+        }
+        strcpy(index.table, table.name);
+        index.table_root = table.root_page;
+    }
+
+    if (db_write_begin(db) != STATUS_OK) {
+        return STATUS_ERROR;
+    }
+    DbTable existing_table;
+    DbIndex existing_index;
+    if (db_tables_find(db, name, &existing_table) || db_indexes_find(db, name, &existing_index)) {
+        db_write_end(db, STATUS_OK);
+        latch_unlock_exclusive(&db->write_latch);
+        return STATUS_EXISTS;
+    }
+    if (index.table[0] != '\0' && !db_tables_find(db, index.table, &existing_table)) {
+        db_write_end(db, STATUS_OK);
+        latch_unlock_exclusive(&db->write_latch);
+        fprintf(stderr, "Error: No table '%s'\n", index.table);
+        return STATUS_ERROR;
+    }
+    pager_scope_begin(db->pager);
+    index.root_page = pager_allocate_pages(db->pager, 1);
+    void *root = pager_get_page_for_write(db->pager, index.root_page);
+    int status = STATUS_ERROR;
+    if (root) {
+        leaf_node_init(root);
+        set_node_root(root, true);
+        pager_flush(db->pager, index.root_page);
+        status = STATUS_OK;
+    }
+    pager_scope_end(db->pager);
+
+    // The records as of the last write, which only this writer could change
+    if (status == STATUS_OK) {
+        DbIndexBuild build = { db, &index, STATUS_OK };
+        if (table_scan_version(db->pager, index.table_root, db->pager->versions.epoch, NULL,
+                               db_index_build_record, &build) < 0) {
+            status = STATUS_ERROR;
+        } else {
+            status = build.status;
+        }
+    }
+    if (status == STATUS_OK) {
+        char key[MAX_KEY_LEN];
+        char value[32 + DB_TABLE_NAME_MAX];
+        db_catalog_key_of(name, key);
+        snprintf(value, sizeof(value), "%u %u %u %s", index.root_page, (unsigned int)(unsigned char)index.delimiter,
+                 index.field, index.table);
+        pager_scope_begin(db->pager);
+        status = db_insert_locked(db, 0, key, value);
+        pager_scope_end(db->pager);
+    }
+    status = db_write_end(db, status);
+    if (status == STATUS_OK && db_indexes_add(db, &index) != 0) {
+        status = STATUS_ERROR;
+    }
+    latch_unlock_exclusive(&db->write_latch);
+    return status;
+}
+
+// Drop a secondary index: its catalog record goes, its pages are left unused
+int db_drop_index(Database *db, const char *name) {
+    if (!db || !name || strlen(name) > DB_TABLE_NAME_MAX) {
+        return STATUS_ERROR;
+    }
+    if (db_write_begin(db) != STATUS_OK) {
+        return STATUS_ERROR;
+    }
+    DbIndex index;
+    if (!db_indexes_find(db, name, &index)) {
+        db_write_end(db, STATUS_OK);
+        latch_unlock_exclusive(&db->write_latch);
+        return STATUS_NOT_FOUND;
+    }
+    char key[MAX_KEY_LEN];
+    db_catalog_key_of(name, key);
+    pager_scope_begin(db->pager);
+    int status = db_delete_locked(db, 0, key);
+    pager_scope_end(db->pager);
+    status = db_write_end(db, status);
+    if (status == STATUS_OK) {
+        db_indexes_remove(db, name);
+    }
+    latch_unlock_exclusive(&db->write_latch);
+    return status;
+}
+
+// Look up a secondary index
+int db_index_info(Database *db, const char *name, DbIndex *index) {
+    if (!db || !name || !index) {
+        return STATUS_ERROR;
+    }
+    return db_indexes_find(db, name, index) ? STATUS_OK : STATUS_NOT_FOUND;
+}
+
+// A walk over index entries with the records they point to, all read as
+// of one snapshot
+typedef struct {
+    Database *db;
+    const DbIndex *index;
+    uint64_t epoch;
+    const char *low;  // NULL: unbounded
+    const char *high; // NULL: unbounded
+    bool exact;       // Only fields equal to low
+    char last_prefix[INDEX_FIELD_PREFIX_LEN + 1]; // Entries past this field part end the walk
+    DbIndexScanCallback callback;
+    void *arg;
+    int64_t visited;
+    bool failed;
+} DbIndexWalk;
+
+static int db_index_walk_entry(const char *entry, const char *key, void *arg) {
+    DbIndexWalk *walk = arg;
+    if (walk->exact || walk->high) {
+        char prefix[INDEX_FIELD_PREFIX_LEN + 1];
+        index_field_prefix(entry, prefix);
+        if (strcmp(prefix, walk->last_prefix) > 0) {
+            return 1;
+        }
+    }
+    // The entry only holds the start of the field: compare the whole of it
+    char value[MAX_VALUE_LEN];
+    char field[INDEX_FIELD_MAX + 1];
+    size_t length;
+    int found = table_get_version(walk->db->pager, walk->index->table_root, walk->epoch, key, value,
+                                  sizeof(value), &length);
+    if (found < 0) {
+        walk->failed = true;
+        return 1;
+    }
+    if (!found || !index_field(value, walk->index->delimiter, walk->index->field, field)) {
+        return 0;
+    }
+    if (walk->exact ? strcmp(field, walk->low) != 0
+                    : (walk->low && strcmp(field, walk->low) < 0) || (walk->high && strcmp(field, walk->high) >= 0)) {
+        return 0;
+    }
+    walk->visited++;
+    return walk->callback(key, value, walk->arg);
+}
+
+// Walk the entries of an index through a new snapshot
+static int64_t db_index_walk(Database *db, const char *name, const char *low, const char *high, bool exact,
+                             DbIndexScanCallback callback, void *arg) {
+    DbIndex index;
+    if (!db_indexes_find(db, name, &index)) {
+        fprintf(stderr, "Error: No index '%s'\n", name);
+        return STATUS_ERROR;
+    }
+    DbSnapshot snapshot;
+    if (db_snapshot(db, &snapshot) != STATUS_OK) {
+        return STATUS_ERROR;
+    }
+    DbIndexWalk walk = { db, &index, snapshot.epoch, low, high, exact, "", callback, arg, 0, false };
+    char start[INDEX_FIELD_PREFIX_LEN + 1] = "";
+    if (low) {
+        index_field_prefix(low, start);
+    }
+    if (exact || high) {
+        index_field_prefix(exact ? low : high, walk.last_prefix);
+    }
+    int64_t entries = table_scan_version(db->pager, index.root_page, snapshot.epoch, start, db_index_walk_entry,
+                                         &walk);
+    db_snapshot_release(&snapshot);
+    return entries < 0 || walk.failed ? STATUS_ERROR : walk.visited;
+}
+
+// The first record db_get_by_index finds
+typedef struct {
+    char *key;
+    char *buf;
+    size_t cap;
+    int length;
+} DbIndexGet;
+
+static int db_index_get_record(const char *key, const char *value, void *arg) {
+    DbIndexGet *get = arg;
+    snprintf(get->key, MAX_KEY_LEN, "%s", key);
+    size_t length = strlen(value);
+    if (get->cap > 0) {
+        snprintf(get->buf, get->cap, "%s", value);
+    }
+    get->length = (int)length;
+    return 1;
+}
+
+// Get the record whose indexed field equals field
+int db_get_by_index(Database *db, const char *index, const char *field, char key[MAX_KEY_LEN], char *buf,
+                    size_t cap) {
+    if (!db || !index || !field || !key || (!buf && cap > 0)) {
+        return STATUS_ERROR;
+    }
+    db_tick(db);
+    DbIndexGet get = { key, buf, cap, STATUS_NOT_FOUND };
+    if (db_index_walk(db, index, field, NULL, true, db_index_get_record, &get) < 0) {
+        return STATUS_ERROR;
+    }
+    return get.length;
+}
+
+// Visit the records whose indexed field is in [low, high)
+int64_t db_index_scan(Database *db, const char *index, const char *low, const char *high,
+                      DbIndexScanCallback callback, void *arg) {
+    if (!db || !index || !callback) {
+        return STATUS_ERROR;
+    }
+    return db_index_walk(db, index, low, high, false, callback, arg);
+}
@@ -4,18 +4,267 @@
 #include "pager.h"
 #include "btree.h"
 #include "wal.h"
+#include "bloom.h"
+#include "hash_index.h"
+#include "row_cache.h"
+#include "index_key.h"
+#include "analyze.h"
 #include "utility.h" // For MAX_FILENAME_LEN
+#include <time.h>
+
+// Longest name of a table (see db_create_table)
+#define DB_TABLE_NAME_MAX 63
+
+// The catalog of named tables is kept in the default tree, under keys made
+// of this byte and the table name; keys of the default tree may not start
+// with it
+#define DB_CATALOG_KEY_PREFIX '\x01'
+_Static_assert(DB_CATALOG_KEY_PREFIX == ANALYZE_CATALOG_KEY_PREFIX, "ANALYZE must leave the catalog out");
+
+// A named table: a tree of its own with its own root page, from
+// db_table_info and db_tables
+typedef struct {
+    char name[DB_TABLE_NAME_MAX + 1];
+    uint32_t root_page;
+    KeyType key_type; // Kept in the table's root page, like the default tree's
+    uint32_t key_width;
+} DbTable;
+
+// Options for db_create_table
+typedef struct {
+    KeyType key_type;   // See DbOptions.key_type
+    uint32_t key_width;
+} DbTableOptions;
+
+// A secondary index over one field of the values of a tree (the default
+// tree or a named table): a tree of its own mapping the field to the keys
+// of the records holding it (see index_key.h), from db_index_info. Every
+// write to the tree changes its indexes in the same WAL transaction.
+typedef struct {
+    char name[DB_TABLE_NAME_MAX + 1]; // Shares the catalog with table names
+    uint32_t root_page;
+    char table[DB_TABLE_NAME_MAX + 1]; // Indexed table, "" for the default tree
+    uint32_t table_root;
+    char delimiter; // See DbIndexOptions
+    uint32_t field;
+} DbIndex;
+
+// Options for db_create_index
+typedef struct {
+    const char *table; // Named table to index, or NULL for the default tree
+    char delimiter;    // Split values at this byte ('\0': the whole value is the field)
+    uint32_t field;    // Which part of the split value to index, from 0
+} DbIndexOptions;
+
+// Summary of the last db_analyze. It is kept as a catalog record (see
+// DB_ANALYSIS_KEY), so it outlives the handle and db_analysis reads it
+// without touching a page.
+typedef struct {
+    time_t taken_at;
+    bool sampled;        // Estimated from random descents, not read page by page
+    TreeAnalysis tree;   // The default tree's user records: catalog records left out, as in db_count
+    uint64_t tree_pages; // Pages of every tree: the default one, tables and indexes
+    uint64_t file_pages; // Pages in the database file
+    uint64_t free_pages; // Pages no tree reaches (those of dropped tables and indexes)
+    uint64_t wal_bytes;  // Size of the WAL
+} DbAnalysis;
+
+// Options for db_analyze
+typedef struct {
+    uint32_t samples; // Random descents per tree; 0 reads every page
+    uint32_t threads; // Worker threads of an exact analysis (0 or 1: the caller's only)
+} DbAnalyzeOptions;
+
+// Catalog key of the analysis summary: keys starting with the prefix twice
+// hold the database's own metadata, which is why no table or index name
+// may start with the prefix byte
+#define DB_ANALYSIS_KEY "\x01\x01" "analyze"
+
+// Called by db_index_scan for each matching record; return nonzero to stop
+typedef BTreeScanFn DbIndexScanCallback;
+
+// Merge operator for db_merge: combine the value of key (NULL if there
+// is no record) with an operand into out (MAX_VALUE_LEN bytes, NUL
+// included). Return STATUS_OK to store out; anything else leaves the
+// record as it was. Called with the write latch held: it must not call
+// back into the database.
+typedef int (*DbMergeOperator)(const char *key, const char *existing, const char *operand, char *out, void *arg);
+
+// A deferred merge waiting to be folded into its record
+typedef struct {
+    char key[MAX_KEY_LEN];
+    char operand[MAX_VALUE_LEN];
+    uint8_t kind;   // What the operand is for (db_incr, db_append or db_merge)
+    uint32_t order; // Position among the pending merges
+} DbPendingMerge;
+
+// Version of the file layout, stamped on page 0 when a database is
+// created. Raised with every change to the layout of pages or of the
+// catalog; files of another version are refused at open rather than
+// misread.
+#define DB_FORMAT_VERSION 1
+
+// Pending deferred merges that make the writer fold them without waiting
+// for a read or a write
+#define DB_MERGE_PENDING_MAX 4096
 
 // Database structure
-// WARNING: This implementation uses a global static instance (db_instance in db_core.c)
-// which limits the application to a single database and is NOT thread-safe.
-// For multi-database or multi-threaded use, this design would need to be refactored.
+// Each db_open returns its own heap-allocated handle owning its pager, WAL
+// and caches, so any number of databases can be open at once.
+// A handle may be shared by threads: lookups run concurrently, latching
+// pages shared on their way down the tree, while writes take turns and
+// latch exclusively only the pages they change. Open and close are not
+// thread-safe, and neither are db_get (its pointer is unprotected once it
+// returns) nor cursors over db->pager.
 typedef struct Database {
     char filename[MAX_FILENAME_LEN];
     Pager* pager;
     WAL* wal;
+    Latch write_latch; // Held by the one writer
+    // Warm restart (see DbOptions)
+    bool warm_restart;
+    char warm_path[MAX_FILENAME_LEN + 8]; // "<filename>.warm"
+    uint32_t warm_save_interval;
+    time_t warm_saved_at;
+    _Atomic uint32_t warm_ops; // Operations since the save timer was last checked
+    Latch warm_latch;          // Held while saving the warm list
+    // Negative lookup filter (see DbOptions), replaced only by the writer
+    _Atomic(BloomFilter*) bloom; // NULL when off
+    uint32_t bloom_bits_per_key;
+    uint64_t bloom_deletes; // Keys deleted since the filter was built
+    char bloom_path[MAX_FILENAME_LEN + 8]; // "<filename>.bloom"
+    _Atomic uint64_t bloom_negatives;       // Lookups the filter answered
+    _Atomic uint64_t bloom_false_positives; // Absent keys the filter let through
+    // Where hot keys were last found (see DbOptions); NULL when off
+    HashIndex* hash_index;
+    // Copies of hot values (see DbOptions); NULL when off
+    RowCache* row_cache;
+    // How keys are encoded and ordered, fixed when the database is created
+    KeyType key_type;
+    uint32_t key_width; // Bytes per binary key
+    // Named tables, read from the catalog at open and changed by the writer
+    DbTable* tables;
+    uint32_t num_tables;
+    // Secondary indexes, read from the catalog at open like the tables
+    DbIndex* indexes;
+    uint32_t num_indexes;
+    Latch tables_latch; // Shared to look a table or index up, exclusive to change the lists
+    // Merges (see DbOptions.deferred_merges and db_set_merge_operator)
+    DbMergeOperator merge_operator;
+    void *merge_arg;
+    bool deferred_merges;
+    DbPendingMerge *pending_merges; // Logged to the WAL, not yet in their records
+    Latch merge_sync_latch; // Held by the thread syncing operands for every merge waiting (db_merges_sync)
+    uint32_t pending_merges_cap;
+    _Atomic uint32_t num_pending_merges; // Checked by readers, which fold them first
+    // Expiry sweeper (see DbOptions.expiry_sweep_leaves), run by the writer
+    uint32_t expiry_sweep_leaves;
+    uint32_t expiry_sweep_page;   // Leaf the next step starts at, 0 for the first leaf
+    time_t expiry_swept_at;       // When the last step ran
+    _Atomic uint32_t expiry_ops;  // Operations since the sweep timer was last checked
+    // Last analysis, read from the catalog at open; under tables_latch
+    DbAnalysis analysis;
+    bool has_analysis;
 } Database;
 
+// A value read in place by db_get_pinned. The leaf holding it stays pinned
+// in the page cache, unchanged by later writes, until db_pinned_release.
+typedef struct {
+    Database* db;      // NULL when nothing is pinned
+    uint32_t frame;    // Pinned page frame
+    const char* value; // NUL-terminated value inside the pinned page
+    size_t length;     // strlen(value)
+} DbPinnedValue;
+
+// A read-only view of the database as of one moment, from db_snapshot.
+// Reads through it see no write made after it was taken, and take no part
+// in the writer's latching beyond brief shared latches on current pages.
+typedef struct {
+    Database* db;   // NULL once released
+    uint64_t epoch; // Writes it sees (see page_versions.h)
+} DbSnapshot;
+
+// Called by db_snapshot_scan for each record; return nonzero to stop
+typedef BTreeScanFn DbScanCallback;
+
+// Operations between checks of the warm list save timer
+#define DB_WARM_CHECK_OPS 256
+
+// Operations between checks of the expiry sweep timer
+#define DB_EXPIRY_CHECK_OPS 256
+
+// Smallest number of keys a Bloom filter is sized for
+#define DB_BLOOM_MIN_KEYS 1024
+
+// Negative lookup filter state, from db_bloom_stats
+typedef struct {
+    bool enabled;
+    uint64_t keys;           // Keys in the filter, deleted ones included
+    uint64_t capacity;       // Keys it is sized for; it is rebuilt larger beyond that
+    uint32_t hashes;
+    size_t memory_bytes;
+    double expected_fp_rate; // From the fill
+    uint64_t negatives;      // Lookups answered without reading the tree
+    uint64_t false_positives; // Lookups of absent keys the filter let through
+    double observed_fp_rate; // false_positives / (negatives + false_positives)
+} DbBloomStats;
+
+// Page and row cache counters, from db_cache_stats
+typedef struct {
+    PagerStats pages;
+    uint32_t page_frames; // Page cache size
+    size_t page_bytes;
+    RowCacheStats rows;   // All zero when the row cache is off
+} DbCacheStats;
+
+// Options for db_open_with_options
+typedef struct {
+    // Storage options (direct I/O, huge pages). Databases opened with the
+    // same pager.budget share one page cache allowance.
+    PagerOptions pager;
+    // Save the resident page list to "<filename>.warm" at close and preload
+    // those pages at open, so a restart does not begin with a cold cache
+    bool warm_restart;
+    // With warm_restart, also save the list every this many seconds
+    // (0 = only at close)
+    uint32_t warm_save_interval;
+    // Keep a Bloom filter of the keys with this many bits per key (10 gives
+    // about 1% false positives; 0 = none). Lookups, updates and deletes of
+    // keys it rules out never touch the tree. Saved to "<filename>.bloom"
+    // at close and read back at open; built from the tree otherwise.
+    uint32_t bloom_bits_per_key;
+    // Remember the leaf page and cell of up to about this many hot keys
+    // (0 = none). Point lookups of those keys check that one cell instead
+    // of descending the tree; about 9 bytes per entry.
+    uint32_t hash_index_entries;
+    // Keep copies of recently read values in a cache of this many bytes,
+    // apart from the page cache (0 = none). db_get_into and db_multi_get
+    // answer from it without touching a page; writes drop the keys they
+    // change. Hot values then cost their own size rather than a whole page
+    // each, so a smaller page cache can serve more hot keys.
+    size_t row_cache_bytes;
+    // Key type of a new database (see key_type.h), stored in its root page.
+    // Integer and binary keys are passed to the functions below encoded by
+    // db_key_u64 / db_key_i64 / db_key_binary, and sort as numbers or
+    // bytes. An existing database keeps its type: opening it with another
+    // type fails, with the default (KEY_TYPE_STRING) it is accepted.
+    KeyType key_type;
+    uint32_t key_width; // Bytes per key for KEY_TYPE_BINARY (1 to KEY_BINARY_MAX_WIDTH)
+    // Blind merges (db_incr without a result, db_append, db_merge) log
+    // their operand to the WAL and return without reading the record.
+    // Operands are folded into the records, one descent per key however
+    // many operands it has, before the next read or write of the database
+    // sees them, or once DB_MERGE_PENDING_MAX are waiting. An operand that
+    // turns out not to apply (an increment of a value that is not an
+    // integer) is then reported and dropped.
+    bool deferred_merges;
+    // Walk this many leaves of the default tree a second, at most, deleting
+    // the records that have expired (0 = none; see db_expire_sweep). The
+    // walk resumes where it stopped, and runs between writes on the thread
+    // of whichever operation finds the second has passed.
+    uint32_t expiry_sweep_leaves;
+} DbOptions;
+
 // Function declarations
 
 /**
@@ -26,11 +275,49 @@ typedef struct Database {
 Database* db_open(const char *filename);
 
 /**
- * Close the database and save to disk
- * @param db Database to close
+ * Open or create a database file with explicit options
+ * @param filename Path to the database file
+ * @param options Options, or NULL for defaults
+ * @return Pointer to Database structure, or NULL on error
+ */
+Database* db_open_with_options(const char *filename, const DbOptions *options);
+
+/**
+ * Close the database, save to disk and free the handle
+ * @param db Database to close; invalid after the call
  */
 void db_close(Database *db);
 
+/**
+ * Save the list of cached pages for warm restart now
+ * @param db Database instance opened with warm_restart
+ * @return Number of pages saved, or STATUS_ERROR on failure
+ */
+int db_save_warm_list(Database *db);
+
+/**
+ * Encode an integer or binary key for a database of that key type, for
+ * use with any function taking a key. Decode keys handed back (by scans)
+ * with key_decode_u64 / key_decode_i64 / key_decode_binary.
+ * @param key Receives the encoded key
+ * @return STATUS_OK, or STATUS_ERROR if the database has another key type
+ *         (or, for binary keys, another width)
+ */
+int db_key_u64(const Database *db, uint64_t value, char key[MAX_KEY_LEN]);
+int db_key_i64(const Database *db, int64_t value, char key[MAX_KEY_LEN]);
+int db_key_binary(const Database *db, const void *data, size_t len, char key[MAX_KEY_LEN]);
+
+/**
+ * Encode a key as typed by a user (decimal integers, hex binary keys)
+ * @return STATUS_OK, or STATUS_ERROR if text is not a key of the database's type
+ */
+int db_key_parse(const Database *db, const char *text, char key[MAX_KEY_LEN]);
+
+/**
+ * Write a stored key the way db_key_parse reads it, like snprintf
+ */
+void db_key_format(const Database *db, const char *key, char *buf, size_t cap);
+
 /**
  * Insert or update a key-value pair
  * @param db Database instance
@@ -40,15 +327,159 @@ void db_close(Database *db);
  */
 int db_insert(Database *db, const char *key, const char *value);
 
+/**
+ * Insert a key-value pair that expires at expires_at. From then on reads
+ * treat the record as absent, and a write of the key replaces it; the
+ * sweeper (or db_expire_sweep) deletes it.
+ * @param expires_at Seconds since the Unix epoch (0 = never, as db_insert)
+ * @return STATUS_OK, STATUS_EXISTS if the key holds a record that has not
+ *         expired, STATUS_ERROR on failure
+ */
+int db_insert_expiring(Database *db, const char *key, const char *value, time_t expires_at);
+
+/**
+ * Set when a record of the default tree expires. Updates and merges keep
+ * the expiry time of the record they change.
+ * @param expires_at Seconds since the Unix epoch, or 0 to keep the record
+ * @return STATUS_OK, STATUS_NOT_FOUND if the key doesn't exist (or has
+ *         expired), STATUS_ERROR on failure
+ */
+int db_expire(Database *db, const char *key, time_t expires_at);
+
+/**
+ * Get when a record expires
+ * @param expires_at Set to seconds since the Unix epoch, or 0 if it does not
+ * @return STATUS_OK, STATUS_NOT_FOUND, or STATUS_ERROR on failure
+ */
+int db_get_expiry(Database *db, const char *key, time_t *expires_at);
+
+/**
+ * Walk up to max_leaves leaves of the default tree from where the last
+ * walk stopped, deleting the records that have expired: the expired
+ * records of one leaf go in one write of the leaf, with their index
+ * entries, and the whole walk commits as one WAL transaction. After the
+ * last leaf the next walk starts again from the first.
+ * @return Number of records deleted, or STATUS_ERROR on failure
+ */
+int db_expire_sweep(Database *db, uint32_t max_leaves);
+
+/**
+ * Count the records of the default tree with keys in [low, high). Each
+ * bound is ranked in one descent by the record counts internal nodes keep
+ * for their children, however many records the range holds. Records that
+ * have expired count until they are deleted.
+ * @param low First key counted (NULL for the first record)
+ * @param high Key the range ends before (NULL for past the last record)
+ * @return Number of records, or STATUS_ERROR on failure
+ */
+int64_t db_count(Database *db, const char *low, const char *high);
+
+/**
+ * Find the record at position rank (0 for the first) in key order of the
+ * default tree in one descent, for pagination: a page starting at that
+ * position is then a scan from key (db_snapshot_scan). Ranks are those of
+ * db_count, so a record that has expired may hold a rank: the record after
+ * it is returned instead.
+ * @param key Receives the key (MAX_KEY_LEN bytes)
+ * @param buf Receives the value like snprintf (cap may be 0)
+ * @return Length of the value, STATUS_NOT_FOUND if the tree holds no
+ *         live record at or after rank, STATUS_ERROR on failure
+ */
+int db_seek_rank(Database *db, uint64_t rank, char *key, char *buf, size_t cap);
+
 /**
  * Get value by key
  * @param db Database instance
  * @param key Key to search for
  * @return Direct pointer to value string in database record, or NULL if not found
- * @note The returned pointer is valid until the database is closed or the record is deleted/updated
+ * @note The returned pointer points into a cached page: it is only valid
+ * until the next database call, which may evict the page or shift its
+ * cells, and not at all while another thread writes. Use db_get_into or
+ * db_get_pinned to keep the value.
  */
 const char* db_get(Database *db, const char *key);
 
+/**
+ * Get value by key, copied into a caller buffer
+ * Like snprintf, copies at most cap - 1 bytes and always terminates buf
+ * (if cap > 0); a return value >= cap means the value was truncated.
+ * @param db Database instance
+ * @param key Key to search for
+ * @param buf Destination buffer (may be NULL if cap is 0)
+ * @param cap Size of buf in bytes
+ * @return Length of the value, STATUS_NOT_FOUND if the key doesn't exist, STATUS_ERROR on failure
+ */
+int db_get_into(Database *db, const char *key, char *buf, size_t cap);
+
+/**
+ * Get value by key without copying it
+ * Pins the page frame holding the value: it is not evicted, and a write to
+ * the page moves the page to a new frame rather than changing the pinned
+ * bytes, so pinned->value stays valid and unchanged until released.
+ * Every successful call must be matched by db_pinned_release; pinned frames
+ * count against the cache size.
+ * @param db Database instance
+ * @param key Key to search for
+ * @param pinned Receives the value; left empty unless STATUS_OK is returned
+ * @return STATUS_OK, STATUS_NOT_FOUND if the key doesn't exist, STATUS_ERROR on failure
+ */
+int db_get_pinned(Database *db, const char *key, DbPinnedValue *pinned);
+
+/**
+ * Release a value returned by db_get_pinned (no-op if already released)
+ * @param pinned Handle filled in by db_get_pinned
+ */
+void db_pinned_release(DbPinnedValue *pinned);
+
+/**
+ * Take a snapshot of the database as of the last completed write
+ * While any snapshot is live, a writer saves a copy of each page before it
+ * first changes it after the newest snapshot, so writers never wait for
+ * snapshot readers. Saved pages are freed when the oldest snapshot that can read
+ * them is released. Taking a snapshot waits for a write in progress.
+ * @param db Database instance
+ * @param snapshot Receives the snapshot; release it with db_snapshot_release
+ * @return STATUS_OK on success, STATUS_ERROR on failure
+ */
+int db_snapshot(Database *db, DbSnapshot *snapshot);
+
+/**
+ * Release a snapshot (no-op if already released)
+ * @param snapshot Snapshot filled in by db_snapshot
+ */
+void db_snapshot_release(DbSnapshot *snapshot);
+
+/**
+ * Get the value a key had when the snapshot was taken, copied into buf
+ * (like db_get_into)
+ * @return Length of the value, STATUS_NOT_FOUND, or STATUS_ERROR on failure
+ */
+int db_snapshot_get(const DbSnapshot *snapshot, const char *key, char *buf, size_t cap);
+
+/**
+ * Visit the records of a snapshot in key order, from the first key >= start
+ * (NULL for the first record), while writers carry on
+ * @param callback Called with each key and value; return nonzero to stop
+ * @param arg Passed to callback
+ * @return Number of records visited, or STATUS_ERROR on failure
+ */
+int64_t db_snapshot_scan(const DbSnapshot *snapshot, const char *start, DbScanCallback callback, void *arg);
+
+/**
+ * Get the values of many keys at once
+ * Keys are sorted so neighbours share the descent from the root, and every
+ * target leaf is prefetched before any is probed, so cache misses overlap
+ * instead of being paid one lookup at a time. Values are copied out, as a
+ * batch can touch more pages than the cache keeps resident.
+ * @param db Database instance
+ * @param keys Keys to look up, in any order (duplicates allowed)
+ * @param n Number of keys
+ * @param out n buffers; out[i] receives the value of keys[i], or "" if missing
+ * @param found Optional, may be NULL; found[i] is set to whether keys[i] exists
+ * @return Number of keys found, or STATUS_ERROR on failure
+ */
+int db_multi_get(Database *db, const char *const keys[], size_t n, char (*out)[MAX_VALUE_LEN], bool found[]);
+
 /**
  * Delete a key-value pair
  * @param db Database instance
@@ -64,10 +495,212 @@ int db_delete(Database *db, const char *key);
  */
 void db_list(Database *db);
 
+/**
+ * Report how full the tree's pages are (walks every page)
+ * @param db Database instance
+ * @param stats Filled in on success
+ * @return STATUS_OK on success, STATUS_ERROR on failure
+ */
+int db_fill_stats(Database *db, BTreeFillStats *stats);
+
+/**
+ * Analyze the shape of the database as of one moment: tree height, pages
+ * per level, leaf fill and key sizes of the default tree, pages no tree
+ * reaches and WAL size. Reads through a snapshot, so writes go on
+ * meanwhile. The summary is stored in the catalog for db_analysis.
+ * @param options NULL for an exact analysis on the calling thread
+ * @param analysis Filled in on success (may be NULL)
+ * @return STATUS_OK on success, STATUS_ERROR on failure
+ */
+int db_analyze(Database *db, const DbAnalyzeOptions *options, DbAnalysis *analysis);
+
+/**
+ * Copy the summary of the last db_analyze, kept since then and across
+ * reopens, without reading the tree.
+ * @return STATUS_OK, or STATUS_NOT_FOUND if the database was never analyzed
+ */
+int db_analysis(Database *db, DbAnalysis *analysis);
+
+/**
+ * Report the negative lookup filter's size and false positive rates
+ * @param db Database instance
+ * @param stats Filled in; stats->enabled is false if the filter is off
+ * @return STATUS_OK on success, STATUS_ERROR on failure
+ */
+int db_bloom_stats(Database *db, DbBloomStats *stats);
+
+/**
+ * Report the counters of the page cache and the row cache
+ * @param db Database instance
+ * @param stats Filled in
+ * @return STATUS_OK on success, STATUS_ERROR on failure
+ */
+int db_cache_stats(Database *db, DbCacheStats *stats);
+
+/**
+ * Report the hash index's size, hits and admissions
+ * @param db Database instance
+ * @param stats Filled in; stats->capacity is 0 if the index is off. Hits
+ *        are counted in batches per thread, so recent ones may be missing.
+ * @return STATUS_OK on success, STATUS_ERROR on failure
+ */
+int db_hash_index_stats(Database *db, HashIndexStats *stats);
+
 /**
  * Update the value for an existing key
  * @param db Database instance
  */
 int db_update(Database *db, const char *key, const char *value);
 
+/**
+ * Add delta to the integer value of key (decimal, as db_incr writes it),
+ * in one descent of the tree. A missing key counts as 0 and is inserted.
+ * @param result Receives the new value; NULL for a blind increment, which
+ *        with deferred_merges only logs the operand
+ * @return STATUS_OK, or STATUS_ERROR if the value is not an integer, the
+ *         sum overflows, or on failure
+ */
+int db_incr(Database *db, const char *key, int64_t delta, int64_t *result);
+
+/**
+ * Append suffix to the value of key (inserting it if missing), in one
+ * descent of the tree; deferred like db_incr with deferred_merges
+ * @return STATUS_OK, or STATUS_ERROR if the value would be too long or on failure
+ */
+int db_append(Database *db, const char *key, const char *suffix);
+
+/**
+ * Replace the value of key only if it is still expected, in one descent
+ * @param expected Value the record must have, or NULL if it must not exist
+ * @param value New value
+ * @return STATUS_OK, STATUS_CONFLICT if the record holds something else
+ *         (or exists or not against expected), STATUS_ERROR on failure
+ */
+int db_compare_and_swap(Database *db, const char *key, const char *expected, const char *value);
+
+/**
+ * Register the merge operator db_merge uses (one per handle). With
+ * deferred_merges, register it right after db_open: operands recovered
+ * from the WAL wait for it until the first read or write.
+ * @return STATUS_OK, or STATUS_ERROR on failure
+ */
+int db_set_merge_operator(Database *db, DbMergeOperator merge, void *arg);
+
+/**
+ * Combine operand with the value of key through the merge operator, in
+ * one descent; deferred like db_incr with deferred_merges
+ * @return STATUS_OK, STATUS_ERROR if the operator refused or there is none
+ *         (only reported later when deferred), or on failure
+ */
+int db_merge(Database *db, const char *key, const char *operand);
+
+/**
+ * Create a named table: a tree of its own in the same file, with its own
+ * root page, so its records share no pages with the default tree or other
+ * tables. Its name and root page are recorded in the catalog.
+ * @param name 1 to DB_TABLE_NAME_MAX characters
+ * @param options Key type of the table, or NULL for string keys
+ * @return STATUS_OK, STATUS_EXISTS if a table has that name, STATUS_ERROR on failure
+ */
+int db_create_table(Database *db, const char *name, const DbTableOptions *options);
+
+/**
+ * Drop a named table and its records
+ * @return STATUS_OK, STATUS_NOT_FOUND if there is no such table, STATUS_ERROR on failure
+ * @note The table's pages are not reused: the file does not shrink
+ */
+int db_drop_table(Database *db, const char *name);
+
+/**
+ * Look up a named table
+ * @param table Filled in when found
+ * @return STATUS_OK, or STATUS_NOT_FOUND if there is no such table
+ */
+int db_table_info(Database *db, const char *name, DbTable *table);
+
+/**
+ * List the named tables
+ * @param tables Receives up to max tables, in creation order
+ * @return Number of tables (may exceed max)
+ */
+uint32_t db_tables(Database *db, DbTable *tables, uint32_t max);
+
+/**
+ * Insert a key-value pair into a named table, or replace the value of a key
+ * it holds. Keys are checked against the table's key type.
+ * Records of named tables are not kept in the Bloom filter, hash index or
+ * row cache, which cover the default tree only.
+ * @return STATUS_OK, or STATUS_ERROR on failure (including no such table)
+ */
+int db_table_put(Database *db, const char *table, const char *key, const char *value);
+
+/**
+ * Get a value from a named table, copied into buf (like db_get_into)
+ * @return Length of the value, STATUS_NOT_FOUND, or STATUS_ERROR on failure
+ */
+int db_table_get_into(Database *db, const char *table, const char *key, char *buf, size_t cap);
+
+/**
+ * Delete a key from a named table
+ * @return STATUS_OK, STATUS_NOT_FOUND, or STATUS_ERROR on failure
+ */
+int db_table_delete(Database *db, const char *table, const char *key);
+
+/**
+ * Visit the records of a named table in key order, from the first key
+ * >= start (NULL for the first record), as of the moment the scan begins
+ * (it reads through a snapshot, so writers carry on meanwhile)
+ * @return Number of records visited, or STATUS_ERROR on failure
+ */
+int64_t db_table_scan(Database *db, const char *table, const char *start, DbScanCallback callback, void *arg);
+
+/**
+ * Create a secondary index over one field of the values of the default
+ * tree or a named table, filled from the records already there. From then
+ * on every insert, update and delete changes the index in the same WAL
+ * transaction as the record, so a crash never leaves them apart.
+ * Records without the field are left out of the index.
+ * @param name 1 to DB_TABLE_NAME_MAX characters, unused by tables and indexes
+ * @param options Table and field to index, or NULL for whole values of the default tree
+ * @return STATUS_OK, STATUS_EXISTS if the name is taken, STATUS_ERROR on failure
+ */
+int db_create_index(Database *db, const char *name, const DbIndexOptions *options);
+
+/**
+ * Drop a secondary index (dropping a table drops its indexes)
+ * @return STATUS_OK, STATUS_NOT_FOUND if there is no such index, STATUS_ERROR on failure
+ * @note The index's pages are not reused: the file does not shrink
+ */
+int db_drop_index(Database *db, const char *name);
+
+/**
+ * Look up a secondary index
+ * @param index Filled in when found
+ * @return STATUS_OK, or STATUS_NOT_FOUND if there is no such index
+ */
+int db_index_info(Database *db, const char *name, DbIndex *index);
+
+/**
+ * Get the record whose indexed field equals field; with several, the one
+ * with the lowest key
+ * @param key Receives the record's key
+ * @param buf Receives the record's value like snprintf (cap may be 0)
+ * @return Length of the value, STATUS_NOT_FOUND, or STATUS_ERROR on failure
+ *         (including no such index)
+ */
+int db_get_by_index(Database *db, const char *index, const char *field, char key[MAX_KEY_LEN], char *buf,
+                    size_t cap);
+
+/**
+ * Visit the records whose indexed field is in [low, high), in field order
+ * (then key order), as of the moment the scan begins (through a snapshot,
+ * like db_table_scan). Fields compare as strings.
+ * @param low Lowest field, or NULL for no lower bound
+ * @param high Field past the last one, or NULL for no upper bound
+ * @param callback Called with each record's key and value; return nonzero to stop
+ * @return Number of records visited, or STATUS_ERROR on failure
+ */
+int64_t db_index_scan(Database *db, const char *index, const char *low, const char *high,
+                      DbIndexScanCallback callback, void *arg);
+
 #endif // DB_CORE_H
\ No newline at end of file
@@ -0,0 +1,150 @@
+#ifndef _WIN32
+#define _GNU_SOURCE
+#endif
+#include "frame_arena.h"
+#include "pager.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+// Try to back the region with huge pages: explicit ones, or a mapping the
+// kernel accepted MADV_HUGEPAGE for. Returns NULL if not possible.
+static void* arena_map_huge(size_t* size) {
+#if defined(__linux__)
+    size_t rounded = (*size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+#ifdef MAP_HUGETLB
+    // Explicit huge pages (requires vm.nr_hugepages to be reserved)
+    void* region = mmap(NULL, rounded, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (region != MAP_FAILED) {
+        *size = rounded;
+        return region;
+    }
+#endif
+#ifdef MADV_HUGEPAGE
+    // Fall back to transparent huge pages
+    void* thp = mmap(NULL, rounded, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (thp != MAP_FAILED) {
+        // Refused when THP is disabled: the region would be normal pages
+        if (madvise(thp, rounded, MADV_HUGEPAGE) == 0) {
+            *size = rounded;
+            return thp;
+        }
+        munmap(thp, rounded);
+    }
+#endif
+    return NULL;
+#else
+    (void)size;
+    return NULL;
+#endif
+}
+
+static void* arena_alloc_aligned(size_t size) {
+#ifdef _WIN32
+    return _aligned_malloc(size, PAGE_SIZE);
+#else
+    void* region = NULL;
+    if (posix_memalign(&region, PAGE_SIZE, size) != 0) {
+        return NULL;
+    }
+    return region;
+#endif
+}
+
+FrameArena* frame_arena_create(uint32_t num_frames, bool use_huge_pages) {
+    if (num_frames == 0) {
+        fprintf(stderr, "Error: Frame arena needs at least one frame\n");
+        return NULL;
+    }
+
+    FrameArena* arena = malloc(sizeof(FrameArena));
+    if (!arena) {
+        fprintf(stderr, "Failed to allocate memory for frame arena\n");
+        return NULL;
+    }
+    arena->size = (size_t)num_frames * PAGE_SIZE;
+    arena->base = NULL;
+    arena->huge_pages = false;
+    arena->mapped = false;
+
+    if (use_huge_pages) {
+        arena->base = arena_map_huge(&arena->size);
+        if (arena->base) {
+            arena->huge_pages = true;
+            arena->mapped = true;
+        } else {
+            fprintf(stderr, "Warning: Huge pages unavailable, using normal pages for frame arena\n");
+        }
+    }
+    if (!arena->base) {
+        arena->size = (size_t)num_frames * PAGE_SIZE;
+        arena->base = arena_alloc_aligned(arena->size);
+    }
+    if (!arena->base) {
+        fprintf(stderr, "Failed to allocate %u frames for frame arena\n", num_frames);
+        free(arena);
+        return NULL;
+    }
+
+    arena->free_list = malloc(num_frames * sizeof(uint32_t));
+    if (!arena->free_list) {
+        fprintf(stderr, "Failed to allocate frame arena free list\n");
+        arena->num_frames = num_frames;
+        frame_arena_destroy(arena);
+        return NULL;
+    }
+    // Hand out low frames first so a small working set stays compact
+    for (uint32_t i = 0; i < num_frames; i++) {
+        arena->free_list[i] = num_frames - 1 - i;
+    }
+    arena->num_frames = num_frames;
+    arena->num_free = num_frames;
+
+    return arena;
+}
+
+void* frame_arena_alloc(FrameArena* arena) {
+    if (arena->num_free == 0) {
+        return NULL;
+    }
+    uint32_t index = arena->free_list[--arena->num_free];
+    return arena->base + (size_t)index * PAGE_SIZE;
+}
+
+void frame_arena_free(FrameArena* arena, void* frame) {
+    if (!frame) return;
+    size_t offset = (size_t)((uint8_t*)frame - arena->base);
+    if ((uint8_t*)frame < arena->base || offset % PAGE_SIZE != 0 ||
+        offset / PAGE_SIZE >= arena->num_frames) {
+        fprintf(stderr, "Error: Frame %p does not belong to this arena\n", frame);
+        return;
+    }
+    arena->free_list[arena->num_free++] = (uint32_t)(offset / PAGE_SIZE);
+}
+
+void frame_arena_destroy(FrameArena* arena) {
+    if (!arena) return;
+    if (arena->base) {
+#ifdef _WIN32
+        _aligned_free(arena->base);
+#else
+        if (arena->mapped) {
+            munmap(arena->base, arena->size);
+        } else {
+            free(arena->base);
+        }
+#endif
+    }
+    free(arena->free_list);
+    free(arena);
+}
@@ -0,0 +1,49 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * Frame arena: one preallocated, PAGE_SIZE-aligned region carved into
+ * page frames. The pager takes its frames from here instead of calling
+ * calloc() on every cache miss, which keeps memory usage fixed at open
+ * and satisfies the buffer alignment rules of O_DIRECT.
+ */
+typedef struct FrameArena {
+    uint8_t* base;        // Start of the frame region
+    size_t size;          // Size of the region in bytes (may be rounded up)
+    uint32_t num_frames;  // Number of usable frames
+    uint32_t num_free;    // Number of frames on the free list
+    uint32_t* free_list;  // Stack of free frame indices
+    bool huge_pages;      // Region is backed by huge pages
+    bool mapped;          // Region was obtained with mmap (vs aligned malloc)
+} FrameArena;
+
+/**
+ * Create an arena holding num_frames page frames.
+ * If use_huge_pages is set, huge pages are tried first; when they are
+ * unavailable a warning is printed and the arena uses normal pages
+ * (huge_pages stays false).
+ * @return Arena, or NULL on allocation failure
+ */
+FrameArena* frame_arena_create(uint32_t num_frames, bool use_huge_pages);
+
+/**
+ * Take a frame from the arena. The frame contents are undefined.
+ * @return Pointer to a PAGE_SIZE frame, or NULL if the arena is exhausted
+ */
+void* frame_arena_alloc(FrameArena* arena);
+
+/**
+ * Return a frame previously obtained from frame_arena_alloc().
+ */
+void frame_arena_free(FrameArena* arena, void* frame);
+
+/**
+ * Release the arena and all of its frames.
+ */
+void frame_arena_destroy(FrameArena* arena);
+
+#endif // FRAME_ARENA_H
@@ -0,0 +1,183 @@
+#include "hash_index.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Entry word: tag (16 bits, never 0) | cell (16 bits) | page (32 bits)
+#define HASH_INDEX_TAG_SHIFT 48
+#define HASH_INDEX_CELL_SHIFT 32
+// Doorkeeper bits per entry
+#define HASH_INDEX_DOORKEEPER_BITS 8
+
+static uint64_t hash_index_tag(uint64_t hash) {
+    return (hash >> HASH_INDEX_TAG_SHIFT) | 1;
+}
+
+static _Atomic uint64_t* hash_index_set(HashIndex* index, uint64_t hash) {
+    return index->entries + (size_t)(hash & index->set_mask) * HASH_INDEX_WAYS;
+}
+
+HashIndex* hash_index_create(uint32_t capacity) {
+    uint32_t num_sets = 1;
+    while (num_sets * HASH_INDEX_WAYS < capacity && num_sets < (1u << 28)) {
+        num_sets *= 2;
+    }
+    size_t num_entries = (size_t)num_sets * HASH_INDEX_WAYS;
+    size_t doorkeeper_bits = num_entries * HASH_INDEX_DOORKEEPER_BITS;
+    HashIndex* index = calloc(1, sizeof(HashIndex));
+    if (index) {
+        index->entries = calloc(num_entries, sizeof(uint64_t));
+        index->referenced = calloc(num_entries, sizeof(uint8_t));
+        index->hands = calloc(num_sets, sizeof(uint8_t));
+        index->doorkeeper = calloc(doorkeeper_bits / 64, sizeof(uint64_t));
+    }
+    if (!index || !index->entries || !index->referenced || !index->hands || !index->doorkeeper) {
+        fprintf(stderr, "Failed to allocate hash index\n");
+        hash_index_destroy(index);
+        return NULL;
+    }
+    index->set_mask = num_sets - 1;
+    index->doorkeeper_mask = (uint32_t)(doorkeeper_bits - 1);
+    return index;
+}
+
+void hash_index_destroy(HashIndex* index) {
+    if (!index) {
+        return;
+    }
+    free(index->entries);
+    free(index->referenced);
+    free(index->hands);
+    free(index->doorkeeper);
+    free(index);
+}
+
+bool hash_index_find(HashIndex* index, uint64_t hash, uint32_t* page_num, uint32_t* cell_num) {
+    _Atomic uint64_t* set = hash_index_set(index, hash);
+    uint64_t tag = hash_index_tag(hash);
+    for (uint32_t way = 0; way < HASH_INDEX_WAYS; way++) {
+        uint64_t entry = atomic_load_explicit(&set[way], memory_order_relaxed);
+        if ((entry >> HASH_INDEX_TAG_SHIFT) == tag) {
+            *page_num = (uint32_t)entry;
+            *cell_num = (uint32_t)(entry >> HASH_INDEX_CELL_SHIFT) & 0xFFFF;
+            // Only write the bit when it changes, to keep hot lines shared
+            _Atomic uint8_t* referenced = &index->referenced[&set[way] - index->entries];
+            if (!atomic_load_explicit(referenced, memory_order_relaxed)) {
+                atomic_store_explicit(referenced, 1, memory_order_relaxed);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+// Hits of the calling thread not yet added to the counter
+static _Thread_local struct {
+    HashIndex* index;
+    uint32_t hits;
+} hash_index_hit_batch;
+
+void hash_index_hit(HashIndex* index) {
+    if (hash_index_hit_batch.index != index) {
+        hash_index_hit_batch.index = index; // Hits pending for another index are dropped
+        hash_index_hit_batch.hits = 0;
+    }
+    if (++hash_index_hit_batch.hits == HASH_INDEX_HIT_BATCH) {
+        hash_index_hit_batch.hits = 0;
+        atomic_fetch_add_explicit(&index->hits, HASH_INDEX_HIT_BATCH, memory_order_relaxed);
+    }
+}
+
+// Whether the key missed before in this window; marks it if not
+static bool hash_index_doorkeeper(HashIndex* index, uint64_t hash) {
+    uint32_t bit = (uint32_t)(hash >> 16) & index->doorkeeper_mask;
+    uint64_t mask = 1ull << (bit % 64);
+    if (atomic_load_explicit(&index->doorkeeper[bit / 64], memory_order_relaxed) & mask) {
+        return true;
+    }
+    atomic_fetch_or_explicit(&index->doorkeeper[bit / 64], mask, memory_order_relaxed);
+    // Start a new window once the doorkeeper has seen as many keys as it
+    // has entries, so old misses age out
+    if (atomic_fetch_add_explicit(&index->window, 1, memory_order_relaxed) + 1 >= index->doorkeeper_mask /
+                                                                              HASH_INDEX_DOORKEEPER_BITS) {
+        atomic_store_explicit(&index->window, 0, memory_order_relaxed);
+        for (uint32_t i = 0; i <= index->doorkeeper_mask / 64; i++) {
+            atomic_store_explicit(&index->doorkeeper[i], 0, memory_order_relaxed);
+        }
+    }
+    return false;
+}
+
+void hash_index_record(HashIndex* index, uint64_t hash, uint32_t page_num, uint32_t cell_num, bool stale) {
+    if (cell_num > 0xFFFF) {
+        return;
+    }
+    _Atomic uint64_t* set = hash_index_set(index, hash);
+    uint64_t tag = hash_index_tag(hash);
+    uint64_t entry = (tag << HASH_INDEX_TAG_SHIFT) | ((uint64_t)cell_num << HASH_INDEX_CELL_SHIFT) | page_num;
+    if (stale) {
+        atomic_fetch_add_explicit(&index->stale, 1, memory_order_relaxed);
+    }
+    // A key with an entry keeps its way
+    for (uint32_t way = 0; way < HASH_INDEX_WAYS; way++) {
+        uint64_t current = atomic_load_explicit(&set[way], memory_order_relaxed);
+        if ((current >> HASH_INDEX_TAG_SHIFT) == tag) {
+            atomic_compare_exchange_strong_explicit(&set[way], &current, entry, memory_order_relaxed,
+                                                    memory_order_relaxed);
+            return;
+        }
+    }
+    if (!hash_index_doorkeeper(index, hash)) {
+        atomic_fetch_add_explicit(&index->rejected, 1, memory_order_relaxed);
+        return;
+    }
+
+    // An empty way, else the first one CLOCK finds unreferenced
+    size_t base = (size_t)(set - index->entries);
+    uint32_t victim = HASH_INDEX_WAYS;
+    for (uint32_t way = 0; way < HASH_INDEX_WAYS; way++) {
+        uint64_t current = atomic_load_explicit(&set[way], memory_order_relaxed);
+        if (current == 0) {
+            victim = way;
+            break;
+        }
+    }
+    _Atomic uint8_t* hand = &index->hands[base / HASH_INDEX_WAYS];
+    for (uint32_t step = 0; victim == HASH_INDEX_WAYS; step++) {
+        uint32_t way = atomic_fetch_add_explicit(hand, 1, memory_order_relaxed) % HASH_INDEX_WAYS;
+        // A second lap takes whatever the hand points at
+        if (step >= HASH_INDEX_WAYS || !atomic_exchange_explicit(&index->referenced[base + way], 0,
+                                                                 memory_order_relaxed)) {
+            victim = way;
+        }
+    }
+    atomic_store_explicit(&index->referenced[base + victim], 0, memory_order_relaxed);
+    atomic_store_explicit(&set[victim], entry, memory_order_relaxed);
+    atomic_fetch_add_explicit(&index->admitted, 1, memory_order_relaxed);
+}
+
+void hash_index_remove(HashIndex* index, uint64_t hash) {
+    _Atomic uint64_t* set = hash_index_set(index, hash);
+    uint64_t tag = hash_index_tag(hash);
+    for (uint32_t way = 0; way < HASH_INDEX_WAYS; way++) {
+        uint64_t current = atomic_load_explicit(&set[way], memory_order_relaxed);
+        if ((current >> HASH_INDEX_TAG_SHIFT) == tag) {
+            atomic_compare_exchange_strong_explicit(&set[way], &current, 0, memory_order_relaxed,
+                                                    memory_order_relaxed);
+        }
+    }
+}
+
+void hash_index_get_stats(HashIndex* index, HashIndexStats* stats) {
+    size_t num_entries = ((size_t)index->set_mask + 1) * HASH_INDEX_WAYS;
+    stats->capacity = (uint32_t)num_entries;
+    stats->used = 0;
+    for (size_t i = 0; i < num_entries; i++) {
+        stats->used += atomic_load_explicit(&index->entries[i], memory_order_relaxed) != 0;
+    }
+    stats->hits = atomic_load_explicit(&index->hits, memory_order_relaxed);
+    stats->stale = atomic_load_explicit(&index->stale, memory_order_relaxed);
+    stats->admitted = atomic_load_explicit(&index->admitted, memory_order_relaxed);
+    stats->rejected = atomic_load_explicit(&index->rejected, memory_order_relaxed);
+    stats->memory_bytes = num_entries * (sizeof(uint64_t) + sizeof(uint8_t)) + (index->set_mask + 1) +
+                          ((size_t)index->doorkeeper_mask + 1) / 8;
+}
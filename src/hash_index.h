@@ -0,0 +1,92 @@
+#ifndef HASH_INDEX_H
+#define HASH_INDEX_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/**
+ * Hash index: an in-memory map from hot keys to where their record was
+ * last seen (leaf page and cell), so a lookup can go straight to the leaf
+ * instead of descending the tree.
+ *
+ * Entries are hints, never trusted: the reader checks that the cell still
+ * holds the key before using it. Leaves only ever split (keys move right)
+ * and cells shift on insert and delete, so a hint can go stale but a
+ * matching cell is always the live record. Stale hints are refreshed by
+ * the lookup that falls back to the tree.
+ *
+ * The table is set-associative (HASH_INDEX_WAYS entries per set), each
+ * entry one atomic word holding a 16-bit key tag, the cell and the page,
+ * so lookups, admissions and removals from any thread need no lock.
+ * Admission follows a doorkeeper: a key gets an entry the second time it
+ * misses within a window, so keys read once do not push out hot ones.
+ * Within a set the victim is chosen by CLOCK over per-entry reference bits.
+ */
+
+#define HASH_INDEX_WAYS 4
+// Hits a thread counts before adding them to the shared counter
+#define HASH_INDEX_HIT_BATCH 64
+
+typedef struct {
+    _Atomic uint64_t* entries;    // num_sets * HASH_INDEX_WAYS, 0 = empty
+    _Atomic uint8_t* referenced;  // CLOCK bit per entry
+    _Atomic uint8_t* hands;       // CLOCK hand per set
+    uint32_t set_mask;            // num_sets - 1 (a power of two)
+    _Atomic uint64_t* doorkeeper; // Keys that missed once in this window
+    uint32_t doorkeeper_mask;     // Bits - 1 (a power of two)
+    _Atomic uint32_t window;      // Doorkeeper insertions since it was cleared
+    // Counters
+    _Atomic uint64_t hits;        // Lookups served through an entry
+    _Atomic uint64_t stale;       // Entries that no longer matched their cell
+    _Atomic uint64_t admitted;
+    _Atomic uint64_t rejected;    // Misses the doorkeeper turned away
+} HashIndex;
+
+typedef struct {
+    uint32_t capacity; // Entries
+    uint32_t used;
+    uint64_t hits;
+    uint64_t stale;
+    uint64_t admitted;
+    uint64_t rejected;
+    size_t memory_bytes;
+} HashIndexStats;
+
+/**
+ * Create an index of about capacity entries (rounded up to a power of two
+ * number of sets).
+ * @return The index, or NULL on allocation failure
+ */
+HashIndex* hash_index_create(uint32_t capacity);
+
+void hash_index_destroy(HashIndex* index);
+
+/**
+ * Where the key with this hash (key_hash) was last seen.
+ * @return true and sets *page_num and *cell_num on a hit
+ */
+bool hash_index_find(HashIndex* index, uint64_t hash, uint32_t* page_num, uint32_t* cell_num);
+
+/**
+ * Count a hit: call once the found cell matched the key.
+ */
+void hash_index_hit(HashIndex* index);
+
+/**
+ * Record where a key was found by a lookup that did not use the index.
+ * A key with an entry has it updated in place; a new key goes through
+ * the doorkeeper.
+ * @param stale Whether the lookup followed a stale entry of this key
+ */
+void hash_index_record(HashIndex* index, uint64_t hash, uint32_t page_num, uint32_t cell_num, bool stale);
+
+/**
+ * Drop the entry of a key, if any (after a delete).
+ */
+void hash_index_remove(HashIndex* index, uint64_t hash);
+
+void hash_index_get_stats(HashIndex* index, HashIndexStats* stats);
+
+#endif // HASH_INDEX_H
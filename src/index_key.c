@@ -0,0 +1,55 @@
+#include "index_key.h"
+#include "key_head.h"
+#include <stdio.h>
+#include <string.h>
+
+// Bytes of a long primary key kept before its hash
+#define INDEX_PK_HASHED_PREFIX_LEN (INDEX_PK_PART_LEN - 16)
+
+bool index_field(const char* value, char delimiter, uint32_t field, char* out) {
+    const char* start = value;
+    if (delimiter != '\0') {
+        for (uint32_t i = 0; i < field; i++) {
+            start = strchr(start, delimiter);
+            if (!start) {
+                return false;
+            }
+            start++;
+        }
+    } else if (field != 0) {
+        return false;
+    }
+    const char* end = delimiter != '\0' ? strchr(start, delimiter) : NULL;
+    size_t length = end ? (size_t)(end - start) : strlen(start);
+    if (length > INDEX_FIELD_MAX) {
+        length = INDEX_FIELD_MAX;
+    }
+    memcpy(out, start, length);
+    out[length] = '\0';
+    return true;
+}
+
+size_t index_field_prefix(const char* field, char* out) {
+    size_t length = 0;
+    while (length < INDEX_FIELD_PREFIX_LEN && field[length] != '\0' && field[length] != INDEX_KEY_SEPARATOR) {
+        out[length] = field[length];
+        length++;
+    }
+    out[length] = '\0';
+    return length;
+}
+
+size_t index_entry_key(const char* field, const char* key, char* out) {
+    size_t length = index_field_prefix(field, out);
+    out[length++] = INDEX_KEY_SEPARATOR;
+    size_t key_length = strlen(key);
+    if (key_length <= INDEX_PK_PART_LEN) {
+        memcpy(out + length, key, key_length + 1);
+        return length + key_length;
+    }
+    // Keys cut to the same prefix still get entries of their own
+    memcpy(out + length, key, INDEX_PK_HASHED_PREFIX_LEN);
+    length += INDEX_PK_HASHED_PREFIX_LEN;
+    snprintf(out + length, 17, "%016llx", (unsigned long long)key_hash(key, key_length));
+    return length + 16;
+}
@@ -0,0 +1,53 @@
+#ifndef INDEX_KEY_H
+#define INDEX_KEY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * Keys of secondary index entries.
+ *
+ * An index is a tree of its own whose keys are made of the indexed field
+ * and the record's primary key:
+ *   field part - the field, cut at its first INDEX_KEY_SEPARATOR and after
+ *                INDEX_FIELD_PREFIX_LEN bytes
+ *   separator  - INDEX_KEY_SEPARATOR, which sorts below every other byte a
+ *                field part can hold, so entries sort by field first
+ *   key part   - the primary key; one longer than INDEX_PK_PART_LEN is cut
+ *                and ends with 16 hex digits of its hash instead
+ * The entry's value is the whole primary key. Fields that share a field
+ * part (long ones, or ones holding the separator) land next to each other,
+ * so lookups read the record back and compare the whole field.
+ */
+
+#define INDEX_KEY_SEPARATOR '\x01'
+// Bytes of a field kept in an entry key
+#define INDEX_FIELD_PREFIX_LEN 64
+// Longest primary key kept whole in an entry key
+#define INDEX_PK_PART_LEN 62
+// Longest field a lookup can match (a value is at most MAX_VALUE_LEN - 1)
+#define INDEX_FIELD_MAX 255
+
+/**
+ * Copy field number field (0-based) of value, splitting it at delimiter,
+ * into out (INDEX_FIELD_MAX + 1 bytes). A delimiter of '\0' makes the
+ * whole value the field.
+ * @return false if value has no such field
+ */
+bool index_field(const char* value, char delimiter, uint32_t field, char* out);
+
+/**
+ * Field part of field, as it starts an entry key, into out
+ * (INDEX_FIELD_PREFIX_LEN + 1 bytes)
+ * @return Its length
+ */
+size_t index_field_prefix(const char* field, char* out);
+
+/**
+ * Entry key of a record into out (128 bytes, MAX_KEY_LEN)
+ * @return Its length
+ */
+size_t index_entry_key(const char* field, const char* key, char* out);
+
+#endif // INDEX_KEY_H
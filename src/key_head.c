@@ -0,0 +1,113 @@
+#include "key_head.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define KEY_HEAD_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define KEY_HEAD_NEON 1
+#endif
+
+// Binary search narrows the range to at most this many heads, which are
+// then compared all at once
+#define KEY_HEAD_WINDOW 16
+
+#if defined(KEY_HEAD_SSE2)
+// Number of set bits in a 4-lane compare mask
+static const uint8_t mask_bits[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+#endif
+
+uint32_t key_head(const void* key, uint32_t len) {
+    const uint8_t* bytes = key;
+    uint32_t head = 0;
+    for (uint32_t i = 0; i < KEY_HEAD_SIZE; i++) {
+        head <<= 8;
+        if (i < len && bytes[i] == 0) {
+            len = i; // A NUL ends the key: zero-pad the rest
+        }
+        if (i < len) {
+            head |= bytes[i];
+        }
+    }
+    return head;
+}
+
+// Count heads[0 .. n) below head and above head
+static void key_head_count(const uint32_t* heads, uint32_t n, uint32_t head,
+                           uint32_t* below, uint32_t* above) {
+    uint32_t num_below = 0;
+    uint32_t num_above = 0;
+    uint32_t i = 0;
+#if defined(KEY_HEAD_SSE2)
+    // SSE2 only compares signed integers: flip the sign bits to compare unsigned
+    const __m128i bias = _mm_set1_epi32((int)0x80000000u);
+    const __m128i target = _mm_xor_si128(_mm_set1_epi32((int)head), bias);
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(heads + i)), bias);
+        int lt = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(v, target)));
+        int gt = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, target)));
+        num_below += mask_bits[lt];
+        num_above += mask_bits[gt];
+    }
+#elif defined(KEY_HEAD_NEON)
+    const uint32x4_t target = vdupq_n_u32(head);
+    for (; i + 4 <= n; i += 4) {
+        uint32x4_t v = vld1q_u32(heads + i);
+        // Compare masks are all ones: shift down to 1 per lane and add
+        num_below += vaddvq_u32(vshrq_n_u32(vcltq_u32(v, target), 31));
+        num_above += vaddvq_u32(vshrq_n_u32(vcgtq_u32(v, target), 31));
+    }
+#endif
+    for (; i < n; i++) {
+        num_below += heads[i] < head;
+        num_above += heads[i] > head;
+    }
+    *below = num_below;
+    *above = num_above;
+}
+
+void key_head_range(const uint32_t* heads, uint32_t n, uint32_t head, uint32_t* lo, uint32_t* hi) {
+    // Everything before begin is below head and everything from end on is above it
+    uint32_t begin = 0;
+    uint32_t end = n;
+    while (end - begin > KEY_HEAD_WINDOW) {
+        uint32_t mid = begin + (end - begin) / 2;
+        if (heads[mid] < head) {
+            begin = mid + 1;
+        } else if (heads[mid] > head) {
+            end = mid;
+        } else {
+            break; // A run of equal heads: count the rest
+        }
+    }
+    uint32_t below;
+    uint32_t above;
+    key_head_count(heads + begin, end - begin, head, &below, &above);
+    *lo = begin + below;
+    *hi = end - above;
+}
+
+uint64_t key_hash(const void* key, size_t len) {
+    const uint8_t* bytes = key;
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+    // FNV alone leaves the high bits weak for short keys
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+const char* key_head_implementation(void) {
+#if defined(KEY_HEAD_SSE2)
+    return "sse2";
+#elif defined(KEY_HEAD_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,43 @@
+#ifndef KEY_HEAD_H
+#define KEY_HEAD_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Key heads: the first KEY_HEAD_SIZE bytes of a key read as a big-endian
+ * integer, zero-padded when the key is shorter. Keys never contain NUL, so
+ * comparing two heads as integers gives the same order as strcmp() on the
+ * keys whenever the heads differ; only equal heads need the full key.
+ *
+ * Nodes keep the heads of their keys in a dense array so a search touches
+ * a few cache lines of integers instead of every key it compares.
+ */
+#define KEY_HEAD_SIZE sizeof(uint32_t)
+
+/**
+ * Head of the len bytes at key (stops early at a NUL).
+ */
+uint32_t key_head(const void* key, uint32_t len);
+
+/**
+ * Locate head in a sorted array of n heads.
+ * On return heads[0 .. *lo) are below head, heads[*lo .. *hi) equal it and
+ * heads[*hi .. n) are above it. Uses SSE2 / NEON compares where available.
+ */
+void key_head_range(const uint32_t* heads, uint32_t n, uint32_t head, uint32_t* lo, uint32_t* hi);
+
+/**
+ * 64-bit hash of the len bytes at key, for the in-memory filters and
+ * indexes over keys. FNV-1a followed by a 64-bit finalizer, so every
+ * output bit depends on every input byte.
+ */
+uint64_t key_hash(const void* key, size_t len);
+
+/**
+ * Name of the compare implementation ("sse2", "neon" or "scalar"),
+ * for benchmark output.
+ */
+const char* key_head_implementation(void);
+
+#endif // KEY_HEAD_H
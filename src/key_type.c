@@ -0,0 +1,194 @@
+#include "key_type.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+
+#define KEY_GROUP_BITS 7
+#define KEY_GROUP_FLAG 0x80u
+
+size_t key_encoded_len(size_t width) {
+    return (8 * width + KEY_GROUP_BITS - 1) / KEY_GROUP_BITS;
+}
+
+size_t key_encode_binary(const void* data, size_t len, char* out) {
+    const uint8_t* bytes = data;
+    size_t encoded_len = key_encoded_len(len);
+    uint32_t bits = 0;  // Pending bits, the oldest highest
+    uint32_t pending = 0;
+    size_t in = 0;
+    for (size_t i = 0; i < encoded_len; i++) {
+        if (pending < KEY_GROUP_BITS) {
+            // Past the end the stream is padded with zero bits
+            bits = (bits << 8) | (in < len ? bytes[in] : 0);
+            in++;
+            pending += 8;
+        }
+        pending -= KEY_GROUP_BITS;
+        out[i] = (char)(KEY_GROUP_FLAG | ((bits >> pending) & 0x7Fu));
+    }
+    out[encoded_len] = '\0';
+    return encoded_len;
+}
+
+bool key_decode_binary(const char* key, void* data, size_t width) {
+    size_t encoded_len = key_encoded_len(width);
+    if (strlen(key) != encoded_len) {
+        return false;
+    }
+    uint8_t* bytes = data;
+    uint32_t bits = 0;
+    uint32_t pending = 0;
+    size_t out = 0;
+    for (size_t i = 0; i < encoded_len; i++) {
+        uint8_t group = (uint8_t)key[i];
+        if (!(group & KEY_GROUP_FLAG)) {
+            return false;
+        }
+        bits = (bits << KEY_GROUP_BITS) | (group & 0x7Fu);
+        pending += KEY_GROUP_BITS;
+        if (pending >= 8) {
+            pending -= 8;
+            if (out < width) {
+                bytes[out++] = (uint8_t)(bits >> pending);
+            }
+        }
+    }
+    // The padding bits are zero, so every key has one encoding
+    return out == width && (bits & ((1u << pending) - 1)) == 0;
+}
+
+size_t key_encode_u64(uint64_t value, char* out) {
+    uint8_t bytes[8];
+    for (int i = 7; i >= 0; i--) {
+        bytes[i] = (uint8_t)value;
+        value >>= 8;
+    }
+    return key_encode_binary(bytes, sizeof(bytes), out);
+}
+
+bool key_decode_u64(const char* key, uint64_t* value) {
+    uint8_t bytes[8];
+    if (!key_decode_binary(key, bytes, sizeof(bytes))) {
+        return false;
+    }
+    *value = 0;
+    for (int i = 0; i < 8; i++) {
+        *value = (*value << 8) | bytes[i];
+    }
+    return true;
+}
+
+size_t key_encode_i64(int64_t value, char* out) {
+    return key_encode_u64((uint64_t)value ^ (1ull << 63), out);
+}
+
+bool key_decode_i64(const char* key, int64_t* value) {
+    uint64_t bits;
+    if (!key_decode_u64(key, &bits)) {
+        return false;
+    }
+    *value = (int64_t)(bits ^ (1ull << 63));
+    return true;
+}
+
+bool key_type_check(KeyType type, uint32_t width, const char* key) {
+    uint8_t bytes[KEY_BINARY_MAX_WIDTH];
+    switch (type) {
+    case KEY_TYPE_STRING:
+        return true;
+    case KEY_TYPE_U64:
+    case KEY_TYPE_I64:
+        return key_decode_binary(key, bytes, 8);
+    case KEY_TYPE_BINARY:
+        return width <= KEY_BINARY_MAX_WIDTH && key_decode_binary(key, bytes, width);
+    }
+    return false;
+}
+
+const char* key_type_name(KeyType type) {
+    switch (type) {
+    case KEY_TYPE_STRING:
+        return "string";
+    case KEY_TYPE_U64:
+        return "u64";
+    case KEY_TYPE_I64:
+        return "i64";
+    case KEY_TYPE_BINARY:
+        return "binary";
+    }
+    return "unknown";
+}
+
+bool key_parse(KeyType type, uint32_t width, const char* text, char* out) {
+    uint8_t bytes[KEY_BINARY_MAX_WIDTH];
+    char* end;
+    switch (type) {
+    case KEY_TYPE_STRING:
+        if (strlen(text) >= KEY_STRING_MAX_LEN) {
+            return false;
+        }
+        strcpy(out, text);
+        return true;
+    case KEY_TYPE_U64: {
+        if (*text == '\0' || *text == '-') {
+            return false;
+        }
+        errno = 0;
+        unsigned long long value = strtoull(text, &end, 10);
+        if (*end != '\0' || errno == ERANGE) {
+            return false;
+        }
+        key_encode_u64((uint64_t)value, out);
+        return true;
+    }
+    case KEY_TYPE_I64: {
+        if (*text == '\0') {
+            return false;
+        }
+        errno = 0;
+        long long value = strtoll(text, &end, 10);
+        if (*end != '\0' || errno == ERANGE) {
+            return false;
+        }
+        key_encode_i64((int64_t)value, out);
+        return true;
+    }
+    case KEY_TYPE_BINARY:
+        if (width > KEY_BINARY_MAX_WIDTH || strlen(text) != 2 * (size_t)width) {
+            return false;
+        }
+        for (uint32_t i = 0; i < width; i++) {
+            char digits[3] = { text[2 * i], text[2 * i + 1], '\0' };
+            if (!isxdigit((unsigned char)digits[0]) || !isxdigit((unsigned char)digits[1])) {
+                return false;
+            }
+            bytes[i] = (uint8_t)strtoul(digits, NULL, 16);
+        }
+        key_encode_binary(bytes, width, out);
+        return true;
+    }
+    return false;
+}
+
+void key_format(KeyType type, uint32_t width, const char* key, char* buf, size_t cap) {
+    uint8_t bytes[KEY_BINARY_MAX_WIDTH];
+    uint64_t u64;
+    int64_t i64;
+    if (cap == 0) {
+        return;
+    }
+    if (type == KEY_TYPE_U64 && key_decode_u64(key, &u64)) {
+        snprintf(buf, cap, "%llu", (unsigned long long)u64);
+    } else if (type == KEY_TYPE_I64 && key_decode_i64(key, &i64)) {
+        snprintf(buf, cap, "%lld", (long long)i64);
+    } else if (type == KEY_TYPE_BINARY && width <= KEY_BINARY_MAX_WIDTH && key_decode_binary(key, bytes, width)) {
+        buf[0] = '\0';
+        for (uint32_t i = 0; i < width && 2 * (size_t)i + 2 < cap; i++) {
+            snprintf(buf + 2 * i, 3, "%02x", bytes[i]);
+        }
+    } else {
+        snprintf(buf, cap, "%s", key);
+    }
+}
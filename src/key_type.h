@@ -0,0 +1,84 @@
+#ifndef KEY_TYPE_H
+#define KEY_TYPE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * Key types: what the keys of a table are and how they sort.
+ *
+ * Nodes store keys as NUL-free strings and search them with key heads and
+ * strcmp (see key_head.h). Typed keys are encoded into that form so byte
+ * order is the type's own order: the value's bytes, big-endian, are cut
+ * into 7-bit groups and each group is stored with the high bit set. Every
+ * key of a type has the same length and no NUL, so strcmp on encoded keys
+ * compares the numbers (or the binary strings) themselves, and a key head
+ * holds the top 28 bits of the key.
+ *   u64    - 10 bytes
+ *   i64    - 10 bytes, sign bit flipped so negatives sort first
+ *   binary - fixed width, (8 * width + 6) / 7 bytes
+ *   string - stored as given
+ */
+
+typedef enum {
+    KEY_TYPE_STRING = 0,
+    KEY_TYPE_U64 = 1,
+    KEY_TYPE_I64 = 2,
+    KEY_TYPE_BINARY = 3
+} KeyType;
+
+// Encoded length of a 64-bit integer key
+#define KEY_INT_ENCODED_LEN 10
+// Widest binary key whose encoding fits in a leaf key cell
+#define KEY_BINARY_MAX_WIDTH 111
+// Longest string key plus its NUL (MAX_KEY_LEN)
+#define KEY_STRING_MAX_LEN 128
+
+/**
+ * Encoded length of a key of width bytes (8 for the integer types).
+ */
+size_t key_encoded_len(size_t width);
+
+/**
+ * Encode a key into out, which must hold key_encoded_len(8) + 1 bytes for
+ * the integer types or key_encoded_len(len) + 1 for binary ones (len at
+ * most KEY_BINARY_MAX_WIDTH). out is NUL-terminated.
+ * @return The encoded length
+ */
+size_t key_encode_u64(uint64_t value, char* out);
+size_t key_encode_i64(int64_t value, char* out);
+size_t key_encode_binary(const void* data, size_t len, char* out);
+
+/**
+ * Decode a key stored by the matching encoder.
+ * @return false if key is not an encoded key of that type (or width)
+ */
+bool key_decode_u64(const char* key, uint64_t* value);
+bool key_decode_i64(const char* key, int64_t* value);
+bool key_decode_binary(const char* key, void* data, size_t width);
+
+/**
+ * Whether key is a valid key of the type (binary ones of width bytes).
+ */
+bool key_type_check(KeyType type, uint32_t width, const char* key);
+
+/**
+ * Encode a key typed by a user into out (KEY_STRING_MAX_LEN bytes):
+ * decimal for the integer types, 2 * width hex digits for binary keys.
+ * @return false if text is not a key of the type
+ */
+bool key_parse(KeyType type, uint32_t width, const char* text, char* out);
+
+/**
+ * Write a stored key the way key_parse reads it, like snprintf. Keys that
+ * do not decode are written as stored.
+ */
+void key_format(KeyType type, uint32_t width, const char* key, char* buf, size_t cap);
+
+/**
+ * Name of a key type ("string", "u64", "i64" or "binary").
+ */
+const char* key_type_name(KeyType type);
+
+#endif // KEY_TYPE_H
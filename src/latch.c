@@ -0,0 +1,77 @@
+#include "latch.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sched.h>
+#endif
+
+// Busy-wait iterations before a waiter starts yielding its time slice
+#define LATCH_SPINS 64
+
+void latch_pause(uint32_t* spins) {
+    if (++*spins < LATCH_SPINS) {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        __asm__ __volatile__("yield");
+#endif
+        return;
+    }
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+void latch_init(Latch* latch) {
+    atomic_init(&latch->state, 0);
+}
+
+void latch_lock_shared(Latch* latch) {
+    uint32_t spins = 0;
+    for (;;) {
+        uint32_t state = atomic_load_explicit(&latch->state, memory_order_relaxed);
+        if (!(state & (LATCH_WRITER | LATCH_PENDING)) &&
+            atomic_compare_exchange_weak_explicit(&latch->state, &state, state + 1,
+                                                  memory_order_acquire, memory_order_relaxed)) {
+            return;
+        }
+        latch_pause(&spins);
+    }
+}
+
+void latch_unlock_shared(Latch* latch) {
+    atomic_fetch_sub_explicit(&latch->state, 1, memory_order_release);
+}
+
+void latch_lock_exclusive(Latch* latch) {
+    uint32_t spins = 0;
+    for (;;) {
+        uint32_t state = atomic_load_explicit(&latch->state, memory_order_relaxed);
+        if ((state & ~LATCH_PENDING) == 0) {
+            // Free, apart from our own (or another writer's) pending mark
+            if (atomic_compare_exchange_weak_explicit(&latch->state, &state, LATCH_WRITER,
+                                                      memory_order_acquire, memory_order_relaxed)) {
+                return;
+            }
+            continue;
+        }
+        if (!(state & LATCH_PENDING)) {
+            atomic_fetch_or_explicit(&latch->state, LATCH_PENDING, memory_order_relaxed);
+        }
+        latch_pause(&spins);
+    }
+}
+
+void latch_unlock_exclusive(Latch* latch) {
+    // Also clears a pending mark: a writer still waiting sets it again
+    atomic_store_explicit(&latch->state, 0, memory_order_release);
+}
+
+bool latch_try_lock_exclusive(Latch* latch) {
+    uint32_t expected = 0;
+    return atomic_compare_exchange_strong_explicit(&latch->state, &expected, LATCH_WRITER,
+                                                   memory_order_acquire, memory_order_relaxed);
+}
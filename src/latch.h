@@ -0,0 +1,43 @@
+#ifndef LATCH_H
+#define LATCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/**
+ * Latch: a reader-writer lock in one atomic word, for the short critical
+ * sections of the storage engine (a page search, a frame table update).
+ * Waiters spin briefly, then yield the CPU. A waiting writer stops new
+ * readers from entering, so a steady stream of readers cannot starve it.
+ * Latches are not reentrant and need no setup beyond latch_init.
+ */
+typedef struct {
+    _Atomic uint32_t state; // LATCH_* bits plus the number of readers
+} Latch;
+
+#define LATCH_WRITER  (1u << 31) // Held exclusively
+#define LATCH_PENDING (1u << 30) // A writer is waiting for readers to leave
+
+void latch_init(Latch* latch);
+
+void latch_lock_shared(Latch* latch);
+void latch_unlock_shared(Latch* latch);
+
+void latch_lock_exclusive(Latch* latch);
+void latch_unlock_exclusive(Latch* latch);
+
+/**
+ * Take the latch exclusively if that is possible without waiting.
+ * @return true if the latch was taken
+ */
+bool latch_try_lock_exclusive(Latch* latch);
+
+/**
+ * One step of waiting the way latches do, for loops that wait on
+ * something else: a pause while spins (start it at 0) is small, then a
+ * yield of the time slice.
+ */
+void latch_pause(uint32_t* spins);
+
+#endif // LATCH_H
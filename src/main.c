@@ -1,17 +1,174 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "db_core.h"
 #include "utility.h"
 
+// Table chosen with USE; "" for the default tree
+static char current_table[DB_TABLE_NAME_MAX + 1];
+
+// Encode a key typed at the prompt for the key type of the current table
+static bool parse_key(Database *db, const char *text, char *stored_key) {
+    KeyType key_type = db->key_type;
+    uint32_t key_width = db->key_width;
+    if (current_table[0] != '\0') {
+        DbTable table;
+        if (db_table_info(db, current_table, &table) != STATUS_OK) {
+            fprintf(stderr, "Error: No table '%s'\n", current_table);
+            return false;
+        }
+        key_type = table.key_type;
+        key_width = table.key_width;
+    }
+    if (!key_parse(key_type, key_width, text, stored_key)) {
+        fprintf(stderr, "Error: '%s' is not a %s key\n", text, key_type_name(key_type));
+        return false;
+    }
+    return true;
+}
+
+// Print a record of the current table for LIST
+static int print_table_record(const char *key, const char *value, void *arg) {
+    const DbTable *table = arg;
+    char formatted[2 * KEY_BINARY_MAX_WIDTH + 1];
+    key_format(table->key_type, table->key_width, key, formatted, sizeof(formatted));
+    printf("  %s -> %s\n", formatted, value);
+    return 0;
+}
+
+// Parse "<name> [u64|i64|binary:<width>]" for CREATE TABLE
+static bool parse_table_options(const char *text, char *name, DbTableOptions *options) {
+    char type[32] = "";
+    memset(options, 0, sizeof(*options));
+    if (sscanf(text, "%63s %31s", name, type) < 1) {
+        return false;
+    }
+    if (type[0] == '\0' || strcmp(type, "string") == 0) {
+        options->key_type = KEY_TYPE_STRING;
+    } else if (strcmp(type, "u64") == 0) {
+        options->key_type = KEY_TYPE_U64;
+    } else if (strcmp(type, "i64") == 0) {
+        options->key_type = KEY_TYPE_I64;
+    } else if (strncmp(type, "binary:", 7) == 0) {
+        options->key_type = KEY_TYPE_BINARY;
+        options->key_width = (uint32_t)atoi(type + 7);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Parse "<name> [FIELD <n> SPLIT <c>]" for CREATE INDEX
+static bool parse_index_options(const char *text, char *name, DbIndexOptions *options) {
+    char field_word[8] = "";
+    char split_word[8] = "";
+    char delimiter[4] = "";
+    unsigned int field = 0;
+    memset(options, 0, sizeof(*options));
+    int parsed = sscanf(text, "%63s %7s %u %7s %3s", name, field_word, &field, split_word, delimiter);
+    if (parsed == 1) {
+        return true;
+    }
+    if (parsed != 5 || oktadb_strcasecmp(field_word, "FIELD") != 0 || oktadb_strcasecmp(split_word, "SPLIT") != 0 ||
+        strlen(delimiter) != 1) {
+        return false;
+    }
+    options->field = field;
+    options->delimiter = delimiter[0];
+    return true;
+}
+
+// Parse "[SAMPLE <n>] [THREADS <n>]" for ANALYZE
+static bool parse_analyze_options(const char *text, DbAnalyzeOptions *options) {
+    memset(options, 0, sizeof(*options));
+    char word[8];
+    unsigned int number;
+    int consumed;
+    while (sscanf(text, "%7s %u%n", word, &number, &consumed) == 2) {
+        if (oktadb_strcasecmp(word, "SAMPLE") == 0 && number > 0) {
+            options->samples = number;
+        } else if (oktadb_strcasecmp(word, "THREADS") == 0 && number > 0) {
+            options->threads = number;
+        } else {
+            return false;
+        }
+        text += consumed;
+    }
+    return sscanf(text, "%7s", word) != 1;
+}
+
+// Print a summary from ANALYZE, for ANALYZE and STATS
+static void print_analysis(const DbAnalysis *analysis) {
+    const TreeAnalysis *tree = &analysis->tree;
+    char taken[32];
+    strftime(taken, sizeof(taken), "%Y-%m-%d %H:%M:%S", localtime(&analysis->taken_at));
+    printf("Analysis:   %s, taken %s (%llu pages read)\n", analysis->sampled ? "sampled" : "exact", taken,
+           (unsigned long long)tree->pages_read);
+    printf("Height:     %u, pages per level:", tree->height);
+    for (uint32_t level = 0; level < tree->height; level++) {
+        printf(" %llu", (unsigned long long)tree->level_pages[level]);
+    }
+    printf("\n");
+    printf("Leaf fill:  %.1f%% (%llu records)\n", 100.0 * tree_analysis_leaf_fill(tree),
+           (unsigned long long)tree->records);
+    printf("Key sizes:  %.1f bytes on average, %u to %u;", tree->records ? (double)tree->key_bytes / tree->records : 0.0,
+           tree->key_min, tree->key_max);
+    for (uint32_t i = 0; i < ANALYZE_KEY_BUCKETS; i++) {
+        printf("%s <=%u: %llu", i > 0 ? "," : "", analyze_key_bucket_max[i], (unsigned long long)tree->key_lengths[i]);
+    }
+    printf("\n");
+    printf("Pages:      %llu in the file, %llu in trees, %llu free\n", (unsigned long long)analysis->file_pages,
+           (unsigned long long)analysis->tree_pages, (unsigned long long)analysis->free_pages);
+    printf("WAL:        %.1f KB\n", analysis->wal_bytes / 1024.0);
+}
+
 int main(int argc, char *argv[]) {
     if (argc < 2) {
         fprintf(stderr, "Error: Database file not specified\n");
-        fprintf(stderr, "Usage: %s <database_file>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <database_file> [--direct] [--huge-pages] [--warm] [--bloom] [--hash-index] [--row-cache] [--deferred-merges] [--expiry-sweep] [--keys=u64|i64|binary:<width>] [--checksum=off|sampled|always]\n", argv[0]);
         return 1;
     }
 
     const char *db_file = argv[1];
-    Database *db = db_open(db_file);
+    DbOptions options = {0};
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--direct") == 0) {
+            options.pager.flags |= PAGER_OPEN_DIRECT;
+        } else if (strcmp(argv[i], "--huge-pages") == 0) {
+            options.pager.flags |= PAGER_OPEN_HUGE_PAGES;
+        } else if (strcmp(argv[i], "--checksum=off") == 0) {
+            options.pager.checksum_mode = PAGER_CHECKSUM_OFF;
+        } else if (strcmp(argv[i], "--checksum=sampled") == 0) {
+            options.pager.checksum_mode = PAGER_CHECKSUM_SAMPLED;
+        } else if (strcmp(argv[i], "--checksum=always") == 0) {
+            options.pager.checksum_mode = PAGER_CHECKSUM_ALWAYS;
+        } else if (strcmp(argv[i], "--bloom") == 0) {
+            options.bloom_bits_per_key = 10;
+        } else if (strcmp(argv[i], "--hash-index") == 0) {
+            options.hash_index_entries = 65536;
+        } else if (strcmp(argv[i], "--row-cache") == 0) {
+            options.row_cache_bytes = 8u << 20;
+        } else if (strcmp(argv[i], "--deferred-merges") == 0) {
+            options.deferred_merges = true;
+        } else if (strcmp(argv[i], "--expiry-sweep") == 0) {
+            options.expiry_sweep_leaves = 64;
+        } else if (strcmp(argv[i], "--keys=u64") == 0) {
+            options.key_type = KEY_TYPE_U64;
+        } else if (strcmp(argv[i], "--keys=i64") == 0) {
+            options.key_type = KEY_TYPE_I64;
+        } else if (strncmp(argv[i], "--keys=binary:", 14) == 0) {
+            options.key_type = KEY_TYPE_BINARY;
+            options.key_width = (uint32_t)atoi(argv[i] + 14);
+        } else if (strcmp(argv[i], "--warm") == 0) {
+            options.warm_restart = true;
+            options.warm_save_interval = 60;
+        } else {
+            fprintf(stderr, "Error: Unknown option '%s'\n", argv[i]);
+            return 1;
+        }
+    }
+
+    Database *db = db_open_with_options(db_file, &options);
     
     if (!db) {
         fprintf(stderr, "Error: Could not open database file: %s\n", db_file);
@@ -24,6 +181,7 @@ int main(int argc, char *argv[]) {
     // Buffer sizes match MAX_VALUE_LEN for command, MAX_KEY_LEN for key/value
     char command[MAX_VALUE_LEN];
     char key[MAX_KEY_LEN];
+    char stored_key[MAX_KEY_LEN]; // key encoded for the database's key type
     char value[MAX_VALUE_LEN];
 
     while (1) {
@@ -58,7 +216,11 @@ int main(int argc, char *argv[]) {
             const char *cmd_ptr = (oktadb_strncasecmp(command, "INSERT ", 7) == 0) ? command + 7 : command + 4;
             // Use format specifiers that match buffer sizes
             if (sscanf(cmd_ptr, "%127s %255s", key, value) == 2) {
-                int status = db_insert(db, key, value);
+                if (!parse_key(db, key, stored_key)) {
+                    continue;
+                }
+                int status = current_table[0] ? db_table_put(db, current_table, stored_key, value)
+                                              : db_insert(db, stored_key, value);
                 if (status == STATUS_OK) {
                     printf("OK: Inserted key '%s'\n", key);
                 } else if (status == STATUS_EXISTS) {
@@ -78,9 +240,13 @@ int main(int argc, char *argv[]) {
         if (oktadb_strncasecmp(command, "GET ", 4) == 0 || oktadb_strncasecmp(command, "FETCH ", 6) == 0) {
             const char *cmd_ptr = (oktadb_strncasecmp(command, "GET ", 4) == 0) ? command + 4 : command + 6;
             if (sscanf(cmd_ptr, "%127s", key) == 1) {
-                const char *result = db_get(db, key);
-                if (result) {
-                    printf("%s\n", result);
+                if (!parse_key(db, key, stored_key)) {
+                    continue;
+                }
+                int length = current_table[0] ? db_table_get_into(db, current_table, stored_key, value, sizeof(value))
+                                              : db_get_into(db, stored_key, value, sizeof(value));
+                if (length >= 0) {
+                    printf("%s\n", value);
                 } else {
                     fprintf(stderr, "Key not found: %s\n", key);
                 }
@@ -94,7 +260,11 @@ int main(int argc, char *argv[]) {
         if (oktadb_strncasecmp(command, "DELETE ", 7) == 0  || oktadb_strncasecmp(command, "DEL ", 4) == 0) {
             const char *cmd_ptr = (oktadb_strncasecmp(command, "DELETE ", 7) == 0) ? command + 7 : command + 4;
             if (sscanf(cmd_ptr, "%127s", key) == 1) {
-                int status = db_delete(db, key);
+                if (!parse_key(db, key, stored_key)) {
+                    continue;
+                }
+                int status = current_table[0] ? db_table_delete(db, current_table, stored_key)
+                                              : db_delete(db, stored_key);
                 if (status == STATUS_OK) {
                     printf("OK: Deleted key '%s'\n", key);
                 } else if (status == STATUS_NOT_FOUND) {
@@ -110,14 +280,255 @@ int main(int argc, char *argv[]) {
 
         // LIST command
         if (oktadb_strcasecmp(command, "LIST") == 0 || oktadb_strcasecmp(command, "LS") == 0) {
-            db_list(db);
+            DbTable table;
+            if (current_table[0] == '\0') {
+                db_list(db);
+            } else if (db_table_info(db, current_table, &table) == STATUS_OK) {
+                printf("Keys in table '%s':\n", table.name);
+                printf("----------------------------------------\n");
+                int64_t count = db_table_scan(db, table.name, NULL, print_table_record, &table);
+                printf("----------------------------------------\n");
+                printf("Total: %lld active record(s)\n", (long long)count);
+            } else {
+                fprintf(stderr, "Error: No table '%s'\n", current_table);
+            }
+            continue;
+        }
+
+        // CREATE TABLE command
+        if (oktadb_strncasecmp(command, "CREATE TABLE ", 13) == 0) {
+            char name[DB_TABLE_NAME_MAX + 1];
+            DbTableOptions table_options;
+            if (!parse_table_options(command + 13, name, &table_options)) {
+                fprintf(stderr, "Error: Invalid syntax. Use: CREATE TABLE <name> [u64|i64|binary:<width>]\n");
+                continue;
+            }
+            int status = db_create_table(db, name, &table_options);
+            if (status == STATUS_OK) {
+                printf("OK: Created table '%s'\n", name);
+            } else if (status == STATUS_EXISTS) {
+                fprintf(stderr, "Error: Table '%s' already exists\n", name);
+            } else {
+                fprintf(stderr, "Error: Failed to create table '%s'\n", name);
+            }
+            continue;
+        }
+
+        // DROP TABLE command
+        if (oktadb_strncasecmp(command, "DROP TABLE ", 11) == 0) {
+            char name[DB_TABLE_NAME_MAX + 1];
+            if (sscanf(command + 11, "%63s", name) != 1) {
+                fprintf(stderr, "Error: Invalid syntax. Use: DROP TABLE <name>\n");
+                continue;
+            }
+            int status = db_drop_table(db, name);
+            if (status == STATUS_OK) {
+                printf("OK: Dropped table '%s'\n", name);
+                if (strcmp(name, current_table) == 0) {
+                    current_table[0] = '\0';
+                }
+            } else if (status == STATUS_NOT_FOUND) {
+                fprintf(stderr, "Error: No table '%s'\n", name);
+            } else {
+                fprintf(stderr, "Error: Failed to drop table '%s'\n", name);
+            }
+            continue;
+        }
+
+        // CREATE INDEX command - index a field of the current table
+        if (oktadb_strncasecmp(command, "CREATE INDEX ", 13) == 0) {
+            char name[DB_TABLE_NAME_MAX + 1];
+            DbIndexOptions index_options;
+            if (!parse_index_options(command + 13, name, &index_options)) {
+                fprintf(stderr, "Error: Invalid syntax. Use: CREATE INDEX <name> [FIELD <n> SPLIT <c>]\n");
+                continue;
+            }
+            index_options.table = current_table[0] != '\0' ? current_table : NULL;
+            int status = db_create_index(db, name, &index_options);
+            if (status == STATUS_OK) {
+                printf("OK: Created index '%s'\n", name);
+            } else if (status == STATUS_EXISTS) {
+                fprintf(stderr, "Error: A table or index named '%s' already exists\n", name);
+            } else {
+                fprintf(stderr, "Error: Failed to create index '%s'\n", name);
+            }
+            continue;
+        }
+
+        // DROP INDEX command
+        if (oktadb_strncasecmp(command, "DROP INDEX ", 11) == 0) {
+            char name[DB_TABLE_NAME_MAX + 1];
+            if (sscanf(command + 11, "%63s", name) != 1) {
+                fprintf(stderr, "Error: Invalid syntax. Use: DROP INDEX <name>\n");
+                continue;
+            }
+            int status = db_drop_index(db, name);
+            if (status == STATUS_OK) {
+                printf("OK: Dropped index '%s'\n", name);
+            } else if (status == STATUS_NOT_FOUND) {
+                fprintf(stderr, "Error: No index '%s'\n", name);
+            } else {
+                fprintf(stderr, "Error: Failed to drop index '%s'\n", name);
+            }
+            continue;
+        }
+
+        // FIND command - records by an indexed field, one value or [low, high)
+        if (oktadb_strncasecmp(command, "FIND ", 5) == 0) {
+            char name[DB_TABLE_NAME_MAX + 1];
+            char low[MAX_VALUE_LEN];
+            char high[MAX_VALUE_LEN + 1];
+            int parsed = sscanf(command + 5, "%63s %255s %255s", name, low, high);
+            DbIndex index;
+            if (parsed < 2) {
+                fprintf(stderr, "Error: Invalid syntax. Use: FIND <index> <value> or FIND <index> <low> <high>\n");
+                continue;
+            }
+            if (db_index_info(db, name, &index) != STATUS_OK) {
+                fprintf(stderr, "Error: No index '%s'\n", name);
+                continue;
+            }
+            if (parsed == 2) {
+                // Fields hold no NUL, so nothing sorts between a value and
+                // the value followed by byte 1
+                snprintf(high, sizeof(high), "%s\x01", low);
+            }
+            // Keys print in the key type of the indexed table
+            DbTable table = { "", 0, db->key_type, db->key_width };
+            if (index.table[0] != '\0' && db_table_info(db, index.table, &table) != STATUS_OK) {
+                fprintf(stderr, "Error: No table '%s'\n", index.table);
+                continue;
+            }
+            int64_t count = db_index_scan(db, name, low, high, print_table_record, &table);
+            if (count < 0) {
+                fprintf(stderr, "Error: Failed to scan index '%s'\n", name);
+            } else {
+                printf("Total: %lld record(s)\n", (long long)count);
+            }
+            continue;
+        }
+
+        // TABLES command
+        if (oktadb_strcasecmp(command, "TABLES") == 0) {
+            DbTable tables[64];
+            uint32_t count = db_tables(db, tables, 64);
+            for (uint32_t i = 0; i < count && i < 64; i++) {
+                printf("  %s (%s keys, root page %u)\n", tables[i].name, key_type_name(tables[i].key_type),
+                       tables[i].root_page);
+            }
+            printf("Total: %u table(s)\n", count);
+            continue;
+        }
+
+        // USE command - choose the table the other commands work on
+        if (oktadb_strcasecmp(command, "USE") == 0) {
+            current_table[0] = '\0';
+            printf("OK: Using the default table\n");
+            continue;
+        }
+        if (oktadb_strncasecmp(command, "USE ", 4) == 0) {
+            char name[DB_TABLE_NAME_MAX + 1];
+            DbTable table;
+            if (sscanf(command + 4, "%63s", name) != 1 || db_table_info(db, name, &table) != STATUS_OK) {
+                fprintf(stderr, "Error: No table '%s'\n", command + 4);
+                continue;
+            }
+            strcpy(current_table, name);
+            printf("OK: Using table '%s'\n", name);
+            continue;
+        }
+
+        // FILL command - how full the tree's pages are
+        if (oktadb_strcasecmp(command, "FILL") == 0) {
+            BTreeFillStats stats;
+            if (db_fill_stats(db, &stats) == STATUS_OK) {
+                printf("Depth:          %u\n", stats.depth);
+                printf("Leaf pages:     %u (%llu records, %.1f%% full)\n", stats.leaf_pages,
+                       (unsigned long long)stats.cells,
+                       100.0 * stats.cells / ((double)stats.leaf_pages * LEAF_NODE_MAX_CELLS));
+                printf("Internal pages: %u (%llu keys, %.1f%% full)\n", stats.internal_pages,
+                       (unsigned long long)stats.separators,
+                       stats.internal_pages ? 100.0 * stats.internal_bytes / ((double)stats.internal_pages * PAGE_USABLE_SIZE) : 0.0);
+            } else {
+                fprintf(stderr, "Error: Failed to read the tree\n");
+            }
+            continue;
+        }
+
+        // BLOOM command - negative lookup filter statistics
+        if (oktadb_strcasecmp(command, "BLOOM") == 0) {
+            DbBloomStats stats;
+            if (db_bloom_stats(db, &stats) != STATUS_OK || !stats.enabled) {
+                printf("Bloom filter is off (start with --bloom)\n");
+            } else {
+                printf("Keys:            %llu of %llu, %u hashes\n", (unsigned long long)stats.keys,
+                       (unsigned long long)stats.capacity, stats.hashes);
+                printf("Memory:          %.1f KB\n", stats.memory_bytes / 1024.0);
+                printf("False positives: %.2f%% expected, %.2f%% observed (%llu of %llu absent keys)\n",
+                       100.0 * stats.expected_fp_rate, 100.0 * stats.observed_fp_rate,
+                       (unsigned long long)stats.false_positives,
+                       (unsigned long long)(stats.negatives + stats.false_positives));
+            }
+            continue;
+        }
+
+        // STATS command - page cache and row cache counters
+        if (oktadb_strcasecmp(command, "STATS") == 0) {
+            DbCacheStats stats;
+            if (db_cache_stats(db, &stats) != STATUS_OK) {
+                fprintf(stderr, "Error: Failed to read cache statistics\n");
+                continue;
+            }
+            uint64_t page_requests = stats.pages.hits + stats.pages.misses;
+            printf("Page cache: %u frames (%.1f MB), %llu hits, %llu misses (%.1f%% hit rate), %llu evictions\n",
+                   stats.page_frames, stats.page_bytes / (1024.0 * 1024.0), (unsigned long long)stats.pages.hits,
+                   (unsigned long long)stats.pages.misses,
+                   page_requests ? 100.0 * stats.pages.hits / page_requests : 0.0,
+                   (unsigned long long)stats.pages.evictions);
+            if (stats.rows.budget_bytes == 0) {
+                printf("Row cache:  off (start with --row-cache)\n");
+            } else {
+                uint64_t row_lookups = stats.rows.hits + stats.rows.misses;
+                printf("Row cache:  %llu values (%.1f of %.1f MB), %llu hits, %llu misses (%.1f%% hit rate), "
+                       "%llu evictions, %llu invalidations\n",
+                       (unsigned long long)stats.rows.entries, stats.rows.bytes / (1024.0 * 1024.0),
+                       stats.rows.budget_bytes / (1024.0 * 1024.0), (unsigned long long)stats.rows.hits,
+                       (unsigned long long)stats.rows.misses, row_lookups ? 100.0 * stats.rows.hits / row_lookups : 0.0,
+                       (unsigned long long)stats.rows.evictions, (unsigned long long)stats.rows.invalidations);
+            }
+            DbAnalysis analysis;
+            if (db_analysis(db, &analysis) == STATUS_OK) {
+                print_analysis(&analysis);
+            } else {
+                printf("Analysis:   none yet (run ANALYZE)\n");
+            }
+            continue;
+        }
+
+        // ANALYZE command - tree shape statistics, stored for STATS
+        if (oktadb_strcasecmp(command, "ANALYZE") == 0 || oktadb_strncasecmp(command, "ANALYZE ", 8) == 0) {
+            DbAnalyzeOptions options;
+            if (!parse_analyze_options(command + 7, &options)) {
+                fprintf(stderr, "Error: Invalid syntax. Use: ANALYZE [SAMPLE <n>] [THREADS <n>]\n");
+                continue;
+            }
+            DbAnalysis analysis;
+            if (db_analyze(db, &options, &analysis) == STATUS_OK) {
+                print_analysis(&analysis);
+            } else {
+                fprintf(stderr, "Error: Failed to analyze the database\n");
+            }
             continue;
         }
 
         // UPDATE command
         if (oktadb_strncasecmp(command, "UPDATE ", 7) == 0) {
             if (sscanf(command + 7, "%127s %255s", key, value) == 2) {
-                int status = db_update(db, key, value);
+                if (!parse_key(db, key, stored_key)) {
+                    continue;
+                }
+                int status = current_table[0] ? db_table_put(db, current_table, stored_key, value)
+                                              : db_update(db, stored_key, value);
                 if (status == STATUS_OK) {
                     printf("OK: Updated key '%s'\n", key);
                 } else if (status == STATUS_NOT_FOUND) {
@@ -131,6 +542,204 @@ int main(int argc, char *argv[]) {
             continue;
         }
         
+        // INCR command - add to an integer value of the default table
+        if (oktadb_strncasecmp(command, "INCR ", 5) == 0) {
+            long long delta = 1;
+            int64_t result;
+            if (sscanf(command + 5, "%127s %lld", key, &delta) < 1) {
+                fprintf(stderr, "Error: Invalid syntax. Use: INCR <key> [delta]\n");
+                continue;
+            }
+            if (current_table[0] != '\0') {
+                fprintf(stderr, "Error: INCR works on the default table (USE)\n");
+                continue;
+            }
+            if (!parse_key(db, key, stored_key)) {
+                continue;
+            }
+            if (db_incr(db, stored_key, (int64_t)delta, &result) == STATUS_OK) {
+                printf("%lld\n", (long long)result);
+            } else {
+                fprintf(stderr, "Error: Failed to increment key '%s'\n", key);
+            }
+            continue;
+        }
+
+        // APPEND command - add to the end of a value of the default table
+        if (oktadb_strncasecmp(command, "APPEND ", 7) == 0) {
+            if (sscanf(command + 7, "%127s %255s", key, value) != 2) {
+                fprintf(stderr, "Error: Invalid syntax. Use: APPEND <key> <suffix>\n");
+                continue;
+            }
+            if (current_table[0] != '\0') {
+                fprintf(stderr, "Error: APPEND works on the default table (USE)\n");
+                continue;
+            }
+            if (!parse_key(db, key, stored_key)) {
+                continue;
+            }
+            if (db_append(db, stored_key, value) == STATUS_OK) {
+                printf("OK: Appended to key '%s'\n", key);
+            } else {
+                fprintf(stderr, "Error: Failed to append to key '%s'\n", key);
+            }
+            continue;
+        }
+
+        // CAS command - replace a value of the default table if unchanged
+        if (oktadb_strncasecmp(command, "CAS ", 4) == 0) {
+            char expected[MAX_VALUE_LEN];
+            if (sscanf(command + 4, "%127s %255s %255s", key, expected, value) != 3) {
+                fprintf(stderr, "Error: Invalid syntax. Use: CAS <key> <expected> <value>\n");
+                continue;
+            }
+            if (current_table[0] != '\0') {
+                fprintf(stderr, "Error: CAS works on the default table (USE)\n");
+                continue;
+            }
+            if (!parse_key(db, key, stored_key)) {
+                continue;
+            }
+            int status = db_compare_and_swap(db, stored_key, expected, value);
+            if (status == STATUS_OK) {
+                printf("OK: Swapped key '%s'\n", key);
+            } else if (status == STATUS_CONFLICT) {
+                fprintf(stderr, "Error: Key '%s' does not hold '%s'\n", key, expected);
+            } else {
+                fprintf(stderr, "Error: Failed to swap key '%s'\n", key);
+            }
+            continue;
+        }
+
+        // EXPIRE command - make a record of the default table expire
+        if (oktadb_strncasecmp(command, "EXPIRE ", 7) == 0) {
+            long long seconds;
+            if (sscanf(command + 7, "%127s %lld", key, &seconds) != 2 || seconds < 0) {
+                fprintf(stderr, "Error: Invalid syntax. Use: EXPIRE <key> <seconds>\n");
+                continue;
+            }
+            if (current_table[0] != '\0') {
+                fprintf(stderr, "Error: EXPIRE works on the default table (USE)\n");
+                continue;
+            }
+            if (!parse_key(db, key, stored_key)) {
+                continue;
+            }
+            int status = db_expire(db, stored_key, time(NULL) + (time_t)seconds);
+            if (status == STATUS_OK) {
+                printf("OK: Key '%s' expires in %lld second(s)\n", key, seconds);
+            } else if (status == STATUS_NOT_FOUND) {
+                fprintf(stderr, "Error: Key '%s' not found\n", key);
+            } else {
+                fprintf(stderr, "Error: Failed to set the expiry of key '%s'\n", key);
+            }
+            continue;
+        }
+
+        // PERSIST command - keep a record of the default table for good
+        if (oktadb_strncasecmp(command, "PERSIST ", 8) == 0) {
+            if (sscanf(command + 8, "%127s", key) != 1) {
+                fprintf(stderr, "Error: Invalid syntax. Use: PERSIST <key>\n");
+                continue;
+            }
+            if (current_table[0] != '\0') {
+                fprintf(stderr, "Error: PERSIST works on the default table (USE)\n");
+                continue;
+            }
+            if (!parse_key(db, key, stored_key)) {
+                continue;
+            }
+            int status = db_expire(db, stored_key, 0);
+            if (status == STATUS_OK) {
+                printf("OK: Key '%s' no longer expires\n", key);
+            } else if (status == STATUS_NOT_FOUND) {
+                fprintf(stderr, "Error: Key '%s' not found\n", key);
+            } else {
+                fprintf(stderr, "Error: Failed to clear the expiry of key '%s'\n", key);
+            }
+            continue;
+        }
+
+        // TTL command - show how long a record of the default table has left
+        if (oktadb_strncasecmp(command, "TTL ", 4) == 0) {
+            if (sscanf(command + 4, "%127s", key) != 1) {
+                fprintf(stderr, "Error: Invalid syntax. Use: TTL <key>\n");
+                continue;
+            }
+            if (current_table[0] != '\0') {
+                fprintf(stderr, "Error: TTL works on the default table (USE)\n");
+                continue;
+            }
+            if (!parse_key(db, key, stored_key)) {
+                continue;
+            }
+            time_t expires_at;
+            int status = db_get_expiry(db, stored_key, &expires_at);
+            if (status == STATUS_OK && expires_at == 0) {
+                printf("Key '%s' does not expire\n", key);
+            } else if (status == STATUS_OK) {
+                time_t now = time(NULL);
+                printf("%lld second(s)\n", (long long)(expires_at > now ? expires_at - now : 0));
+            } else if (status == STATUS_NOT_FOUND) {
+                fprintf(stderr, "Error: Key '%s' not found\n", key);
+            } else {
+                fprintf(stderr, "Error: Failed to read the expiry of key '%s'\n", key);
+            }
+            continue;
+        }
+
+        // COUNT command - records of the default table, all or in [low, high)
+        if (oktadb_strcasecmp(command, "COUNT") == 0 || oktadb_strncasecmp(command, "COUNT ", 6) == 0) {
+            char low[MAX_KEY_LEN];
+            char high[MAX_KEY_LEN];
+            char stored_low[MAX_KEY_LEN];
+            char stored_high[MAX_KEY_LEN];
+            int parsed = command[5] != '\0' ? sscanf(command + 6, "%127s %127s", low, high) : 0;
+            if (parsed == 1 || parsed < 0) {
+                fprintf(stderr, "Error: Invalid syntax. Use: COUNT or COUNT <low> <high>\n");
+                continue;
+            }
+            if (current_table[0] != '\0') {
+                fprintf(stderr, "Error: COUNT works on the default table (USE)\n");
+                continue;
+            }
+            if (parsed == 2 && (!parse_key(db, low, stored_low) || !parse_key(db, high, stored_high))) {
+                continue;
+            }
+            int64_t count = parsed == 2 ? db_count(db, stored_low, stored_high) : db_count(db, NULL, NULL);
+            if (count < 0) {
+                fprintf(stderr, "Error: Failed to count records\n");
+            } else {
+                printf("Total: %lld record(s)\n", (long long)count);
+            }
+            continue;
+        }
+
+        // RANK command - the record at a position of the default table
+        if (oktadb_strncasecmp(command, "RANK ", 5) == 0) {
+            unsigned long long rank;
+            if (sscanf(command + 5, "%llu", &rank) != 1) {
+                fprintf(stderr, "Error: Invalid syntax. Use: RANK <n>\n");
+                continue;
+            }
+            if (current_table[0] != '\0') {
+                fprintf(stderr, "Error: RANK works on the default table (USE)\n");
+                continue;
+            }
+            char value[MAX_VALUE_LEN];
+            int status = db_seek_rank(db, rank, stored_key, value, sizeof(value));
+            if (status >= 0) {
+                char shown[2 * KEY_BINARY_MAX_WIDTH + 1];
+                db_key_format(db, stored_key, shown, sizeof(shown));
+                printf("  %s -> %s\n", shown, value);
+            } else if (status == STATUS_NOT_FOUND) {
+                fprintf(stderr, "Error: No record at position %llu\n", rank);
+            } else {
+                fprintf(stderr, "Error: Failed to seek to position %llu\n", rank);
+            }
+            continue;
+        }
+
         // CLS command - cross-platform screen clearing
         if (oktadb_strcasecmp(command, "CLS") == 0 || oktadb_strcasecmp(command, "CLEAR") == 0) {
             clear_screen();
@@ -0,0 +1,136 @@
+#include "page_table.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t page_table_hash(uint32_t page_num) {
+    // Fibonacci hashing spreads sequential page numbers across the table
+    return page_num * 2654435769u;
+}
+
+static int page_table_alloc(PageTable* table, uint32_t capacity) {
+    table->keys = malloc(capacity * sizeof(uint32_t));
+    table->values = malloc(capacity * sizeof(uint32_t));
+    table->used = calloc(capacity, sizeof(bool));
+    if (!table->keys || !table->values || !table->used) {
+        fprintf(stderr, "Failed to allocate page table\n");
+        free(table->keys);
+        free(table->values);
+        free(table->used);
+        table->keys = NULL;
+        table->values = NULL;
+        table->used = NULL;
+        return -1;
+    }
+    table->capacity = capacity;
+    table->count = 0;
+    return 0;
+}
+
+int page_table_init(PageTable* table, uint32_t expected_entries) {
+    uint32_t capacity = 16;
+    // Keep the load factor at or below 1/2
+    while (capacity < expected_entries * 2) {
+        capacity *= 2;
+    }
+    return page_table_alloc(table, capacity);
+}
+
+void page_table_free(PageTable* table) {
+    free(table->keys);
+    free(table->values);
+    free(table->used);
+    table->keys = NULL;
+    table->values = NULL;
+    table->used = NULL;
+    table->capacity = 0;
+    table->count = 0;
+}
+
+bool page_table_get(const PageTable* table, uint32_t page_num, uint32_t* value) {
+    uint32_t mask = table->capacity - 1;
+    uint32_t slot = page_table_hash(page_num) & mask;
+    // Bounded, as a reader racing a writer (see pager.c) may see any mix
+    // of slots
+    for (uint32_t probes = 0; probes < table->capacity && table->used[slot]; probes++) {
+        if (table->keys[slot] == page_num) {
+            *value = table->values[slot];
+            return true;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return false;
+}
+
+static int page_table_grow(PageTable* table) {
+    PageTable bigger;
+    if (page_table_alloc(&bigger, table->capacity * 2) != 0) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < table->capacity; i++) {
+        if (table->used[i]) {
+            page_table_put(&bigger, table->keys[i], table->values[i]);
+        }
+    }
+    page_table_free(table);
+    *table = bigger;
+    return 0;
+}
+
+int page_table_put(PageTable* table, uint32_t page_num, uint32_t value) {
+    if ((table->count + 1) * 2 > table->capacity) {
+        if (page_table_grow(table) != 0) {
+            return -1;
+        }
+    }
+    uint32_t mask = table->capacity - 1;
+    uint32_t slot = page_table_hash(page_num) & mask;
+    while (table->used[slot]) {
+        if (table->keys[slot] == page_num) {
+            table->values[slot] = value;
+            return 0;
+        }
+        slot = (slot + 1) & mask;
+    }
+    table->used[slot] = true;
+    table->keys[slot] = page_num;
+    table->values[slot] = value;
+    table->count++;
+    return 0;
+}
+
+bool page_table_remove(PageTable* table, uint32_t page_num) {
+    uint32_t mask = table->capacity - 1;
+    uint32_t slot = page_table_hash(page_num) & mask;
+    while (table->used[slot]) {
+        if (table->keys[slot] == page_num) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    if (!table->used[slot]) {
+        return false;
+    }
+
+    // Backward-shift the rest of the probe run into the hole
+    uint32_t hole = slot;
+    uint32_t next = (hole + 1) & mask;
+    while (table->used[next]) {
+        uint32_t home = page_table_hash(table->keys[next]) & mask;
+        // Move the entry if its home slot is not within (hole, next]
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            table->keys[hole] = table->keys[next];
+            table->values[hole] = table->values[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    table->used[hole] = false;
+    table->count--;
+    return true;
+}
+
+void page_table_clear(PageTable* table) {
+    memset(table->used, 0, table->capacity * sizeof(bool));
+    table->count = 0;
+}
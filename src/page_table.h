@@ -0,0 +1,56 @@
+#ifndef PAGE_TABLE_H
+#define PAGE_TABLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Page table: open-addressing hash map from a 32-bit page number to a
+ * 32-bit value (a frame index, a WAL frame number, ...).
+ * Uses linear probing with backward-shift deletion, so there are no
+ * tombstones and lookups stay short under churn.
+ */
+typedef struct {
+    uint32_t* keys;
+    uint32_t* values;
+    bool* used;
+    uint32_t capacity; // Always a power of two
+    uint32_t count;
+} PageTable;
+
+/**
+ * Initialize a table sized for at least expected_entries entries.
+ * @return 0 on success, -1 on allocation failure
+ */
+int page_table_init(PageTable* table, uint32_t expected_entries);
+
+/**
+ * Release the table's memory.
+ */
+void page_table_free(PageTable* table);
+
+/**
+ * Look up a page number.
+ * @return true and sets *value if found, false otherwise
+ */
+bool page_table_get(const PageTable* table, uint32_t page_num, uint32_t* value);
+
+/**
+ * Insert or overwrite the mapping for a page number.
+ * The table grows as needed.
+ * @return 0 on success, -1 on allocation failure
+ */
+int page_table_put(PageTable* table, uint32_t page_num, uint32_t value);
+
+/**
+ * Remove the mapping for a page number, if present.
+ * @return true if an entry was removed
+ */
+bool page_table_remove(PageTable* table, uint32_t page_num);
+
+/**
+ * Remove all entries without releasing memory.
+ */
+void page_table_clear(PageTable* table);
+
+#endif // PAGE_TABLE_H
@@ -0,0 +1,169 @@
+#include "page_versions.h"
+#include "pager.h" // For PAGE_SIZE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t page_versions_bucket(uint32_t page_num) {
+    return (page_num * 2654435769u) >> (32 - 10); // PAGE_VERSIONS_BUCKETS = 2^10
+}
+
+void page_versions_init(PageVersions* versions) {
+    memset(versions, 0, sizeof(*versions));
+    atomic_init(&versions->live_count, 0);
+    latch_init(&versions->latch);
+}
+
+// Free the images that no live snapshot reads. Latch held exclusively.
+static void page_versions_reclaim(PageVersions* versions) {
+    if (!versions->buckets) {
+        return;
+    }
+    // Every snapshot reads images superseded after its epoch, so those
+    // superseded at or before the oldest one are unreachable
+    uint64_t oldest = versions->num_live > 0 ? versions->live[0].epoch : UINT64_MAX;
+    for (uint32_t b = 0; b < PAGE_VERSIONS_BUCKETS; b++) {
+        PageVersion** link = &versions->buckets[b];
+        while (*link) {
+            PageVersion* image = *link;
+            if (image->superseded <= oldest) {
+                *link = image->next;
+                free(image);
+                versions->num_images--;
+            } else {
+                link = &image->next;
+            }
+        }
+    }
+}
+
+void page_versions_destroy(PageVersions* versions) {
+    versions->num_live = 0;
+    page_versions_reclaim(versions);
+    free(versions->buckets);
+    free(versions->live);
+    versions->buckets = NULL;
+    versions->live = NULL;
+    versions->live_capacity = 0;
+    atomic_store(&versions->live_count, 0);
+}
+
+void page_versions_commit(PageVersions* versions) {
+    versions->epoch++;
+}
+
+uint64_t page_versions_acquire(PageVersions* versions, uint32_t num_pages) {
+    latch_lock_exclusive(&versions->latch);
+    uint64_t epoch = versions->epoch;
+    // Epochs only grow, so a new snapshot is the newest
+    if (versions->num_live > 0 && versions->live[versions->num_live - 1].epoch == epoch) {
+        versions->live[versions->num_live - 1].refs++;
+    } else {
+        if (versions->num_live == versions->live_capacity) {
+            uint32_t capacity = versions->live_capacity ? versions->live_capacity * 2 : 8;
+            PageVersionsLive* live = realloc(versions->live, capacity * sizeof(PageVersionsLive));
+            if (!live) {
+                latch_unlock_exclusive(&versions->latch);
+                fprintf(stderr, "Failed to allocate snapshot list\n");
+                return UINT64_MAX;
+            }
+            versions->live = live;
+            versions->live_capacity = capacity;
+        }
+        versions->live[versions->num_live].epoch = epoch;
+        versions->live[versions->num_live].refs = 1;
+        versions->num_live++;
+    }
+    versions->snapshot_pages = num_pages;
+    atomic_fetch_add(&versions->live_count, 1);
+    latch_unlock_exclusive(&versions->latch);
+    return epoch;
+}
+
+void page_versions_release(PageVersions* versions, uint64_t epoch) {
+    latch_lock_exclusive(&versions->latch);
+    for (uint32_t i = 0; i < versions->num_live; i++) {
+        if (versions->live[i].epoch != epoch) {
+            continue;
+        }
+        atomic_fetch_sub(&versions->live_count, 1);
+        if (--versions->live[i].refs == 0) {
+            memmove(&versions->live[i], &versions->live[i + 1],
+                    (versions->num_live - i - 1) * sizeof(PageVersionsLive));
+            versions->num_live--;
+            // Only the oldest snapshot holds images back
+            if (i == 0) {
+                page_versions_reclaim(versions);
+            }
+        }
+        break;
+    }
+    latch_unlock_exclusive(&versions->latch);
+}
+
+int page_versions_preserve(PageVersions* versions, uint32_t page_num, const void* data) {
+    if (atomic_load_explicit(&versions->live_count, memory_order_acquire) == 0) {
+        return 0;
+    }
+    latch_lock_exclusive(&versions->latch);
+    if (versions->num_live == 0 || page_num >= versions->snapshot_pages) {
+        latch_unlock_exclusive(&versions->latch);
+        return 0;
+    }
+    if (!versions->buckets) {
+        versions->buckets = calloc(PAGE_VERSIONS_BUCKETS, sizeof(PageVersion*));
+        if (!versions->buckets) {
+            latch_unlock_exclusive(&versions->latch);
+            fprintf(stderr, "Failed to allocate page version table\n");
+            return -1;
+        }
+    }
+    // Images are linked newest first. The current image is read by every
+    // snapshot newer than the newest saved one.
+    PageVersion** bucket = &versions->buckets[page_versions_bucket(page_num)];
+    uint64_t newest_saved = 0;
+    for (PageVersion* image = *bucket; image; image = image->next) {
+        if (image->page_num == page_num) {
+            newest_saved = image->superseded;
+            break;
+        }
+    }
+    if (versions->live[versions->num_live - 1].epoch < newest_saved) {
+        latch_unlock_exclusive(&versions->latch);
+        return 0;
+    }
+
+    PageVersion* image = malloc(sizeof(PageVersion) + PAGE_SIZE);
+    if (!image) {
+        latch_unlock_exclusive(&versions->latch);
+        fprintf(stderr, "Failed to save page %u for a snapshot\n", page_num);
+        return -1;
+    }
+    image->page_num = page_num;
+    image->superseded = versions->epoch + 1;
+    memcpy(image->data, data, PAGE_SIZE);
+    image->next = *bucket;
+    *bucket = image;
+    versions->num_images++;
+    versions->images_saved++;
+    latch_unlock_exclusive(&versions->latch);
+    return 0;
+}
+
+const void* page_versions_find(PageVersions* versions, uint32_t page_num, uint64_t epoch) {
+    latch_lock_shared(&versions->latch);
+    const void* found = NULL;
+    if (versions->buckets) {
+        // Newest first: the last match superseded after epoch is the oldest
+        for (PageVersion* image = versions->buckets[page_versions_bucket(page_num)]; image; image = image->next) {
+            if (image->page_num == page_num) {
+                if (image->superseded <= epoch) {
+                    break;
+                }
+                found = image->data;
+            }
+        }
+    }
+    latch_unlock_shared(&versions->latch);
+    return found;
+}
@@ -0,0 +1,97 @@
+#ifndef PAGE_VERSIONS_H
+#define PAGE_VERSIONS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "latch.h"
+
+/**
+ * Page versions: the images pages had before writers changed them, kept
+ * for the snapshots that still read them.
+ *
+ * Every write operation is numbered (its epoch). A snapshot taken after
+ * epoch E reads the tree as it was then. The first time a page changes
+ * while a snapshot may still read it, the writer saves its current image,
+ * stamped with the epoch of the write that supersedes it. A snapshot of E
+ * reads the oldest image of a page superseded after E, or the page itself
+ * if it has none. An image is freed once every live snapshot is at or past
+ * the epoch that superseded it: no snapshot can read it any more.
+ */
+
+// Hash buckets of the image table (a power of two)
+#define PAGE_VERSIONS_BUCKETS 1024
+
+typedef struct PageVersion {
+    uint32_t page_num;
+    uint64_t superseded; // Epoch of the write that replaced this image
+    struct PageVersion* next; // Older images and other pages of the bucket
+    uint8_t data[];      // PAGE_SIZE bytes
+} PageVersion;
+
+// A snapshot epoch and the number of snapshots taken at it
+typedef struct {
+    uint64_t epoch;
+    uint32_t refs;
+} PageVersionsLive;
+
+typedef struct {
+    // Write operations completed so far. Changed and read only by the one
+    // writer, and by snapshots taken while writers are held off.
+    uint64_t epoch;
+    _Atomic uint32_t live_count; // Live snapshots (for the writer's fast path)
+    PageVersionsLive* live;      // Distinct live epochs, oldest first
+    uint32_t num_live;
+    uint32_t live_capacity;
+    uint32_t snapshot_pages; // Pages that existed when the newest snapshot was taken
+    PageVersion** buckets;   // Allocated by the first saved image
+    uint32_t num_images;
+    uint64_t images_saved;   // Since init, for tests and stats
+    Latch latch;             // Shared to find images, exclusive to change anything
+} PageVersions;
+
+void page_versions_init(PageVersions* versions);
+
+/**
+ * Free every saved image and the snapshot list.
+ */
+void page_versions_destroy(PageVersions* versions);
+
+/**
+ * End a write operation: later snapshots see it.
+ * Called by the writer while no other writer can run.
+ */
+void page_versions_commit(PageVersions* versions);
+
+/**
+ * Register a snapshot of the tree as of the last committed write.
+ * Called while no write operation is in progress.
+ * @param num_pages Pages in the file now; pages allocated later are new to
+ *                  every live snapshot and never saved
+ * @return The snapshot epoch, or UINT64_MAX on allocation failure
+ */
+uint64_t page_versions_acquire(PageVersions* versions, uint32_t num_pages);
+
+/**
+ * Drop a snapshot registered by page_versions_acquire and free the images
+ * no live snapshot can read any more.
+ */
+void page_versions_release(PageVersions* versions, uint64_t epoch);
+
+/**
+ * Save the image of a page the writer is about to change, if a live
+ * snapshot may read it. Cheap when there are no snapshots, or when the
+ * page was already saved during this write.
+ * @param data The page's current PAGE_SIZE bytes
+ * @return 0 on success (saved or not needed), -1 on allocation failure
+ */
+int page_versions_preserve(PageVersions* versions, uint32_t page_num, const void* data);
+
+/**
+ * Find the image of a page a snapshot reads. The image stays valid while
+ * the snapshot is live.
+ * @return The image, or NULL if the snapshot reads the current page
+ */
+const void* page_versions_find(PageVersions* versions, uint32_t page_num, uint64_t epoch);
+
+#endif // PAGE_VERSIONS_H
@@ -1,5 +1,11 @@
+#ifndef _WIN32
+#define _GNU_SOURCE // O_DIRECT, ftruncate
+#endif
 #include "pager.h"
 #include "wal.h"
+#include "frame_arena.h"
+#include "crc32c.h"
+#include "utility.h" // For MAX_FILENAME_LEN
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -41,8 +47,79 @@
 #include <unistd.h>
 #endif
 
-Pager* pager_open(const char* filename) {
+// Open the database file, bypassing the OS page cache if requested.
+// Sets *direct to whether direct I/O is actually in effect.
+static int pager_open_file(const char* filename, bool* direct) {
+#if defined(O_DIRECT)
+    if (*direct) {
+        int fd = open(filename, O_RDWR | O_CREAT | O_DIRECT, S_IWUSR | S_IRUSR);
+        if (fd != -1) {
+            return fd;
+        }
+        // e.g. tmpfs does not support O_DIRECT
+        fprintf(stderr, "Warning: Direct I/O unavailable for '%s' (%d), using buffered I/O\n", filename, errno);
+        *direct = false;
+    }
+#endif
     int fd = open(filename, O_RDWR | O_CREAT, S_IWUSR | S_IRUSR);
+#if !defined(O_DIRECT) && defined(F_NOCACHE)
+    // macOS: no O_DIRECT, but caching can be disabled per descriptor
+    if (fd != -1 && *direct && fcntl(fd, F_NOCACHE, 1) == -1) {
+        fprintf(stderr, "Warning: F_NOCACHE failed for '%s' (%d), using buffered I/O\n", filename, errno);
+        *direct = false;
+    }
+#elif !defined(O_DIRECT)
+    if (*direct) {
+        fprintf(stderr, "Warning: Direct I/O not supported on this platform, using buffered I/O\n");
+        *direct = false;
+    }
+#endif
+    return fd;
+}
+
+void pager_budget_init(PagerBudget* budget, size_t max_bytes) {
+    size_t frames = max_bytes / PAGE_SIZE;
+    if (frames < PAGER_MIN_FRAMES) {
+        frames = PAGER_MIN_FRAMES;
+    }
+    budget->total_frames = frames > UINT32_MAX ? UINT32_MAX : (uint32_t)frames;
+    budget->used_frames = 0;
+    latch_init(&budget->latch);
+}
+
+// Take up to want frames from a budget.
+// @return Frames granted, or 0 if fewer than PAGER_MIN_FRAMES are left
+static uint32_t pager_budget_acquire(PagerBudget* budget, uint32_t want) {
+    latch_lock_exclusive(&budget->latch);
+    uint32_t left = budget->total_frames - budget->used_frames;
+    uint32_t granted = 0;
+    if (left >= PAGER_MIN_FRAMES) {
+        granted = want < left ? want : left;
+        budget->used_frames += granted;
+    }
+    latch_unlock_exclusive(&budget->latch);
+    return granted;
+}
+
+static void pager_budget_release(PagerBudget* budget, uint32_t frames) {
+    latch_lock_exclusive(&budget->latch);
+    budget->used_frames -= frames;
+    latch_unlock_exclusive(&budget->latch);
+}
+
+Pager* pager_open(const char* filename) {
+    return pager_open_with_options(filename, NULL);
+}
+
+Pager* pager_open_with_options(const char* filename, const PagerOptions* options) {
+    uint32_t flags = options ? options->flags : 0;
+    bool direct = (flags & PAGER_OPEN_DIRECT) != 0;
+    uint32_t cache_frames = (options && options->cache_frames) ? options->cache_frames : TABLE_MAX_PAGES;
+    if (cache_frames < PAGER_MIN_FRAMES) {
+        cache_frames = PAGER_MIN_FRAMES;
+    }
+
+    int fd = pager_open_file(filename, &direct);
     if (fd == -1) {
         fprintf(stderr, "Unable to open file '%s': %d\n", filename, errno);
         return NULL;
@@ -96,95 +173,966 @@ Pager* pager_open(const char* filename) {
         file_length = new_length;
     }
 
-    for (uint32_t i = 0; i < TABLE_MAX_PAGES; i++) {
-        pager->pages[i] = NULL;
+    PagerBudget* budget = options ? options->budget : NULL;
+    if (budget) {
+        cache_frames = pager_budget_acquire(budget, cache_frames);
+        if (cache_frames == 0) {
+            fprintf(stderr, "Unable to open '%s': page cache budget of %u frames exhausted\n",
+                    filename, budget->total_frames);
+            free(pager);
+            close(fd);
+            return NULL;
+        }
     }
+    pager->budget = budget;
+
+    pager->file_length = file_length;
     pager->wal = NULL;
+    pager->direct_io = direct;
+    // Starts a window ahead so last_access 0 (scoped loads) is never recent
+    pager->access_clock = PAGER_RECENT_WINDOW;
+    pager->checksum_mode = options ? options->checksum_mode : PAGER_CHECKSUM_ALWAYS;
+    pager->checksum_loads = 0;
+    memset(&pager->stats, 0, sizeof(pager->stats));
+    pager->policy = (options && options->policy) ? options->policy : &pager_policy_2q;
+    pager->num_frames = cache_frames;
+
+    // All page memory is reserved here, up front. One extra frame serves
+    // as the bounce buffer for direct writes.
+    pager->arena = frame_arena_create(cache_frames + 1, (flags & PAGER_OPEN_HUGE_PAGES) != 0);
+    pager->frames = calloc(cache_frames, sizeof(PageFrame));
+    pager->free_frames = malloc(cache_frames * sizeof(uint32_t));
+    pager->policy_state = pager->policy->create(cache_frames);
+    pager->stripes = calloc(PAGER_STRIPES, sizeof(PagerStripe));
+    uint32_t stripes_ready = 0;
+    if (pager->stripes) {
+        while (stripes_ready < PAGER_STRIPES &&
+               page_table_init(&pager->stripes[stripes_ready].table, cache_frames / PAGER_STRIPES + 1) == 0) {
+            latch_init(&pager->stripes[stripes_ready].latch);
+            atomic_init(&pager->stripes[stripes_ready].hits, 0);
+            atomic_init(&pager->stripes[stripes_ready].version, 0);
+            pager->stripes[stripes_ready].retired = NULL;
+            stripes_ready++;
+        }
+    }
+    bool txn_ready = page_table_init(&pager->txn_pages, 64) == 0;
+    if (!pager->arena || !pager->frames || !pager->free_frames || !pager->policy_state ||
+        stripes_ready < PAGER_STRIPES || !txn_ready) {
+        fprintf(stderr, "Failed to allocate page cache\n");
+        if (txn_ready) page_table_free(&pager->txn_pages);
+        if (budget) pager_budget_release(budget, cache_frames);
+        if (pager->policy_state) pager->policy->destroy(pager->policy_state);
+        for (uint32_t i = 0; i < stripes_ready; i++) {
+            page_table_free(&pager->stripes[i].table);
+        }
+        free(pager->stripes);
+        frame_arena_destroy(pager->arena);
+        free(pager->frames);
+        free(pager->free_frames);
+        free(pager);
+        close(fd);
+        return NULL;
+    }
+    latch_init(&pager->lock);
+    page_versions_init(&pager->versions);
+    pager->in_txn = false;
+    pager->txn_num_pages = 0;
+    pager->scratch = frame_arena_alloc(pager->arena);
+    for (uint32_t i = 0; i < cache_frames; i++) {
+        pager->frames[i].data = frame_arena_alloc(pager->arena);
+        atomic_init(&pager->frames[i].pin_count, 0);
+        atomic_init(&pager->frames[i].stable_pins, 0);
+        atomic_init(&pager->frames[i].detached, false);
+        latch_init(&pager->frames[i].latch);
+        atomic_init(&pager->frames[i].version, 0);
+        // Pop order hands out frame 0 first
+        pager->free_frames[i] = cache_frames - 1 - i;
+    }
+    pager->num_free_frames = cache_frames;
 
     return pager;
 }
 
+void pager_set_checksum(void* page) {
+    uint32_t checksum = crc32c(0, page, PAGE_CHECKSUM_OFFSET);
+    memcpy((uint8_t*)page + PAGE_CHECKSUM_OFFSET, &checksum, PAGE_CHECKSUM_SIZE);
+}
+
+bool pager_verify_checksum(const void* page) {
+    uint32_t stored;
+    memcpy(&stored, (const uint8_t*)page + PAGE_CHECKSUM_OFFSET, PAGE_CHECKSUM_SIZE);
+    return stored == crc32c(0, page, PAGE_CHECKSUM_OFFSET);
+}
+
+// Verify a page just read from the DB file, as selected by the checksum mode.
+static int pager_check_loaded_page(Pager* pager, uint32_t page_num, const void* page) {
+    switch (pager->checksum_mode) {
+        case PAGER_CHECKSUM_OFF:
+            return 0;
+        case PAGER_CHECKSUM_SAMPLED:
+            if (pager->checksum_loads++ % PAGER_CHECKSUM_SAMPLE_INTERVAL != 0) {
+                return 0;
+            }
+            break;
+        case PAGER_CHECKSUM_ALWAYS:
+            break;
+    }
+    if (!pager_verify_checksum(page)) {
+        fprintf(stderr, "Error: Checksum mismatch on page %d, the database file is corrupt\n", page_num);
+        pager->stats.checksum_failures++;
+        return -1;
+    }
+    return 0;
+}
+
+// Stripe of the page table holding page_num: adjacent pages land in
+// different stripes
+static PagerStripe* pager_stripe(Pager* pager, uint32_t page_num) {
+    return &pager->stripes[page_num & (PAGER_STRIPES - 1)];
+}
+
+typedef struct PagerRetiredTable {
+    struct PagerRetiredTable* next;
+    PageTable table;
+} PagerRetiredTable;
+
+// Take the stripe latch to change the table; the version goes odd so
+// latch-free lookups know to retry
+static void pager_stripe_write_begin(PagerStripe* stripe) {
+    latch_lock_exclusive(&stripe->latch);
+    atomic_store_explicit(&stripe->version, atomic_load_explicit(&stripe->version, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static void pager_stripe_write_end(PagerStripe* stripe) {
+    atomic_store_explicit(&stripe->version, atomic_load_explicit(&stripe->version, memory_order_relaxed) + 1,
+                          memory_order_release);
+    latch_unlock_exclusive(&stripe->latch);
+}
+
+// Frame versions, see PageFrame.version. Invalidate before changing the
+// image (or giving up the frame), publish once the image is stable.
+static void pager_frame_invalidate(PageFrame* frame) {
+    uint64_t version = atomic_load_explicit(&frame->version, memory_order_relaxed);
+    if ((version & 1) == 0) {
+        atomic_store_explicit(&frame->version, version + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+    }
+}
+
+static void pager_frame_publish(PageFrame* frame) {
+    uint64_t version = atomic_load_explicit(&frame->version, memory_order_relaxed);
+    if (version & 1) {
+        atomic_store_explicit(&frame->version, version + 1, memory_order_release);
+    }
+}
+
+// Find the frame of a resident page, pinning it if pin is set. The pin is
+// taken under the stripe latch, so eviction (which unmaps under the
+// exclusive stripe latch) cannot take the frame between lookup and pin.
+static bool pager_lookup(Pager* pager, uint32_t page_num, bool pin, uint32_t* frame_index) {
+    PagerStripe* stripe = pager_stripe(pager, page_num);
+    latch_lock_shared(&stripe->latch);
+    bool found = page_table_get(&stripe->table, page_num, frame_index);
+    if (found && pin) {
+        atomic_fetch_add_explicit(&pager->frames[*frame_index].pin_count, 1, memory_order_relaxed);
+    }
+    latch_unlock_shared(&stripe->latch);
+    return found;
+}
+
+static int pager_map(Pager* pager, uint32_t page_num, uint32_t frame_index) {
+    PagerStripe* stripe = pager_stripe(pager, page_num);
+    int result = 0;
+    pager_stripe_write_begin(stripe);
+    if ((stripe->table.count + 1) * 2 > stripe->table.capacity) {
+        // Grow here rather than in page_table_put, which would free the
+        // arrays under latch-free lookups
+        PagerRetiredTable* retired = malloc(sizeof(PagerRetiredTable));
+        PageTable bigger;
+        if (!retired || page_table_init(&bigger, stripe->table.capacity) != 0) {
+            free(retired);
+            pager_stripe_write_end(stripe);
+            return -1;
+        }
+        for (uint32_t i = 0; i < stripe->table.capacity; i++) {
+            if (stripe->table.used[i]) {
+                page_table_put(&bigger, stripe->table.keys[i], stripe->table.values[i]);
+            }
+        }
+        retired->table = stripe->table;
+        retired->next = stripe->retired;
+        stripe->retired = retired;
+        stripe->table = bigger;
+    }
+    result = page_table_put(&stripe->table, page_num, frame_index);
+    pager_stripe_write_end(stripe);
+    return result;
+}
+
+static void pager_unmap(Pager* pager, uint32_t page_num) {
+    PagerStripe* stripe = pager_stripe(pager, page_num);
+    pager_stripe_write_begin(stripe);
+    page_table_remove(&stripe->table, page_num);
+    pager_stripe_write_end(stripe);
+}
+
+static bool pager_frame_evictable(void* ctx, uint32_t frame_index) {
+    Pager* pager = ctx;
+    PageFrame* frame = &pager->frames[frame_index];
+    // Protect pinned pages and pages handed out by the most recent requests
+    return atomic_load_explicit(&frame->pin_count, memory_order_relaxed) == 0 &&
+           pager->access_clock - frame->last_access >= PAGER_RECENT_WINDOW;
+}
+
+// Write a cached page to the WAL, or to the DB file when there is no WAL.
+static int pager_write_frame(Pager* pager, PageFrame* frame) {
+    pager_set_checksum(frame->data);
+    if (pager->wal) {
+        // Write to WAL
+        if (wal_log_page(pager->wal, frame->page_num, frame->data) != 0) {
+            return -1;
+        }
+    } else {
+        // Write directly to DB file
+        off_t offset = lseek(pager->file_descriptor, (off_t)frame->page_num * PAGE_SIZE, SEEK_SET);
+        if (offset == -1) {
+            fprintf(stderr, "Error seeking to page %d: %d\n", frame->page_num, errno);
+            return -1;
+        }
+
+        ssize_t bytes_written = write(pager->file_descriptor, frame->data, PAGE_SIZE);
+        if (bytes_written != PAGE_SIZE) {
+            fprintf(stderr, "Error writing page %d: %d\n", frame->page_num, errno);
+            return -1;
+        }
+        if ((off_t)pager->file_length < offset + PAGE_SIZE) {
+            pager->file_length = offset + PAGE_SIZE;
+        }
+    }
+    frame->dirty = false;
+    return 0;
+}
+
+// Find a free frame, evicting a resident page if necessary.
+// Called with pager->lock held.
+static int pager_claim_frame(Pager* pager, uint32_t* frame_index) {
+    if (pager->num_free_frames > 0) {
+        *frame_index = pager->free_frames[--pager->num_free_frames];
+        pager_frame_invalidate(&pager->frames[*frame_index]);
+        return 0;
+    }
+
+    int64_t victim;
+    PageFrame* frame;
+    for (;;) {
+        victim = pager->policy->choose_victim(pager->policy_state, pager_frame_evictable, pager);
+        if (victim < 0) {
+            fprintf(stderr, "Error: All %u cache frames are in use\n", pager->num_frames);
+            return -1;
+        }
+        // Unmap first, so no new pins can be taken, then make sure no
+        // lookup pinned the frame since the policy chose it
+        frame = &pager->frames[victim];
+        PagerStripe* stripe = pager_stripe(pager, frame->page_num);
+        pager_stripe_write_begin(stripe);
+        // Acquire: the last unpinner's reads of the frame happen before reuse
+        bool pinned = atomic_load_explicit(&frame->pin_count, memory_order_acquire) != 0;
+        if (!pinned) {
+            page_table_remove(&stripe->table, frame->page_num);
+        }
+        pager_stripe_write_end(stripe);
+        if (!pinned) {
+            break;
+        }
+    }
+    // Optimistic readers that found the frame before the unmap must retry
+    pager_frame_invalidate(frame);
+
+    if (frame->dirty) {
+        if (pager_write_frame(pager, frame) != 0) {
+            fprintf(stderr, "Failed to write back page %d before eviction\n", frame->page_num);
+            pager_map(pager, frame->page_num, (uint32_t)victim); // Keep it cached
+            pager_frame_publish(frame);
+            return -1;
+        }
+        pager->stats.writebacks++;
+    }
+    pager->policy->on_evict(pager->policy_state, (uint32_t)victim, frame->page_num);
+    frame->in_use = false;
+    pager->stats.evictions++;
+
+    *frame_index = (uint32_t)victim;
+    return 0;
+}
+
+// Read the current image of a page into buffer.
+// The WAL holds newer images than the DB file until it is checkpointed.
+// Sets *is_new if the page exists in neither.
+static int pager_load_page(Pager* pager, uint32_t page_num, void* buffer, bool* is_new) {
+    *is_new = false;
+    if (pager->wal) {
+        int found = wal_read_page(pager->wal, page_num, buffer);
+        if (found < 0) {
+            return -1;
+        }
+        if (found > 0) {
+            return 0;
+        }
+    }
+
+    off_t offset = lseek(pager->file_descriptor, (off_t)page_num * PAGE_SIZE, SEEK_SET);
+    if (offset == -1) {
+        fprintf(stderr, "Error seeking to page %d: %d\n", page_num, errno);
+        return -1;
+    }
+    ssize_t bytes_read = read(pager->file_descriptor, buffer, PAGE_SIZE);
+    if (bytes_read == -1) {
+        fprintf(stderr, "Error reading file: %d\n", errno);
+        return -1;
+    }
+    if (bytes_read < PAGE_SIZE) {
+        // Past the end of the file: a freshly allocated page
+        memset((uint8_t*)buffer + bytes_read, 0, PAGE_SIZE - bytes_read);
+        *is_new = (bytes_read == 0);
+        return 0;
+    }
+    return pager_check_loaded_page(pager, page_num, buffer);
+}
+
+// Make page_num resident and count the request. With pin set the frame
+// is returned pinned.
+// @return 0 and sets *frame_index, or -1 on error
+static int pager_fetch(Pager* pager, uint32_t page_num, PagerHint hint, bool pin, uint32_t* frame_index) {
+    bool use_once = (hint == PAGER_HINT_USE_ONCE);
+
+    if (pager_lookup(pager, page_num, pin, frame_index)) {
+        PageFrame* frame = &pager->frames[*frame_index];
+        atomic_fetch_add_explicit(&pager_stripe(pager, page_num)->hits, 1, memory_order_relaxed);
+        if (!pin) {
+            // Unscoped, so single-threaded: protect by recency instead
+            frame->last_access = ++pager->access_clock;
+        }
+        // Recency is a hint: skip the update rather than wait behind a miss
+        if (latch_try_lock_exclusive(&pager->lock)) {
+            pager->policy->on_hit(pager->policy_state, *frame_index, use_once);
+            latch_unlock_exclusive(&pager->lock);
+        }
+        return 0;
+    }
+
+    // Cache miss. Take a frame and load the page into it.
+    latch_lock_exclusive(&pager->lock);
+    if (pager_lookup(pager, page_num, pin, frame_index)) {
+        // Loaded by another thread while this one waited
+        latch_unlock_exclusive(&pager->lock);
+        atomic_fetch_add_explicit(&pager_stripe(pager, page_num)->hits, 1, memory_order_relaxed);
+        return 0;
+    }
+    pager->stats.misses++;
+    if (pager_claim_frame(pager, frame_index) != 0) {
+        latch_unlock_exclusive(&pager->lock);
+        return -1;
+    }
+    PageFrame* frame = &pager->frames[*frame_index];
+    bool is_new;
+    if (pager_load_page(pager, page_num, frame->data, &is_new) != 0) {
+        pager->free_frames[pager->num_free_frames++] = *frame_index;
+        latch_unlock_exclusive(&pager->lock);
+        return -1;
+    }
+    frame->page_num = page_num;
+    frame->in_use = true;
+    frame->dirty = is_new; // New pages must reach disk even if never flushed
+    // Misses always tick the clock, so prefetched pages age out
+    pager->access_clock++;
+    frame->last_access = pin ? 0 : pager->access_clock;
+    atomic_store_explicit(&frame->pin_count, pin ? 1 : 0, memory_order_relaxed);
+    if (pager_map(pager, page_num, *frame_index) != 0) {
+        pager->free_frames[pager->num_free_frames++] = *frame_index;
+        latch_unlock_exclusive(&pager->lock);
+        return -1;
+    }
+    pager->policy->on_insert(pager->policy_state, *frame_index, page_num, use_once);
+    pager_frame_publish(frame);
+
+    if (page_num >= pager->num_pages) {
+        pager->num_pages = page_num + 1;
+    }
+    latch_unlock_exclusive(&pager->lock);
+    return 0;
+}
+
+// The calling thread's pin scope
+typedef struct {
+    Pager* pager; // NULL outside a scope
+    uint32_t depth;
+    uint32_t count;
+    uint32_t frames[PAGER_SCOPE_MAX_PINS];
+} PagerScope;
+
+static _Thread_local PagerScope pager_scope;
+
+// Drop one pin of a frame. The last pin of a detached frame frees it.
+static void pager_release_pin(Pager* pager, uint32_t frame_index) {
+    PageFrame* frame = &pager->frames[frame_index];
+    if (atomic_fetch_sub_explicit(&frame->pin_count, 1, memory_order_acq_rel) == 1 &&
+        atomic_exchange(&frame->detached, false)) {
+        latch_lock_exclusive(&pager->lock);
+        pager->free_frames[pager->num_free_frames++] = frame_index;
+        latch_unlock_exclusive(&pager->lock);
+    }
+}
+
+// Fetch a page, pinning it for the rest of the scope if there is one
+static int pager_scoped_fetch(Pager* pager, uint32_t page_num, PagerHint hint, uint32_t* frame_index) {
+    PagerScope* scope = &pager_scope;
+    if (scope->pager != pager) {
+        return pager_fetch(pager, page_num, hint, false, frame_index);
+    }
+    if (pager_fetch(pager, page_num, hint, true, frame_index) != 0) {
+        return -1;
+    }
+    for (uint32_t i = scope->count; i-- > 0;) {
+        if (scope->frames[i] == *frame_index) {
+            // Pinned earlier in this scope: one pin is enough
+            atomic_fetch_sub_explicit(&pager->frames[*frame_index].pin_count, 1, memory_order_relaxed);
+            return 0;
+        }
+    }
+    if (scope->count == PAGER_SCOPE_MAX_PINS) {
+        // Out of room: the page is only protected by recency
+        pager_release_pin(pager, *frame_index);
+        return 0;
+    }
+    scope->frames[scope->count++] = *frame_index;
+    return 0;
+}
+
+int pager_scope_begin(Pager* pager) {
+    PagerScope* scope = &pager_scope;
+    if (scope->pager == pager) {
+        scope->depth++;
+        return 0;
+    }
+    if (scope->pager) {
+        fprintf(stderr, "Error: Thread is already in a pin scope of another pager\n");
+        return -1;
+    }
+    scope->pager = pager;
+    scope->depth = 1;
+    scope->count = 0;
+    return 0;
+}
+
+void pager_scope_end(Pager* pager) {
+    PagerScope* scope = &pager_scope;
+    if (scope->pager != pager || --scope->depth > 0) {
+        return;
+    }
+    for (uint32_t i = 0; i < scope->count; i++) {
+        pager_release_pin(pager, scope->frames[i]);
+    }
+    scope->count = 0;
+    scope->pager = NULL;
+}
+
+void pager_scope_unpin(Pager* pager, uint32_t frame_index) {
+    PagerScope* scope = &pager_scope;
+    if (scope->pager != pager) {
+        return;
+    }
+    for (uint32_t i = scope->count; i-- > 0;) {
+        if (scope->frames[i] == frame_index) {
+            scope->frames[i] = scope->frames[--scope->count];
+            pager_release_pin(pager, frame_index);
+            return;
+        }
+    }
+}
+
+uint32_t pager_allocate_pages(Pager* pager, uint32_t count) {
+    latch_lock_exclusive(&pager->lock);
+    uint32_t first = pager->num_pages;
+    pager->num_pages += count;
+    latch_unlock_exclusive(&pager->lock);
+    return first;
+}
+
 void* pager_get_page(Pager* pager, uint32_t page_num) {
-    if (page_num >= TABLE_MAX_PAGES) {
-        fprintf(stderr, "Tried to fetch page number out of bounds. %d >= %d\n", page_num, TABLE_MAX_PAGES);
-        return NULL; // Or handle error appropriately
+    return pager_get_page_hint(pager, page_num, PAGER_HINT_NORMAL);
+}
+
+void* pager_get_page_hint(Pager* pager, uint32_t page_num, PagerHint hint) {
+    uint32_t frame_index;
+    if (pager_scoped_fetch(pager, page_num, hint, &frame_index) != 0) {
+        return NULL;
     }
+    return pager->frames[frame_index].data;
+}
+
+// Move a page whose frame has stable pins to a copy in another frame, so
+// the pinned readers keep the current image. The copy is pinned like the
+// original would have been and, with latch_copy, latched exclusively
+// before anyone can find it.
+// @return 0 and sets *frame_index to the copy, or -1 on error
+static int pager_move_pinned(Pager* pager, uint32_t page_num, uint32_t* frame_index, bool latch_copy) {
+    uint32_t old_index = *frame_index;
+    PageFrame* frame = &pager->frames[old_index];
 
-    if (pager->pages[page_num] == NULL) {
-        // Cache miss. Allocate memory and load from file.
-        void* page = calloc(1, PAGE_SIZE);
-        if (!page) {
-            fprintf(stderr, "Failed to allocate memory for page\n");
+    latch_lock_exclusive(&pager->lock);
+    // The pinned frame is never the victim
+    uint32_t copy_index;
+    if (pager_claim_frame(pager, &copy_index) != 0) {
+        latch_unlock_exclusive(&pager->lock);
+        return -1;
+    }
+    PageFrame* copy = &pager->frames[copy_index];
+    memcpy(copy->data, frame->data, PAGE_SIZE);
+    copy->page_num = page_num;
+    copy->in_use = true;
+    copy->dirty = frame->dirty;
+    bool scoped = pager_scope.pager == pager && pager_scope.count < PAGER_SCOPE_MAX_PINS;
+    copy->last_access = scoped ? 0 : ++pager->access_clock;
+    atomic_store_explicit(&copy->pin_count, scoped ? 1 : 0, memory_order_relaxed);
+    if (scoped) {
+        pager_scope.frames[pager_scope.count++] = copy_index;
+    }
+    if (latch_copy) {
+        latch_lock_exclusive(&copy->latch); // Its version stays odd until unlatched
+    } else {
+        pager_frame_publish(copy);
+    }
+    pager_map(pager, page_num, copy_index); // Overwrites: cannot fail
+    pager_frame_invalidate(frame); // Stays odd: readers must go to the copy
+    pager->policy->on_evict(pager->policy_state, old_index, page_num);
+    pager->policy->on_insert(pager->policy_state, copy_index, page_num, false);
+    frame->in_use = false;
+    frame->dirty = false;
+    pager->stats.pinned_copies++;
+    latch_unlock_exclusive(&pager->lock);
+
+    // Free the old frame now if its pins went away meanwhile, otherwise
+    // the last unpin does it
+    atomic_store(&frame->detached, true);
+    if (atomic_load(&frame->pin_count) == 0 && atomic_exchange(&frame->detached, false)) {
+        latch_lock_exclusive(&pager->lock);
+        pager->free_frames[pager->num_free_frames++] = old_index;
+        latch_unlock_exclusive(&pager->lock);
+    }
+    *frame_index = copy_index;
+    return 0;
+}
+
+// Note a page the open transaction is about to change, for pager_txn_abort
+static int pager_txn_track(Pager* pager, uint32_t page_num) {
+    return pager->in_txn ? page_table_put(&pager->txn_pages, page_num, 0) : 0;
+}
+
+void* pager_get_page_for_write(Pager* pager, uint32_t page_num) {
+    uint32_t frame_index;
+    if (pager_scoped_fetch(pager, page_num, PAGER_HINT_NORMAL, &frame_index) != 0) {
+        return NULL;
+    }
+    if (atomic_load(&pager->frames[frame_index].stable_pins) > 0 &&
+        pager_move_pinned(pager, page_num, &frame_index, false) != 0) {
+        return NULL;
+    }
+    void* data = pager->frames[frame_index].data;
+    if (pager_txn_track(pager, page_num) != 0 || page_versions_preserve(&pager->versions, page_num, data) != 0) {
+        return NULL;
+    }
+    return data;
+}
+
+void* pager_latch_page(Pager* pager, uint32_t page_num, PagerLatchMode mode, uint32_t* frame_index) {
+    return pager_latch_page_hint(pager, page_num, PAGER_HINT_NORMAL, mode, frame_index);
+}
+
+void* pager_latch_page_hint(Pager* pager, uint32_t page_num, PagerHint hint, PagerLatchMode mode,
+                            uint32_t* frame_index) {
+    if (pager_scoped_fetch(pager, page_num, hint, frame_index) != 0) {
+        return NULL;
+    }
+    PageFrame* frame = &pager->frames[*frame_index];
+    if (mode == PAGER_LATCH_SHARED) {
+        latch_lock_shared(&frame->latch);
+        return frame->data;
+    }
+    latch_lock_exclusive(&frame->latch);
+    pager_frame_invalidate(frame);
+    // Stable pins are taken under a shared latch: none can appear now
+    if (atomic_load(&frame->stable_pins) > 0) {
+        int moved = pager_move_pinned(pager, page_num, frame_index, true);
+        latch_unlock_exclusive(&frame->latch);
+        if (moved != 0) {
             return NULL;
         }
-        uint32_t num_pages = pager->file_length / PAGE_SIZE;
+    }
+    void* data = pager->frames[*frame_index].data;
+    if (pager_txn_track(pager, page_num) != 0 || page_versions_preserve(&pager->versions, page_num, data) != 0) {
+        pager_unlatch_frame(pager, *frame_index, PAGER_LATCH_EXCLUSIVE);
+        return NULL;
+    }
+    return data;
+}
 
-        // We might save a partial page at the end of the file
-        if (pager->file_length % PAGE_SIZE) {
-            num_pages += 1;
-        }
+void pager_unlatch_frame(Pager* pager, uint32_t frame_index, PagerLatchMode mode) {
+    PageFrame* frame = &pager->frames[frame_index];
+    if (mode == PAGER_LATCH_SHARED) {
+        latch_unlock_shared(&frame->latch);
+    } else {
+        pager_frame_publish(frame);
+        latch_unlock_exclusive(&frame->latch);
+    }
+}
+
+// Optimistic hits of the calling thread not yet added to the counters
+typedef struct {
+    Pager* pager;
+    uint32_t hits;
+} PagerHitBatch;
 
-        if (page_num <= num_pages) {
-            lseek(pager->file_descriptor, page_num * PAGE_SIZE, SEEK_SET);
-            ssize_t bytes_read = read(pager->file_descriptor, page, PAGE_SIZE);
-            if (bytes_read == -1) {
-                fprintf(stderr, "Error reading file: %d\n", errno);
-                free(page);
-                return NULL;
+static _Thread_local PagerHitBatch pager_hit_batch;
+
+// Find the frame of a resident page without the stripe latch
+// @return 0 and sets *frame_index, 1 to retry, -1 if not resident
+static int pager_lookup_optimistic(Pager* pager, uint32_t page_num, uint32_t* frame_index) {
+    PagerStripe* stripe = pager_stripe(pager, page_num);
+    uint32_t version = atomic_load_explicit(&stripe->version, memory_order_acquire);
+    if (version & 1) {
+        return 1;
+    }
+    PageTable table = stripe->table;
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&stripe->version, memory_order_relaxed) != version) {
+        return 1;
+    }
+    // Outgrown arrays are kept until close, so this reads live memory
+    bool found = page_table_get(&table, page_num, frame_index);
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&stripe->version, memory_order_relaxed) != version) {
+        return 1;
+    }
+    return found ? 0 : -1;
+}
+
+int pager_optimistic_begin(Pager* pager, uint32_t page_num, const void** data, uint32_t* frame_index,
+                           uint64_t* version) {
+    int status = pager_lookup_optimistic(pager, page_num, frame_index);
+    if (status != 0) {
+        return status;
+    }
+    PageFrame* frame = &pager->frames[*frame_index];
+    *version = atomic_load_explicit(&frame->version, memory_order_acquire);
+    // The frame may hold another page by now: then its version changed too
+    if ((*version & 1) || frame->page_num != page_num) {
+        return 1;
+    }
+    *data = frame->data;
+
+    PagerHitBatch* batch = &pager_hit_batch;
+    if (batch->pager != pager) {
+        batch->pager = pager; // Hits pending for another pager are dropped
+        batch->hits = 0;
+    }
+    if (++batch->hits == PAGER_OPTIMISTIC_HIT_BATCH) {
+        batch->hits = 0;
+        atomic_fetch_add_explicit(&pager_stripe(pager, page_num)->hits, PAGER_OPTIMISTIC_HIT_BATCH,
+                                  memory_order_relaxed);
+        // Sampling keeps hot pages hot in the policy
+        if (latch_try_lock_exclusive(&pager->lock)) {
+            if (atomic_load_explicit(&frame->version, memory_order_relaxed) == *version) {
+                pager->policy->on_hit(pager->policy_state, *frame_index, false);
             }
+            latch_unlock_exclusive(&pager->lock);
         }
+    }
+    return 0;
+}
 
-        pager->pages[page_num] = page;
-        
-        if (page_num >= pager->num_pages) {
-             pager->num_pages = page_num + 1;
+bool pager_optimistic_validate(Pager* pager, uint32_t frame_index, uint64_t version) {
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&pager->frames[frame_index].version, memory_order_relaxed) == version;
+}
+
+int pager_read_version(Pager* pager, uint32_t page_num, uint64_t epoch, PagerHint hint, void* out) {
+    // Once saved, the image a snapshot reads never changes: no latch needed
+    const void* image = page_versions_find(&pager->versions, page_num, epoch);
+    if (image) {
+        memcpy(out, image, PAGE_SIZE);
+        return 0;
+    }
+    if (pager_scope_begin(pager) != 0) {
+        return -1;
+    }
+    uint32_t frame_index;
+    void* page = pager_latch_page_hint(pager, page_num, hint, PAGER_LATCH_SHARED, &frame_index);
+    if (!page) {
+        pager_scope_end(pager);
+        return -1;
+    }
+    // The writer saves images under the exclusive latch: look again
+    image = page_versions_find(&pager->versions, page_num, epoch);
+    memcpy(out, image ? image : page, PAGE_SIZE);
+    pager_unlatch_frame(pager, frame_index, PAGER_LATCH_SHARED);
+    pager_scope_unpin(pager, frame_index);
+    pager_scope_end(pager);
+    return 0;
+}
+
+void* pager_pin_page(Pager* pager, uint32_t page_num, uint32_t* frame_index) {
+    if (pager_fetch(pager, page_num, PAGER_HINT_NORMAL, true, frame_index) != 0) {
+        return NULL;
+    }
+    PageFrame* frame = &pager->frames[*frame_index];
+    atomic_fetch_add(&frame->stable_pins, 1);
+    return frame->data;
+}
+
+void pager_unpin_frame(Pager* pager, uint32_t frame_index) {
+    PageFrame* frame = &pager->frames[frame_index];
+    if (atomic_load(&frame->stable_pins) == 0) {
+        fprintf(stderr, "Warning: Unpin of unpinned frame %u\n", frame_index);
+        return;
+    }
+    atomic_fetch_sub(&frame->stable_pins, 1);
+    pager_release_pin(pager, frame_index);
+}
+
+// Ask the OS to start reading DB file pages [first, first + count)
+static void pager_advise_willneed(Pager* pager, uint32_t first, uint32_t count) {
+#if defined(POSIX_FADV_WILLNEED)
+    if (!pager->direct_io) {
+        posix_fadvise(pager->file_descriptor, (off_t)first * PAGE_SIZE, (off_t)count * PAGE_SIZE,
+                      POSIX_FADV_WILLNEED);
+    }
+#else
+    (void)pager;
+    (void)first;
+    (void)count;
+#endif
+}
+
+uint32_t pager_prefetch(Pager* pager, const uint32_t* page_nums, uint32_t count) {
+    uint32_t file_pages = pager->file_length / PAGE_SIZE;
+    uint32_t missing = 0;
+    uint32_t run_first = 0;
+    uint32_t run_count = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t page_num = page_nums[i];
+        uint32_t frame_index;
+        if (pager_lookup(pager, page_num, false, &frame_index)) {
+#if defined(__GNUC__)
+            // Header and key heads: what a search reads first
+            __builtin_prefetch(pager->frames[frame_index].data);
+            __builtin_prefetch((uint8_t*)pager->frames[frame_index].data + 64);
+#endif
+            continue;
         }
+        missing++;
+        if (page_num >= file_pages) {
+            continue;
+        }
+        if (run_count > 0 && page_num == run_first + run_count) {
+            run_count++;
+            continue;
+        }
+        if (run_count > 0) {
+            pager_advise_willneed(pager, run_first, run_count);
+        }
+        run_first = page_num;
+        run_count = 1;
     }
+    if (run_count > 0) {
+        pager_advise_willneed(pager, run_first, run_count);
+    }
+    return missing;
+}
+
+void pager_mark_dirty(Pager* pager, uint32_t page_num) {
+    uint32_t frame_index;
+    if (pager_lookup(pager, page_num, false, &frame_index)) {
+        pager->frames[frame_index].dirty = true;
+    }
+}
+
+void pager_get_stats(Pager* pager, PagerStats* stats) {
+    latch_lock_exclusive(&pager->lock);
+    *stats = pager->stats;
+    latch_unlock_exclusive(&pager->lock);
+    for (uint32_t i = 0; i < PAGER_STRIPES; i++) {
+        stats->hits += atomic_load_explicit(&pager->stripes[i].hits, memory_order_relaxed);
+    }
+}
 
-    return pager->pages[page_num];
+void pager_reset_stats(Pager* pager) {
+    latch_lock_exclusive(&pager->lock);
+    memset(&pager->stats, 0, sizeof(pager->stats));
+    latch_unlock_exclusive(&pager->lock);
+    for (uint32_t i = 0; i < PAGER_STRIPES; i++) {
+        atomic_store_explicit(&pager->stripes[i].hits, 0, memory_order_relaxed);
+    }
 }
+
 void pager_set_wal(Pager* pager, WAL* wal) {
     pager->wal = wal;
 }
 
-int pager_flush(Pager* pager, uint32_t page_num) {
-    if (pager->pages[page_num] == NULL) {
-        fprintf(stderr, "Tried to flush null page %d\n", page_num);
-        return -1;
+// Under the pager lock, like every other use of the WAL: readers write
+// back evicted pages too
+int pager_txn_begin(Pager* pager) {
+    if (!pager->wal) {
+        return 0;
     }
+    latch_lock_exclusive(&pager->lock);
+    int result = wal_begin(pager->wal);
+    if (result == 0) {
+        pager->in_txn = true;
+        pager->txn_num_pages = pager->num_pages;
+    }
+    latch_unlock_exclusive(&pager->lock);
+    return result;
+}
 
-    if (pager->wal) {
-        // Write to WAL
-        return wal_log_page(pager->wal, page_num, pager->pages[page_num]);
-    } else {
-        // Write directly to DB file
-        off_t offset = lseek(pager->file_descriptor, page_num * PAGE_SIZE, SEEK_SET);
-        if (offset == -1) {
-            fprintf(stderr, "Error seeking to page %d: %d\n", page_num, errno);
+int pager_txn_commit(Pager* pager) {
+    if (!pager->wal) {
+        return 0;
+    }
+    latch_lock_exclusive(&pager->lock);
+    int result = wal_commit(pager->wal);
+    pager->in_txn = false;
+    page_table_clear(&pager->txn_pages);
+    latch_unlock_exclusive(&pager->lock);
+    return result;
+}
+
+// Read a cached page of an aborted transaction back as it was before it.
+// The frame is latched like a write, so readers see the old image or the
+// restored one and never a mix.
+static int pager_txn_restore(Pager* pager, uint32_t page_num) {
+    uint32_t pinned;
+    if (!pager_lookup(pager, page_num, true, &pinned)) {
+        return 0; // Loaded from the WAL or the file when next needed
+    }
+    uint32_t frame_index = pinned;
+    PageFrame* frame = &pager->frames[frame_index];
+    latch_lock_exclusive(&frame->latch);
+    pager_frame_invalidate(frame);
+    if (atomic_load(&frame->stable_pins) > 0) {
+        int moved = pager_move_pinned(pager, page_num, &frame_index, true);
+        latch_unlock_exclusive(&frame->latch);
+        if (moved != 0) {
+            pager_release_pin(pager, pinned);
             return -1;
         }
+        frame = &pager->frames[frame_index];
+    }
+    bool is_new;
+    latch_lock_exclusive(&pager->lock);
+    int result = pager_load_page(pager, page_num, frame->data, &is_new);
+    // A page the transaction allocated is free again
+    frame->dirty = is_new && page_num < pager->txn_num_pages;
+    latch_unlock_exclusive(&pager->lock);
+    pager_unlatch_frame(pager, frame_index, PAGER_LATCH_EXCLUSIVE);
+    pager_release_pin(pager, pinned);
+    return result;
+}
 
-        ssize_t bytes_written = write(pager->file_descriptor, pager->pages[page_num], PAGE_SIZE);
-        if (bytes_written == -1) {
-            fprintf(stderr, "Error writing page %d: %d\n", page_num, errno);
-            return -1;
+int pager_txn_abort(Pager* pager) {
+    if (!pager->wal || !pager->in_txn) {
+        return -1;
+    }
+    latch_lock_exclusive(&pager->lock);
+    // Changed images must not be written back while the log is rewound
+    for (uint32_t i = 0; i < pager->txn_pages.capacity; i++) {
+        uint32_t frame_index;
+        if (pager->txn_pages.used[i] && pager_lookup(pager, pager->txn_pages.keys[i], false, &frame_index)) {
+            pager->frames[frame_index].dirty = false;
+        }
+    }
+    int result = wal_abort(pager->wal, &pager->txn_pages);
+    if (result == 0) {
+        pager->in_txn = false;
+        pager->num_pages = pager->txn_num_pages;
+    }
+    latch_unlock_exclusive(&pager->lock);
+    if (result != 0) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < pager->txn_pages.capacity; i++) {
+        if (pager->txn_pages.used[i] && pager_txn_restore(pager, pager->txn_pages.keys[i]) != 0) {
+            fprintf(stderr, "Error: Failed to restore page %u after an aborted write\n", pager->txn_pages.keys[i]);
+            result = -1;
         }
-        return 0;
     }
+    page_table_clear(&pager->txn_pages);
+    return result;
+}
+
+int pager_append_operand(Pager* pager, const void* record, uint32_t length, uint64_t* seq) {
+    if (!pager->wal) {
+        return -1;
+    }
+    latch_lock_exclusive(&pager->lock);
+    int result = wal_append_operand(pager->wal, record, length, seq);
+    latch_unlock_exclusive(&pager->lock);
+    return result;
+}
+
+int pager_flush_operands(Pager* pager, uint64_t* through) {
+    if (!pager->wal) {
+        return -1;
+    }
+    latch_lock_exclusive(&pager->lock);
+    int result = wal_flush_operands(pager->wal, through);
+    latch_unlock_exclusive(&pager->lock);
+    return result;
+}
+
+int pager_flush(Pager* pager, uint32_t page_num) {
+    uint32_t frame_index;
+    if (!pager_lookup(pager, page_num, false, &frame_index)) {
+        fprintf(stderr, "Tried to flush null page %d\n", page_num);
+        return -1;
+    }
+    latch_lock_exclusive(&pager->lock);
+    int result = pager_write_frame(pager, &pager->frames[frame_index]);
+    latch_unlock_exclusive(&pager->lock);
+    return result;
 }
 
 void pager_close(Pager* pager) {
     int flush_errors = 0;
-    for (uint32_t i = 0; i < TABLE_MAX_PAGES; i++) {
-        if (pager->pages[i]) {
-            if (pager_flush(pager, i) != 0) {
-                fprintf(stderr, "Warning: Failed to flush page %d during close\n", i);
+    for (uint32_t i = 0; i < pager->num_frames; i++) {
+        PageFrame* frame = &pager->frames[i];
+        if (frame->in_use && frame->dirty) {
+            if (pager_write_frame(pager, frame) != 0) {
+                fprintf(stderr, "Warning: Failed to flush page %d during close\n", frame->page_num);
                 flush_errors++;
             }
-            free(pager->pages[i]);
-            pager->pages[i] = NULL;
         }
     }
+    if (pager->budget) {
+        pager_budget_release(pager->budget, pager->num_frames);
+    }
+    pager->policy->destroy(pager->policy_state);
+    for (uint32_t i = 0; i < PAGER_STRIPES; i++) {
+        page_table_free(&pager->stripes[i].table);
+        while (pager->stripes[i].retired) {
+            PagerRetiredTable* retired = pager->stripes[i].retired;
+            pager->stripes[i].retired = retired->next;
+            page_table_free(&retired->table);
+            free(retired);
+        }
+    }
+    free(pager->stripes);
+    free(pager->frames);
+    free(pager->free_frames);
+    frame_arena_destroy(pager->arena);
+    page_versions_destroy(&pager->versions);
+    page_table_free(&pager->txn_pages);
     
     int result = close(pager->file_descriptor);
     if (result == -1) {
@@ -199,22 +1147,218 @@ void pager_close(Pager* pager) {
 }
 
 int pager_write_page_direct(Pager* pager, uint32_t page_num, void* data) {
-    off_t offset = lseek(pager->file_descriptor, page_num * PAGE_SIZE, SEEK_SET);
+    off_t offset = lseek(pager->file_descriptor, (off_t)page_num * PAGE_SIZE, SEEK_SET);
     if (offset == -1) {
         fprintf(stderr, "Error seeking for direct write: %d\n", errno);
         return -1;
     }
 
-    ssize_t bytes_written = write(pager->file_descriptor, data, PAGE_SIZE);
+    // Stage through the aligned scratch frame: the checksum must not be
+    // written into caller data, and O_DIRECT needs an aligned source.
+    memcpy(pager->scratch, data, PAGE_SIZE);
+    pager_set_checksum(pager->scratch);
+
+    ssize_t bytes_written = write(pager->file_descriptor, pager->scratch, PAGE_SIZE);
     if (bytes_written != PAGE_SIZE) {
         fprintf(stderr, "Failed to write page directly\n");
         return -1;
     }
+    if ((off_t)pager->file_length < offset + PAGE_SIZE) {
+        pager->file_length = offset + PAGE_SIZE;
+    }
+    // Recovery writes pages that only the WAL held: they are part of the
+    // file now, and new pages must be allocated after them
+    if (page_num >= pager->num_pages) {
+        pager->num_pages = page_num + 1;
+    }
 
     // Update pager cache if present
-    if (page_num < TABLE_MAX_PAGES && pager->pages[page_num] != NULL) {
-        memcpy(pager->pages[page_num], data, PAGE_SIZE);
+    uint32_t frame_index;
+    if (pager_lookup(pager, page_num, false, &frame_index)) {
+        memcpy(pager->frames[frame_index].data, pager->scratch, PAGE_SIZE);
+        pager->frames[frame_index].dirty = false;
+    }
+
+    return 0;
+}
+
+int pager_save_warm_list(Pager* pager, const char* path) {
+    char tmp_path[MAX_FILENAME_LEN + 8];
+    int written = snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    if (written < 0 || written >= (int)sizeof(tmp_path)) {
+        fprintf(stderr, "Warm list filename too long\n");
+        return -1;
+    }
+
+    uint32_t* pages = malloc(pager->num_frames * sizeof(uint32_t));
+    if (!pages) {
+        fprintf(stderr, "Failed to allocate warm list\n");
+        return -1;
+    }
+    latch_lock_exclusive(&pager->lock);
+    uint32_t count = pager->policy->recency_order(pager->policy_state, pages, pager->num_frames);
+    for (uint32_t i = 0; i < count; i++) {
+        pages[i] = pager->frames[pages[i]].page_num;
     }
+    latch_unlock_exclusive(&pager->lock);
 
+    FILE* file = fopen(tmp_path, "wb");
+    if (!file) {
+        fprintf(stderr, "Failed to create warm list '%s': %d\n", tmp_path, errno);
+        free(pages);
+        return -1;
+    }
+    uint32_t header[2] = { PAGER_WARM_MAGIC, count };
+    bool ok = fwrite(header, sizeof(header), 1, file) == 1 &&
+              (count == 0 || fwrite(pages, sizeof(uint32_t), count, file) == count);
+    ok = (fclose(file) == 0) && ok;
+    free(pages);
+    if (!ok) {
+        fprintf(stderr, "Failed to write warm list '%s'\n", tmp_path);
+        remove(tmp_path);
+        return -1;
+    }
+#ifdef _WIN32
+    remove(path); // rename() does not replace existing files on Windows
+#endif
+    if (rename(tmp_path, path) != 0) {
+        fprintf(stderr, "Failed to replace warm list '%s': %d\n", path, errno);
+        remove(tmp_path);
+        return -1;
+    }
+    return (int)count;
+}
+
+static int compare_page_nums(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Read pages [first, first + count) from the DB file into buffer with one read.
+static int pager_read_run(Pager* pager, uint32_t first, uint32_t count, uint8_t* buffer) {
+    if (lseek(pager->file_descriptor, (off_t)first * PAGE_SIZE, SEEK_SET) == -1) {
+        fprintf(stderr, "Error seeking to page %d: %d\n", first, errno);
+        return -1;
+    }
+    size_t length = (size_t)count * PAGE_SIZE;
+    size_t done = 0;
+    while (done < length) {
+        ssize_t bytes_read = read(pager->file_descriptor, buffer + done, (unsigned int)(length - done));
+        if (bytes_read <= 0) {
+            fprintf(stderr, "Error reading pages %d-%d: %d\n", first, first + count - 1, errno);
+            return -1;
+        }
+        done += (size_t)bytes_read;
+    }
     return 0;
 }
+
+int pager_load_warm_list(Pager* pager, const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return 0;
+    }
+    uint32_t header[2];
+    if (fread(header, sizeof(header), 1, file) != 1 || header[0] != PAGER_WARM_MAGIC) {
+        fprintf(stderr, "Warning: Ignoring invalid warm list '%s'\n", path);
+        fclose(file);
+        return -1;
+    }
+
+    // Only the hottest pages that fit into free frames are worth reading
+    uint32_t count = header[1] < pager->num_free_frames ? header[1] : pager->num_free_frames;
+    uint32_t* ordered = malloc((count + 1) * sizeof(uint32_t));
+    uint32_t* sorted = malloc((count + 1) * sizeof(uint32_t));
+    bool* pending = calloc(pager->num_frames, sizeof(bool));
+    // Aligned, so runs can be read with O_DIRECT as well
+    FrameArena* run_buffer = frame_arena_create(PAGER_WARM_READ_PAGES, false);
+    bool ok = ordered && sorted && pending && run_buffer;
+    if (!ok) {
+        fprintf(stderr, "Failed to allocate warm list buffers\n");
+    } else if (fread(ordered, sizeof(uint32_t), count, file) != count) {
+        fprintf(stderr, "Warning: Ignoring truncated warm list '%s'\n", path);
+        ok = false;
+    }
+    fclose(file);
+    if (!ok) {
+        free(ordered);
+        free(sorted);
+        free(pending);
+        frame_arena_destroy(run_buffer);
+        return -1;
+    }
+
+    uint32_t file_pages = pager->file_length / PAGE_SIZE;
+    uint32_t num_sorted = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t frame_index;
+        if (ordered[i] < file_pages && !pager_lookup(pager, ordered[i], false, &frame_index)) {
+            sorted[num_sorted++] = ordered[i];
+        }
+    }
+    qsort(sorted, num_sorted, sizeof(uint32_t), compare_page_nums);
+
+    int loaded = 0;
+    uint32_t i = 0;
+    while (i < num_sorted) {
+        // Extend the run over adjacent pages (duplicates collapse into it)
+        uint32_t first = sorted[i];
+        uint32_t end = i + 1;
+        while (end < num_sorted && sorted[end] - first < PAGER_WARM_READ_PAGES &&
+               sorted[end] <= sorted[end - 1] + 1) {
+            end++;
+        }
+        uint32_t run_pages = sorted[end - 1] - first + 1;
+        if (pager_read_run(pager, first, run_pages, run_buffer->base) != 0) {
+            break;
+        }
+        for (; i < end; i++) {
+            uint32_t page_num = sorted[i];
+            uint32_t frame_index;
+            if (pager_lookup(pager, page_num, false, &frame_index) || pager->num_free_frames == 0) {
+                continue;
+            }
+            frame_index = pager->free_frames[--pager->num_free_frames];
+            PageFrame* frame = &pager->frames[frame_index];
+            // The WAL holds newer images than the DB file until checkpointed
+            int in_wal = pager->wal ? wal_read_page(pager->wal, page_num, frame->data) : 0;
+            if (in_wal < 0 || pager_map(pager, page_num, frame_index) != 0) {
+                pager->free_frames[pager->num_free_frames++] = frame_index;
+                continue;
+            }
+            if (in_wal == 0) {
+                memcpy(frame->data, run_buffer->base + (size_t)(page_num - first) * PAGE_SIZE, PAGE_SIZE);
+                if (pager_check_loaded_page(pager, page_num, frame->data) != 0) {
+                    pager_unmap(pager, page_num);
+                    pager->free_frames[pager->num_free_frames++] = frame_index;
+                    continue;
+                }
+            }
+            frame->page_num = page_num;
+            frame->in_use = true;
+            frame->dirty = false;
+            frame->last_access = 0; // Not recently requested: evictable
+            pager_frame_publish(frame);
+            pending[frame_index] = true;
+            loaded++;
+        }
+    }
+
+    // Hand the pages to the policy coldest first, so the hottest end up most recent
+    for (uint32_t j = count; j-- > 0;) {
+        uint32_t frame_index;
+        if (!pager_lookup(pager, ordered[j], false, &frame_index) || !pending[frame_index]) {
+            continue;
+        }
+        pending[frame_index] = false; // Duplicates in the list are inserted once
+        pager->policy->on_insert(pager->policy_state, frame_index, ordered[j], false);
+    }
+    pager->stats.warmed += (uint64_t)loaded;
+
+    free(ordered);
+    free(sorted);
+    free(pending);
+    frame_arena_destroy(run_buffer);
+    return loaded;
+}
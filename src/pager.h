@@ -4,32 +4,338 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
+#include "page_table.h"
+#include "pager_policy.h"
+#include "latch.h"
+#include "page_versions.h"
 
 #define PAGE_SIZE 4096
-#define TABLE_MAX_PAGES 100
+// Every page ends with a CRC32C of the bytes before it, set when the page
+// is written out. A stored value of 0 means "no checksum" (pages written
+// before checksums existed) and is not verified.
+#define PAGE_CHECKSUM_SIZE sizeof(uint32_t)
+#define PAGE_CHECKSUM_OFFSET (PAGE_SIZE - PAGE_CHECKSUM_SIZE)
+#define PAGE_USABLE_SIZE PAGE_CHECKSUM_OFFSET // Bytes available to page layouts
+#define TABLE_MAX_PAGES 100 // Default number of cached page frames
+
+// Smallest cache the pager accepts. Callers hold plain page pointers for the
+// duration of an operation, so the cache must be able to keep every page an
+// operation touches resident at once. With several threads in the pager it
+// must hold the pages of all their operations at once.
+#define PAGER_MIN_FRAMES 16
+// A frame handed out by one of the last PAGER_RECENT_WINDOW page requests is
+// never chosen for eviction, which keeps those pointers valid. This only
+// covers requests made outside a pin scope (see pager_scope_begin), which
+// are for single-threaded use.
+#define PAGER_RECENT_WINDOW 8
+// Lock stripes of the page table (a power of two)
+#define PAGER_STRIPES 16
+// Most distinct pages one pin scope keeps pinned
+#define PAGER_SCOPE_MAX_PINS 256
+// Optimistic hits a thread counts before adding them to the pager counters
+#define PAGER_OPTIMISTIC_HIT_BATCH 64
 
 typedef struct WAL WAL;
+typedef struct FrameArena FrameArena;
+
+// Access hints for pager_get_page_hint
+typedef enum {
+    PAGER_HINT_NORMAL,  // Regular access, counts towards recency
+    PAGER_HINT_USE_ONCE // Scan access: do not let this page displace hot pages
+} PagerHint;
+
+// Warm list file: magic, page count, then page numbers (uint32 each),
+// hottest page first
+#define PAGER_WARM_MAGIC 0x4D52574Fu // "OWRM"
+// Longest run of adjacent pages read with a single call when warming
+#define PAGER_WARM_READ_PAGES 32
+
+// When pages read from the DB file are checked against their checksum
+typedef enum {
+    PAGER_CHECKSUM_ALWAYS,  // Every load (default)
+    PAGER_CHECKSUM_SAMPLED, // One load in PAGER_CHECKSUM_SAMPLE_INTERVAL
+    PAGER_CHECKSUM_OFF      // Never; checksums are still written
+} PagerChecksumMode;
+
+#define PAGER_CHECKSUM_SAMPLE_INTERVAL 16
+
+// Pager open flags
+#define PAGER_OPEN_DIRECT     (1u << 0) // Bypass the OS page cache (O_DIRECT / F_NOCACHE)
+#define PAGER_OPEN_HUGE_PAGES (1u << 1) // Back the frame arena with huge pages if available
+
+// Page frames shared by the pagers of many databases in one process.
+// Each pager draws its frames from the budget when it opens and returns
+// them when it closes, so the process never caches more than total_frames
+// pages however many databases are open.
+typedef struct {
+    uint32_t total_frames;
+    uint32_t used_frames; // Held by open pagers
+    Latch latch;          // Pagers may open and close on different threads
+} PagerBudget;
+
+typedef struct {
+    uint32_t flags;        // PAGER_OPEN_* flags
+    uint32_t cache_frames; // Page frames preallocated at open (0 = TABLE_MAX_PAGES)
+    const PagerPolicyOps* policy; // Replacement policy (NULL = pager_policy_2q)
+    PagerChecksumMode checksum_mode;
+    // Shared frame budget (NULL = none). The pager gets cache_frames, or
+    // what is left of the budget if that is less; open fails if fewer than
+    // PAGER_MIN_FRAMES are left.
+    PagerBudget* budget;
+} PagerOptions;
+
+// Latch modes for pager_latch_page
+typedef enum {
+    PAGER_LATCH_SHARED,   // Read the page; other readers may too
+    PAGER_LATCH_EXCLUSIVE // Modify the page; no one else may read it meanwhile
+} PagerLatchMode;
+
+// A cached page
+typedef struct {
+    void* data;           // PAGE_SIZE bytes carved from the frame arena
+    uint32_t page_num;    // Page held by this frame (valid if in_use)
+    bool in_use;
+    bool dirty;           // Modified since last written to the WAL / DB file
+    uint64_t last_access; // Value of the pager access clock at the last unscoped request
+    _Atomic uint32_t pin_count;   // Pins of any kind; pinned frames are never evicted
+    _Atomic uint32_t stable_pins; // pager_pin_page pins: writers move the page to a copy
+    _Atomic bool detached; // Replaced by a copy while pinned; freed by the last unpin
+    Latch latch;          // Page latch, see pager_latch_page
+    // Optimistic read version: even while the frame holds a stable image of
+    // page_num, odd while it is being changed (exclusive latch, load) or once
+    // it no longer holds the cached image. See pager_optimistic_begin.
+    _Atomic uint64_t version;
+} PageFrame;
+
+// One lock stripe of the page table. Padded so the fields of neighbouring
+// stripes never share a cache line.
+typedef union {
+    struct {
+        Latch latch;           // Shared for lookups, exclusive to change the table
+        PageTable table;       // page_num -> frame index, for the pages of this stripe
+        _Atomic uint64_t hits; // Cache hits on this stripe's pages
+        // Odd while the table changes, for lookups without the latch
+        _Atomic uint32_t version;
+        // Arrays of outgrown tables: latch-free lookups may still be
+        // reading them, so they are freed at close
+        struct PagerRetiredTable* retired;
+    };
+    uint8_t padding[128];
+} PagerStripe;
+
+// Cache counters, see pager_get_stats
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t writebacks; // Dirty pages written out by eviction
+    uint64_t warmed;     // Pages preloaded by pager_load_warm_list
+    uint64_t checksum_failures; // Loads refused because the page checksum did not match
+    uint64_t pinned_copies; // Pages copied because a writer found them pinned
+} PagerStats;
 
 typedef struct {
     int file_descriptor;
     uint32_t file_length;
     uint32_t num_pages;
-    void* pages[TABLE_MAX_PAGES]; // Simple cache for now
     WAL* wal; // Pointer to WAL instance
+    FrameArena* arena; // Aligned arena that page frames are carved from
+    void* scratch; // Aligned bounce buffer for direct writes of caller data
+    bool direct_io; // File was opened with the OS page cache bypassed
+    PageFrame* frames; // Cache frames
+    uint32_t num_frames;
+    uint32_t* free_frames; // Stack of unused frame indices
+    uint32_t num_free_frames;
+    const PagerPolicyOps* policy;
+    void* policy_state;
+    uint64_t access_clock; // Incremented on misses and unscoped requests
+    PagerChecksumMode checksum_mode;
+    uint32_t checksum_loads; // DB file loads, drives sampled verification
+    PagerStats stats; // Hits are counted per stripe instead
+    PagerBudget* budget; // Budget num_frames was drawn from, or NULL
+    PagerStripe* stripes; // Page table, PAGER_STRIPES stripes
+    // Serializes misses, eviction, the free list, the replacement policy,
+    // the counters in stats and writes to the WAL / DB file
+    Latch lock;
+    // Images of changed pages kept for snapshots, see pager_read_version
+    PageVersions versions;
+    // The open transaction, for pager_txn_abort: the pages taken for write
+    // since pager_txn_begin (value 0) and num_pages when it began
+    bool in_txn;
+    PageTable txn_pages;
+    uint32_t txn_num_pages;
 } Pager;
 
+/**
+ * Initialize a frame budget of max_bytes of page cache
+ * (at least PAGER_MIN_FRAMES frames).
+ */
+void pager_budget_init(PagerBudget* budget, size_t max_bytes);
+
 /**
  * Open the pager for a given file.
  * Creates the file if it doesn't exist.
  */
 Pager* pager_open(const char* filename);
 
+/**
+ * Open the pager with explicit options.
+ * With PAGER_OPEN_DIRECT the pager cache is the only cache for the file;
+ * if the filesystem refuses direct I/O the file is opened normally and a
+ * warning is printed.
+ * @param options Options, or NULL for defaults
+ */
+Pager* pager_open_with_options(const char* filename, const PagerOptions* options);
+
 /**
  * Get a page from the pager.
- * If the page is not in cache, it is read from disk.
+ * If the page is not in cache, it is read from the WAL or from disk,
+ * evicting another page if the cache is full. Returns NULL if the page
+ * cannot be read or fails checksum verification.
+ * The returned pointer stays valid for at least the next
+ * PAGER_RECENT_WINDOW page requests.
  */
 void* pager_get_page(Pager* pager, uint32_t page_num);
 
+/**
+ * Get a page with an access hint.
+ * Scans pass PAGER_HINT_USE_ONCE so that touching every leaf once does not
+ * flush the pages used by point lookups.
+ */
+void* pager_get_page_hint(Pager* pager, uint32_t page_num, PagerHint hint);
+
+/**
+ * Get a page that the caller is about to modify.
+ * Same as pager_get_page, except when the page is pinned: readers holding
+ * the pin keep the current image and the page moves to a copy in another
+ * frame, which is returned. Every write to a cached page must go through
+ * a pointer obtained this way. With other threads in the pager, the page
+ * must also be latched exclusively (pager_latch_page) while it changes.
+ * If a live snapshot may read the page, its image is saved first (see
+ * page_versions_preserve). Returns NULL if that fails.
+ */
+void* pager_get_page_for_write(Pager* pager, uint32_t page_num);
+
+/**
+ * Reserve count new pages at the end of the file.
+ * @return Number of the first new page
+ */
+uint32_t pager_allocate_pages(Pager* pager, uint32_t count);
+
+/**
+ * Start a pin scope on the calling thread: until pager_scope_end, every
+ * page this thread gets from the pager stays pinned, so its pointers stay
+ * valid for the whole operation whatever other threads request. All page
+ * access from multiple threads must happen inside scopes. A nested begin
+ * on the same pager is a no-op; a thread has one scope at a time.
+ * @return 0 on success, -1 if the thread is in a scope of another pager
+ */
+int pager_scope_begin(Pager* pager);
+
+/**
+ * End the calling thread's pin scope and unpin its pages.
+ */
+void pager_scope_end(Pager* pager);
+
+/**
+ * Unpin one page of the calling thread's scope before the scope ends, for
+ * walks that would otherwise pin every page they pass (hand-over-hand
+ * scans). The page must not be latched or used afterwards.
+ */
+void pager_scope_unpin(Pager* pager, uint32_t frame_index);
+
+/**
+ * Get a page and latch its frame. Shared latches exclude writers, an
+ * exclusive latch excludes everyone; the page must not be read or changed
+ * without one while other threads are in the pager. Exclusive mode gets
+ * the page as pager_get_page_for_write does. Only use inside a pin scope.
+ * @param frame_index Set to the frame to pass to pager_unlatch_frame
+ */
+void* pager_latch_page(Pager* pager, uint32_t page_num, PagerLatchMode mode, uint32_t* frame_index);
+
+/**
+ * pager_latch_page with a caching hint, as pager_get_page_hint.
+ */
+void* pager_latch_page_hint(Pager* pager, uint32_t page_num, PagerHint hint, PagerLatchMode mode,
+                            uint32_t* frame_index);
+
+/**
+ * Release a latch taken by pager_latch_page. The page stays pinned until
+ * the scope ends.
+ */
+void pager_unlatch_frame(Pager* pager, uint32_t frame_index, PagerLatchMode mode);
+
+/**
+ * Optimistic reads: look at a cached page without latching or pinning it,
+ * so readers never write to memory other threads read. Begin returns the
+ * page and its version; the caller copies what it needs and then checks
+ * with pager_optimistic_validate that the version is unchanged. Only
+ * then may the copy be trusted: it may be torn, or come from a frame that
+ * was reused for another page meanwhile, so never follow offsets from the
+ * page itself before validating. Hits are counted in per-thread batches,
+ * and only every PAGER_OPTIMISTIC_HIT_BATCH-th one updates the policy.
+ * @return 0 on success, 1 if the page is changing right now (retry), -1
+ *         if it is not resident (read it through pager_latch_page instead)
+ */
+int pager_optimistic_begin(Pager* pager, uint32_t page_num, const void** data, uint32_t* frame_index,
+                           uint64_t* version);
+
+/**
+ * Whether the frame still has the version pager_optimistic_begin returned,
+ * i.e. everything read from it since is consistent.
+ */
+bool pager_optimistic_validate(Pager* pager, uint32_t frame_index, uint64_t version);
+
+/**
+ * Copy a page as a snapshot of the given epoch sees it: a saved image if
+ * the page changed since, otherwise the current page, read under a shared
+ * latch. Safe next to the writer.
+ * @param epoch Snapshot epoch from page_versions_acquire
+ * @param out Receives PAGE_SIZE bytes
+ * @return 0 on success, -1 if the page could not be read
+ */
+int pager_read_version(Pager* pager, uint32_t page_num, uint64_t epoch, PagerHint hint, void* out);
+
+/**
+ * Get a page and pin its frame: the returned pointer stays valid, and the
+ * bytes it points to unchanged, until pager_unpin_frame, regardless of
+ * later page requests or writes to the page. With concurrent writers the
+ * caller must hold a shared latch on the page while pinning it.
+ * @param frame_index Set to the frame to pass to pager_unpin_frame
+ */
+void* pager_pin_page(Pager* pager, uint32_t page_num, uint32_t* frame_index);
+
+/**
+ * Release a pin taken by pager_pin_page.
+ */
+void pager_unpin_frame(Pager* pager, uint32_t frame_index);
+
+/**
+ * Hint that the given pages will be requested soon. Pages already cached
+ * are pulled into the CPU cache; the others are announced to the OS
+ * (posix_fadvise WILLNEED, adjacent page numbers in one call) so their
+ * reads overlap instead of running one after another. Does not load or
+ * evict anything and does not count as an access.
+ * @return Number of pages that were not cached
+ */
+uint32_t pager_prefetch(Pager* pager, const uint32_t* page_nums, uint32_t count);
+
+/**
+ * Mark a cached page as modified without writing it yet.
+ * Dirty pages are written back when evicted or at close.
+ */
+void pager_mark_dirty(Pager* pager, uint32_t page_num);
+
+/**
+ * Copy the cache counters into *stats.
+ */
+void pager_get_stats(Pager* pager, PagerStats* stats);
+
+/**
+ * Reset the cache counters to zero.
+ */
+void pager_reset_stats(Pager* pager);
+
 /**
  * Flush a specific page to disk.
  * @return 0 on success, -1 on error
@@ -42,14 +348,81 @@ int pager_flush(Pager* pager, uint32_t page_num);
 void pager_set_wal(Pager* pager, WAL* wal);
 
 /**
- * Close the pager and flush all pages to disk.
+ * Group the pages written until pager_txn_commit into one WAL transaction
+ * (see wal_begin), so recovery applies them together or not at all. For
+ * the one writer; a no-op without a WAL.
+ * @return 0 on success, -1 on error
+ */
+int pager_txn_begin(Pager* pager);
+int pager_txn_commit(Pager* pager);
+
+/**
+ * Abort the open transaction instead of committing it: its frames are
+ * dropped from the WAL, the pages it changed are read back into the cache
+ * as they were at pager_txn_begin and the pages it allocated are given
+ * back. For the one writer, outside any pin scope. Without a WAL pages
+ * reach the file as they are written and nothing can be undone.
+ * @return 0 on success, -1 on error or without a WAL
+ */
+int pager_txn_abort(Pager* pager);
+
+/**
+ * Log an operand of a deferred merge to the WAL (see wal_append_operand),
+ * outside a transaction. Not synced: see pager_flush_operands.
+ * @return 0 on success, -1 on error or without a WAL
+ */
+int pager_append_operand(Pager* pager, const void* record, uint32_t length, uint64_t* seq);
+
+/**
+ * Write the WAL's open operand frame (see wal_flush_operands), outside a
+ * transaction; wal_sync_operands then makes it durable without the pager
+ * lock.
+ * @return 0 on success, -1 on error or without a WAL
+ */
+int pager_flush_operands(Pager* pager, uint64_t* through);
+
+/**
+ * Close the pager and flush all dirty pages to disk.
  */
 void pager_close(Pager* pager);
 
+/**
+ * Save the numbers of the resident pages, most valuable first according
+ * to the replacement policy, so a later open can preload them.
+ * The list is written to a temporary file and renamed over path.
+ * @return Number of pages saved, or -1 on error
+ */
+int pager_save_warm_list(Pager* pager, const char* path);
+
+/**
+ * Preload the pages named in a warm list written by pager_save_warm_list.
+ * Pages are read in page-number order, adjacent pages with a single read
+ * of up to PAGER_WARM_READ_PAGES pages, and only into free frames: the
+ * hottest pages are kept when the list is larger than the cache. Pages past
+ * the end of the file or already resident are skipped. A missing file is
+ * not an error. Call before other threads use the pager.
+ * @return Number of pages loaded, or -1 if the list is unreadable
+ */
+int pager_load_warm_list(Pager* pager, const char* path);
+
+/**
+ * Compute the checksum of a page and store it in its trailer.
+ */
+void pager_set_checksum(void* page);
+
+/**
+ * Check a page against the checksum in its trailer. A trailer of 0 must
+ * match too, so a zero-filled page is not taken for a valid one.
+ * @return true if it matches
+ */
+bool pager_verify_checksum(const void* page);
+
 /**
  * Write page data directly to the database file at the given page number.
- * This bypasses the WAL and writes directly to disk.
- * Also updates the pager cache if the page is present.
+ * This bypasses the WAL and writes directly to disk. The page is written
+ * with its checksum set; data itself is not modified.
+ * Also updates the pager cache if the page is present, and counts a page
+ * past the end of the file in num_pages.
  * Returns 0 on success, -1 on failure.
  */
 int pager_write_page_direct(Pager* pager, uint32_t page_num, void* data);
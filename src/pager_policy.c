@@ -0,0 +1,332 @@
+#include "pager_policy.h"
+#include "page_table.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define FRAME_NIL UINT32_MAX
+
+// Intrusive doubly linked list over frame indices. head = most recent.
+typedef struct {
+    uint32_t head;
+    uint32_t tail;
+    uint32_t size;
+} FrameList;
+
+static void frame_list_init(FrameList* list) {
+    list->head = FRAME_NIL;
+    list->tail = FRAME_NIL;
+    list->size = 0;
+}
+
+static void frame_list_push_head(FrameList* list, uint32_t* prev, uint32_t* next, uint32_t frame) {
+    prev[frame] = FRAME_NIL;
+    next[frame] = list->head;
+    if (list->head != FRAME_NIL) {
+        prev[list->head] = frame;
+    } else {
+        list->tail = frame;
+    }
+    list->head = frame;
+    list->size++;
+}
+
+static void frame_list_push_tail(FrameList* list, uint32_t* prev, uint32_t* next, uint32_t frame) {
+    next[frame] = FRAME_NIL;
+    prev[frame] = list->tail;
+    if (list->tail != FRAME_NIL) {
+        next[list->tail] = frame;
+    } else {
+        list->head = frame;
+    }
+    list->tail = frame;
+    list->size++;
+}
+
+static void frame_list_unlink(FrameList* list, uint32_t* prev, uint32_t* next, uint32_t frame) {
+    if (prev[frame] != FRAME_NIL) {
+        next[prev[frame]] = next[frame];
+    } else {
+        list->head = next[frame];
+    }
+    if (next[frame] != FRAME_NIL) {
+        prev[next[frame]] = prev[frame];
+    } else {
+        list->tail = prev[frame];
+    }
+    prev[frame] = FRAME_NIL;
+    next[frame] = FRAME_NIL;
+    list->size--;
+}
+
+// Walk from the cold end towards the hot end and return the first evictable frame
+static int64_t frame_list_victim(const FrameList* list, const uint32_t* prev,
+                                 PagerEvictableFn evictable, void* ctx) {
+    for (uint32_t frame = list->tail; frame != FRAME_NIL; frame = prev[frame]) {
+        if (evictable(ctx, frame)) {
+            return frame;
+        }
+    }
+    return -1;
+}
+
+// Append frames from the hot end towards the cold end
+static uint32_t frame_list_collect(const FrameList* list, const uint32_t* next,
+                                   uint32_t* frames, uint32_t count, uint32_t max) {
+    for (uint32_t frame = list->head; frame != FRAME_NIL && count < max; frame = next[frame]) {
+        frames[count++] = frame;
+    }
+    return count;
+}
+
+// ---------------------------------------------------------------------------
+// LRU
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint32_t* prev;
+    uint32_t* next;
+    FrameList lru;
+} LruState;
+
+static void* lru_create(uint32_t num_frames) {
+    LruState* state = malloc(sizeof(LruState));
+    if (!state) {
+        return NULL;
+    }
+    state->prev = malloc(num_frames * sizeof(uint32_t));
+    state->next = malloc(num_frames * sizeof(uint32_t));
+    if (!state->prev || !state->next) {
+        free(state->prev);
+        free(state->next);
+        free(state);
+        return NULL;
+    }
+    frame_list_init(&state->lru);
+    return state;
+}
+
+static void lru_destroy(void* opaque) {
+    LruState* state = opaque;
+    if (!state) return;
+    free(state->prev);
+    free(state->next);
+    free(state);
+}
+
+static void lru_on_insert(void* opaque, uint32_t frame, uint32_t page_num, bool use_once) {
+    LruState* state = opaque;
+    (void)page_num;
+    if (use_once) {
+        frame_list_push_tail(&state->lru, state->prev, state->next, frame);
+    } else {
+        frame_list_push_head(&state->lru, state->prev, state->next, frame);
+    }
+}
+
+static void lru_on_hit(void* opaque, uint32_t frame, bool use_once) {
+    LruState* state = opaque;
+    if (use_once) {
+        return;
+    }
+    frame_list_unlink(&state->lru, state->prev, state->next, frame);
+    frame_list_push_head(&state->lru, state->prev, state->next, frame);
+}
+
+static int64_t lru_choose_victim(void* opaque, PagerEvictableFn evictable, void* ctx) {
+    LruState* state = opaque;
+    return frame_list_victim(&state->lru, state->prev, evictable, ctx);
+}
+
+static void lru_on_evict(void* opaque, uint32_t frame, uint32_t page_num) {
+    LruState* state = opaque;
+    (void)page_num;
+    frame_list_unlink(&state->lru, state->prev, state->next, frame);
+}
+
+static uint32_t lru_recency_order(void* opaque, uint32_t* frames, uint32_t max) {
+    LruState* state = opaque;
+    return frame_list_collect(&state->lru, state->next, frames, 0, max);
+}
+
+const PagerPolicyOps pager_policy_lru = {
+    "lru",
+    lru_create,
+    lru_destroy,
+    lru_on_insert,
+    lru_on_hit,
+    lru_choose_victim,
+    lru_on_evict,
+    lru_recency_order,
+};
+
+// ---------------------------------------------------------------------------
+// 2Q
+// ---------------------------------------------------------------------------
+
+typedef enum {
+    QUEUE_ONCE,  // Pages brought in by scans
+    QUEUE_A1IN,  // First-time pages (FIFO)
+    QUEUE_AM     // Pages referenced again after leaving A1in (LRU)
+} TwoQueue;
+
+typedef struct {
+    uint32_t* prev;
+    uint32_t* next;
+    uint8_t* queue;
+    FrameList once;
+    FrameList a1in;
+    FrameList am;
+    uint32_t kin;          // Target size of A1in
+    // A1out: ghost FIFO of page numbers recently evicted from A1in
+    uint32_t* ghost_ring;
+    uint32_t kout;
+    uint32_t ghost_pos;
+    uint32_t ghost_count;
+    PageTable ghost_index; // page_num -> ring slot
+} TwoQState;
+
+static void* twoq_create(uint32_t num_frames) {
+    TwoQState* state = calloc(1, sizeof(TwoQState));
+    if (!state) {
+        return NULL;
+    }
+    state->kin = num_frames / 4 > 0 ? num_frames / 4 : 1;
+    state->kout = num_frames / 2 > 0 ? num_frames / 2 : 1;
+    state->prev = malloc(num_frames * sizeof(uint32_t));
+    state->next = malloc(num_frames * sizeof(uint32_t));
+    state->queue = malloc(num_frames * sizeof(uint8_t));
+    state->ghost_ring = malloc(state->kout * sizeof(uint32_t));
+    if (!state->prev || !state->next || !state->queue || !state->ghost_ring ||
+        page_table_init(&state->ghost_index, state->kout) != 0) {
+        free(state->prev);
+        free(state->next);
+        free(state->queue);
+        free(state->ghost_ring);
+        free(state);
+        return NULL;
+    }
+    frame_list_init(&state->once);
+    frame_list_init(&state->a1in);
+    frame_list_init(&state->am);
+    return state;
+}
+
+static void twoq_destroy(void* opaque) {
+    TwoQState* state = opaque;
+    if (!state) return;
+    free(state->prev);
+    free(state->next);
+    free(state->queue);
+    free(state->ghost_ring);
+    page_table_free(&state->ghost_index);
+    free(state);
+}
+
+static FrameList* twoq_list(TwoQState* state, uint32_t frame) {
+    switch ((TwoQueue)state->queue[frame]) {
+        case QUEUE_ONCE: return &state->once;
+        case QUEUE_A1IN: return &state->a1in;
+        case QUEUE_AM: return &state->am;
+    }
+    return &state->am;
+}
+
+static void twoq_ghost_add(TwoQState* state, uint32_t page_num) {
+    uint32_t slot = state->ghost_pos;
+    if (state->ghost_count == state->kout) {
+        // Ring is full: forget the oldest ghost unless it has been re-added since
+        uint32_t old_page = state->ghost_ring[slot];
+        uint32_t old_slot;
+        if (page_table_get(&state->ghost_index, old_page, &old_slot) && old_slot == slot) {
+            page_table_remove(&state->ghost_index, old_page);
+        }
+    } else {
+        state->ghost_count++;
+    }
+    state->ghost_ring[slot] = page_num;
+    page_table_put(&state->ghost_index, page_num, slot);
+    state->ghost_pos = (slot + 1) % state->kout;
+}
+
+static void twoq_on_insert(void* opaque, uint32_t frame, uint32_t page_num, bool use_once) {
+    TwoQState* state = opaque;
+    if (use_once) {
+        state->queue[frame] = QUEUE_ONCE;
+        frame_list_push_head(&state->once, state->prev, state->next, frame);
+    } else if (page_table_remove(&state->ghost_index, page_num)) {
+        // Referenced again soon after leaving A1in: it is hot
+        state->queue[frame] = QUEUE_AM;
+        frame_list_push_head(&state->am, state->prev, state->next, frame);
+    } else {
+        state->queue[frame] = QUEUE_A1IN;
+        frame_list_push_head(&state->a1in, state->prev, state->next, frame);
+    }
+}
+
+static void twoq_on_hit(void* opaque, uint32_t frame, bool use_once) {
+    TwoQState* state = opaque;
+    if (use_once) {
+        return;
+    }
+    switch ((TwoQueue)state->queue[frame]) {
+        case QUEUE_ONCE:
+            // A scanned page that is now used normally becomes a first-time page
+            frame_list_unlink(&state->once, state->prev, state->next, frame);
+            state->queue[frame] = QUEUE_A1IN;
+            frame_list_push_head(&state->a1in, state->prev, state->next, frame);
+            break;
+        case QUEUE_A1IN:
+            // Correlated references inside A1in do not promote
+            break;
+        case QUEUE_AM:
+            frame_list_unlink(&state->am, state->prev, state->next, frame);
+            frame_list_push_head(&state->am, state->prev, state->next, frame);
+            break;
+    }
+}
+
+static int64_t twoq_choose_victim(void* opaque, PagerEvictableFn evictable, void* ctx) {
+    TwoQState* state = opaque;
+    int64_t victim = frame_list_victim(&state->once, state->prev, evictable, ctx);
+    if (victim >= 0) {
+        return victim;
+    }
+    if (state->a1in.size > state->kin || state->am.size == 0) {
+        victim = frame_list_victim(&state->a1in, state->prev, evictable, ctx);
+        if (victim >= 0) {
+            return victim;
+        }
+        return frame_list_victim(&state->am, state->prev, evictable, ctx);
+    }
+    victim = frame_list_victim(&state->am, state->prev, evictable, ctx);
+    if (victim >= 0) {
+        return victim;
+    }
+    return frame_list_victim(&state->a1in, state->prev, evictable, ctx);
+}
+
+static void twoq_on_evict(void* opaque, uint32_t frame, uint32_t page_num) {
+    TwoQState* state = opaque;
+    if (state->queue[frame] == QUEUE_A1IN) {
+        twoq_ghost_add(state, page_num);
+    }
+    frame_list_unlink(twoq_list(state, frame), state->prev, state->next, frame);
+}
+
+static uint32_t twoq_recency_order(void* opaque, uint32_t* frames, uint32_t max) {
+    TwoQState* state = opaque;
+    // Pages proven hot come first; scanned pages are not worth restoring
+    uint32_t count = frame_list_collect(&state->am, state->next, frames, 0, max);
+    return frame_list_collect(&state->a1in, state->next, frames, count, max);
+}
+
+const PagerPolicyOps pager_policy_2q = {
+    "2q",
+    twoq_create,
+    twoq_destroy,
+    twoq_on_insert,
+    twoq_on_hit,
+    twoq_choose_victim,
+    twoq_on_evict,
+    twoq_recency_order,
+};
@@ -0,0 +1,55 @@
+#ifndef PAGER_POLICY_H
+#define PAGER_POLICY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Pluggable page replacement policy for the pager cache.
+ *
+ * A policy tracks frames by index (0 .. num_frames-1) and decides which
+ * resident frame to evict when the cache is full. The pager calls the
+ * hooks below; the policy never touches page data.
+ *
+ * "use_once" marks accesses made by scans: such pages should not displace
+ * the working set of repeatedly accessed pages.
+ */
+
+// Returns true if the pager allows the given frame to be evicted now
+typedef bool (*PagerEvictableFn)(void* ctx, uint32_t frame);
+
+typedef struct PagerPolicyOps {
+    const char* name;
+    // Allocate policy state for a cache of num_frames frames (NULL on failure)
+    void* (*create)(uint32_t num_frames);
+    void (*destroy)(void* state);
+    // A page was loaded into a free frame after a cache miss
+    void (*on_insert)(void* state, uint32_t frame, uint32_t page_num, bool use_once);
+    // A resident page was accessed again
+    void (*on_hit)(void* state, uint32_t frame, bool use_once);
+    // Pick a resident frame to evict, or return -1 if none is evictable
+    int64_t (*choose_victim)(void* state, PagerEvictableFn evictable, void* ctx);
+    // A resident frame is being released; page_num is the page it held
+    void (*on_evict)(void* state, uint32_t frame, uint32_t page_num);
+    // Write up to max resident frames worth keeping, most valuable first.
+    // Returns the number of frames written.
+    uint32_t (*recency_order)(void* state, uint32_t* frames, uint32_t max);
+} PagerPolicyOps;
+
+/**
+ * Plain least-recently-used. Use-once pages are inserted at the cold end.
+ * Recency order is the LRU list from the hot end.
+ */
+extern const PagerPolicyOps pager_policy_lru;
+
+/**
+ * 2Q (Johnson & Shasha). New pages enter a small FIFO (A1in); only pages
+ * referenced again after falling out of it (remembered in the A1out ghost
+ * list) are admitted to the main LRU (Am). A single scan therefore cannot
+ * flush the hot set. Use-once pages go to a separate queue that is always
+ * evicted first and never promoted through the ghost list.
+ * Recency order lists Am, then A1in; use-once pages are left out.
+ */
+extern const PagerPolicyOps pager_policy_2q;
+
+#endif // PAGER_POLICY_H
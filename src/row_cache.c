@@ -0,0 +1,230 @@
+#include "row_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ROW_CACHE_MIN_BUCKETS 64
+
+static RowCacheShard* row_cache_shard(RowCache* cache, uint64_t hash) {
+    // High bits: the low ones pick the bucket within the shard
+    return &cache->shards[hash >> 60];
+}
+
+static size_t row_cache_entry_size(size_t key_length, size_t value_length) {
+    return sizeof(RowCacheEntry) + key_length + value_length + 2;
+}
+
+RowCache* row_cache_create(size_t budget_bytes) {
+    RowCache* cache = calloc(1, sizeof(RowCache));
+    if (!cache) {
+        fprintf(stderr, "Failed to allocate row cache\n");
+        return NULL;
+    }
+    for (int i = 0; i < ROW_CACHE_SHARDS; i++) {
+        RowCacheShard* shard = &cache->shards[i];
+        latch_init(&shard->latch);
+        shard->buckets = calloc(ROW_CACHE_MIN_BUCKETS, sizeof(RowCacheEntry*));
+        if (!shard->buckets) {
+            fprintf(stderr, "Failed to allocate row cache buckets\n");
+            row_cache_destroy(cache);
+            return NULL;
+        }
+        shard->bucket_mask = ROW_CACHE_MIN_BUCKETS - 1;
+        shard->budget = budget_bytes / ROW_CACHE_SHARDS;
+    }
+    return cache;
+}
+
+void row_cache_destroy(RowCache* cache) {
+    if (!cache) {
+        return;
+    }
+    for (int i = 0; i < ROW_CACHE_SHARDS; i++) {
+        RowCacheShard* shard = &cache->shards[i];
+        if (!shard->buckets) {
+            continue;
+        }
+        for (uint32_t b = 0; b <= shard->bucket_mask; b++) {
+            RowCacheEntry* entry = shard->buckets[b];
+            while (entry) {
+                RowCacheEntry* next = entry->next;
+                free(entry);
+                entry = next;
+            }
+        }
+        free(shard->buckets);
+    }
+    free(cache);
+}
+
+// The link pointing to key's entry, or to the NULL ending its bucket
+static RowCacheEntry** row_cache_link(RowCacheShard* shard, uint64_t hash, const char* key) {
+    RowCacheEntry** link = &shard->buckets[hash & shard->bucket_mask];
+    while (*link && ((*link)->hash != hash || strcmp((*link)->data, key) != 0)) {
+        link = &(*link)->next;
+    }
+    return link;
+}
+
+// Unlink an entry from its bucket and the CLOCK ring and free it.
+// Exclusive latch held.
+static void row_cache_remove(RowCacheShard* shard, RowCacheEntry** link) {
+    RowCacheEntry* entry = *link;
+    *link = entry->next;
+    if (entry->clock_next == entry) {
+        shard->hand = NULL;
+    } else {
+        entry->clock_prev->clock_next = entry->clock_next;
+        entry->clock_next->clock_prev = entry->clock_prev;
+        if (shard->hand == entry) {
+            shard->hand = entry->clock_next;
+        }
+    }
+    shard->bytes -= row_cache_entry_size(entry->key_length, entry->value_length);
+    shard->count--;
+    free(entry);
+}
+
+// Evict until need more bytes fit. Exclusive latch held.
+static void row_cache_make_room(RowCacheShard* shard, size_t need) {
+    while (shard->hand && shard->bytes + need > shard->budget) {
+        RowCacheEntry* entry = shard->hand;
+        if (atomic_exchange_explicit(&entry->referenced, 0, memory_order_relaxed)) {
+            shard->hand = entry->clock_next; // Second chance
+            continue;
+        }
+        row_cache_remove(shard, row_cache_link(shard, entry->hash, entry->data));
+        shard->evictions++;
+    }
+}
+
+// Double the buckets once there are more entries than buckets. Exclusive
+// latch held; keeps the old table if the allocation fails.
+static void row_cache_grow(RowCacheShard* shard) {
+    uint32_t num_buckets = (shard->bucket_mask + 1) * 2;
+    RowCacheEntry** buckets = calloc(num_buckets, sizeof(RowCacheEntry*));
+    if (!buckets) {
+        return;
+    }
+    for (uint32_t b = 0; b <= shard->bucket_mask; b++) {
+        RowCacheEntry* entry = shard->buckets[b];
+        while (entry) {
+            RowCacheEntry* next = entry->next;
+            RowCacheEntry** head = &buckets[entry->hash & (num_buckets - 1)];
+            entry->next = *head;
+            *head = entry;
+            entry = next;
+        }
+    }
+    free(shard->buckets);
+    shard->buckets = buckets;
+    shard->bucket_mask = num_buckets - 1;
+}
+
+bool row_cache_get(RowCache* cache, uint64_t hash, const char* key, char* buf, size_t cap, size_t* length,
+                   uint64_t* generation) {
+    RowCacheShard* shard = row_cache_shard(cache, hash);
+    latch_lock_shared(&shard->latch);
+    RowCacheEntry* entry = *row_cache_link(shard, hash, key);
+    if (!entry) {
+        // Under the latch: no invalidation lands between the miss and this
+        *generation = atomic_load_explicit(&shard->generation, memory_order_relaxed);
+        latch_unlock_shared(&shard->latch);
+        atomic_fetch_add_explicit(&shard->misses, 1, memory_order_relaxed);
+        return false;
+    }
+    if (!atomic_load_explicit(&entry->referenced, memory_order_relaxed)) {
+        atomic_store_explicit(&entry->referenced, 1, memory_order_relaxed);
+    }
+    *length = entry->value_length;
+    if (cap > 0) {
+        size_t copied = *length < cap ? *length : cap - 1;
+        memcpy(buf, entry->data + entry->key_length + 1, copied);
+        buf[copied] = '\0';
+    }
+    latch_unlock_shared(&shard->latch);
+    atomic_fetch_add_explicit(&shard->hits, 1, memory_order_relaxed);
+    return true;
+}
+
+void row_cache_put(RowCache* cache, uint64_t hash, const char* key, const char* value, uint64_t generation) {
+    RowCacheShard* shard = row_cache_shard(cache, hash);
+    size_t key_length = strlen(key);
+    size_t value_length = strlen(value);
+    size_t size = row_cache_entry_size(key_length, value_length);
+    if (size > shard->budget) {
+        return;
+    }
+    RowCacheEntry* entry = malloc(size);
+    if (!entry) {
+        return;
+    }
+    entry->hash = hash;
+    atomic_init(&entry->referenced, 0);
+    entry->key_length = (uint32_t)key_length;
+    entry->value_length = (uint32_t)value_length;
+    memcpy(entry->data, key, key_length + 1);
+    memcpy(entry->data + key_length + 1, value, value_length + 1);
+
+    latch_lock_exclusive(&shard->latch);
+    if (atomic_load_explicit(&shard->generation, memory_order_relaxed) != generation) {
+        latch_unlock_exclusive(&shard->latch); // Read before a write to this shard
+        free(entry);
+        return;
+    }
+    RowCacheEntry** link = row_cache_link(shard, hash, key);
+    if (*link) {
+        row_cache_remove(shard, link);
+    }
+    row_cache_make_room(shard, size);
+    if (shard->count > shard->bucket_mask) {
+        row_cache_grow(shard);
+    }
+    RowCacheEntry** head = &shard->buckets[hash & shard->bucket_mask];
+    entry->next = *head;
+    *head = entry;
+    // Just behind the hand: the last entry it reaches
+    if (shard->hand) {
+        entry->clock_next = shard->hand;
+        entry->clock_prev = shard->hand->clock_prev;
+        entry->clock_prev->clock_next = entry;
+        shard->hand->clock_prev = entry;
+    } else {
+        entry->clock_next = entry;
+        entry->clock_prev = entry;
+        shard->hand = entry;
+    }
+    shard->bytes += size;
+    shard->count++;
+    shard->inserts++;
+    latch_unlock_exclusive(&shard->latch);
+}
+
+void row_cache_invalidate(RowCache* cache, uint64_t hash, const char* key) {
+    RowCacheShard* shard = row_cache_shard(cache, hash);
+    latch_lock_exclusive(&shard->latch);
+    atomic_fetch_add_explicit(&shard->generation, 1, memory_order_relaxed);
+    RowCacheEntry** link = row_cache_link(shard, hash, key);
+    if (*link) {
+        row_cache_remove(shard, link);
+    }
+    shard->invalidations++;
+    latch_unlock_exclusive(&shard->latch);
+}
+
+void row_cache_get_stats(RowCache* cache, RowCacheStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    for (int i = 0; i < ROW_CACHE_SHARDS; i++) {
+        RowCacheShard* shard = &cache->shards[i];
+        latch_lock_shared(&shard->latch);
+        stats->budget_bytes += shard->budget;
+        stats->bytes += shard->bytes;
+        stats->entries += shard->count;
+        stats->inserts += shard->inserts;
+        stats->evictions += shard->evictions;
+        stats->invalidations += shard->invalidations;
+        latch_unlock_shared(&shard->latch);
+        stats->hits += atomic_load_explicit(&shard->hits, memory_order_relaxed);
+        stats->misses += atomic_load_explicit(&shard->misses, memory_order_relaxed);
+    }
+}
@@ -0,0 +1,109 @@
+#ifndef ROW_CACHE_H
+#define ROW_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "latch.h"
+
+/**
+ * Row cache: copies of hot key-value pairs, with a memory budget of its
+ * own, so a hot value costs its own bytes rather than the whole page it
+ * lives in.
+ *
+ * The cache is split into ROW_CACHE_SHARDS shards by key hash, each with
+ * its own latch, table and share of the budget. Lookups take the shard
+ * latch shared and only set a reference bit; inserts, removals and
+ * evictions take it exclusively. Within a shard the victim is chosen by
+ * CLOCK over the entries.
+ *
+ * Writers invalidate a key after changing it. A lookup that misses reads
+ * the shard's generation, which every invalidation bumps; a fill made
+ * with an older generation is dropped, so a value read from the tree
+ * before a write can never be cached after it.
+ */
+
+#define ROW_CACHE_SHARDS 16
+
+typedef struct RowCacheEntry {
+    struct RowCacheEntry* next;        // Next in the bucket chain
+    struct RowCacheEntry* clock_prev;  // CLOCK ring
+    struct RowCacheEntry* clock_next;
+    uint64_t hash;
+    _Atomic uint8_t referenced;
+    uint32_t key_length;
+    uint32_t value_length;
+    char data[];                       // Key, NUL, value, NUL
+} RowCacheEntry;
+
+// One shard. Padded so neighbouring shards never share a cache line.
+typedef union {
+    struct {
+        Latch latch;            // Shared for lookups, exclusive to change the shard
+        RowCacheEntry** buckets;
+        uint32_t bucket_mask;   // Buckets - 1 (a power of two)
+        uint32_t count;
+        RowCacheEntry* hand;    // CLOCK hand, NULL when empty
+        size_t bytes;           // Charged for the entries
+        size_t budget;
+        _Atomic uint64_t generation; // Invalidations so far
+        _Atomic uint64_t hits;
+        _Atomic uint64_t misses;
+        // Changed under the exclusive latch
+        uint64_t inserts;
+        uint64_t evictions;
+        uint64_t invalidations;
+    };
+    uint8_t padding[128];
+} RowCacheShard;
+
+typedef struct {
+    RowCacheShard shards[ROW_CACHE_SHARDS];
+} RowCache;
+
+typedef struct {
+    size_t budget_bytes;
+    size_t bytes;         // Entries and their keys and values
+    uint64_t entries;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t inserts;
+    uint64_t evictions;     // Entries dropped for room
+    uint64_t invalidations; // Keys invalidated by writes, cached or not
+} RowCacheStats;
+
+/**
+ * Create a cache holding up to budget_bytes of entries (split evenly
+ * between the shards).
+ * @return The cache, or NULL on allocation failure
+ */
+RowCache* row_cache_create(size_t budget_bytes);
+
+void row_cache_destroy(RowCache* cache);
+
+/**
+ * Copy the cached value of key into buf, like snprintf.
+ * @param hash key_hash of key
+ * @param length Set to the length of the value on a hit
+ * @param generation Set on a miss; pass it to row_cache_put
+ * @return true on a hit
+ */
+bool row_cache_get(RowCache* cache, uint64_t hash, const char* key, char* buf, size_t cap, size_t* length,
+                   uint64_t* generation);
+
+/**
+ * Cache the value of key read from the tree after a miss, unless the key's
+ * shard was invalidated since (generation from row_cache_get). Replaces
+ * any entry of the key; evicts others to stay within the budget.
+ */
+void row_cache_put(RowCache* cache, uint64_t hash, const char* key, const char* value, uint64_t generation);
+
+/**
+ * Drop key after a write changed it, and stop fills begun before.
+ */
+void row_cache_invalidate(RowCache* cache, uint64_t hash, const char* key);
+
+void row_cache_get_stats(RowCache* cache, RowCacheStats* stats);
+
+#endif // ROW_CACHE_H
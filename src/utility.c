@@ -1,100 +1,120 @@
-#include "utility.h"
-#include <stdio.h>
-#include <string.h>
-#include <ctype.h>
-
-#ifdef _WIN32
-#include <windows.h>
-#endif
-
-// Portable case-insensitive string comparison functions
-#ifdef _WIN32
-// Windows: Provide our own implementations to avoid conflicts with MinGW
-int oktadb_strcasecmp(const char *s1, const char *s2) {
-    if (!s1 || !s2) {
-        if (!s1 && !s2) return 0;
-        return s1 ? 1 : -1;
-    }
-    
-    while (*s1 && *s2) {
-        int diff = tolower((unsigned char)*s1) - tolower((unsigned char)*s2);
-        if (diff != 0) return diff;
-        s1++;
-        s2++;
-    }
-    return tolower((unsigned char)*s1) - tolower((unsigned char)*s2);
-}
-
-int oktadb_strncasecmp(const char *s1, const char *s2, size_t n) {
-    if (n == 0) return 0;
-    if (!s1 || !s2) {
-        if (!s1 && !s2) return 0;
-        return s1 ? 1 : -1;
-    }
-    
-    // Compare up to n characters
-    while (n > 0 && *s1 && *s2) {
-        int diff = tolower((unsigned char)*s1) - tolower((unsigned char)*s2);
-        if (diff != 0) return diff;
-        s1++;
-        s2++;
-        n--;
-    }
-    
-    // If we exhausted all n characters without finding a difference, strings match
-    if (n == 0) return 0;
-    
-    // Otherwise, one string ended before n characters - compare remaining
-    return tolower((unsigned char)*s1) - tolower((unsigned char)*s2);
-}
-#else
-// Unix/Linux has these in strings.h
-#include <strings.h>
-#endif
-
-// Function to print help documentation
-void print_help(void) {
-    printf("OktaDB - A learning database implementation\n");
-    printf("Usage:\n");
-    printf("  INSERT/ADD <key> <value>  - Insert a key-value pair\n");
-    printf("  GET/FETCH <key>           - Retrieve value by key\n");
-    printf("  DELETE <key>              - Delete a key-value pair\n");
-    printf("  UPDATE <key> <value>      - Update a key-value pair\n");
-    printf("  LIST                      - List all keys\n");
-    printf("  HELP                      - Show this help\n");
-    printf("  CLS/CLEAR                 - Clear the screen\n");
-    printf("  EXIT/QUIT/CLOSE           - Exit the program\n");
-}
-
-// Function to clear the screen in a cross-platform way
-void clear_screen(void) {
-#ifdef _WIN32
-    // Windows implementation using Console API
-    HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
-    CONSOLE_SCREEN_BUFFER_INFO csbi;
-    DWORD count;
-    DWORD cellCount;
-    COORD homeCoords = { 0, 0 };
-
-    // Early return if we can't get the console handle
-    if (hConsole == INVALID_HANDLE_VALUE) return;
-
-    // Get the number of cells (characters) in the current console buffer
-    if (!GetConsoleScreenBufferInfo(hConsole, &csbi)) return;
-    cellCount = csbi.dwSize.X * csbi.dwSize.Y;
-
-    // Fill the entire buffer with spaces to clear visible content
-    if (!FillConsoleOutputCharacter(hConsole, (TCHAR)' ', cellCount, homeCoords, &count)) return;
-
-    // Restore the original colors and attributes across the entire buffer
-    if (!FillConsoleOutputAttribute(hConsole, csbi.wAttributes, cellCount, homeCoords, &count)) return;
-
-    // Move the cursor back to the top-left corner (home position)
-    SetConsoleCursorPosition(hConsole, homeCoords);
-#else
-    // Unix/Linux/Mac - use ANSI escape codes
-    // \033[2J clears the screen, \033[H moves cursor to home
-    printf("\033[2J\033[H");
-    fflush(stdout);
-#endif
-}
+#include "utility.h"
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Portable case-insensitive string comparison functions
+#ifdef _WIN32
+// Windows: Provide our own implementations to avoid conflicts with MinGW
+int oktadb_strcasecmp(const char *s1, const char *s2) {
+    if (!s1 || !s2) {
+        if (!s1 && !s2) return 0;
+        return s1 ? 1 : -1;
+    }
+    
+    while (*s1 && *s2) {
+        int diff = tolower((unsigned char)*s1) - tolower((unsigned char)*s2);
+        if (diff != 0) return diff;
+        s1++;
+        s2++;
+    }
+    return tolower((unsigned char)*s1) - tolower((unsigned char)*s2);
+}
+
+int oktadb_strncasecmp(const char *s1, const char *s2, size_t n) {
+    if (n == 0) return 0;
+    if (!s1 || !s2) {
+        if (!s1 && !s2) return 0;
+        return s1 ? 1 : -1;
+    }
+    
+    // Compare up to n characters
+    while (n > 0 && *s1 && *s2) {
+        int diff = tolower((unsigned char)*s1) - tolower((unsigned char)*s2);
+        if (diff != 0) return diff;
+        s1++;
+        s2++;
+        n--;
+    }
+    
+    // If we exhausted all n characters without finding a difference, strings match
+    if (n == 0) return 0;
+    
+    // Otherwise, one string ended before n characters - compare remaining
+    return tolower((unsigned char)*s1) - tolower((unsigned char)*s2);
+}
+#else
+// Unix/Linux has these in strings.h
+#include <strings.h>
+#endif
+
+// Function to print help documentation
+void print_help(void) {
+    printf("OktaDB - A learning database implementation\n");
+    printf("Usage:\n");
+    printf("  INSERT/ADD <key> <value>  - Insert a key-value pair\n");
+    printf("  GET/FETCH <key>           - Retrieve value by key\n");
+    printf("  DELETE <key>              - Delete a key-value pair\n");
+    printf("  UPDATE <key> <value>      - Update a key-value pair\n");
+    printf("  LIST                      - List all keys\n");
+    printf("  INCR <key> [delta]        - Add delta (default 1) to an integer value\n");
+    printf("  APPEND <key> <suffix>     - Append to a value\n");
+    printf("  CAS <key> <expected> <value> - Replace a value only if it is still expected\n");
+    printf("  EXPIRE <key> <seconds>    - Delete a record once seconds have passed\n");
+    printf("  PERSIST <key>             - Keep a record that was set to expire\n");
+    printf("  TTL <key>                 - Show the seconds a record has left\n");
+    printf("  COUNT [<low> <high>]      - Count the records, or those with keys in [low, high)\n");
+    printf("  RANK <n>                  - Show the record at position n (0 = first) in key order\n");
+    printf("  FILL                      - Show how full the tree's pages are\n");
+    printf("  BLOOM                     - Show the Bloom filter's size and false positives\n");
+    printf("  STATS                     - Show page cache and row cache hit rates and the last analysis\n");
+    printf("  ANALYZE [SAMPLE <n>] [THREADS <n>] - Measure tree shape, leaf fill, key sizes, free pages and WAL size\n");
+    printf("  CREATE TABLE <name> [type] - Create a named table (type u64, i64 or binary:<width>)\n");
+    printf("  DROP TABLE <name>         - Drop a named table and its records\n");
+    printf("  TABLES                    - List the named tables\n");
+    printf("  USE [<name>]              - Work on a named table, or the default one\n");
+    printf("  CREATE INDEX <name> [FIELD <n> SPLIT <c>] - Index the values (or their n-th field split at c) of the current table\n");
+    printf("  DROP INDEX <name>         - Drop a secondary index\n");
+    printf("  FIND <index> <value>      - List the records whose indexed field is value\n");
+    printf("  FIND <index> <low> <high> - List the records whose indexed field is in [low, high)\n");
+    printf("  HELP                      - Show this help\n");
+    printf("  CLS/CLEAR                 - Clear the screen\n");
+    printf("  EXIT/QUIT/CLOSE           - Exit the program\n");
+}
+
+// Function to clear the screen in a cross-platform way
+void clear_screen(void) {
+#ifdef _WIN32
+    // Windows implementation using Console API
+    HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
+    CONSOLE_SCREEN_BUFFER_INFO csbi;
+    DWORD count;
+    DWORD cellCount;
+    COORD homeCoords = { 0, 0 };
+
+    // Early return if we can't get the console handle
+    if (hConsole == INVALID_HANDLE_VALUE) return;
+
+    // Get the number of cells (characters) in the current console buffer
+    if (!GetConsoleScreenBufferInfo(hConsole, &csbi)) return;
+    cellCount = csbi.dwSize.X * csbi.dwSize.Y;
+
+    // Fill the entire buffer with spaces to clear visible content
+    if (!FillConsoleOutputCharacter(hConsole, (TCHAR)' ', cellCount, homeCoords, &count)) return;
+
+    // Restore the original colors and attributes across the entire buffer
+    if (!FillConsoleOutputAttribute(hConsole, csbi.wAttributes, cellCount, homeCoords, &count)) return;
+
+    // Move the cursor back to the top-left corner (home position)
+    SetConsoleCursorPosition(hConsole, homeCoords);
+#else
+    // Unix/Linux/Mac - use ANSI escape codes
+    // \033[2J clears the screen, \033[H moves cursor to home
+    printf("\033[2J\033[H");
+    fflush(stdout);
+#endif
+}
@@ -11,7 +11,8 @@ typedef enum {
     STATUS_NOT_FOUND = -2,   // Key not found
     STATUS_EXISTS = -3,      // Key already exists (consolidated from STATUS_DUPLICATE)
     STATUS_FULL = -4,        // Database is full
-    STATUS_NOT_IMPLEMENTED = -5 // Feature not yet implemented
+    STATUS_NOT_IMPLEMENTED = -5, // Feature not yet implemented
+    STATUS_CONFLICT = -6     // Compare-and-swap found another value
 } Status;
 
 // Centralized constants
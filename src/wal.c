@@ -1,3 +1,6 @@
+#ifndef _WIN32
+#define _GNU_SOURCE // ftruncate
+#endif
 #include "wal.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -6,6 +9,43 @@
 #include <sys/stat.h>
 #include <errno.h>
 
+// Index the frames already present in the log (left over from a crash)
+static void wal_build_index(WAL* wal) {
+    off_t size = lseek(wal->fd, 0, SEEK_END);
+    if (size <= 0) {
+        return;
+    }
+    // A torn frame at the tail is ignored, and so are the frames of a
+    // transaction whose last frame never made it
+    uint32_t complete_frames = (uint32_t)(size / WAL_FRAME_SIZE);
+    uint32_t committed_frames = 0;
+    WalFrameHeader header;
+    for (uint32_t frame = 0; frame < complete_frames; frame++) {
+        if (lseek(wal->fd, (off_t)frame * WAL_FRAME_SIZE, SEEK_SET) == -1 ||
+            read(wal->fd, &header, sizeof(header)) != sizeof(header)) {
+            break;
+        }
+        if (!(header.page_num & WAL_FRAME_MORE)) {
+            committed_frames = frame + 1;
+        }
+    }
+    for (uint32_t frame = 0; frame < committed_frames; frame++) {
+        if (lseek(wal->fd, (off_t)frame * WAL_FRAME_SIZE, SEEK_SET) == -1 ||
+            read(wal->fd, &header, sizeof(header)) != sizeof(header)) {
+            break;
+        }
+        if ((header.page_num & ~WAL_FRAME_MORE) != WAL_FRAME_OPERANDS) {
+            page_table_put(&wal->index, header.page_num & ~WAL_FRAME_MORE, frame);
+        }
+        wal->num_frames = frame + 1;
+    }
+    // New frames go right after the committed ones
+    off_t committed_size = (off_t)wal->num_frames * (off_t)WAL_FRAME_SIZE;
+    if (committed_size < size && ftruncate(wal->fd, committed_size) != 0) {
+        fprintf(stderr, "Warning: Failed to drop the uncommitted tail of %s\n", wal->filename);
+    }
+}
+
 WAL* wal_open(const char* db_filename) {
     if (!db_filename || strlen(db_filename) == 0) {
         fprintf(stderr, "Error: Invalid database filename for WAL\n");
@@ -30,6 +70,23 @@ WAL* wal_open(const char* db_filename) {
         free(wal);
         return NULL;
     }
+
+    wal->num_frames = 0;
+    wal->in_txn = false;
+    wal->held = false;
+    wal->held_data = malloc(PAGE_SIZE);
+    wal->operands = calloc(1, PAGE_SIZE);
+    wal->operands_used = 0;
+    wal->operands_logged = 0;
+    atomic_init(&wal->operands_synced, 0);
+    if (!wal->held_data || !wal->operands || page_table_init(&wal->index, 64) != 0) {
+        close(wal->fd);
+        free(wal->held_data);
+        free(wal->operands);
+        free(wal);
+        return NULL;
+    }
+    wal_build_index(wal);
     
     return wal;
 }
@@ -37,6 +94,9 @@ WAL* wal_open(const char* db_filename) {
 void wal_close(WAL* wal) {
     if (wal) {
         close(wal->fd);
+        page_table_free(&wal->index);
+        free(wal->held_data);
+        free(wal->operands);
         free(wal);
     }
 }
@@ -86,6 +146,45 @@ uint32_t calculate_checksum(void* data, size_t len) {
     return crc ^ 0xFFFFFFFF;
 }
 
+// Append one frame without syncing it
+static int wal_append_frame(WAL* wal, uint32_t page_num, const void* data) {
+    WalFrameHeader header;
+    header.page_num = page_num;
+    header.checksum = calculate_checksum((void*)data, PAGE_SIZE);
+    
+    if (write(wal->fd, &header, sizeof(header)) != sizeof(header)) {
+        return -1;
+    }
+    
+    if (write(wal->fd, data, PAGE_SIZE) != PAGE_SIZE) {
+        return -1;
+    }
+    wal->num_frames++;
+    return 0;
+}
+
+// Append one frame; flags is 0 or WAL_FRAME_MORE. Synced unless more
+// frames of its transaction follow.
+static int wal_write_frame(WAL* wal, uint32_t page_num, uint32_t flags, const void* data) {
+    if (wal_append_frame(wal, page_num | flags, data) != 0) {
+        return -1;
+    }
+    if (!flags && fsync(wal->fd) != 0) {
+        fprintf(stderr, "Error: Failed to sync WAL: %d\n", errno);
+        return -1;
+    }
+    return 0;
+}
+
+// Raise operands_synced to through (syncs may finish out of order)
+static void wal_mark_synced(WAL* wal, uint64_t through) {
+    uint64_t synced = atomic_load_explicit(&wal->operands_synced, memory_order_relaxed);
+    while (synced < through &&
+           !atomic_compare_exchange_weak_explicit(&wal->operands_synced, &synced, through, memory_order_release,
+                                                  memory_order_relaxed)) {
+    }
+}
+
 int wal_log_page(WAL* wal, uint32_t page_num, void* data) {
     if (!wal) {
         fprintf(stderr, "Error: WAL is NULL\n");
@@ -95,27 +194,218 @@ int wal_log_page(WAL* wal, uint32_t page_num, void* data) {
         fprintf(stderr, "Error: Cannot log NULL page data\n");
         return -1;
     }
+    if (page_num >= WAL_FRAME_OPERANDS) {
+        fprintf(stderr, "Error: Page %u is beyond what the WAL can log\n", page_num);
+        return -1;
+    }
 
-    WalFrameHeader header;
-    header.page_num = page_num;
-    header.checksum = calculate_checksum(data, PAGE_SIZE);
-    
-    if (write(wal->fd, &header, sizeof(header)) != sizeof(header)) {
+    if (!wal->in_txn) {
+        if (wal_write_frame(wal, page_num, 0, data) != 0) {
+            return -1;
+        }
+        page_table_put(&wal->index, page_num, wal->num_frames - 1);
+        return 0;
+    }
+    // In a transaction the page before this one is not the last after all
+    if (wal->held && wal_write_frame(wal, wal->held_page_num, WAL_FRAME_MORE, wal->held_data) != 0) {
         return -1;
     }
-    
-    if (write(wal->fd, data, PAGE_SIZE) != PAGE_SIZE) {
+    memcpy(wal->held_data, data, PAGE_SIZE);
+    wal->held_page_num = page_num;
+    wal->held = true;
+    page_table_put(&wal->index, page_num, wal->num_frames);
+    return 0;
+}
+
+int wal_begin(WAL* wal) {
+    if (!wal || wal->in_txn) {
+        fprintf(stderr, "Error: WAL transaction already open\n");
         return -1;
     }
-    
-    
+    wal->in_txn = true;
+    wal->txn_first_frame = wal->num_frames;
+    return 0;
+}
+
+int wal_commit(WAL* wal) {
+    if (!wal || !wal->in_txn) {
+        fprintf(stderr, "Error: No WAL transaction to commit\n");
+        return -1;
+    }
+    int result = 0;
+    if (wal->held) {
+        result = wal_write_frame(wal, wal->held_page_num, 0, wal->held_data);
+        wal->held = false;
+    }
+    wal->in_txn = false;
+    if (result == 0) {
+        // The operands not yet written are in the pages just committed
+        memset(wal->operands, 0, wal->operands_used);
+        wal->operands_used = 0;
+        wal_mark_synced(wal, wal->operands_logged);
+    }
+    return result;
+}
+
+int wal_abort(WAL* wal, PageTable* pages) {
+    if (!wal || !wal->in_txn) {
+        fprintf(stderr, "Error: No WAL transaction to abort\n");
+        return -1;
+    }
+    if (wal->num_frames == wal->txn_first_frame && !wal->held) {
+        wal->in_txn = false; // Nothing logged
+        return 0;
+    }
+    // The held page is indexed at num_frames, past the frames written
+    for (uint32_t i = 0; i < wal->index.capacity; i++) {
+        if (wal->index.used[i] && wal->index.values[i] >= wal->txn_first_frame &&
+            page_table_put(pages, wal->index.keys[i], 0) != 0) {
+            return -1;
+        }
+    }
+    if (ftruncate(wal->fd, (off_t)wal->txn_first_frame * (off_t)WAL_FRAME_SIZE) != 0) {
+        // Left open, so no later commit makes the frames count
+        fprintf(stderr, "Error: Failed to drop an aborted transaction from %s: %d\n", wal->filename, errno);
+        return -1;
+    }
+    wal->held = false;
+    wal->in_txn = false;
+    // Index the frames left: the pages logged since wal_begin go back to
+    // their earlier frames, or to the DB file
+    page_table_clear(&wal->index);
+    wal->num_frames = 0;
+    wal_build_index(wal);
+    return 0;
+}
+
+// Write the open operand frame and start an empty one
+static int wal_write_operands(WAL* wal) {
+    if (wal->operands_used == 0) {
+        return 0;
+    }
+    if (wal_append_frame(wal, WAL_FRAME_OPERANDS, wal->operands) != 0) {
+        fprintf(stderr, "Error: Failed to write WAL operand frame: %d\n", errno);
+        return -1;
+    }
+    memset(wal->operands, 0, wal->operands_used);
+    wal->operands_used = 0;
+    return 0;
+}
+
+int wal_append_operand(WAL* wal, const void* record, uint32_t length, uint64_t* seq) {
+    if (!wal || !record || length == 0 || length > WAL_OPERAND_MAX || wal->in_txn) {
+        fprintf(stderr, "Error: Cannot log operands here\n");
+        return -1;
+    }
+    // Each operand is its 16-bit length, then its bytes; a length of 0 (or
+    // no room for one) ends the frame
+    if (wal->operands_used + sizeof(uint16_t) + length > PAGE_SIZE && wal_write_operands(wal) != 0) {
+        return -1;
+    }
+    uint16_t prefix = (uint16_t)length;
+    memcpy(wal->operands + wal->operands_used, &prefix, sizeof(prefix));
+    memcpy(wal->operands + wal->operands_used + sizeof(prefix), record, length);
+    wal->operands_used += sizeof(prefix) + length;
+    *seq = ++wal->operands_logged;
+    return 0;
+}
+
+int wal_flush_operands(WAL* wal, uint64_t* through) {
+    if (!wal || wal->in_txn) {
+        fprintf(stderr, "Error: Cannot write operands in a transaction\n");
+        return -1;
+    }
+    *through = wal->operands_logged;
+    return wal_write_operands(wal);
+}
+
+int wal_sync_operands(WAL* wal, uint64_t through) {
     if (fsync(wal->fd) != 0) {
         fprintf(stderr, "Error: Failed to sync WAL: %d\n", errno);
         return -1;
     }
+    wal_mark_synced(wal, through);
     return 0;
 }
 
+uint64_t wal_operands_synced(WAL* wal) {
+    return atomic_load_explicit(&wal->operands_synced, memory_order_acquire);
+}
+
+int wal_read_operands(WAL* wal, int (*fn)(const void* record, uint32_t length, void* arg), void* arg) {
+    if (!wal || !fn) {
+        return -1;
+    }
+    // Operands before the last page frame were merged by then
+    WalFrameHeader header;
+    uint32_t first = 0;
+    for (uint32_t frame = 0; frame < wal->num_frames; frame++) {
+        if (lseek(wal->fd, (off_t)frame * WAL_FRAME_SIZE, SEEK_SET) == -1 ||
+            read(wal->fd, &header, sizeof(header)) != sizeof(header)) {
+            return -1;
+        }
+        if ((header.page_num & ~WAL_FRAME_MORE) != WAL_FRAME_OPERANDS) {
+            first = frame + 1;
+        }
+    }
+    uint8_t* data = malloc(PAGE_SIZE);
+    if (!data) {
+        return -1;
+    }
+    int passed = 0;
+    for (uint32_t frame = first; frame < wal->num_frames; frame++) {
+        if (lseek(wal->fd, (off_t)frame * WAL_FRAME_SIZE, SEEK_SET) == -1 ||
+            read(wal->fd, &header, sizeof(header)) != sizeof(header) ||
+            read(wal->fd, data, PAGE_SIZE) != PAGE_SIZE || calculate_checksum(data, PAGE_SIZE) != header.checksum) {
+            fprintf(stderr, "Corrupt WAL operand frame %u\n", frame);
+            free(data);
+            return -1;
+        }
+        uint32_t offset = 0;
+        uint16_t length;
+        while (offset + sizeof(length) <= PAGE_SIZE) {
+            memcpy(&length, data + offset, sizeof(length));
+            offset += sizeof(length);
+            if (length == 0 || offset + length > PAGE_SIZE) {
+                break;
+            }
+            passed++;
+            if (fn(data + offset, length, arg) != 0) {
+                free(data);
+                return passed;
+            }
+            offset += length;
+        }
+    }
+    free(data);
+    return passed;
+}
+
+int wal_read_page(WAL* wal, uint32_t page_num, void* data) {
+    uint32_t frame;
+    if (!page_table_get(&wal->index, page_num, &frame)) {
+        return 0;
+    }
+
+    if (wal->held && frame == wal->num_frames) {
+        memcpy(data, wal->held_data, PAGE_SIZE); // Not written yet
+        return 1;
+    }
+
+    WalFrameHeader header;
+    if (lseek(wal->fd, (off_t)frame * WAL_FRAME_SIZE, SEEK_SET) == -1 ||
+        read(wal->fd, &header, sizeof(header)) != sizeof(header) ||
+        read(wal->fd, data, PAGE_SIZE) != PAGE_SIZE) {
+        fprintf(stderr, "Error reading WAL frame %u for page %u\n", frame, page_num);
+        return -1;
+    }
+    if ((header.page_num & ~WAL_FRAME_MORE) != page_num || calculate_checksum(data, PAGE_SIZE) != header.checksum) {
+        fprintf(stderr, "Corrupt WAL frame %u for page %u\n", frame, page_num);
+        return -1;
+    }
+    return 1;
+}
+
 int wal_checkpoint(WAL* wal, Pager* pager) {
     if (!wal || !pager) {
         fprintf(stderr, "Error: NULL parameters in wal_checkpoint\n");
@@ -132,7 +422,9 @@ int wal_checkpoint(WAL* wal, Pager* pager) {
         return -1;
     }
     
-    while (read(wal->fd, &header, sizeof(header)) == sizeof(header)) {
+    // Frames after num_frames belong to a transaction that never committed
+    for (uint32_t frame = 0; frame < wal->num_frames && read(wal->fd, &header, sizeof(header)) == sizeof(header);
+         frame++) {
         ssize_t bytes_read = read(wal->fd, buffer, PAGE_SIZE);  
         if (bytes_read != PAGE_SIZE) {  
             if (bytes_read > 0) {  
@@ -151,8 +443,12 @@ int wal_checkpoint(WAL* wal, Pager* pager) {
             return -1;
         }
         
+        if ((header.page_num & ~WAL_FRAME_MORE) == WAL_FRAME_OPERANDS) {
+            continue;
+        }
+
         // Write to DB using pager's direct write API
-        if (pager_write_page_direct(pager, header.page_num, buffer) != 0) {
+        if (pager_write_page_direct(pager, header.page_num & ~WAL_FRAME_MORE, buffer) != 0) {
             fprintf(stderr, "Failed to write page in checkpoint\n");
             free(buffer);
             return -1;
@@ -169,7 +465,7 @@ int wal_checkpoint(WAL* wal, Pager* pager) {
     
     // Truncate WAL - save old fd in case reopen fails
     int old_fd = wal->fd;
-    int new_fd = open(wal->filename, O_RDWR | O_CREAT | O_TRUNC, S_IWUSR | S_IRUSR);
+    int new_fd = open(wal->filename, O_RDWR | O_CREAT | O_TRUNC | O_APPEND, S_IWUSR | S_IRUSR);
     if (new_fd == -1) {
         fprintf(stderr, "Failed to truncate WAL file\n");
         // Keep old fd valid - don't close it since we couldn't get a new one.
@@ -180,6 +476,8 @@ int wal_checkpoint(WAL* wal, Pager* pager) {
     // Successfully opened new truncated file, close the old one
     close(old_fd);
     wal->fd = new_fd;
+    page_table_clear(&wal->index);
+    wal->num_frames = 0;
     
     return 0;
 }
\ No newline at end of file
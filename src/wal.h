@@ -38,26 +38,58 @@
 #define S_IRUSR _S_IREAD
 #endif
 #define fsync _commit
+#define ftruncate _chsize
 #else
 #include <unistd.h>
 #endif
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 #include "pager.h"
+#include "page_table.h"
 
 typedef struct WAL WAL;
 
 // WAL Frame Header
 typedef struct {
-    uint32_t page_num;
+    uint32_t page_num; // With WAL_FRAME_MORE on all but the last frame of a transaction
     uint32_t checksum; // Simple checksum for now
 } WalFrameHeader;
 
+// Set in a frame's page_num when more frames of its transaction follow.
+// Recovery applies a transaction only once its last frame (the one
+// without the flag) is in the log, so the pages of one write reach the
+// database file together or not at all.
+#define WAL_FRAME_MORE 0x80000000u
+
+// Page number of a frame that holds operands of deferred merges instead of
+// a page (see wal_append_operand); no page has this number
+#define WAL_FRAME_OPERANDS 0x7FFFFFFFu
+
 struct WAL {
     int fd;
     char filename[256];
+    uint32_t num_frames; // Frames currently in the log
+    PageTable index;     // page_num -> latest frame holding that page
+    // Transaction (wal_begin): the last page logged is held back until
+    // wal_commit writes it as the closing frame. Its frame number is
+    // num_frames.
+    bool in_txn;
+    uint32_t txn_first_frame; // num_frames at wal_begin, for wal_abort
+    bool held;
+    uint32_t held_page_num;
+    uint8_t* held_data; // PAGE_SIZE bytes
+    // Operands of deferred merges (wal_append_operand) gather in a frame
+    // written once it is full or on wal_flush_operands, so one frame and
+    // one sync serve all the operands logged meanwhile
+    uint8_t* operands;                // PAGE_SIZE bytes
+    uint32_t operands_used;           // Bytes of it taken
+    uint64_t operands_logged;         // Operands appended so far
+    _Atomic uint64_t operands_synced; // Operands known to be durable
 };
 
+#define WAL_FRAME_SIZE (sizeof(WalFrameHeader) + PAGE_SIZE)
+
 /**
  * Open the WAL for a given database file.
  * The WAL file will be named "<db_filename>.wal".
@@ -78,6 +110,84 @@ void wal_close(WAL* wal);
  */
 int wal_log_page(WAL* wal, uint32_t page_num, void* data);
 
+/**
+ * Begin a transaction: pages logged until wal_commit are applied by
+ * recovery all together or not at all, and are synced once, at commit,
+ * instead of page by page.
+ * @return 0 on success, -1 on error (a transaction is already open)
+ */
+int wal_begin(WAL* wal);
+
+/**
+ * Commit the open transaction: write its last page and sync the log. The
+ * transaction is taken to have folded the operands appended before it:
+ * the open operand frame is dropped and they count as durable.
+ * @return 0 on success, -1 on error
+ */
+int wal_commit(WAL* wal);
+
+/**
+ * Abort the open transaction: drop the frames it logged, so the log and
+ * its index are as they were at wal_begin.
+ * @param pages Receives the numbers of the pages the transaction logged
+ *              (value 0), whose cached images are now stale
+ * @return 0 on success, -1 on error
+ */
+int wal_abort(WAL* wal, PageTable* pages);
+
+/**
+ * Append one operand of a deferred merge (length bytes whose layout is up
+ * to the caller, at most WAL_OPERAND_MAX) to the open operand frame,
+ * writing the frame first if it is full. Nothing is synced: see
+ * wal_sync_operands. Not in a transaction. Checkpoints skip operand
+ * frames: the pages the operands are later merged into are logged as
+ * usual, and the transaction that does so drops the open frame.
+ * @param seq Receives the operand's number, for wal_sync_operands
+ * @return 0 on success, -1 on error
+ */
+int wal_append_operand(WAL* wal, const void* record, uint32_t length, uint64_t* seq);
+
+// Largest operand wal_append_operand takes: a frame less its length prefix
+#define WAL_OPERAND_MAX (PAGE_SIZE - sizeof(uint16_t))
+
+/**
+ * Write the open operand frame, if it holds any. Not in a transaction.
+ * @param through Receives the number of the last operand logged: all of
+ *                them are written or committed once this returns
+ * @return 0 on success, -1 on error
+ */
+int wal_flush_operands(WAL* wal, uint64_t* through);
+
+/**
+ * Sync the log after wal_flush_operands, so the operands up to through
+ * are durable. Only syncs the file, so appends may go on meanwhile.
+ * @return 0 on success, -1 on error
+ */
+int wal_sync_operands(WAL* wal, uint64_t through);
+
+/**
+ * Number of the last operand known to be durable: synced by
+ * wal_sync_operands or folded by a committed transaction.
+ */
+uint64_t wal_operands_synced(WAL* wal);
+
+/**
+ * Call fn with each operand logged after the last page frame, in log
+ * order: the operands no page holds yet. For recovery, before the
+ * checkpoint drops them.
+ * @return Number of operands passed to fn, or -1 on error
+ */
+int wal_read_operands(WAL* wal, int (*fn)(const void* record, uint32_t length, void* arg), void* arg);
+
+/**
+ * Read the most recent logged image of a page.
+ * Used by the pager when a page that was evicted is needed again before
+ * the WAL has been checkpointed.
+ * @return 1 if the page was found and read into data, 0 if the page has
+ *         no frame in the WAL, -1 on error
+ */
+int wal_read_page(WAL* wal, uint32_t page_num, void* data);
+
 /**
  * Checkpoint the WAL.
  * Moves all frames from WAL to the main database file.
@@ -4,6 +4,10 @@
 #include <assert.h>
 #include "../src/btree.h"
 #include "../src/pager.h"
+#include "../src/key_head.h"
+
+#define MAX_TEST_KEY 128
+#define TEST_FANOUT_KEYS 20000
 
 void test_btree_insert_find() {
     printf("Testing btree_insert and btree_find...\n");
@@ -130,9 +134,284 @@ void test_cursor_advance_single_leaf() {
     printf("Passed!\n");
 }
 
+/**
+ * Test table_find_into() with a stack-allocated cursor.
+ */
+void test_table_find_into() {
+    printf("Testing table_find_into with a stack cursor...\n");
+
+    const char* db_file = "test_find_into.db";
+    remove(db_file);
+    remove("test_find_into.db.wal");
+
+    Pager* pager = pager_open(db_file);
+    assert(pager != NULL);
+
+    void* root_node = pager_get_page(pager, 0);
+    leaf_node_init(root_node);
+    set_node_root(root_node, true);
+
+    Cursor cursor;
+    assert(table_find_into(pager, 0, "beta", &cursor) == 0);
+    leaf_node_insert(&cursor, "beta", "2");
+    assert(table_find_into(pager, 0, "alpha", &cursor) == 0);
+    leaf_node_insert(&cursor, "alpha", "1");
+
+    assert(table_find_into(pager, 0, "alpha", &cursor) == 0);
+    assert(cursor.cell_num == 0);
+    assert(strcmp((char*)cursor_value(&cursor), "1") == 0);
+
+    assert(table_find_into(pager, 0, "beta", &cursor) == 0);
+    assert(cursor.cell_num == 1);
+    assert(strcmp((char*)cursor_value(&cursor), "2") == 0);
+
+    // Missing key positions the cursor at its insertion point
+    assert(table_find_into(pager, 0, "gamma", &cursor) == 0);
+    assert(cursor.cell_num == 2);
+
+    pager_close(pager);
+    remove(db_file);
+    remove("test_find_into.db.wal");
+
+    printf("Passed!\n");
+}
+
+// Insert keys[0..count) into a fresh tree and check lookups and a full scan
+static Pager* build_and_check_tree(const char* db_file, char (*keys)[MAX_TEST_KEY], int count) {
+    remove(db_file);
+    Pager* pager = pager_open(db_file);
+    assert(pager != NULL);
+    void* root_node = pager_get_page(pager, 0);
+    leaf_node_init(root_node);
+    set_node_root(root_node, true);
+
+    Cursor cursor;
+    for (int i = 0; i < count; i++) {
+        assert(table_find_into(pager, 0, keys[i], &cursor) == 0);
+        leaf_node_insert(&cursor, keys[i], keys[i] + strlen(keys[i]) - 8);
+    }
+    for (int i = 0; i < count; i++) {
+        assert(table_find_into(pager, 0, keys[i], &cursor) == 0);
+        char* value = (char*)cursor_value(&cursor);
+        assert(value != NULL && strcmp(value, keys[i] + strlen(keys[i]) - 8) == 0);
+    }
+
+    // A scan returns every key in order
+    Cursor* scan = table_start(pager, 0);
+    assert(scan != NULL);
+    int scanned = 0;
+    char previous[MAX_TEST_KEY] = "";
+    while (!scan->end_of_table) {
+        void* leaf = pager_get_page(pager, scan->page_num);
+        char* key = leaf_node_key(leaf, scan->cell_num);
+        assert(strcmp(previous, key) < 0);
+        strcpy(previous, key);
+        scanned++;
+        cursor_advance(scan);
+    }
+    free(scan);
+    assert(scanned == count);
+    return pager;
+}
+
+static uint32_t tree_height(Pager* pager) {
+    uint32_t height = 1;
+    void* node = pager_get_page(pager, 0);
+    while (get_node_type(node) == NODE_INTERNAL) {
+        node = pager_get_page(pager, *internal_node_child(node, 0));
+        height++;
+    }
+    return height;
+}
+
+static void shuffle_keys(char (*keys)[MAX_TEST_KEY], int count) {
+    unsigned int seed = 7;
+    char tmp[MAX_TEST_KEY];
+    for (int i = count - 1; i > 0; i--) {
+        seed = seed * 1103515245u + 12345u;
+        int j = (int)((seed >> 8) % (unsigned int)(i + 1));
+        memcpy(tmp, keys[i], MAX_TEST_KEY);
+        memcpy(keys[i], keys[j], MAX_TEST_KEY);
+        memcpy(keys[j], tmp, MAX_TEST_KEY);
+    }
+}
+
+void test_internal_node_fanout() {
+    printf("Testing internal node splits and fanout...\n");
+    const char* db_file = "test_fanout.db";
+    static char keys[TEST_FANOUT_KEYS][MAX_TEST_KEY];
+
+    // Short keys with a shared prefix: separators shrink to a byte or two
+    for (int i = 0; i < TEST_FANOUT_KEYS; i++) {
+        snprintf(keys[i], MAX_TEST_KEY, "user:%08d", i);
+    }
+    shuffle_keys(keys, TEST_FANOUT_KEYS);
+    Pager* pager = build_and_check_tree(db_file, keys, TEST_FANOUT_KEYS);
+    void* root = pager_get_page(pager, 0);
+    assert(get_node_type(root) == NODE_INTERNAL);
+    // Thousands of leaves under a root that fits a few hundred children
+    assert(tree_height(pager) == 3);
+    void* child = pager_get_page(pager, *internal_node_child(root, 0));
+    assert(*internal_node_num_keys(child) >= 100);
+    char separator[INTERNAL_NODE_KEY_SIZE];
+    assert(internal_node_key_copy(root, 0, separator) <= strlen("user:00000000"));
+    assert(strncmp(separator, "user:", 5) == 0);
+    // The cursor records the internal pages it passed, root first
+    Cursor cursor;
+    assert(table_find_into(pager, 0, keys[123], &cursor) == 0);
+    assert(cursor.path_depth == tree_height(pager) - 1 && cursor.path[0] == 0);
+    for (uint32_t level = 0; level < cursor.path_depth; level++) {
+        void* node = pager_get_page(pager, cursor.path[level]);
+        uint32_t below = level + 1 < cursor.path_depth ? cursor.path[level + 1] : cursor.page_num;
+        assert(*internal_node_child(node, internal_node_find_child(node, keys[123])) == below);
+    }
+    pager_close(pager);
+
+    // Long keys that differ early: long separators, splits by bytes
+    for (int i = 0; i < TEST_FANOUT_KEYS / 4; i++) {
+        snprintf(keys[i], MAX_TEST_KEY, "%08x%0100d%08d", (unsigned int)i * 2654435761u, 0, i);
+    }
+    pager = build_and_check_tree(db_file, keys, TEST_FANOUT_KEYS / 4);
+    assert(tree_height(pager) >= 3);
+    pager_close(pager);
+
+    // Long shared prefix, sequential order
+    for (int i = 0; i < TEST_FANOUT_KEYS / 4; i++) {
+        snprintf(keys[i], MAX_TEST_KEY, "%0110d%08d", 0, i);
+    }
+    pager = build_and_check_tree(db_file, keys, TEST_FANOUT_KEYS / 4);
+    pager_close(pager);
+
+    remove(db_file);
+    printf("Passed!\n");
+}
+
+void test_sequential_split_fill() {
+    printf("Testing split policy fill factors...\n");
+    const char* db_file = "test_split_fill.db";
+    static char keys[TEST_FANOUT_KEYS][MAX_TEST_KEY];
+    for (int i = 0; i < TEST_FANOUT_KEYS; i++) {
+        snprintf(keys[i], MAX_TEST_KEY, "event:%08d", i);
+    }
+
+    // Ascending keys leave every page behind the insert point full
+    Pager* pager = build_and_check_tree(db_file, keys, TEST_FANOUT_KEYS);
+    BTreeFillStats stats;
+    assert(btree_fill_stats(pager, 0, &stats) == 0);
+    assert(stats.cells == TEST_FANOUT_KEYS);
+    assert(stats.leaf_pages == (TEST_FANOUT_KEYS + LEAF_NODE_MAX_CELLS - 1) / LEAF_NODE_MAX_CELLS);
+    assert(stats.internal_pages > 1 && stats.depth == 3);
+    printf("  Sequential: %u leaves, %u internal, %.1f%% / %.1f%% full\n", stats.leaf_pages, stats.internal_pages,
+           100.0 * stats.cells / (stats.leaf_pages * LEAF_NODE_MAX_CELLS),
+           100.0 * stats.internal_bytes / ((double)stats.internal_pages * PAGE_USABLE_SIZE));
+    // All internal nodes but the rightmost of each level are full
+    assert(stats.internal_bytes * 10 >= (uint64_t)(stats.internal_pages - 2) * PAGE_USABLE_SIZE * 9);
+    pager_close(pager);
+
+    // Random order still splits in the middle
+    shuffle_keys(keys, TEST_FANOUT_KEYS);
+    pager = build_and_check_tree(db_file, keys, TEST_FANOUT_KEYS);
+    assert(btree_fill_stats(pager, 0, &stats) == 0);
+    assert(stats.cells == TEST_FANOUT_KEYS);
+    printf("  Random:     %u leaves, %.1f%% full\n", stats.leaf_pages,
+           100.0 * stats.cells / (stats.leaf_pages * LEAF_NODE_MAX_CELLS));
+    assert(stats.cells * 10 < (uint64_t)stats.leaf_pages * LEAF_NODE_MAX_CELLS * 9);
+    assert(stats.cells * 2 >= (uint64_t)stats.leaf_pages * LEAF_NODE_MAX_CELLS);
+    pager_close(pager);
+
+    remove(db_file);
+    printf("Passed!\n");
+}
+
+static int sign(long long v) {
+    return (v > 0) - (v < 0);
+}
+
+void test_key_heads() {
+    printf("Testing key heads...\n");
+
+    // Head order agrees with strcmp whenever the heads differ
+    const char* samples[] = { "", "a", "ab", "abc", "abcd", "abcde", "abd", "b", "\x7f", "\xff",
+                              "\xff\xff\xff\xff\x01", "a\x01", "user:1", "user:10", "user:2" };
+    int num_samples = (int)(sizeof(samples) / sizeof(samples[0]));
+    for (int i = 0; i < num_samples; i++) {
+        for (int j = 0; j < num_samples; j++) {
+            uint32_t a = key_head(samples[i], (uint32_t)strlen(samples[i]));
+            uint32_t b = key_head(samples[j], (uint32_t)strlen(samples[j]));
+            int cmp = sign(strcmp(samples[i], samples[j]));
+            if (a != b) {
+                assert(sign((long long)a - (long long)b) == cmp);
+            } else if (strlen(samples[i]) <= KEY_HEAD_SIZE && strlen(samples[j]) <= KEY_HEAD_SIZE) {
+                assert(cmp == 0);
+            }
+        }
+    }
+    // A NUL or the length ends the key
+    assert(key_head("ab\0z", 4) == key_head("ab", 2));
+    assert(key_head("abcd", 2) == key_head("ab", 2));
+
+    // Range search matches a linear scan, with runs of equal heads and
+    // heads on both sides of the sign bit
+    uint32_t heads[200];
+    unsigned int seed = 11;
+    for (uint32_t n = 0; n <= 200; n += 7) {
+        uint32_t value = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            seed = seed * 1103515245u + 12345u;
+            value += (seed >> 16) % 3 == 0 ? 0 : (seed >> 8) % 0x3000000u;
+            heads[i] = value;
+        }
+        for (uint32_t i = 0; i <= n; i++) {
+            uint32_t probes[3] = { i < n ? heads[i] : 0xFFFFFFFFu, i < n ? heads[i] + 1 : 0, i < n ? heads[i] - 1 : 0 };
+            for (int p = 0; p < 3; p++) {
+                uint32_t lo, hi, expect_lo = 0, expect_hi = 0;
+                for (uint32_t k = 0; k < n; k++) {
+                    expect_lo += heads[k] < probes[p];
+                    expect_hi += heads[k] <= probes[p];
+                }
+                key_head_range(heads, n, probes[p], &lo, &hi);
+                assert(lo == expect_lo && hi == expect_hi);
+            }
+        }
+    }
+
+    // Leaf heads follow inserts and removals
+    const char* db_file = "test_key_heads.db";
+    remove(db_file);
+    Pager* pager = pager_open(db_file);
+    assert(pager != NULL);
+    void* leaf = pager_get_page(pager, 0);
+    leaf_node_init(leaf);
+    set_node_root(leaf, true);
+    const char* keys[] = { "pear", "apple", "apricot", "fig", "apples" };
+    Cursor cursor;
+    for (int i = 0; i < 5; i++) {
+        assert(table_find_into(pager, 0, keys[i], &cursor) == 0);
+        leaf_node_insert(&cursor, keys[i], "v");
+    }
+    leaf = pager_get_page(pager, 0);
+    leaf_node_remove(leaf, 1); // "apples"
+    assert(*leaf_node_num_cells(leaf) == 4);
+    for (uint32_t i = 0; i < 4; i++) {
+        char* key = leaf_node_key(leaf, i);
+        assert(leaf_node_heads(leaf)[i] == key_head(key, (uint32_t)strlen(key)));
+    }
+    assert(table_find_into(pager, 0, "apricot", &cursor) == 0 && cursor.cell_num == 1);
+    assert(table_find_into(pager, 0, "apples", &cursor) == 0 && cursor.cell_num == 1);
+    pager_close(pager);
+    remove(db_file);
+    remove("test_key_heads.db.wal");
+
+    printf("Passed!\n");
+}
+
 int main() {
+    test_key_heads();
     test_btree_insert_find();
+    test_table_find_into();
     test_cursor_advance_single_leaf();
+    test_internal_node_fanout();
+    test_sequential_split_fill();
     printf("All BTree tests passed!\n");
     return 0;
 }
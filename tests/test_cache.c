@@ -0,0 +1,312 @@
+#include "minunit.h"
+#include "../src/db_core.h"
+#include "../src/utility.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_CACHE_DB "test_cache.db"
+#define TEST_CACHE_KEYS 300 // Sequential keys pack leaves full: about 30 pages, twice the cache
+
+static Database *db = NULL;
+
+static void clean_cache_db() {
+    if (db) {
+        db_close(db);
+        db = NULL;
+    }
+    remove(TEST_CACHE_DB);
+    remove("test_cache.db.wal");
+    remove("test_cache.db.warm");
+}
+
+static Database *open_small_cache(const PagerPolicyOps *policy) {
+    DbOptions options = {0};
+    options.pager.cache_frames = PAGER_MIN_FRAMES;
+    options.pager.policy = policy;
+    return db_open_with_options(TEST_CACHE_DB, &options);
+}
+
+static const char *insert_keys(int count) {
+    char key[32];
+    char value[32];
+    for (int i = 0; i < count; i++) {
+        snprintf(key, sizeof(key), "key-%05d", i);
+        snprintf(value, sizeof(value), "value-%05d", i);
+        mu_assert("error, insert failed", db_insert(db, key, value) == STATUS_OK);
+    }
+    return 0;
+}
+
+static const char *verify_keys(int count) {
+    char key[32];
+    char value[32];
+    for (int i = 0; i < count; i++) {
+        snprintf(key, sizeof(key), "key-%05d", i);
+        snprintf(value, sizeof(value), "value-%05d", i);
+        const char *result = db_get(db, key);
+        mu_assert("error, key missing", result != NULL);
+        mu_assert("error, value mismatch", strcmp(result, value) == 0);
+    }
+    return 0;
+}
+
+// A tree larger than the cache must survive eviction, both through the
+// WAL (pages re-read before checkpoint) and across a reopen.
+static const char *test_cache_eviction_roundtrip() {
+    printf("Running test_cache_eviction_roundtrip...\n");
+    clean_cache_db();
+
+    db = open_small_cache(NULL);
+    mu_assert("error, db_open failed", db != NULL);
+    const char *err = insert_keys(TEST_CACHE_KEYS);
+    if (err) return err;
+    err = verify_keys(TEST_CACHE_KEYS);
+    if (err) return err;
+
+    PagerStats stats;
+    pager_get_stats(db->pager, &stats);
+    mu_assert("error, expected evictions with a small cache", stats.evictions > 0);
+    mu_assert("error, tree should outgrow the cache", db->pager->num_pages > PAGER_MIN_FRAMES);
+
+    db_close(db);
+    db = open_small_cache(&pager_policy_lru);
+    mu_assert("error, db_open failed on reopen", db != NULL);
+    err = verify_keys(TEST_CACHE_KEYS);
+    if (err) return err;
+
+    clean_cache_db();
+    printf("[Pass]  test_cache_eviction_roundtrip PASSED\n");
+    return 0;
+}
+
+// Scans cross leaf boundaries and return every record in key order.
+static const char *test_scan_all_leaves() {
+    printf("Running test_scan_all_leaves...\n");
+    clean_cache_db();
+
+    db = open_small_cache(NULL);
+    mu_assert("error, db_open failed", db != NULL);
+    const char *err = insert_keys(TEST_CACHE_KEYS);
+    if (err) return err;
+    mu_assert("error, delete failed", db_delete(db, "key-00000") == STATUS_OK);
+
+    Cursor *cursor = table_start(db->pager, 0);
+    mu_assert("error, table_start failed", cursor != NULL);
+    char expected[32];
+    int count = 1;
+    while (!cursor->end_of_table) {
+        snprintf(expected, sizeof(expected), "value-%05d", count);
+        mu_assert("error, scan out of order", strcmp((char *)cursor_value(cursor), expected) == 0);
+        count++;
+        cursor_advance(cursor);
+    }
+    free(cursor);
+    mu_assert("error, scan missed records", count == TEST_CACHE_KEYS);
+
+    clean_cache_db();
+    printf("[Pass]  test_scan_all_leaves PASSED\n");
+    return 0;
+}
+
+// Pages fetched as use-once must not push out pages in regular use.
+// LRU is used so the hot set is known to sit at the hot end; under 2Q
+// pages only touched inside A1in are not yet protected from eviction.
+static const char *test_use_once_keeps_hot_pages() {
+    printf("Running test_use_once_keeps_hot_pages...\n");
+    clean_cache_db();
+
+    db = open_small_cache(&pager_policy_lru);
+    mu_assert("error, db_open failed", db != NULL);
+    const char *err = insert_keys(TEST_CACHE_KEYS);
+    if (err) return err;
+
+    // Warm the hot set, then scan everything as use-once
+    for (int round = 0; round < 3; round++) {
+        mu_assert("error, hot key missing", db_get(db, "key-00000") != NULL);
+        mu_assert("error, hot key missing", db_get(db, "key-00070") != NULL);
+    }
+    Cursor *cursor = table_start(db->pager, 0);
+    mu_assert("error, table_start failed", cursor != NULL);
+    while (!cursor->end_of_table) {
+        cursor_advance(cursor);
+    }
+    free(cursor);
+
+    PagerStats before;
+    PagerStats after;
+    pager_get_stats(db->pager, &before);
+    mu_assert("error, hot key missing", db_get(db, "key-00000") != NULL);
+    mu_assert("error, hot key missing", db_get(db, "key-00070") != NULL);
+    pager_get_stats(db->pager, &after);
+    mu_assert("error, scan evicted hot pages", after.misses == before.misses);
+
+    clean_cache_db();
+    printf("[Pass]  test_use_once_keeps_hot_pages PASSED\n");
+    return 0;
+}
+
+static Database *open_warm(void) {
+    DbOptions options = {0};
+    options.pager.cache_frames = PAGER_MIN_FRAMES;
+    options.warm_restart = true;
+    return db_open_with_options(TEST_CACHE_DB, &options);
+}
+
+// Pages cached at close are preloaded at the next open.
+static const char *test_warm_restart() {
+    printf("Running test_warm_restart...\n");
+    clean_cache_db();
+
+    db = open_warm();
+    mu_assert("error, db_open failed", db != NULL);
+    const char *err = insert_keys(TEST_CACHE_KEYS);
+    if (err) return err;
+    for (int round = 0; round < 3; round++) {
+        mu_assert("error, hot key missing", db_get(db, "key-00005") != NULL);
+        mu_assert("error, hot key missing", db_get(db, "key-00130") != NULL);
+    }
+    db_close(db);
+
+    FILE *warm = fopen("test_cache.db.warm", "rb");
+    mu_assert("error, warm list not written at close", warm != NULL);
+    fclose(warm);
+
+    db = open_warm();
+    mu_assert("error, db_open failed on reopen", db != NULL);
+    PagerStats stats;
+    pager_get_stats(db->pager, &stats);
+    mu_assert("error, no pages preloaded", stats.warmed > 0);
+    mu_assert("error, preload should not count as misses", stats.misses == 0);
+
+    mu_assert("error, hot key missing", db_get(db, "key-00005") != NULL);
+    mu_assert("error, hot key missing", db_get(db, "key-00130") != NULL);
+    pager_get_stats(db->pager, &stats);
+    mu_assert("error, hot pages were not preloaded", stats.misses == 0);
+    err = verify_keys(TEST_CACHE_KEYS);
+    if (err) return err;
+
+    clean_cache_db();
+    printf("[Pass]  test_warm_restart PASSED\n");
+    return 0;
+}
+
+// A damaged warm list is ignored rather than failing the open.
+static const char *test_warm_restart_bad_list() {
+    printf("Running test_warm_restart_bad_list...\n");
+    clean_cache_db();
+
+    db = open_warm();
+    mu_assert("error, db_open failed", db != NULL);
+    const char *err = insert_keys(20);
+    if (err) return err;
+    db_close(db);
+
+    FILE *warm = fopen("test_cache.db.warm", "wb");
+    mu_assert("error, could not overwrite warm list", warm != NULL);
+    fputs("not a warm list", warm);
+    fclose(warm);
+
+    db = open_warm();
+    mu_assert("error, db_open failed with a bad warm list", db != NULL);
+    PagerStats stats;
+    pager_get_stats(db->pager, &stats);
+    mu_assert("error, bad warm list should load nothing", stats.warmed == 0);
+    err = verify_keys(20);
+    if (err) return err;
+
+    clean_cache_db();
+    printf("[Pass]  test_warm_restart_bad_list PASSED\n");
+    return 0;
+}
+
+// The row cache answers repeated lookups without touching a page, stays
+// within its budget and never serves a value a write has changed
+static const char *test_row_cache() {
+    printf("Running test_row_cache...\n");
+    clean_cache_db();
+    DbOptions options = {0};
+    options.pager.cache_frames = PAGER_MIN_FRAMES;
+    options.row_cache_bytes = 64 * 1024;
+    db = db_open_with_options(TEST_CACHE_DB, &options);
+    mu_assert("error, db_open failed", db != NULL);
+    const char *err = insert_keys(TEST_CACHE_KEYS);
+    if (err) return err;
+
+    char key[32];
+    char value[32];
+    char buf[MAX_VALUE_LEN];
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass == 1) {
+            pager_reset_stats(db->pager);
+        }
+        for (int i = 0; i < TEST_CACHE_KEYS; i++) {
+            snprintf(key, sizeof(key), "key-%05d", i);
+            snprintf(value, sizeof(value), "value-%05d", i);
+            mu_assert("error, get failed", db_get_into(db, key, buf, sizeof(buf)) == (int)strlen(value) &&
+                                           strcmp(buf, value) == 0);
+        }
+    }
+    DbCacheStats stats;
+    mu_assert("error, cache stats", db_cache_stats(db, &stats) == STATUS_OK);
+    mu_assert("error, second pass read pages", stats.pages.hits + stats.pages.misses == 0);
+    mu_assert("error, row cache counters", stats.rows.hits == TEST_CACHE_KEYS &&
+                                           stats.rows.misses == TEST_CACHE_KEYS &&
+                                           stats.rows.entries == TEST_CACHE_KEYS);
+    mu_assert("error, row cache budget", stats.rows.bytes > 0 && stats.rows.bytes <= stats.rows.budget_bytes);
+    mu_assert("error, page cache size", stats.page_frames == PAGER_MIN_FRAMES);
+
+    // Writes drop the keys they change
+    mu_assert("error, update failed", db_update(db, "key-00007", "changed") == STATUS_OK);
+    mu_assert("error, stale value after update", db_get_into(db, "key-00007", buf, sizeof(buf)) == 7 &&
+                                                 strcmp(buf, "changed") == 0);
+    mu_assert("error, delete failed", db_delete(db, "key-00008") == STATUS_OK);
+    mu_assert("error, deleted key cached", db_get_into(db, "key-00008", buf, sizeof(buf)) == STATUS_NOT_FOUND);
+    mu_assert("error, insert failed", db_insert(db, "key-00008", "again") == STATUS_OK);
+    mu_assert("error, reinserted key", db_get_into(db, "key-00008", buf, sizeof(buf)) == 5 &&
+                                       strcmp(buf, "again") == 0);
+    // A truncated read is answered but not cached
+    mu_assert("error, truncated get", db_get_into(db, "key-00009", buf, 4) == 11 && strcmp(buf, "val") == 0);
+    mu_assert("error, full get after truncated", db_get_into(db, "key-00009", buf, sizeof(buf)) == 11 &&
+                                                 strcmp(buf, "value-00009") == 0);
+
+    const char *batch[3] = { "key-00007", "key-00010", "missing" };
+    char out[3][MAX_VALUE_LEN];
+    bool found[3];
+    mu_assert("error, multi-get", db_multi_get(db, batch, 3, out, found) == 2 && found[0] && found[1] &&
+                                  !found[2] && strcmp(out[0], "changed") == 0 &&
+                                  strcmp(out[1], "value-00010") == 0);
+    db_close(db);
+
+    // A budget smaller than the hot set evicts
+    options.row_cache_bytes = ROW_CACHE_SHARDS * 256;
+    db = db_open_with_options(TEST_CACHE_DB, &options);
+    mu_assert("error, db_open failed", db != NULL);
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 10; i < TEST_CACHE_KEYS; i++) {
+            snprintf(key, sizeof(key), "key-%05d", i);
+            snprintf(value, sizeof(value), "value-%05d", i);
+            mu_assert("error, get failed", db_get_into(db, key, buf, sizeof(buf)) == (int)strlen(value) &&
+                                           strcmp(buf, value) == 0);
+        }
+    }
+    mu_assert("error, cache stats", db_cache_stats(db, &stats) == STATUS_OK);
+    mu_assert("error, no evictions", stats.rows.evictions > 0 && stats.rows.entries < TEST_CACHE_KEYS);
+    mu_assert("error, over budget", stats.rows.bytes <= stats.rows.budget_bytes);
+
+    clean_cache_db();
+    printf("[Pass]  test_row_cache PASSED\n");
+    return 0;
+}
+
+const char *all_cache_tests() {
+    printf("\n=== Running Page Cache Tests ===\n");
+    mu_run_test(test_cache_eviction_roundtrip);
+    mu_run_test(test_scan_all_leaves);
+    mu_run_test(test_use_once_keeps_hot_pages);
+    mu_run_test(test_warm_restart);
+    mu_run_test(test_warm_restart_bad_list);
+    mu_run_test(test_row_cache);
+    printf("=== Page Cache Tests Complete ===\n\n");
+    return 0;
+}
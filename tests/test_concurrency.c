@@ -0,0 +1,227 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "../src/db_core.h"
+
+// Readers and a snapshot scanner run against one writer that updates
+// existing keys and inserts new ones (splitting leaves and internal
+// nodes), on a cache small enough that pages are evicted and reloaded
+// throughout.
+
+#define TEST_DB "test_concurrency.db"
+#define BASE_KEYS 2000
+#define NEW_KEYS 3000
+#define READERS 4
+#define CACHE_FRAMES 64
+
+static Database* db;
+static atomic_int inserted;   // Keys BASE_KEYS .. BASE_KEYS + inserted exist
+static atomic_bool done;
+static atomic_int failures;
+
+static void make_key(char* key, int i) {
+    snprintf(key, 32, "key-%06d", (i * 7919) % (BASE_KEYS + NEW_KEYS));
+}
+
+// Every value of key i starts with "v<i>:"
+static int value_matches(const char* value, int i) {
+    char prefix[32];
+    int len = snprintf(prefix, sizeof(prefix), "v%d:", (i * 7919) % (BASE_KEYS + NEW_KEYS));
+    return strncmp(value, prefix, len) == 0;
+}
+
+static void fail(const char* what, int i) {
+    fprintf(stderr, "Reader check failed: %s (key %d)\n", what, i);
+    atomic_fetch_add(&failures, 1);
+}
+
+static void* reader(void* arg) {
+    unsigned int seed = (unsigned int)(uintptr_t)arg;
+    char key[32];
+    char value[MAX_VALUE_LEN];
+    while (!atomic_load(&done)) {
+        seed = seed * 1103515245u + 12345u;
+        int limit = BASE_KEYS + atomic_load(&inserted);
+        int i = (int)((seed >> 8) % (unsigned int)limit);
+        make_key(key, i);
+
+        switch ((seed >> 4) % 3) {
+        case 0:
+            if (db_get_into(db, key, value, sizeof(value)) < 0 || !value_matches(value, i)) {
+                fail("db_get_into", i);
+            }
+            break;
+        case 1: {
+            DbPinnedValue pinned;
+            if (db_get_pinned(db, key, &pinned) != STATUS_OK || !value_matches(pinned.value, i)) {
+                fail("db_get_pinned", i);
+                break;
+            }
+            // The pinned bytes must not change under later writes
+            strcpy(value, pinned.value);
+            for (int spin = 0; spin < 100; spin++) {
+                if (strcmp(value, pinned.value) != 0) {
+                    fail("pinned value changed", i);
+                    break;
+                }
+            }
+            db_pinned_release(&pinned);
+            break;
+        }
+        default: {
+            char keys[8][32];
+            const char* batch[8];
+            int index[8];
+            char out[8][MAX_VALUE_LEN];
+            bool found[8];
+            for (int k = 0; k < 8; k++) {
+                index[k] = (i + k * 131) % limit;
+                make_key(keys[k], index[k]);
+                batch[k] = keys[k];
+            }
+            if (db_multi_get(db, batch, 8, out, found) != 8) {
+                fail("db_multi_get", i);
+                break;
+            }
+            for (int k = 0; k < 8; k++) {
+                if (!found[k] || !value_matches(out[k], index[k])) {
+                    fail("db_multi_get value", index[k]);
+                }
+            }
+            break;
+        }
+        }
+    }
+    return NULL;
+}
+
+// A snapshot scan sees a whole number of writes: strictly increasing keys,
+// as many as existed when it was taken, with values that belong to them
+typedef struct {
+    int count;
+    int bad;
+    char last[32];
+} SnapshotScan;
+
+static int check_snapshot_record(const char* key, const char* value, void* arg) {
+    SnapshotScan* scan = arg;
+    int i = atoi(key + 4);
+    char prefix[32];
+    int len = snprintf(prefix, sizeof(prefix), "v%d:", i);
+    if ((scan->count > 0 && strcmp(scan->last, key) >= 0) || strncmp(value, prefix, len) != 0) {
+        scan->bad++;
+    }
+    strcpy(scan->last, key);
+    scan->count++;
+    return 0;
+}
+
+static void* snapshot_scanner(void* arg) {
+    (void)arg;
+    while (!atomic_load(&done)) {
+        int before = atomic_load(&inserted);
+        DbSnapshot snapshot;
+        if (db_snapshot(db, &snapshot) != STATUS_OK) {
+            fail("db_snapshot", 0);
+            break;
+        }
+        int after = atomic_load(&inserted);
+        SnapshotScan scan = {0};
+        int64_t visited = db_snapshot_scan(&snapshot, NULL, check_snapshot_record, &scan);
+        // Scanning again finds the same records
+        SnapshotScan again = {0};
+        db_snapshot_scan(&snapshot, NULL, check_snapshot_record, &again);
+        db_snapshot_release(&snapshot);
+        if (visited != scan.count || scan.bad > 0 || again.count != scan.count || again.bad > 0 ||
+            scan.count < BASE_KEYS + before || scan.count > BASE_KEYS + after) {
+            fail("db_snapshot_scan", scan.count);
+        }
+    }
+    return NULL;
+}
+
+static void* writer(void* arg) {
+    (void)arg;
+    char key[32];
+    char value[64];
+    for (int n = 0; n < NEW_KEYS; n++) {
+        int i = BASE_KEYS + n;
+        make_key(key, i);
+        snprintf(value, sizeof(value), "v%d:new", (i * 7919) % (BASE_KEYS + NEW_KEYS));
+        assert(db_insert(db, key, value) == STATUS_OK);
+        atomic_store(&inserted, n + 1);
+
+        // Rewrite an older key in place
+        int old = (n * 31) % i;
+        make_key(key, old);
+        snprintf(value, sizeof(value), "v%d:update-%d", (old * 7919) % (BASE_KEYS + NEW_KEYS), n);
+        assert(db_update(db, key, value) == STATUS_OK);
+    }
+    return NULL;
+}
+
+void test_readers_with_writer() {
+    printf("Testing concurrent readers with a writer...\n");
+    remove(TEST_DB);
+    remove(TEST_DB ".wal");
+    remove(TEST_DB ".bloom");
+
+    DbOptions options = {0};
+    options.pager.cache_frames = CACHE_FRAMES;
+    options.bloom_bits_per_key = 10; // Grown and rebuilt while readers check it
+    options.hash_index_entries = 1024; // Entries go stale under readers as leaves split
+    options.row_cache_bytes = 64 * 1024; // Filled by readers while the writer invalidates
+    db = db_open_with_options(TEST_DB, &options);
+    assert(db != NULL);
+
+    char key[32];
+    char value[64];
+    for (int i = 0; i < BASE_KEYS; i++) {
+        make_key(key, i);
+        snprintf(value, sizeof(value), "v%d:base", (i * 7919) % (BASE_KEYS + NEW_KEYS));
+        assert(db_insert(db, key, value) == STATUS_OK);
+    }
+
+    pthread_t readers[READERS];
+    pthread_t writer_thread;
+    pthread_t scanner_thread;
+    for (int r = 0; r < READERS; r++) {
+        assert(pthread_create(&readers[r], NULL, reader, (void*)(uintptr_t)(r + 1)) == 0);
+    }
+    assert(pthread_create(&scanner_thread, NULL, snapshot_scanner, NULL) == 0);
+    assert(pthread_create(&writer_thread, NULL, writer, NULL) == 0);
+    pthread_join(writer_thread, NULL);
+    atomic_store(&done, true);
+    for (int r = 0; r < READERS; r++) {
+        pthread_join(readers[r], NULL);
+    }
+    pthread_join(scanner_thread, NULL);
+    assert(atomic_load(&failures) == 0);
+    // Every snapshot is gone, and with them the saved pages
+    assert(db->pager->versions.num_images == 0);
+
+    // Every key is there once the threads are gone
+    for (int i = 0; i < BASE_KEYS + NEW_KEYS; i++) {
+        make_key(key, i);
+        assert(db_get_into(db, key, value, sizeof(value)) > 0);
+        assert(value_matches(value, i));
+    }
+    BTreeFillStats stats;
+    assert(db_fill_stats(db, &stats) == STATUS_OK);
+    assert(stats.cells == BASE_KEYS + NEW_KEYS);
+
+    db_close(db);
+    remove(TEST_DB);
+    remove(TEST_DB ".wal");
+    remove(TEST_DB ".bloom");
+    printf("Passed!\n");
+}
+
+int main() {
+    test_readers_with_writer();
+    printf("All concurrency tests passed!\n");
+    return 0;
+}
@@ -1,9 +1,16 @@
+#define _POSIX_C_SOURCE 200809L // fork, waitpid
 #include "minunit.h"
 #include "../src/db_core.h"
 #include "../src/utility.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
+#ifndef _WIN32
+#include <pthread.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 #define TEST_DB_FILE "test_db.dat"
 
@@ -17,6 +24,7 @@ static void clean_test_db() {
     }
     remove(TEST_DB_FILE);
     remove("test_db.dat.wal");
+    remove("test_db.dat.bloom");
 }
 
 static const char *test_db_open_close() {
@@ -204,6 +212,1600 @@ static const char *test_db_delete_only_key() {
     return 0;
 }
 
+#define MULTI_GET_KEYS 1500 // More leaves than the default cache holds
+#define MULTI_GET_BATCH 400
+
+static const char *test_db_multi_get() {
+    printf("Running test_db_multi_get...\n");
+    clean_test_db();
+    db = db_open(TEST_DB_FILE);
+
+    char key[32];
+    char value[32];
+    for (int i = 0; i < MULTI_GET_KEYS; i++) {
+        snprintf(key, sizeof(key), "k%05d", (i * 7919) % MULTI_GET_KEYS);
+        snprintf(value, sizeof(value), "v%05d", (i * 7919) % MULTI_GET_KEYS);
+        mu_assert("error, insert failed", db_insert(db, key, value) == STATUS_OK);
+    }
+
+    // Unsorted batch spread over the whole tree, with misses and a duplicate
+    static char batch_keys[MULTI_GET_BATCH][32];
+    static char out[MULTI_GET_BATCH][MAX_VALUE_LEN];
+    const char *keys[MULTI_GET_BATCH];
+    bool found[MULTI_GET_BATCH];
+    for (int i = 0; i < MULTI_GET_BATCH; i++) {
+        int n = (i * 613) % (MULTI_GET_KEYS + 100); // Numbers past MULTI_GET_KEYS are missing
+        snprintf(batch_keys[i], sizeof(batch_keys[i]), "k%05d", n);
+        keys[i] = batch_keys[i];
+    }
+    keys[MULTI_GET_BATCH - 1] = keys[0];
+    int expected_hits = 0;
+    for (int i = 0; i < MULTI_GET_BATCH; i++) {
+        expected_hits += atoi(keys[i] + 1) < MULTI_GET_KEYS;
+    }
+
+    int hits = db_multi_get(db, keys, MULTI_GET_BATCH, out, found);
+    mu_assert("error, multi-get hit count", hits == expected_hits);
+    for (int i = 0; i < MULTI_GET_BATCH; i++) {
+        const char *single = db_get(db, keys[i]);
+        mu_assert("error, multi-get found flag", found[i] == (single != NULL));
+        if (single) {
+            mu_assert("error, multi-get value mismatch", strcmp(out[i], single) == 0);
+        } else {
+            mu_assert("error, missing key should give an empty value", out[i][0] == '\0');
+        }
+    }
+
+    mu_assert("error, empty batch", db_multi_get(db, keys, 0, out, NULL) == 0);
+    mu_assert("error, single key without found[]", db_multi_get(db, keys, 1, out, NULL) == (found[0] ? 1 : 0));
+
+    clean_test_db();
+    printf("[Pass]  test_db_multi_get PASSED\n");
+    return 0;
+}
+
+static const char *test_db_get_into() {
+    printf("Running test_db_get_into...\n");
+    clean_test_db();
+    db = db_open(TEST_DB_FILE);
+    db_insert(db, "key1", "a longer value");
+
+    char buf[MAX_VALUE_LEN];
+    mu_assert("error, get_into length", db_get_into(db, "key1", buf, sizeof(buf)) == 14);
+    mu_assert("error, get_into value", strcmp(buf, "a longer value") == 0);
+    mu_assert("error, get_into truncated length", db_get_into(db, "key1", buf, 5) == 14);
+    mu_assert("error, get_into truncated value", strcmp(buf, "a lo") == 0);
+    mu_assert("error, get_into length only", db_get_into(db, "key1", NULL, 0) == 14);
+    mu_assert("error, get_into missing key", db_get_into(db, "nonexistent", buf, sizeof(buf)) == STATUS_NOT_FOUND);
+
+    clean_test_db();
+    printf("[Pass]  test_db_get_into PASSED\n");
+    return 0;
+}
+
+#define PINNED_KEYS 1500 // More leaves than the default cache holds
+
+static const char *test_db_get_pinned() {
+    printf("Running test_db_get_pinned...\n");
+    clean_test_db();
+    db = db_open(TEST_DB_FILE);
+    db_insert(db, "m-key", "pinned value");
+
+    DbPinnedValue pinned;
+    mu_assert("error, get_pinned missing key", db_get_pinned(db, "nonexistent", &pinned) == STATUS_NOT_FOUND);
+    mu_assert("error, get_pinned failed", db_get_pinned(db, "m-key", &pinned) == STATUS_OK);
+    mu_assert("error, get_pinned value", strcmp(pinned.value, "pinned value") == 0);
+    mu_assert("error, get_pinned length", pinned.length == 12);
+
+    // Shift the cells of the pinned leaf, update the key, then push every
+    // page out of the cache: the pinned bytes must not change
+    db_insert(db, "a-key", "shifts m-key right");
+    mu_assert("error, update failed", db_update(db, "m-key", "new value") == STATUS_OK);
+    char key[32];
+    for (int i = 0; i < PINNED_KEYS; i++) {
+        snprintf(key, sizeof(key), "k%05d", (i * 7919) % PINNED_KEYS);
+        mu_assert("error, insert failed", db_insert(db, key, "filler") == STATUS_OK);
+    }
+    mu_assert("error, pinned value changed", strcmp(pinned.value, "pinned value") == 0);
+
+    char buf[MAX_VALUE_LEN];
+    db_get_into(db, "m-key", buf, sizeof(buf));
+    mu_assert("error, update not visible", strcmp(buf, "new value") == 0);
+
+    db_pinned_release(&pinned);
+    mu_assert("error, release should clear the handle", pinned.value == NULL);
+    db_pinned_release(&pinned);
+
+    mu_assert("error, get_pinned after updates", db_get_pinned(db, "m-key", &pinned) == STATUS_OK);
+    mu_assert("error, get_pinned updated value", strcmp(pinned.value, "new value") == 0);
+    db_pinned_release(&pinned);
+
+    clean_test_db();
+    printf("[Pass]  test_db_get_pinned PASSED\n");
+    return 0;
+}
+
+// Lookups without latches see a page that is being changed and fall back,
+// and see the change once it is done
+static const char *test_db_get_optimistic() {
+    printf("Running test_db_get_optimistic...\n");
+    clean_test_db();
+    db = db_open(TEST_DB_FILE);
+    char key[32];
+    for (int i = 0; i < 300; i++) {
+        snprintf(key, sizeof(key), "k%05d", i);
+        mu_assert("error, insert failed", db_insert(db, key, "before") == STATUS_OK);
+    }
+
+    char buf[MAX_VALUE_LEN];
+    size_t length;
+    mu_assert("error, optimistic get failed",
+              table_get_optimistic(db->pager, 0, "k00042", buf, sizeof(buf), &length, NULL, NULL, NULL) == 1);
+    mu_assert("error, optimistic get value", strcmp(buf, "before") == 0 && length == 6);
+    mu_assert("error, optimistic get missing key",
+              table_get_optimistic(db->pager, 0, "k99999", buf, sizeof(buf), &length, NULL, NULL, NULL) == 0);
+
+    // Change the leaf the way a writer does: under its exclusive latch
+    Cursor cursor;
+    mu_assert("error, find failed", table_find_into(db->pager, 0, "k00042", &cursor) == 0);
+    pager_scope_begin(db->pager);
+    uint32_t frame;
+    void *leaf = pager_latch_page(db->pager, cursor.page_num, PAGER_LATCH_EXCLUSIVE, &frame);
+    mu_assert("error, latch failed", leaf != NULL);
+    strcpy(leaf_node_value(leaf, cursor.cell_num), "after");
+    mu_assert("error, optimistic get must not read a latched page",
+              table_get_optimistic(db->pager, 0, "k00042", buf, sizeof(buf), &length, NULL, NULL, NULL) == -1);
+    pager_unlatch_frame(db->pager, frame, PAGER_LATCH_EXCLUSIVE);
+    pager_scope_end(db->pager);
+
+    mu_assert("error, optimistic get after unlatch",
+              table_get_optimistic(db->pager, 0, "k00042", buf, sizeof(buf), &length, NULL, NULL, NULL) == 1);
+    mu_assert("error, change not visible", strcmp(buf, "after") == 0);
+
+    clean_test_db();
+    printf("[Pass]  test_db_get_optimistic PASSED\n");
+    return 0;
+}
+
+// Count the records of a snapshot scan and check they come in key order
+typedef struct {
+    int count;
+    int unordered;
+    char last[MAX_KEY_LEN];
+} ScanCheck;
+
+static int check_scan(const char *key, const char *value, void *arg) {
+    ScanCheck *check = arg;
+    (void)value;
+    if (check->count > 0 && strcmp(check->last, key) >= 0) {
+        check->unordered++;
+    }
+    strcpy(check->last, key);
+    check->count++;
+    return 0;
+}
+
+// A snapshot keeps seeing the tree as it was through updates, deletes and
+// splits, and its saved pages go away with it
+static const char *test_db_snapshot() {
+    printf("Running test_db_snapshot...\n");
+    clean_test_db();
+    db = db_open(TEST_DB_FILE);
+    char key[32];
+    char value[32];
+    for (int i = 0; i < 200; i++) {
+        snprintf(key, sizeof(key), "k%05d", i * 2);
+        snprintf(value, sizeof(value), "old-%d", i * 2);
+        mu_assert("error, insert failed", db_insert(db, key, value) == STATUS_OK);
+    }
+
+    DbSnapshot snapshot;
+    mu_assert("error, snapshot failed", db_snapshot(db, &snapshot) == STATUS_OK);
+    mu_assert("error, update failed", db_update(db, "k00010", "new") == STATUS_OK);
+    mu_assert("error, delete failed", db_delete(db, "k00020") == STATUS_OK);
+    for (int i = 0; i < 600; i++) {
+        snprintf(key, sizeof(key), "k%05d", i * 2 + 1); // Splits the old leaves
+        mu_assert("error, insert failed", db_insert(db, key, "new") == STATUS_OK);
+    }
+    mu_assert("error, no pages saved", db->pager->versions.num_images > 0);
+
+    char buf[MAX_VALUE_LEN];
+    mu_assert("error, snapshot sees update",
+              db_snapshot_get(&snapshot, "k00010", buf, sizeof(buf)) == 6 && strcmp(buf, "old-10") == 0);
+    mu_assert("error, snapshot sees delete", db_snapshot_get(&snapshot, "k00020", buf, sizeof(buf)) == 6);
+    mu_assert("error, snapshot sees insert",
+              db_snapshot_get(&snapshot, "k00011", buf, sizeof(buf)) == STATUS_NOT_FOUND);
+    mu_assert("error, database lost the update",
+              db_get_into(db, "k00010", buf, sizeof(buf)) == 3 && strcmp(buf, "new") == 0);
+
+    ScanCheck check = {0};
+    mu_assert("error, snapshot scan", db_snapshot_scan(&snapshot, NULL, check_scan, &check) == 200);
+    mu_assert("error, snapshot scan count", check.count == 200 && check.unordered == 0);
+    memset(&check, 0, sizeof(check));
+    mu_assert("error, snapshot scan from key", db_snapshot_scan(&snapshot, "k00301", check_scan, &check) == 49);
+
+    // A newer snapshot sees everything so far
+    DbSnapshot newer;
+    mu_assert("error, snapshot failed", db_snapshot(db, &newer) == STATUS_OK);
+    memset(&check, 0, sizeof(check));
+    mu_assert("error, newer snapshot scan", db_snapshot_scan(&newer, NULL, check_scan, &check) == 799);
+
+    db_snapshot_release(&snapshot);
+    db_snapshot_release(&snapshot); // No-op
+    mu_assert("error, db_snapshot_get after release", db_snapshot_get(&snapshot, "k00010", buf, sizeof(buf)) == STATUS_ERROR);
+    mu_assert("error, pages kept for the newer snapshot", db->pager->versions.num_images == 0);
+    mu_assert("error, update failed", db_update(db, "k00012", "newer") == STATUS_OK);
+    mu_assert("error, page not saved for the newer snapshot", db->pager->versions.num_images == 1);
+    mu_assert("error, newer snapshot sees update",
+              db_snapshot_get(&newer, "k00012", buf, sizeof(buf)) == 6 && strcmp(buf, "old-12") == 0);
+    db_snapshot_release(&newer);
+    mu_assert("error, saved pages not freed", db->pager->versions.num_images == 0);
+
+    clean_test_db();
+    printf("[Pass]  test_db_snapshot PASSED\n");
+    return 0;
+}
+
+static bool file_exists(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file) {
+        fclose(file);
+    }
+    return file != NULL;
+}
+
+// The Bloom filter answers for absent keys, never for present ones, grows
+// with the keys and survives a close and reopen
+static const char *test_db_bloom_filter() {
+    printf("Running test_db_bloom_filter...\n");
+    clean_test_db();
+    DbOptions options = {0};
+    options.bloom_bits_per_key = 10;
+    db = db_open_with_options(TEST_DB_FILE, &options);
+    mu_assert("error, db_open failed", db != NULL);
+
+    char key[32];
+    char buf[MAX_VALUE_LEN];
+    int keys = 3 * DB_BLOOM_MIN_KEYS; // Grows the filter twice
+    for (int i = 0; i < keys; i++) {
+        snprintf(key, sizeof(key), "present-%d", i);
+        mu_assert("error, insert failed", db_insert(db, key, "v") == STATUS_OK);
+    }
+    DbBloomStats stats;
+    mu_assert("error, bloom stats", db_bloom_stats(db, &stats) == STATUS_OK && stats.enabled);
+    mu_assert("error, filter did not grow", stats.capacity >= (uint64_t)keys && stats.keys == (uint64_t)keys);
+
+    for (int i = 0; i < keys; i++) {
+        snprintf(key, sizeof(key), "present-%d", i);
+        mu_assert("error, filter ruled out a present key", db_get_into(db, key, buf, sizeof(buf)) == 1);
+    }
+    for (int i = 0; i < 1000; i++) {
+        snprintf(key, sizeof(key), "absent-%d", i);
+        mu_assert("error, absent key found", db_get_into(db, key, buf, sizeof(buf)) == STATUS_NOT_FOUND);
+    }
+    mu_assert("error, update of absent key", db_update(db, "absent-1", "v") == STATUS_NOT_FOUND);
+    mu_assert("error, delete of absent key", db_delete(db, "absent-1") == STATUS_NOT_FOUND);
+    mu_assert("error, bloom stats", db_bloom_stats(db, &stats) == STATUS_OK);
+    mu_assert("error, filter answered too few lookups", stats.negatives >= 900);
+    mu_assert("error, false positive rate", stats.observed_fp_rate < 0.1 && stats.expected_fp_rate < 0.1);
+    mu_assert("error, filter memory", stats.memory_bytes > 0 && stats.memory_bytes <= stats.capacity * 10 / 8 + 64);
+
+    // Deleted keys stay in the filter until enough of them pile up
+    mu_assert("error, delete failed", db_delete(db, "present-0") == STATUS_OK);
+    mu_assert("error, deleted key found", db_get_into(db, "present-0", buf, sizeof(buf)) == STATUS_NOT_FOUND);
+
+    // Saved at close, taken back (and removed) at open
+    db_close(db);
+    db = NULL;
+    mu_assert("error, filter not saved", file_exists("test_db.dat.bloom"));
+    db = db_open_with_options(TEST_DB_FILE, &options);
+    mu_assert("error, db_open failed on reopen", db != NULL);
+    mu_assert("error, saved filter left behind", !file_exists("test_db.dat.bloom"));
+    mu_assert("error, bloom stats", db_bloom_stats(db, &stats) == STATUS_OK);
+    mu_assert("error, saved filter not loaded", stats.keys == (uint64_t)keys);
+    for (int i = 1; i < keys; i++) {
+        snprintf(key, sizeof(key), "present-%d", i);
+        mu_assert("error, loaded filter ruled out a present key", db_get_into(db, key, buf, sizeof(buf)) == 1);
+    }
+
+    // Without the file the filter is built from the tree
+    db_close(db);
+    db = NULL;
+    remove("test_db.dat.bloom");
+    db = db_open_with_options(TEST_DB_FILE, &options);
+    mu_assert("error, bloom stats", db_bloom_stats(db, &stats) == STATUS_OK);
+    mu_assert("error, rebuilt filter", stats.keys == (uint64_t)keys - 1);
+    const char *batch[2] = { "present-7", "absent-7" };
+    char out[2][MAX_VALUE_LEN];
+    bool found[2];
+    mu_assert("error, multi-get", db_multi_get(db, batch, 2, out, found) == 1 && found[0] && !found[1]);
+
+    // A session with the filter off changes the tree without it: its saved
+    // copy must not be trusted afterwards
+    db_close(db);
+    db = db_open(TEST_DB_FILE);
+    mu_assert("error, db_open failed without filter", db != NULL);
+    mu_assert("error, insert without filter", db_insert(db, "added-off", "x") == STATUS_OK);
+    db_close(db);
+    db = db_open_with_options(TEST_DB_FILE, &options);
+    mu_assert("error, db_open failed on reopen", db != NULL);
+    mu_assert("error, key added without filter", db_get_into(db, "added-off", buf, sizeof(buf)) == 1);
+    mu_assert("error, key added without filter", db_get(db, "added-off") != NULL);
+
+    clean_test_db();
+    printf("[Pass]  test_db_bloom_filter PASSED\n");
+    return 0;
+}
+
+// Hash index hits go straight to the leaf; inserts, splits, updates and
+// deletes never make a lookup through it return a wrong answer
+static const char *test_db_hash_index() {
+    printf("Running test_db_hash_index...\n");
+    clean_test_db();
+    DbOptions options = {0};
+    options.hash_index_entries = 256;
+    db = db_open_with_options(TEST_DB_FILE, &options);
+    mu_assert("error, db_open failed", db != NULL);
+
+    char key[32];
+    char value[32];
+    char buf[MAX_VALUE_LEN];
+    for (int i = 0; i < 200; i++) {
+        snprintf(key, sizeof(key), "k%03d0", i);
+        snprintf(value, sizeof(value), "v%d", i);
+        mu_assert("error, insert failed", db_insert(db, key, value) == STATUS_OK);
+    }
+    // The first miss of a key only marks it; the second admits it
+    for (int pass = 0; pass < 6; pass++) {
+        for (int i = 0; i < 200; i++) {
+            snprintf(key, sizeof(key), "k%03d0", i);
+            snprintf(value, sizeof(value), "v%d", i);
+            mu_assert("error, get failed", db_get_into(db, key, buf, sizeof(buf)) == (int)strlen(value) &&
+                                           strcmp(buf, value) == 0);
+        }
+    }
+    HashIndexStats stats;
+    mu_assert("error, hash index stats", db_hash_index_stats(db, &stats) == STATUS_OK);
+    mu_assert("error, index size", stats.capacity == 256 && stats.used > 0 && stats.used <= stats.capacity);
+    mu_assert("error, doorkeeper", stats.rejected > 0 && stats.admitted > 0);
+    mu_assert("error, no hits", stats.hits >= HASH_INDEX_HIT_BATCH);
+
+    // Keys in between shift cells and split leaves under the entries
+    for (int i = 0; i < 200; i++) {
+        snprintf(key, sizeof(key), "k%03d5", i);
+        mu_assert("error, insert failed", db_insert(db, key, "new") == STATUS_OK);
+    }
+    mu_assert("error, update failed", db_update(db, "k1000", "updated") == STATUS_OK);
+    mu_assert("error, delete failed", db_delete(db, "k0500") == STATUS_OK);
+    for (int pass = 0; pass < 3; pass++) {
+        for (int i = 0; i < 200; i++) {
+            snprintf(key, sizeof(key), "k%03d0", i);
+            snprintf(value, sizeof(value), "v%d", i);
+            const char *expected = i == 100 ? "updated" : value;
+            int length = db_get_into(db, key, buf, sizeof(buf));
+            if (i == 50) {
+                mu_assert("error, deleted key found", length == STATUS_NOT_FOUND);
+                continue;
+            }
+            mu_assert("error, get after splits", length == (int)strlen(expected) && strcmp(buf, expected) == 0);
+            const char *direct = db_get(db, key);
+            mu_assert("error, db_get after splits", direct && strcmp(direct, expected) == 0);
+            DbPinnedValue pinned;
+            mu_assert("error, pinned get after splits", db_get_pinned(db, key, &pinned) == STATUS_OK &&
+                                                        strcmp(pinned.value, expected) == 0);
+            db_pinned_release(&pinned);
+        }
+    }
+    mu_assert("error, deleted key found", db_get(db, "k0500") == NULL);
+    DbPinnedValue pinned;
+    mu_assert("error, deleted key pinned", db_get_pinned(db, "k0500", &pinned) == STATUS_NOT_FOUND);
+    mu_assert("error, hash index stats", db_hash_index_stats(db, &stats) == STATUS_OK);
+    mu_assert("error, stale entries not refreshed", stats.stale > 0);
+
+    clean_test_db();
+    printf("[Pass]  test_db_hash_index PASSED\n");
+    return 0;
+}
+
+// Integer scan check: keys decode and arrive in increasing order
+typedef struct {
+    KeyType type;
+    int count;
+    bool ordered;
+    uint64_t last; // i64 keys with the sign bit flipped, as encoded
+} KeyOrderScan;
+
+static int check_key_order(const char *key, const char *value, void *arg) {
+    (void)value;
+    KeyOrderScan *scan = arg;
+    uint64_t current = 0;
+    int64_t signed_value;
+    if (scan->type == KEY_TYPE_U64) {
+        scan->ordered = scan->ordered && key_decode_u64(key, &current);
+    } else {
+        scan->ordered = scan->ordered && key_decode_i64(key, &signed_value);
+        current = (uint64_t)signed_value ^ (1ull << 63);
+    }
+    if (scan->count > 0 && current <= scan->last) {
+        scan->ordered = false;
+    }
+    scan->last = current;
+    scan->count++;
+    return 0;
+}
+
+// Integer and binary keys sort by value, survive splits and a reopen, and
+// the key type cannot be changed once the database exists
+static const char *test_db_key_types() {
+    printf("Running test_db_key_types...\n");
+    clean_test_db();
+    char key[MAX_KEY_LEN];
+    char buf[MAX_VALUE_LEN];
+
+    // Encodings round-trip and keep the order of the values
+    const uint64_t numbers[] = { 0, 1, 127, 128, 255, 256, 1u << 28, UINT64_MAX - 1, UINT64_MAX };
+    char previous[MAX_KEY_LEN] = "";
+    for (size_t i = 0; i < sizeof(numbers) / sizeof(numbers[0]); i++) {
+        uint64_t decoded;
+        mu_assert("error, u64 encoded length", key_encode_u64(numbers[i], key) == KEY_INT_ENCODED_LEN);
+        mu_assert("error, u64 round trip", key_decode_u64(key, &decoded) && decoded == numbers[i]);
+        mu_assert("error, u64 order", i == 0 || strcmp(previous, key) < 0);
+        strcpy(previous, key);
+    }
+    const int64_t signed_numbers[] = { INT64_MIN, -1000, -1, 0, 1, 1000, INT64_MAX };
+    for (size_t i = 0; i < sizeof(signed_numbers) / sizeof(signed_numbers[0]); i++) {
+        int64_t decoded;
+        key_encode_i64(signed_numbers[i], key);
+        mu_assert("error, i64 round trip", key_decode_i64(key, &decoded) && decoded == signed_numbers[i]);
+        mu_assert("error, i64 order", i == 0 || strcmp(previous, key) < 0);
+        strcpy(previous, key);
+    }
+    mu_assert("error, string accepted as u64", !key_decode_u64("12345", &(uint64_t){0}));
+
+    // A u64 database, filled in an order unrelated to the numbers
+    DbOptions options = {0};
+    options.key_type = KEY_TYPE_U64;
+    db = db_open_with_options(TEST_DB_FILE, &options);
+    mu_assert("error, db_open failed", db != NULL);
+    mu_assert("error, key type", db->key_type == KEY_TYPE_U64);
+    int keys = 500; // Splits the root twice
+    for (int i = 0; i < keys; i++) {
+        uint64_t value = (uint64_t)((i * 7919) % keys) * 1000;
+        snprintf(buf, sizeof(buf), "v%llu", (unsigned long long)value);
+        mu_assert("error, encode", db_key_u64(db, value, key) == STATUS_OK);
+        mu_assert("error, insert", db_insert(db, key, buf) == STATUS_OK);
+    }
+    mu_assert("error, encode", db_key_u64(db, UINT64_MAX, key) == STATUS_OK);
+    mu_assert("error, insert max", db_insert(db, key, "max") == STATUS_OK);
+    mu_assert("error, string key accepted", db_insert(db, "plain", "v") == STATUS_ERROR);
+    mu_assert("error, i64 key for u64 database", db_key_i64(db, 1, key) == STATUS_ERROR);
+    db_close(db);
+
+    // The type is kept in the root and checked at open
+    options.key_type = KEY_TYPE_I64;
+    mu_assert("error, opened with another key type", db_open_with_options(TEST_DB_FILE, &options) == NULL);
+    db = db_open(TEST_DB_FILE);
+    mu_assert("error, db_open failed", db != NULL);
+    mu_assert("error, key type lost", db->key_type == KEY_TYPE_U64);
+    mu_assert("error, encode", db_key_u64(db, 42000, key) == STATUS_OK);
+    mu_assert("error, get", db_get_into(db, key, buf, sizeof(buf)) > 0 && strcmp(buf, "v42000") == 0);
+    mu_assert("error, parse", db_key_parse(db, "42000", key) == STATUS_OK &&
+                              db_get_into(db, key, buf, sizeof(buf)) > 0);
+    db_key_format(db, key, buf, sizeof(buf));
+    mu_assert("error, format", strcmp(buf, "42000") == 0);
+    DbSnapshot snapshot;
+    mu_assert("error, snapshot", db_snapshot(db, &snapshot) == STATUS_OK);
+    KeyOrderScan scan = { KEY_TYPE_U64, 0, true, 0 };
+    db_snapshot_scan(&snapshot, NULL, check_key_order, &scan);
+    db_snapshot_release(&snapshot);
+    mu_assert("error, u64 keys out of order", scan.ordered && scan.count == keys + 1);
+    clean_test_db();
+
+    // i64: negatives first
+    options.key_type = KEY_TYPE_I64;
+    db = db_open_with_options(TEST_DB_FILE, &options);
+    mu_assert("error, db_open failed", db != NULL);
+    for (int i = 0; i < 200; i++) {
+        int64_t value = (int64_t)((i * 37) % 200) - 100;
+        mu_assert("error, encode", db_key_i64(db, value, key) == STATUS_OK);
+        mu_assert("error, insert", db_insert(db, key, "v") == STATUS_OK);
+    }
+    mu_assert("error, snapshot", db_snapshot(db, &snapshot) == STATUS_OK);
+    scan = (KeyOrderScan){ KEY_TYPE_I64, 0, true, 0 };
+    db_snapshot_scan(&snapshot, NULL, check_key_order, &scan);
+    db_snapshot_release(&snapshot);
+    mu_assert("error, i64 keys out of order", scan.ordered && scan.count == 200 && scan.last == (99 ^ (1ull << 63)));
+    clean_test_db();
+
+    // Binary keys may hold any byte, NUL included
+    options.key_type = KEY_TYPE_BINARY;
+    options.key_width = 16;
+    db = db_open_with_options(TEST_DB_FILE, &options);
+    mu_assert("error, db_open failed", db != NULL);
+    uint8_t zeros[16] = {0};
+    uint8_t ones[16];
+    memset(ones, 0xFF, sizeof(ones));
+    mu_assert("error, encode", db_key_binary(db, zeros, sizeof(zeros), key) == STATUS_OK);
+    mu_assert("error, insert zeros", db_insert(db, key, "zeros") == STATUS_OK);
+    mu_assert("error, encode", db_key_binary(db, ones, sizeof(ones), key) == STATUS_OK);
+    mu_assert("error, insert ones", db_insert(db, key, "ones") == STATUS_OK);
+    mu_assert("error, wrong width", db_key_binary(db, ones, 8, key) == STATUS_ERROR);
+    mu_assert("error, parse", db_key_parse(db, "00000000000000000000000000000000", key) == STATUS_OK);
+    mu_assert("error, get zeros", db_get_into(db, key, buf, sizeof(buf)) == 5 && strcmp(buf, "zeros") == 0);
+    uint8_t decoded[16];
+    mu_assert("error, binary round trip", key_decode_binary(key, decoded, sizeof(decoded)) &&
+                                          memcmp(decoded, zeros, sizeof(zeros)) == 0);
+    clean_test_db();
+
+    options.key_width = 0;
+    mu_assert("error, opened without a binary width", db_open_with_options(TEST_DB_FILE, &options) == NULL);
+    clean_test_db();
+    printf("[Pass]  test_db_key_types PASSED\n");
+    return 0;
+}
+
+// Scan check for named tables: counts records, keys in increasing order
+typedef struct {
+    int count;
+    bool ordered;
+    char last[MAX_KEY_LEN];
+} TableScan;
+
+static int check_table_scan(const char *key, const char *value, void *arg) {
+    (void)value;
+    TableScan *scan = arg;
+    if (scan->count > 0 && strcmp(scan->last, key) >= 0) {
+        scan->ordered = false;
+    }
+    strcpy(scan->last, key);
+    scan->count++;
+    return 0;
+}
+
+// Overwrite page 0 of the test database with page
+static bool write_page0(const uint8_t *page) {
+    FILE *file = fopen(TEST_DB_FILE, "r+b");
+    if (!file) {
+        return false;
+    }
+    bool written = fwrite(page, 1, PAGE_SIZE, file) == PAGE_SIZE;
+    return fclose(file) == 0 && written;
+}
+
+// Page 0 carries the format version: a file of another version, or whose
+// page 0 is zero-filled, is refused at open instead of misread
+static const char *test_db_format_version() {
+    printf("Running test_db_format_version...\n");
+    clean_test_db();
+    db = db_open(TEST_DB_FILE);
+    mu_assert("error, db_open failed", db != NULL);
+    mu_assert("error, insert", db_insert(db, "k", "v") == STATUS_OK);
+    mu_assert("error, stamped", root_node_format(pager_get_page(db->pager, 0)) == DB_FORMAT_VERSION);
+    db_close(db);
+
+    uint8_t page[PAGE_SIZE];
+    FILE *file = fopen(TEST_DB_FILE, "rb");
+    mu_assert("error, read page 0", file && fread(page, 1, PAGE_SIZE, file) == PAGE_SIZE);
+    fclose(file);
+
+    // Another version, with a valid checksum
+    set_root_node_format(page, DB_FORMAT_VERSION + 1);
+    pager_set_checksum(page);
+    mu_assert("error, write page 0", write_page0(page));
+    db = db_open(TEST_DB_FILE);
+    mu_assert("error, other version opened", db == NULL);
+
+    // As written before versions existed
+    set_root_node_format(page, 0);
+    pager_set_checksum(page);
+    mu_assert("error, write page 0", write_page0(page));
+    db = db_open(TEST_DB_FILE);
+    mu_assert("error, unversioned opened", db == NULL);
+
+    // Zero-filled: the trailer of 0 does not pass for a checksum
+    memset(page, 0, sizeof(page));
+    mu_assert("error, write page 0", write_page0(page));
+    db = db_open(TEST_DB_FILE);
+    mu_assert("error, zeroed page 0 opened", db == NULL);
+
+    clean_test_db();
+    printf("[Pass]  test_db_format_version PASSED\n");
+    return 0;
+}
+
+// Named tables keep their records apart from the default tree and each
+// other, split their own roots, and survive a reopen; dropped ones are gone
+static const char *test_db_tables() {
+    printf("Running test_db_tables...\n");
+    clean_test_db();
+    db = db_open(TEST_DB_FILE);
+    mu_assert("error, db_open failed", db != NULL);
+    char key[MAX_KEY_LEN];
+    char buf[MAX_VALUE_LEN];
+
+    DbTableOptions counters = { KEY_TYPE_U64, 0 };
+    mu_assert("error, create users", db_create_table(db, "users", NULL) == STATUS_OK);
+    mu_assert("error, create counters", db_create_table(db, "counters", &counters) == STATUS_OK);
+    mu_assert("error, create twice", db_create_table(db, "users", NULL) == STATUS_EXISTS);
+    mu_assert("error, empty name", db_create_table(db, "", NULL) == STATUS_ERROR);
+
+    // One key, three trees
+    mu_assert("error, insert default", db_insert(db, "alice", "default") == STATUS_OK);
+    mu_assert("error, put users", db_table_put(db, "users", "alice", "user") == STATUS_OK);
+    mu_assert("error, get users", db_table_get_into(db, "users", "alice", buf, sizeof(buf)) == 4 &&
+                                  strcmp(buf, "user") == 0);
+    mu_assert("error, get default", db_get_into(db, "alice", buf, sizeof(buf)) == 7 && strcmp(buf, "default") == 0);
+    mu_assert("error, put replaces", db_table_put(db, "users", "alice", "user2") == STATUS_OK &&
+                                     db_table_get_into(db, "users", "alice", buf, sizeof(buf)) == 5);
+    mu_assert("error, string key in u64 table", db_table_put(db, "counters", "alice", "1") == STATUS_ERROR);
+    mu_assert("error, no such table", db_table_put(db, "missing", "alice", "1") == STATUS_ERROR);
+    mu_assert("error, catalog key accepted", db_insert(db, "\x01users", "7") == STATUS_ERROR);
+
+    // Enough records to split the table's root twice
+    int records = 300;
+    for (int i = 0; i < records; i++) {
+        snprintf(key, sizeof(key), "user%04d", (i * 7) % records);
+        mu_assert("error, put", db_table_put(db, "users", key, "v") == STATUS_OK);
+        key_encode_u64((uint64_t)i, key);
+        mu_assert("error, put counter", db_table_put(db, "counters", key, "0") == STATUS_OK);
+    }
+    TableScan scan = { 0, true, "" };
+    mu_assert("error, scan", db_table_scan(db, "users", NULL, check_table_scan, &scan) == records + 1);
+    mu_assert("error, table out of order", scan.ordered && scan.count == records + 1);
+    mu_assert("error, table delete", db_table_delete(db, "users", "alice") == STATUS_OK &&
+                                     db_table_delete(db, "users", "alice") == STATUS_NOT_FOUND);
+
+    // The default tree does not show the catalog
+    DbSnapshot snapshot;
+    mu_assert("error, snapshot", db_snapshot(db, &snapshot) == STATUS_OK);
+    scan = (TableScan){ 0, true, "" };
+    mu_assert("error, default scan", db_snapshot_scan(&snapshot, NULL, check_table_scan, &scan) == 1);
+    db_snapshot_release(&snapshot);
+    mu_assert("error, default tree sees catalog", scan.count == 1 && strcmp(scan.last, "alice") == 0);
+    db_close(db);
+
+    // Reopen: the catalog is read back with the key types
+    db = db_open(TEST_DB_FILE);
+    mu_assert("error, reopen failed", db != NULL);
+    DbTable tables[4];
+    mu_assert("error, table count", db_tables(db, tables, 4) == 2);
+    DbTable info;
+    mu_assert("error, counters info", db_table_info(db, "counters", &info) == STATUS_OK &&
+                                      info.key_type == KEY_TYPE_U64 && info.root_page != 0);
+    key_encode_u64(123, key);
+    mu_assert("error, get counter", db_table_get_into(db, "counters", key, buf, sizeof(buf)) == 1);
+    mu_assert("error, get user", db_table_get_into(db, "users", "user0123", buf, sizeof(buf)) == 1);
+
+    // Dropped tables are gone, and a new table of that name starts empty
+    mu_assert("error, drop", db_drop_table(db, "users") == STATUS_OK);
+    mu_assert("error, drop twice", db_drop_table(db, "users") == STATUS_NOT_FOUND);
+    mu_assert("error, get after drop", db_table_get_into(db, "users", "user0123", buf, sizeof(buf)) == STATUS_ERROR);
+    mu_assert("error, recreate", db_create_table(db, "users", NULL) == STATUS_OK);
+    mu_assert("error, recreated table not empty",
+              db_table_get_into(db, "users", "user0123", buf, sizeof(buf)) == STATUS_NOT_FOUND);
+    db_close(db);
+    db = db_open(TEST_DB_FILE);
+    mu_assert("error, reopen failed", db != NULL);
+    mu_assert("error, table count after drop", db_tables(db, tables, 4) == 2);
+    mu_assert("error, default record", db_get_into(db, "alice", buf, sizeof(buf)) == 7);
+
+    clean_test_db();
+    printf("[Pass]  test_db_tables PASSED\n");
+    return 0;
+}
+
+#ifndef _WIN32
+// Run write in a child process that has TEST_DB_FILE open and exits
+// without closing it, as a crash would: whatever the pager evicted is in
+// the WAL only, the database file stops short of it
+static bool crash_writer(void (*write)(Database *crashing)) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        Database *crashing = db_open(TEST_DB_FILE);
+        if (!crashing) {
+            _exit(1);
+        }
+        write(crashing);
+        _exit(0);
+    }
+    int status;
+    return pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static void crash_key(int i, char *key) {
+    snprintf(key, MAX_KEY_LEN, "crash%05d", i);
+}
+
+static void insert_crash_keys(Database *target, int first, int last) {
+    char key[MAX_KEY_LEN];
+    for (int i = first; i < last; i++) {
+        crash_key(i, key);
+        db_insert(target, key, key);
+    }
+}
+
+// An index on the city, then records of cities c00 to c09
+static void crash_fill_indexed(Database *crashing) {
+    char key[MAX_KEY_LEN];
+    char value[MAX_VALUE_LEN];
+    DbIndexOptions by_city = { NULL, ',', 0 };
+    if (db_create_index(crashing, "city", &by_city) != STATUS_OK) {
+        _exit(1);
+    }
+    for (int i = 0; i < 1500; i++) {
+        snprintf(key, sizeof(key), "j%04d", i);
+        snprintf(value, sizeof(value), "c%02d,%d", i % 10, i);
+        db_insert(crashing, key, value);
+    }
+}
+
+// Counts the records of a snapshot whose city (field 0) is want
+typedef struct {
+    const char *want;
+    int64_t count;
+} CityCount;
+
+static int count_city(const char *key, const char *value, void *arg) {
+    (void)key;
+    CityCount *city = arg;
+    char field[INDEX_FIELD_MAX + 1];
+    if (index_field(value, ',', 0, field) && strcmp(field, city->want) == 0) {
+        city->count++;
+    }
+    return 0;
+}
+
+static int count_entry(const char *key, const char *value, void *arg) {
+    (void)key;
+    (void)value;
+    (*(int64_t *)arg)++;
+    return 0;
+}
+
+// The city index holds one entry per record, and finds the same records
+// for each city as a scan of the table
+static bool city_index_agrees(void) {
+    DbIndex info;
+    BTreeFillStats fill;
+    if (db_index_info(db, "city", &info) != STATUS_OK || btree_fill_stats(db->pager, info.root_page, &fill) != 0 ||
+        (int64_t)fill.cells != db_count(db, NULL, NULL)) {
+        return false;
+    }
+    DbSnapshot snapshot;
+    if (db_snapshot(db, &snapshot) != STATUS_OK) {
+        return false;
+    }
+    bool agree = true;
+    for (int c = 0; c < 10 && agree; c++) {
+        char want[8];
+        char high[8];
+        snprintf(want, sizeof(want), "c%02d", c);
+        snprintf(high, sizeof(high), "c%02d", c + 1);
+        CityCount city = { want, 0 };
+        int64_t entries = 0;
+        db_snapshot_scan(&snapshot, NULL, count_city, &city);
+        agree = db_index_scan(db, "city", want, high, count_entry, &entries) == city.count && city.count > 0;
+    }
+    db_snapshot_release(&snapshot);
+    return agree;
+}
+#endif
+
+// Secondary indexes follow inserts, updates and deletes, answer exact and
+// range lookups, tell apart fields longer than an entry keeps, and are read
+// back from the catalog
+static const char *test_db_secondary_index() {
+    printf("Running test_db_secondary_index...\n");
+    clean_test_db();
+    db = db_open(TEST_DB_FILE);
+    mu_assert("error, db_open failed", db != NULL);
+    char key[MAX_KEY_LEN];
+    char value[MAX_VALUE_LEN];
+    char found[MAX_KEY_LEN];
+    char buf[MAX_VALUE_LEN];
+
+    // "city,n": cities c00 to c09, thirty records each
+    int records = 300;
+    for (int i = 0; i < records; i++) {
+        snprintf(key, sizeof(key), "k%04d", i);
+        snprintf(value, sizeof(value), "c%02d,%d", i % 10, i);
+        mu_assert("error, insert", db_insert(db, key, value) == STATUS_OK);
+    }
+    // Built from the records already there
+    DbIndexOptions by_city = { NULL, ',', 0 };
+    mu_assert("error, create index", db_create_index(db, "city", &by_city) == STATUS_OK);
+    mu_assert("error, create twice", db_create_index(db, "city", &by_city) == STATUS_EXISTS);
+    mu_assert("error, no such index", db_get_by_index(db, "missing", "c01", found, buf, sizeof(buf)) == STATUS_ERROR);
+    mu_assert("error, get by index", db_get_by_index(db, "city", "c03", found, buf, sizeof(buf)) == 5 &&
+                                     strcmp(found, "k0003") == 0 && strcmp(buf, "c03,3") == 0);
+    mu_assert("error, missing field", db_get_by_index(db, "city", "c1", found, buf, sizeof(buf)) == STATUS_NOT_FOUND);
+    TableScan scan = { 0, true, "" };
+    mu_assert("error, exact range", db_index_scan(db, "city", "c04", "c05", check_table_scan, &scan) == 30);
+    scan = (TableScan){ 0, true, "" };
+    mu_assert("error, range", db_index_scan(db, "city", "c02", "c05", check_table_scan, &scan) == 90);
+    mu_assert("error, unbounded", db_index_scan(db, "city", NULL, NULL, check_table_scan, &scan) == records);
+
+    // Writes move entries: an update changes the city, a delete drops it,
+    // an insert adds one
+    mu_assert("error, update", db_update(db, "k0003", "c99,3") == STATUS_OK);
+    mu_assert("error, updated field", db_get_by_index(db, "city", "c99", found, buf, sizeof(buf)) == 5 &&
+                                      strcmp(found, "k0003") == 0);
+    mu_assert("error, old entry left", db_get_by_index(db, "city", "c03", found, buf, sizeof(buf)) > 0 &&
+                                       strcmp(found, "k0013") == 0);
+    mu_assert("error, delete", db_delete(db, "k0013") == STATUS_OK);
+    scan = (TableScan){ 0, true, "" };
+    mu_assert("error, after delete", db_index_scan(db, "city", "c03", "c04", check_table_scan, &scan) == 28);
+    mu_assert("error, insert", db_insert(db, "k9999", "c03") == STATUS_OK);
+    scan = (TableScan){ 0, true, "" };
+    mu_assert("error, after insert", db_index_scan(db, "city", "c03", "c04", check_table_scan, &scan) == 29);
+
+    // Fields that only differ past the part an entry keeps
+    memset(value, 'x', 100);
+    value[100] = '\0';
+    mu_assert("error, insert long", db_insert(db, "long1", value) == STATUS_OK);
+    value[99] = 'y';
+    mu_assert("error, insert long", db_insert(db, "long2", value) == STATUS_OK);
+    mu_assert("error, long field", db_get_by_index(db, "city", value, found, buf, sizeof(buf)) == 100 &&
+                                   strcmp(found, "long2") == 0);
+    db_close(db);
+
+    // Reopen: the index is in the catalog and still in step
+    db = db_open(TEST_DB_FILE);
+    mu_assert("error, reopen failed", db != NULL);
+    DbIndex info;
+    mu_assert("error, index info", db_index_info(db, "city", &info) == STATUS_OK && info.delimiter == ',' &&
+                                   info.field == 0 && info.table_root == 0 && info.root_page != 0);
+    mu_assert("error, get after reopen", db_get_by_index(db, "city", "c99", found, buf, sizeof(buf)) == 5);
+    DbSnapshot snapshot;
+    mu_assert("error, snapshot", db_snapshot(db, &snapshot) == STATUS_OK);
+    scan = (TableScan){ 0, true, "" };
+    mu_assert("error, catalog shown", db_snapshot_scan(&snapshot, NULL, check_table_scan, &scan) == records + 2);
+    db_snapshot_release(&snapshot);
+
+    // An index of a named table goes with it
+    mu_assert("error, create table", db_create_table(db, "people", NULL) == STATUS_OK);
+    mu_assert("error, table put", db_table_put(db, "people", "p1", "ann") == STATUS_OK);
+    DbIndexOptions by_name = { "people", '\0', 0 };
+    mu_assert("error, name taken", db_create_index(db, "people", &by_name) == STATUS_EXISTS);
+    mu_assert("error, create table index", db_create_index(db, "name", &by_name) == STATUS_OK);
+    mu_assert("error, table put", db_table_put(db, "people", "p2", "bob") == STATUS_OK);
+    mu_assert("error, table put", db_table_put(db, "people", "p1", "cy") == STATUS_OK);
+    mu_assert("error, table index", db_get_by_index(db, "name", "bob", found, buf, sizeof(buf)) == 3 &&
+                                    strcmp(found, "p2") == 0);
+    mu_assert("error, replaced entry left", db_get_by_index(db, "name", "ann", found, buf, 0) == STATUS_NOT_FOUND);
+    mu_assert("error, default tree untouched", db_get_by_index(db, "city", "bob", found, buf, 0) == STATUS_NOT_FOUND);
+    mu_assert("error, drop table", db_drop_table(db, "people") == STATUS_OK);
+    mu_assert("error, index outlived table", db_index_info(db, "name", &info) == STATUS_NOT_FOUND);
+    mu_assert("error, drop index", db_drop_index(db, "city") == STATUS_OK &&
+                                   db_drop_index(db, "city") == STATUS_NOT_FOUND);
+    db_close(db);
+    db = db_open(TEST_DB_FILE);
+    mu_assert("error, reopen failed", db != NULL);
+    mu_assert("error, dropped index back", db_index_info(db, "city", &info) == STATUS_NOT_FOUND);
+    mu_assert("error, records lost", db_get_into(db, "k0003", buf, sizeof(buf)) == 5);
+
+#ifndef _WIN32
+    // A writer on a new file crashes with its records and index entries in
+    // the WAL; both are recovered, and writes after the reopen keep them
+    // in step
+    clean_test_db();
+    mu_assert("error, crashed writer", crash_writer(crash_fill_indexed));
+    db = db_open(TEST_DB_FILE);
+    mu_assert("error, reopen failed", db != NULL);
+    mu_assert("error, index after crash", city_index_agrees());
+    for (int i = 0; i < 500; i++) {
+        snprintf(key, sizeof(key), "m%04d", i);
+        snprintf(value, sizeof(value), "c%02d,%d", i % 10, i);
+        mu_assert("error, insert after crash", db_insert(db, key, value) == STATUS_OK);
+    }
+    mu_assert("error, update after crash", db_update(db, "j0003", "c07,3") == STATUS_OK);
+    mu_assert("error, delete after crash", db_delete(db, "j0004") == STATUS_OK);
+    mu_assert("error, index after writes", city_index_agrees());
+    for (int i = 0; i < 2000; i++) {
+        int n = i < 1500 ? i : i - 1500;
+        snprintf(key, sizeof(key), "%c%04d", i < 1500 ? 'j' : 'm', n);
+        snprintf(value, sizeof(value), "c%02d,%d", i == 3 ? 7 : n % 10, n);
+        int length = db_get_into(db, key, buf, sizeof(buf));
+        mu_assert("error, record after crash",
+                  i == 4 ? length == STATUS_NOT_FOUND : length > 0 && strcmp(buf, value) == 0);
+    }
+    mu_assert("error, snapshot", db_snapshot(db, &snapshot) == STATUS_OK);
+    scan = (TableScan){ 0, true, "" };
+    int64_t scanned = db_snapshot_scan(&snapshot, NULL, check_table_scan, &scan);
+    db_snapshot_release(&snapshot);
+    mu_assert("error, scan after crash", scanned == db_count(db, NULL, NULL) && scan.ordered);
+#endif
+
+    clean_test_db();
+    printf("[Pass]  test_db_secondary_index PASSED\n");
+    return 0;
+}
+
+#ifndef _WIN32
+// Blind increments of "hits" from one of several threads
+static void *deferred_incr_worker(void *arg) {
+    (void)arg;
+    for (int i = 0; i < 200; i++) {
+        if (db_incr(db, "hits", 1, NULL) != STATUS_OK) {
+            return "incr failed";
+        }
+    }
+    return NULL;
+}
+#endif
+
+// Merge operator for the test: keeps the larger of two integers
+static int merge_max(const char *key, const char *existing, const char *operand, char *out, void *arg) {
+    (void)key;
+    (*(int *)arg)++;
+    long long value = atoll(operand);
+    if (existing && atoll(existing) > value) {
+        value = atoll(existing);
+    }
+    snprintf(out, MAX_VALUE_LEN, "%lld", value);
+    return STATUS_OK;
+}
+
+// Copy a file as it is, to look at a database as a crash would leave it
+static bool copy_file(const char *from, const char *to) {
+    FILE *in = fopen(from, "rb");
+    FILE *out = fopen(to, "wb");
+    char chunk[4096];
+    size_t n;
+    bool ok = in && out;
+    while (ok && (n = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+        ok = fwrite(chunk, 1, n, out) == n;
+    }
+    if (in) fclose(in);
+    if (out) fclose(out);
+    return ok;
+}
+
+// Put an entry for key under field in an index, behind the database's back
+static void plant_index_entry(const DbIndex *index, const char *field, const char *key) {
+    char entry[MAX_KEY_LEN];
+    index_entry_key(field, key, entry);
+    Cursor cursor;
+    if (table_find_into(db->pager, index->root_page, entry, &cursor) == 0) {
+        leaf_node_insert(&cursor, entry, key);
+    }
+}
+
+// A write whose index entry cannot be added fails as a whole: its record
+// change is rolled back with the rest of its transaction, cached values
+// stay those of the tree, and the merges it folded stay pending
+static const char *test_db_failed_write() {
+    printf("Running test_db_failed_write...\n");
+    clean_test_db();
+    DbOptions options = {0};
+    options.row_cache_bytes = 1 << 20;
+    options.deferred_merges = true;
+    db = db_open_with_options(TEST_DB_FILE, &options);
+    mu_assert("error, db_open failed", db != NULL);
+    char key[MAX_KEY_LEN];
+    char value[MAX_VALUE_LEN];
+    char buf[MAX_VALUE_LEN];
+    int records = 200;
+    for (int i = 0; i < records; i++) {
+        snprintf(key, sizeof(key), "k%04d", i);
+        snprintf(value, sizeof(value), "c%02d,%d", i % 10, i);
+        mu_assert("error, insert", db_insert(db, key, value) == STATUS_OK);
+    }
+    DbIndexOptions by_city = { NULL, ',', 0 };
+    mu_assert("error, create index", db_create_index(db, "city", &by_city) == STATUS_OK);
+    DbIndex info;
+    mu_assert("error, index info", db_index_info(db, "city", &info) == STATUS_OK);
+    // The entries these writes would add are taken already
+    plant_index_entry(&info, "c77", "k0003");
+    plant_index_entry(&info, "c77", "new");
+    BTreeFillStats fill;
+    mu_assert("error, fill stats", btree_fill_stats(db->pager, info.root_page, &fill) == 0);
+    uint32_t entries = fill.cells;
+    char found[MAX_KEY_LEN];
+
+    mu_assert("error, cached", db_get_into(db, "k0003", buf, sizeof(buf)) == 5 &&
+                               db_get_into(db, "k0003", buf, sizeof(buf)) == 5);
+    mu_assert("error, incr", db_incr(db, "hits", 1, NULL) == STATUS_OK && db->num_pending_merges == 1);
+    mu_assert("error, update went through", db_update(db, "k0003", "c77,x") == STATUS_ERROR);
+    mu_assert("error, merge dropped", db->num_pending_merges == 1);
+    mu_assert("error, insert went through", db_insert(db, "new", "c77,y") == STATUS_ERROR);
+    mu_assert("error, entries changed", btree_fill_stats(db->pager, info.root_page, &fill) == 0 &&
+                                        fill.cells == entries);
+    // Reads fold the merge first
+    mu_assert("error, stale value", db_get_into(db, "k0003", buf, sizeof(buf)) == 5 && strcmp(buf, "c03,3") == 0);
+    mu_assert("error, record left", db_get_into(db, "new", buf, sizeof(buf)) == STATUS_NOT_FOUND);
+    mu_assert("error, old entry gone", db_get_by_index(db, "city", "c03", found, buf, sizeof(buf)) == 5 &&
+                                       strcmp(found, "k0003") == 0);
+    mu_assert("error, merge lost", db_get_into(db, "hits", buf, sizeof(buf)) == 1 && strcmp(buf, "1") == 0);
+    // Later writes commit as usual
+    mu_assert("error, insert after", db_insert(db, "k9999", "c09,9999") == STATUS_OK);
+    mu_assert("error, fill stats", btree_fill_stats(db->pager, info.root_page, &fill) == 0);
+    entries = fill.cells;
+    db_close(db);
+
+    // Nothing of the failed writes reached the WAL
+    db = db_open(TEST_DB_FILE);
+    mu_assert("error, reopen failed", db != NULL);
+    mu_assert("error, value after reopen", db_get_into(db, "k0003", buf, sizeof(buf)) == 5 &&
+                                           strcmp(buf, "c03,3") == 0);
+    mu_assert("error, record after reopen", db_get_into(db, "new", buf, sizeof(buf)) == STATUS_NOT_FOUND);
+    mu_assert("error, merge after reopen", db_get_into(db, "hits", buf, sizeof(buf)) == 1);
+    mu_assert("error, count", db_count(db, NULL, NULL) == records + 2);
+    mu_assert("error, entries after reopen", btree_fill_stats(db->pager, info.root_page, &fill) == 0 &&
+                                             fill.cells == entries);
+    mu_assert("error, entry after reopen", db_get_by_index(db, "city", "c03", found, buf, sizeof(buf)) == 5 &&
+                                           strcmp(found, "k0003") == 0);
+    clean_test_db();
+    printf("[Pass]  test_db_failed_write PASSED\n");
+    return 0;
+}
+
+// Increments, appends, compare-and-swap and a merge operator change one
+// record at a time; deferred merges are folded before reads and survive a
+// crash without being applied twice
+static const char *test_db_read_modify_write() {
+    printf("Running test_db_read_modify_write...\n");
+    clean_test_db();
+    db = db_open(TEST_DB_FILE);
+    mu_assert("error, db_open failed", db != NULL);
+    char buf[MAX_VALUE_LEN];
+    int64_t result = 0;
+
+    mu_assert("error, incr missing", db_incr(db, "hits", 1, &result) == STATUS_OK && result == 1);
+    mu_assert("error, incr", db_incr(db, "hits", 41, &result) == STATUS_OK && result == 42);
+    mu_assert("error, decr", db_incr(db, "hits", -50, &result) == STATUS_OK && result == -8);
+    mu_assert("error, stored", db_get_into(db, "hits", buf, sizeof(buf)) == 2 && strcmp(buf, "-8") == 0);
+    mu_assert("error, insert text", db_insert(db, "name", "ann") == STATUS_OK);
+    mu_assert("error, incr text", db_incr(db, "name", 1, NULL) == STATUS_ERROR);
+    mu_assert("error, insert max", db_insert(db, "big", "9223372036854775807") == STATUS_OK);
+    mu_assert("error, overflow", db_incr(db, "big", 1, NULL) == STATUS_ERROR);
+
+    mu_assert("error, append", db_append(db, "name", "-bob") == STATUS_OK &&
+                               db_get_into(db, "name", buf, sizeof(buf)) == 7 && strcmp(buf, "ann-bob") == 0);
+    mu_assert("error, append missing", db_append(db, "log", "a") == STATUS_OK);
+    char long_suffix[MAX_VALUE_LEN - 1];
+    memset(long_suffix, 'x', sizeof(long_suffix) - 1);
+    long_suffix[sizeof(long_suffix) - 1] = '\0';
+    mu_assert("error, append too long", db_append(db, "log", long_suffix) == STATUS_OK &&
+                                        db_append(db, "log", "yz") == STATUS_ERROR);
+
+    mu_assert("error, cas", db_compare_and_swap(db, "name", "ann-bob", "cy") == STATUS_OK);
+    mu_assert("error, cas stale", db_compare_and_swap(db, "name", "ann-bob", "dee") == STATUS_CONFLICT);
+    mu_assert("error, cas absent", db_compare_and_swap(db, "fresh", NULL, "1") == STATUS_OK);
+    mu_assert("error, cas exists", db_compare_and_swap(db, "fresh", NULL, "2") == STATUS_CONFLICT);
+    mu_assert("error, cas missing", db_compare_and_swap(db, "nobody", "1", "2") == STATUS_CONFLICT);
+    mu_assert("error, cas value", db_get_into(db, "name", buf, sizeof(buf)) == 2 && strcmp(buf, "cy") == 0);
+
+    int calls = 0;
+    mu_assert("error, merge without operator", db_merge(db, "max", "3") == STATUS_ERROR);
+    mu_assert("error, set operator", db_set_merge_operator(db, merge_max, &calls) == STATUS_OK);
+    mu_assert("error, merge", db_merge(db, "max", "3") == STATUS_OK && db_merge(db, "max", "9") == STATUS_OK &&
+                              db_merge(db, "max", "5") == STATUS_OK);
+    mu_assert("error, merged", db_get_into(db, "max", buf, sizeof(buf)) == 1 && strcmp(buf, "9") == 0);
+    mu_assert("error, reserved key", db_incr(db, "\x01t", 1, NULL) == STATUS_ERROR);
+    db_close(db);
+
+    // Deferred: blind merges are logged and folded before the next read
+    DbOptions options = {0};
+    options.deferred_merges = true;
+    db = db_open_with_options(TEST_DB_FILE, &options);
+    mu_assert("error, reopen failed", db != NULL);
+    db_set_merge_operator(db, merge_max, &calls);
+    calls = 0;
+    for (int i = 0; i < 100; i++) {
+        mu_assert("error, blind incr", db_incr(db, "hits", 1, NULL) == STATUS_OK);
+    }
+    mu_assert("error, deferred merge", db_merge(db, "max", "20") == STATUS_OK && db_merge(db, "max", "4") == STATUS_OK);
+    mu_assert("error, merges not pending", db->num_pending_merges == 102 && calls == 0);
+    mu_assert("error, deferred sum", db_get_into(db, "hits", buf, sizeof(buf)) == 2 && strcmp(buf, "92") == 0);
+    mu_assert("error, folded", db->num_pending_merges == 0 && calls == 2);
+    mu_assert("error, incr with result", db_incr(db, "hits", 8, &result) == STATUS_OK && result == 100);
+    mu_assert("error, deferred new key", db_append(db, "later", "x") == STATUS_OK &&
+                                         db_delete(db, "later") == STATUS_OK);
+
+    // A crash with merges pending: the copy recovers them once
+    mu_assert("error, blind incr", db_incr(db, "hits", 5, NULL) == STATUS_OK);
+    mu_assert("error, blind incr", db_incr(db, "hits", 5, NULL) == STATUS_OK);
+    mu_assert("error, copy", copy_file(TEST_DB_FILE, "test_db_crash.dat") &&
+                             copy_file("test_db.dat.wal", "test_db_crash.dat.wal"));
+    Database *crashed = db_open_with_options("test_db_crash.dat", &options);
+    mu_assert("error, open copy", crashed != NULL);
+    mu_assert("error, recovered", db_get_into(crashed, "hits", buf, sizeof(buf)) == 3 && strcmp(buf, "110") == 0);
+    mu_assert("error, later key", db_get_into(crashed, "later", buf, sizeof(buf)) == STATUS_NOT_FOUND);
+    db_close(crashed);
+    remove("test_db_crash.dat");
+    remove("test_db_crash.dat.wal");
+    const char *expected_hits = "110";
+
+#ifndef _WIN32
+    // Threads merging at once share operand frames and syncs. At a crash
+    // every merge that returned is recovered, and the copy logs them again
+    // packed: 802 records of 10 bytes take two frames.
+    pthread_t threads[4];
+    for (int t = 0; t < 4; t++) {
+        mu_assert("error, start thread", pthread_create(&threads[t], NULL, deferred_incr_worker, NULL) == 0);
+    }
+    bool merged = true;
+    for (int t = 0; t < 4; t++) {
+        void *failure;
+        pthread_join(threads[t], &failure);
+        merged = merged && failure == NULL;
+    }
+    mu_assert("error, concurrent incr", merged && db->num_pending_merges == 802);
+    mu_assert("error, copy", copy_file(TEST_DB_FILE, "test_db_crash.dat") &&
+                             copy_file("test_db.dat.wal", "test_db_crash.dat.wal"));
+    crashed = db_open_with_options("test_db_crash.dat", &options);
+    mu_assert("error, open copy", crashed != NULL);
+    mu_assert("error, relogged packed", crashed->num_pending_merges == 802 && crashed->wal->num_frames == 2);
+    mu_assert("error, recovered", db_get_into(crashed, "hits", buf, sizeof(buf)) == 3 && strcmp(buf, "910") == 0);
+    db_close(crashed);
+    remove("test_db_crash.dat");
+    remove("test_db_crash.dat.wal");
+    expected_hits = "910";
+#endif
+
+    // Closing folds them too
+    db_close(db);
+    db = db_open(TEST_DB_FILE);
+    mu_assert("error, reopen failed", db != NULL);
+    mu_assert("error, after close", db_get_into(db, "hits", buf, sizeof(buf)) == 3 && strcmp(buf, expected_hits) == 0);
+    mu_assert("error, max after close", db_get_into(db, "max", buf, sizeof(buf)) == 2 && strcmp(buf, "20") == 0);
+
+    clean_test_db();
+    printf("[Pass]  test_db_read_modify_write PASSED\n");
+    return 0;
+}
+
+// Expired records vanish from reads at once, make way for new ones, and
+// are deleted by the sweeper leaf by leaf with their index entries
+static const char *test_db_expiry() {
+    printf("Running test_db_expiry...\n");
+    clean_test_db();
+    DbOptions options = {0};
+    options.row_cache_bytes = 1 << 20;
+    db = db_open_with_options(TEST_DB_FILE, &options);
+    mu_assert("error, db_open failed", db != NULL);
+    char key[MAX_KEY_LEN];
+    char buf[MAX_VALUE_LEN];
+    time_t now = time(NULL);
+    time_t expires_at;
+
+    // Every third record has expired, every third will expire in an hour
+    int records = 300;
+    int expired = 0;
+    for (int i = 0; i < records; i++) {
+        snprintf(key, sizeof(key), "s%04d", i);
+        time_t when = i % 3 == 0 ? now - 1 : i % 3 == 1 ? now + 3600 : 0;
+        expired += i % 3 == 0;
+        mu_assert("error, insert", db_insert_expiring(db, key, "session", when) == STATUS_OK);
+    }
+    DbIndexOptions whole = { NULL, '\0', 0 };
+    mu_assert("error, create index", db_create_index(db, "by_value", &whole) == STATUS_OK);
+    mu_assert("error, expired get", db_get(db, "s0000") == NULL &&
+                                    db_get_into(db, "s0000", buf, sizeof(buf)) == STATUS_NOT_FOUND);
+    DbPinnedValue pinned;
+    mu_assert("error, expired pinned", db_get_pinned(db, "s0003", &pinned) == STATUS_NOT_FOUND);
+    const char *keys[] = { "s0001", "s0003", "s0002" };
+    char out[3][MAX_VALUE_LEN];
+    bool found[3];
+    mu_assert("error, multi get", db_multi_get(db, keys, 3, out, found) == 2 && found[0] && !found[1] && found[2]);
+    mu_assert("error, live get", db_get_into(db, "s0001", buf, sizeof(buf)) == 7);
+    mu_assert("error, expiry", db_get_expiry(db, "s0001", &expires_at) == STATUS_OK && expires_at == now + 3600);
+    mu_assert("error, no expiry", db_get_expiry(db, "s0002", &expires_at) == STATUS_OK && expires_at == 0);
+    mu_assert("error, expired expiry", db_get_expiry(db, "s0000", &expires_at) == STATUS_NOT_FOUND);
+    // Expiring records stay out of the row cache, others go in
+    RowCacheStats rows;
+    row_cache_get_stats(db->row_cache, &rows);
+    uint64_t cached = rows.entries;
+    db_get_into(db, "s0004", buf, sizeof(buf));
+    db_get_into(db, "s0005", buf, sizeof(buf));
+    row_cache_get_stats(db->row_cache, &rows);
+    mu_assert("error, row cache", rows.entries == cached + 1);
+
+    DbSnapshot snapshot;
+    mu_assert("error, snapshot", db_snapshot(db, &snapshot) == STATUS_OK);
+    TableScan scan = { 0, true, "" };
+    mu_assert("error, scan", db_snapshot_scan(&snapshot, NULL, check_table_scan, &scan) == records - expired &&
+                             scan.ordered);
+    db_snapshot_release(&snapshot);
+    scan = (TableScan){ 0, true, "" };
+    mu_assert("error, index scan", db_index_scan(db, "by_value", NULL, NULL, check_table_scan, &scan) ==
+                                   records - expired);
+
+    // Writes see an expired record as missing
+    mu_assert("error, update expired", db_update(db, "s0003", "x") == STATUS_NOT_FOUND);
+    mu_assert("error, delete expired", db_delete(db, "s0006") == STATUS_NOT_FOUND);
+    mu_assert("error, insert live", db_insert(db, "s0001", "x") == STATUS_EXISTS);
+    mu_assert("error, replace expired", db_insert(db, "s0003", "renewed") == STATUS_OK &&
+                                        db_get_into(db, "s0003", buf, sizeof(buf)) == 7 &&
+                                        db_get_expiry(db, "s0003", &expires_at) == STATUS_OK && expires_at == 0);
+    mu_assert("error, incr expired", db_incr(db, "s0009", 2, NULL) == STATUS_OK &&
+                                     db_get_into(db, "s0009", buf, sizeof(buf)) == 1 && strcmp(buf, "2") == 0);
+    mu_assert("error, replaced entry", db_get_by_index(db, "by_value", "renewed", key, buf, sizeof(buf)) == 7 &&
+                                       strcmp(key, "s0003") == 0);
+    expired -= 2;
+    // An update keeps the expiry time, db_expire sets and clears it
+    mu_assert("error, update", db_update(db, "s0001", "v2") == STATUS_OK &&
+                               db_get_expiry(db, "s0001", &expires_at) == STATUS_OK && expires_at == now + 3600);
+    mu_assert("error, persist", db_expire(db, "s0001", 0) == STATUS_OK &&
+                                db_get_expiry(db, "s0001", &expires_at) == STATUS_OK && expires_at == 0);
+    mu_assert("error, expire now", db_expire(db, "s0002", now) == STATUS_OK &&
+                                   db_get_into(db, "s0002", buf, sizeof(buf)) == STATUS_NOT_FOUND);
+    mu_assert("error, expire missing", db_expire(db, "s0000", now + 10) == STATUS_NOT_FOUND);
+    expired++;
+    db_close(db);
+
+    // Expiry times are kept in the leaves
+    db = db_open(TEST_DB_FILE);
+    mu_assert("error, reopen failed", db != NULL);
+    mu_assert("error, expiry after reopen", db_get_expiry(db, "s0004", &expires_at) == STATUS_OK &&
+                                            expires_at == now + 3600);
+    mu_assert("error, expired after reopen", db_get_into(db, "s0002", buf, sizeof(buf)) == STATUS_NOT_FOUND);
+
+    // The sweeper takes a few leaves at a time and stops at the end
+    BTreeFillStats fill;
+    db_fill_stats(db, &fill);
+    uint64_t cells = fill.cells;
+    int swept = 0;
+    for (uint32_t leaf = 0; leaf < fill.leaf_pages; leaf += 4) {
+        int removed = db_expire_sweep(db, 4);
+        mu_assert("error, sweep step", removed >= 0 && removed <= 4 * (int)LEAF_NODE_MAX_CELLS);
+        swept += removed;
+    }
+    mu_assert("error, swept", swept == expired);
+    db_fill_stats(db, &fill);
+    mu_assert("error, cells left", fill.cells == cells - (uint64_t)expired);
+    mu_assert("error, sweep again", db_expire_sweep(db, 1000) == 0);
+    scan = (TableScan){ 0, true, "" };
+    mu_assert("error, index entries left", db_index_scan(db, "by_value", NULL, NULL, check_table_scan, &scan) ==
+                                           records - expired);
+    db_close(db);
+
+    // The background sweep runs from operations once a second has passed
+    options = (DbOptions){0};
+    options.expiry_sweep_leaves = 1000;
+    db = db_open_with_options(TEST_DB_FILE, &options);
+    mu_assert("error, reopen failed", db != NULL);
+    mu_assert("error, expire", db_expire(db, "s0004", now - 1) == STATUS_OK);
+    db->expiry_swept_at = 0;
+    for (int i = 0; i < DB_EXPIRY_CHECK_OPS; i++) {
+        db_get_into(db, "s0001", buf, sizeof(buf));
+    }
+    db_fill_stats(db, &fill);
+    mu_assert("error, background sweep", fill.cells == cells - (uint64_t)expired - 1);
+
+    clean_test_db();
+    printf("[Pass]  test_db_expiry PASSED\n");
+    return 0;
+}
+
+// Keys whose neighbours share a long prefix, so separators are long and
+// internal nodes split while the test stays small
+static void rank_key(int i, char *key) {
+    snprintf(key, MAX_KEY_LEN, "%03d%080d%05d", i / 20, 0, i);
+}
+
+// Records under page_num; clears *consistent if an internal node's count
+// for a child differs from what the child holds
+static uint64_t count_subtree(Pager *pager, uint32_t page_num, bool *consistent) {
+    void *node = pager_get_page(pager, page_num);
+    if (get_node_type(node) == NODE_LEAF) {
+        return *leaf_node_num_cells(node);
+    }
+    // Copied out: the walk below may evict the node
+    uint32_t num_keys = *internal_node_num_keys(node);
+    uint32_t children[INTERNAL_NODE_MAX_CELLS + 1];
+    uint32_t counts[INTERNAL_NODE_MAX_CELLS + 1];
+    for (uint32_t i = 0; i <= num_keys; i++) {
+        children[i] = *internal_node_child(node, i);
+        counts[i] = *internal_node_child_count(node, i);
+    }
+    uint64_t total = 0;
+    for (uint32_t i = 0; i <= num_keys; i++) {
+        uint64_t below = count_subtree(pager, children[i], consistent);
+        if (below != counts[i]) {
+            *consistent = false;
+        }
+        total += below;
+    }
+    return total;
+}
+
+static const char *test_db_count_rank() {
+    printf("Running test_db_count_rank...\n");
+    clean_test_db();
+    db = db_open(TEST_DB_FILE);
+    mu_assert("error, db_open failed", db != NULL);
+    // Its catalog record sorts before the records and is not counted
+    mu_assert("error, create table", db_create_table(db, "other", NULL) == STATUS_OK);
+    char key[MAX_KEY_LEN];
+    char want[MAX_KEY_LEN];
+    char buf[MAX_VALUE_LEN];
+    int records = 1200;
+    for (int i = 0; i < records; i++) {
+        rank_key(i * 7 % records, key);
+        mu_assert("error, insert", db_insert(db, key, "v") == STATUS_OK);
+    }
+    BTreeFillStats fill;
+    db_fill_stats(db, &fill);
+    mu_assert("error, tree too shallow", fill.depth >= 3);
+    bool consistent = true;
+    mu_assert("error, counts", count_subtree(db->pager, 0, &consistent) == fill.cells && consistent);
+
+    char low[MAX_KEY_LEN];
+    char high[MAX_KEY_LEN];
+    rank_key(100, low);
+    rank_key(250, high);
+    mu_assert("error, count all", db_count(db, NULL, NULL) == records);
+    mu_assert("error, count range", db_count(db, low, high) == 150);
+    mu_assert("error, count from", db_count(db, low, NULL) == records - 100);
+    mu_assert("error, count to", db_count(db, NULL, high) == 250);
+    mu_assert("error, count reversed", db_count(db, high, low) == 0);
+    mu_assert("error, count between keys", db_count(db, "001", "002") == 20);
+    int ranks[] = { 0, 1, 599, 1199 };
+    for (int i = 0; i < 4; i++) {
+        rank_key(ranks[i], want);
+        mu_assert("error, seek rank", db_seek_rank(db, (uint64_t)ranks[i], key, buf, sizeof(buf)) == 1 &&
+                                      strcmp(key, want) == 0 && strcmp(buf, "v") == 0);
+    }
+    mu_assert("error, seek past end", db_seek_rank(db, (uint64_t)records, key, buf, sizeof(buf)) == STATUS_NOT_FOUND);
+
+    // Deletes come off the counts
+    for (int i = 0; i < records; i += 5) {
+        rank_key(i, key);
+        mu_assert("error, delete", db_delete(db, key) == STATUS_OK);
+    }
+    records -= records / 5;
+    mu_assert("error, count after deletes", db_count(db, NULL, NULL) == records);
+    mu_assert("error, range after deletes", db_count(db, low, high) == 120);
+    rank_key(1, want);
+    mu_assert("error, seek first", db_seek_rank(db, 0, key, buf, sizeof(buf)) == 1 && strcmp(key, want) == 0);
+    rank_key(6, want);
+    mu_assert("error, seek fifth", db_seek_rank(db, 4, key, buf, sizeof(buf)) == 1 && strcmp(key, want) == 0);
+
+    // An expired record keeps its rank until the sweeper deletes it
+    rank_key(1, key);
+    mu_assert("error, expire", db_expire(db, key, time(NULL) - 1) == STATUS_OK);
+    mu_assert("error, count expired", db_count(db, NULL, NULL) == records);
+    rank_key(2, want);
+    mu_assert("error, seek past expired", db_seek_rank(db, 0, key, buf, sizeof(buf)) == 1 && strcmp(key, want) == 0);
+    mu_assert("error, sweep", db_expire_sweep(db, 1000) == 1);
+    records--;
+    mu_assert("error, count swept", db_count(db, NULL, NULL) == records);
+    db_close(db);
+
+    db = db_open(TEST_DB_FILE);
+    mu_assert("error, reopen failed", db != NULL);
+    db_fill_stats(db, &fill);
+    consistent = true;
+    mu_assert("error, counts after reopen", count_subtree(db->pager, 0, &consistent) == fill.cells && consistent);
+    mu_assert("error, count after reopen", db_count(db, NULL, NULL) == records);
+    clean_test_db();
+    printf("[Pass]  test_db_count_rank PASSED\n");
+    return 0;
+}
+
+static const char *test_db_analyze() {
+    printf("Running test_db_analyze...\n");
+    clean_test_db();
+    db = db_open(TEST_DB_FILE);
+    mu_assert("error, db_open failed", db != NULL);
+    DbAnalysis analysis;
+    mu_assert("error, no analysis yet", db_analysis(db, &analysis) == STATUS_NOT_FOUND);
+    mu_assert("error, reserved table name", db_create_table(db, "\x01x", NULL) == STATUS_ERROR);
+    mu_assert("error, create table", db_create_table(db, "other", NULL) == STATUS_OK);
+    char key[MAX_KEY_LEN];
+    for (int i = 0; i < 40; i++) {
+        snprintf(key, sizeof(key), "row%02d", i);
+        mu_assert("error, table put", db_table_put(db, "other", key, "v") == STATUS_OK);
+    }
+    int records = 1200;
+    for (int i = 0; i < records; i++) {
+        rank_key(i * 7 % records, key);
+        mu_assert("error, insert", db_insert(db, key, "v") == STATUS_OK);
+    }
+
+    // Exact: the same as walking the tree
+    BTreeFillStats fill;
+    db_fill_stats(db, &fill);
+    DbAnalyzeOptions options = { 0, 1 };
+    mu_assert("error, analyze", db_analyze(db, &options, &analysis) == STATUS_OK);
+    const TreeAnalysis *tree = &analysis.tree;
+    mu_assert("error, exact height", tree->height == fill.depth && fill.depth >= 3);
+    mu_assert("error, exact leaves", tree->level_pages[tree->height - 1] == fill.leaf_pages);
+    mu_assert("error, exact pages", tree->pages == fill.leaf_pages + fill.internal_pages);
+    // The table's catalog record is a cell, not a record
+    mu_assert("error, exact records", tree->records == (uint64_t)records && fill.cells == (uint64_t)records + 1);
+    mu_assert("error, key sizes", tree->key_bytes == (uint64_t)records * 88 && tree->key_min == 88 &&
+                                  tree->key_max == 88 && tree->key_lengths[0] == 0 &&
+                                  tree->key_lengths[ANALYZE_KEY_BUCKETS - 1] == (uint64_t)records);
+    mu_assert("error, no free pages", analysis.free_pages == 0 && !analysis.sampled);
+    mu_assert("error, file pages", analysis.file_pages == analysis.tree_pages && analysis.tree_pages > tree->pages);
+    mu_assert("error, analysis is not a record", db_count(db, NULL, NULL) == records);
+    // The summary is a catalog record now: the next analyses leave it out
+    DbAnalysis single;
+    DbAnalysis threaded;
+    mu_assert("error, analyze again", db_analyze(db, &options, &single) == STATUS_OK);
+    mu_assert("error, summary counted", single.tree.records == tree->records &&
+                                        single.tree.key_bytes == tree->key_bytes &&
+                                        (int64_t)single.tree.records == db_count(db, NULL, NULL));
+    options.threads = 4;
+    mu_assert("error, threaded analyze", db_analyze(db, &options, &threaded) == STATUS_OK);
+    mu_assert("error, threaded differs", threaded.tree.records == single.tree.records &&
+                                         threaded.tree.pages == single.tree.pages &&
+                                         threaded.tree.key_bytes == single.tree.key_bytes &&
+                                         threaded.tree.pages_read == single.tree.pages_read);
+
+    // Sampled: estimates from a few hundred descents
+    DbAnalysis sampled;
+    options.samples = 300;
+    mu_assert("error, sampled analyze", db_analyze(db, &options, &sampled) == STATUS_OK);
+    mu_assert("error, sampled flag", sampled.sampled && sampled.tree.height == tree->height);
+    // The root once, then a page per level below it for each descent
+    mu_assert("error, sampled cost", sampled.tree.pages_read == 1 + 300 * (uint64_t)(tree->height - 1));
+    double leaves = (double)tree->level_pages[tree->height - 1];
+    mu_assert("error, sampled leaves", fabs((double)sampled.tree.level_pages[tree->height - 1] - leaves) < leaves * 0.25);
+    mu_assert("error, sampled records", fabs((double)sampled.tree.records - records) < records * 0.25);
+
+    // Typed keys count at their decoded length, not their encoding
+    DbTableOptions u64_keys = { KEY_TYPE_U64, 0 };
+    mu_assert("error, create typed table", db_create_table(db, "typed", &u64_keys) == STATUS_OK);
+    for (uint64_t i = 0; i < 50; i++) {
+        key_encode_u64(i, key);
+        mu_assert("error, typed put", db_table_put(db, "typed", key, "v") == STATUS_OK);
+    }
+    DbTable typed;
+    TreeAnalysis typed_tree;
+    mu_assert("error, typed info", db_table_info(db, "typed", &typed) == STATUS_OK);
+    mu_assert("error, typed analyze", tree_analyze(db->pager, typed.root_page, db->pager->versions.epoch, 1,
+                                                         &typed_tree) == 0);
+    mu_assert("error, typed key sizes", typed_tree.records == 50 && typed_tree.key_bytes == 50 * 8 &&
+                                        typed_tree.key_min == 8 && typed_tree.key_max == 8 &&
+                                        typed_tree.key_lengths[0] == 50);
+
+    // The dropped table's pages are no tree's any more
+    DbTable table;
+    mu_assert("error, table info", db_table_info(db, "other", &table) == STATUS_OK);
+    BTreeFillStats table_fill;
+    mu_assert("error, table fill", btree_fill_stats(db->pager, table.root_page, &table_fill) == 0);
+    mu_assert("error, drop table", db_drop_table(db, "other") == STATUS_OK);
+    options.samples = 0;
+    mu_assert("error, analyze after drop", db_analyze(db, &options, &analysis) == STATUS_OK);
+    mu_assert("error, free pages", analysis.free_pages == table_fill.leaf_pages + table_fill.internal_pages);
+    db_close(db);
+
+    // Kept in the catalog: read back at open without a walk
+    db = db_open(TEST_DB_FILE);
+    mu_assert("error, reopen failed", db != NULL);
+    DbAnalysis stored;
+    mu_assert("error, stored analysis", db_analysis(db, &stored) == STATUS_OK);
+    mu_assert("error, stored summary", stored.taken_at == analysis.taken_at && !stored.sampled &&
+                                       stored.tree.height == analysis.tree.height &&
+                                       stored.tree.pages == analysis.tree.pages &&
+                                       stored.tree.records == analysis.tree.records &&
+                                       stored.tree.key_bytes == analysis.tree.key_bytes &&
+                                       stored.free_pages == analysis.free_pages &&
+                                       stored.wal_bytes == analysis.wal_bytes);
+    mu_assert("error, count after reopen", db_count(db, NULL, NULL) == records);
+    clean_test_db();
+    printf("[Pass]  test_db_analyze PASSED\n");
+    return 0;
+}
+
+#ifndef _WIN32
+static void crash_fill_new(Database *crashing) {
+    insert_crash_keys(crashing, 0, 3000);
+}
+
+static void crash_fill_grown(Database *crashing) {
+    insert_crash_keys(crashing, 4000, 7000);
+}
+
+// Every key in [0, last) is there with its value, and nothing else
+static bool crash_keys_intact(int last) {
+    char key[MAX_KEY_LEN];
+    char buf[MAX_VALUE_LEN];
+    for (int i = 0; i < last; i++) {
+        crash_key(i, key);
+        if (db_get_into(db, key, buf, sizeof(buf)) < 0 || strcmp(buf, key) != 0) {
+            return false;
+        }
+    }
+    return db_count(db, NULL, NULL) == last;
+}
+
+// Writes after recovering a crash: pages recovered from the WAL are part
+// of the file, and new pages go after them
+static const char *test_db_crash_recovery() {
+    printf("Running test_db_crash_recovery...\n");
+    clean_test_db();
+    // A new file whose whole tree was still in the WAL
+    mu_assert("error, crashed writer", crash_writer(crash_fill_new));
+    db = db_open(TEST_DB_FILE);
+    mu_assert("error, reopen failed", db != NULL);
+    insert_crash_keys(db, 3000, 4000);
+    mu_assert("error, keys lost on a new file", crash_keys_intact(4000));
+    db_close(db);
+    db = NULL;
+
+    // A file that grew in the WAL past its size on disk
+    mu_assert("error, crashed writer", crash_writer(crash_fill_grown));
+    db = db_open(TEST_DB_FILE);
+    mu_assert("error, reopen failed", db != NULL);
+    insert_crash_keys(db, 7000, 9000);
+    mu_assert("error, keys lost on a grown file", crash_keys_intact(9000));
+    db_close(db);
+    db = db_open(TEST_DB_FILE);
+    mu_assert("error, reopen failed", db != NULL);
+    mu_assert("error, keys lost after close", crash_keys_intact(9000));
+    clean_test_db();
+    printf("[Pass]  test_db_crash_recovery PASSED\n");
+    return 0;
+}
+#endif
+
+#define TENANTS 8
+
+static const char *test_db_many_open() {
+    printf("Running test_db_many_open...\n");
+    clean_test_db();
+
+    // Tenants share one page cache budget: enough for all of them at the minimum size
+    PagerBudget budget;
+    pager_budget_init(&budget, (size_t)TENANTS * PAGER_MIN_FRAMES * PAGE_SIZE);
+    DbOptions options = {0};
+    options.pager.cache_frames = PAGER_MIN_FRAMES;
+    options.pager.budget = &budget;
+
+    Database *tenants[TENANTS];
+    char file[32];
+    char key[32];
+    char value[32];
+    for (int t = 0; t < TENANTS; t++) {
+        snprintf(file, sizeof(file), "test_tenant%d.dat", t);
+        remove(file);
+        tenants[t] = db_open_with_options(file, &options);
+        mu_assert("error, tenant open failed", tenants[t] != NULL);
+    }
+    mu_assert("error, budget should be used up", budget.used_frames == budget.total_frames);
+
+    // Same keys, different values in every tenant
+    for (int i = 0; i < 200; i++) {
+        for (int t = 0; t < TENANTS; t++) {
+            snprintf(key, sizeof(key), "key%03d", i);
+            snprintf(value, sizeof(value), "tenant%d-%d", t, i);
+            mu_assert("error, tenant insert failed", db_insert(tenants[t], key, value) == STATUS_OK);
+        }
+    }
+    for (int t = 0; t < TENANTS; t++) {
+        char expected[32];
+        snprintf(expected, sizeof(expected), "tenant%d-%d", t, 123);
+        mu_assert("error, tenant value", db_get_into(tenants[t], "key123", value, sizeof(value)) > 0);
+        mu_assert("error, tenants must not share data", strcmp(value, expected) == 0);
+    }
+
+    // Closing one tenant frees its share for a new one, and leaves the others intact
+    db_close(tenants[0]);
+    mu_assert("error, closed tenant should return its frames", budget.used_frames == budget.total_frames - PAGER_MIN_FRAMES);
+    tenants[0] = db_open_with_options("test_tenant0.dat", &options);
+    mu_assert("error, tenant reopen failed", tenants[0] != NULL);
+    mu_assert("error, reopened tenant value", db_get_into(tenants[0], "key042", value, sizeof(value)) > 0 &&
+                                              strcmp(value, "tenant0-42") == 0);
+    mu_assert("error, other tenant value", db_get_into(tenants[5], "key042", value, sizeof(value)) > 0 &&
+                                           strcmp(value, "tenant5-42") == 0);
+
+    for (int t = 0; t < TENANTS; t++) {
+        db_close(tenants[t]);
+        snprintf(file, sizeof(file), "test_tenant%d.dat", t);
+        remove(file);
+        snprintf(file, sizeof(file), "test_tenant%d.dat.wal", t);
+        remove(file);
+    }
+    mu_assert("error, budget should be free", budget.used_frames == 0);
+    printf("[Pass]  test_db_many_open PASSED\n");
+    return 0;
+}
+
 const char *all_db_tests() {
     printf("\n=== Running Database Core Tests ===\n");
     mu_run_test(test_db_open_close);
@@ -216,6 +1818,26 @@ const char *all_db_tests() {
     mu_run_test(test_db_delete_last_key);
     mu_run_test(test_db_delete_middle_key);
     mu_run_test(test_db_delete_only_key);
+    mu_run_test(test_db_multi_get);
+    mu_run_test(test_db_get_into);
+    mu_run_test(test_db_get_pinned);
+    mu_run_test(test_db_get_optimistic);
+    mu_run_test(test_db_snapshot);
+    mu_run_test(test_db_bloom_filter);
+    mu_run_test(test_db_hash_index);
+    mu_run_test(test_db_key_types);
+    mu_run_test(test_db_format_version);
+    mu_run_test(test_db_tables);
+    mu_run_test(test_db_secondary_index);
+    mu_run_test(test_db_failed_write);
+    mu_run_test(test_db_read_modify_write);
+    mu_run_test(test_db_expiry);
+    mu_run_test(test_db_count_rank);
+    mu_run_test(test_db_analyze);
+#ifndef _WIN32
+    mu_run_test(test_db_crash_recovery);
+#endif
+    mu_run_test(test_db_many_open);
     printf("=== Database Core Tests Complete ===\n\n");
     return 0;
 }
@@ -7,6 +7,7 @@ int tests_run = 0;
 extern const char *all_utility_tests();
 extern const char *all_db_tests();
 extern const char *all_btree_split_tests();
+extern const char *all_cache_tests();
 
 int main(int argc, char **argv) {
     (void)argc;
@@ -27,6 +28,11 @@ int main(int argc, char **argv) {
         printf("BTREE SPLIT TESTS FAILED: %s\n", result_split);
         failed = 1;
     }
+    const char *result_cache = all_cache_tests();
+    if (result_cache != 0) {
+        printf("PAGE CACHE TESTS FAILED: %s\n", result_cache);
+        failed = 1;
+    }
     if (!failed) {
         printf("ALL TESTS PASSED\n");
     }
@@ -3,6 +3,7 @@
 #include <string.h>
 #include <assert.h>
 #include "../src/pager.h"
+#include "../src/crc32c.h"
 
 void test_pager_open_close() {
     printf("Testing pager_open and pager_close...\n");
@@ -54,9 +55,221 @@ void test_pager_read_write() {
     printf("Passed!\n");
 }
 
+void test_pager_direct_io() {
+    printf("Testing pager with direct I/O and the frame arena...\n");
+    const char* db_file = "test_pager_direct.db";
+    remove(db_file);
+
+    PagerOptions options = { .flags = PAGER_OPEN_DIRECT };
+    Pager* pager = pager_open_with_options(db_file, &options);
+    assert(pager != NULL);
+
+    // Frames must be page aligned for O_DIRECT
+    void* page0 = pager_get_page(pager, 0);
+    void* page1 = pager_get_page(pager, 1);
+    assert(page0 != NULL && page1 != NULL);
+    assert(((uintptr_t)page0 % PAGE_SIZE) == 0);
+    assert(((uintptr_t)page1 % PAGE_SIZE) == 0);
+
+    strcpy((char*)page0, "Direct page 0");
+    strcpy((char*)page1, "Direct page 1");
+    assert(pager_flush(pager, 0) == 0);
+    assert(pager_flush(pager, 1) == 0);
+
+    // Direct writes from an unaligned caller buffer must also work
+    char* unaligned = malloc(PAGE_SIZE + 1);
+    memset(unaligned + 1, 0, PAGE_SIZE);
+    strcpy(unaligned + 1, "Rewritten page 1");
+    assert(pager_write_page_direct(pager, 1, unaligned + 1) == 0);
+    free(unaligned);
+    pager_close(pager);
+
+    pager = pager_open_with_options(db_file, &options);
+    assert(pager != NULL);
+    assert(strcmp((char*)pager_get_page(pager, 0), "Direct page 0") == 0);
+    assert(strcmp((char*)pager_get_page(pager, 1), "Rewritten page 1") == 0);
+    pager_close(pager);
+
+    remove(db_file);
+    printf("Passed!\n");
+}
+
+static Pager* open_with_checksum_mode(const char* db_file, PagerChecksumMode mode) {
+    PagerOptions options = { .checksum_mode = mode };
+    return pager_open_with_options(db_file, &options);
+}
+
+void test_pager_checksum() {
+    printf("Testing page checksums...\n");
+    const char* db_file = "test_pager_crc.db";
+    remove(db_file);
+
+    // Standard CRC-32C check value
+    assert(crc32c(0, "123456789", 9) == 0xE3069283u);
+
+    Pager* pager = pager_open(db_file);
+    assert(pager != NULL);
+    strcpy((char*)pager_get_page(pager, 0), "checksummed page");
+    strcpy((char*)pager_get_page(pager, 1), "unchecked page");
+    strcpy((char*)pager_get_page(pager, 2), "zeroed page");
+    assert(pager_flush(pager, 0) == 0);
+    pager_close(pager);
+
+    // Page 1 written without a checksum, page 2 zero-filled as a block that
+    // was never written: a trailer of 0 is no exemption
+    char unchecked[PAGE_SIZE] = {0};
+    strcpy(unchecked, "unchecked page");
+    char zeroed[PAGE_SIZE] = {0};
+    FILE* file = fopen(db_file, "r+b");
+    assert(file != NULL);
+    fseek(file, PAGE_SIZE, SEEK_SET);
+    fwrite(unchecked, 1, PAGE_SIZE, file);
+    fwrite(zeroed, 1, PAGE_SIZE, file);
+    fclose(file);
+    assert(!pager_verify_checksum(zeroed));
+
+    PagerStats stats;
+    pager = open_with_checksum_mode(db_file, PAGER_CHECKSUM_ALWAYS);
+    assert(pager != NULL);
+    char* page0 = pager_get_page(pager, 0);
+    assert(page0 != NULL && strcmp(page0, "checksummed page") == 0);
+    assert(pager_verify_checksum(page0));
+    assert(pager_get_page(pager, 1) == NULL);
+    assert(pager_get_page(pager, 2) == NULL);
+    pager_get_stats(pager, &stats);
+    assert(stats.checksum_failures == 2);
+    pager_close(pager);
+
+    // Flip one bit in page 0
+    file = fopen(db_file, "r+b");
+    assert(file != NULL);
+    fseek(file, 100, SEEK_SET);
+    int byte = fgetc(file);
+    fseek(file, 100, SEEK_SET);
+    fputc(byte ^ 0x01, file);
+    fclose(file);
+
+    pager = open_with_checksum_mode(db_file, PAGER_CHECKSUM_ALWAYS);
+    assert(pager != NULL);
+    assert(pager_get_page(pager, 0) == NULL);
+    pager_get_stats(pager, &stats);
+    assert(stats.checksum_failures == 1);
+    pager_close(pager);
+
+    // Sampling checks the first load
+    pager = open_with_checksum_mode(db_file, PAGER_CHECKSUM_SAMPLED);
+    assert(pager != NULL);
+    assert(pager_get_page(pager, 0) == NULL);
+    pager_close(pager);
+
+    pager = open_with_checksum_mode(db_file, PAGER_CHECKSUM_OFF);
+    assert(pager != NULL);
+    assert(pager_get_page(pager, 0) != NULL);
+    pager_get_stats(pager, &stats);
+    assert(stats.checksum_failures == 0);
+    pager_close(pager);
+
+    remove(db_file);
+    printf("Passed!\n");
+}
+
+void test_pager_pin() {
+    printf("Testing pinned pages under eviction and writes...\n");
+    const char* db_file = "test_pager_pin.db";
+    remove(db_file);
+    PagerOptions options = { .cache_frames = PAGER_MIN_FRAMES };
+    Pager* pager = pager_open_with_options(db_file, &options);
+    assert(pager != NULL);
+
+    char* page0 = pager_get_page_for_write(pager, 0);
+    strcpy(page0, "before");
+    uint32_t frame;
+    char* pinned = pager_pin_page(pager, 0, &frame);
+    assert(pinned == page0);
+
+    // Cycle many more pages than there are frames through the cache
+    for (uint32_t i = 1; i <= 4 * PAGER_MIN_FRAMES; i++) {
+        char* page = pager_get_page_for_write(pager, i);
+        assert(page != NULL);
+        sprintf(page, "page %u", i);
+    }
+    PagerStats stats;
+    pager_get_stats(pager, &stats);
+    assert(stats.evictions > 0);
+    assert(strcmp(pinned, "before") == 0);
+
+    // A write moves the page to a copy and leaves the pinned image alone
+    char* writable = pager_get_page_for_write(pager, 0);
+    assert(writable != pinned);
+    strcpy(writable, "after");
+    assert(strcmp(pinned, "before") == 0);
+    assert(strcmp(pager_get_page(pager, 0), "after") == 0);
+    pager_get_stats(pager, &stats);
+    assert(stats.pinned_copies == 1);
+
+    // The last unpin frees the detached frame; later writes need no copy
+    uint32_t free_before = pager->num_free_frames;
+    pager_unpin_frame(pager, frame);
+    assert(pager->num_free_frames == free_before + 1);
+    assert(pager_get_page_for_write(pager, 0) == writable);
+    pager_get_stats(pager, &stats);
+    assert(stats.pinned_copies == 1);
+    pager_close(pager);
+
+    pager = pager_open(db_file);
+    assert(strcmp(pager_get_page(pager, 0), "after") == 0);
+    assert(strcmp(pager_get_page(pager, 7), "page 7") == 0);
+    pager_close(pager);
+
+    remove(db_file);
+    printf("Passed!\n");
+}
+
+void test_pager_budget() {
+    printf("Testing a frame budget shared by several pagers...\n");
+    const char* files[3] = { "test_pager_budget0.db", "test_pager_budget1.db", "test_pager_budget2.db" };
+    PagerBudget budget;
+    pager_budget_init(&budget, (size_t)100 * PAGE_SIZE);
+    assert(budget.total_frames == 100);
+
+    PagerOptions options = { .cache_frames = 64, .budget = &budget };
+    Pager* first = pager_open_with_options(files[0], &options);
+    assert(first != NULL && first->num_frames == 64);
+    // Only 36 frames are left: the second pager gets those
+    Pager* second = pager_open_with_options(files[1], &options);
+    assert(second != NULL && second->num_frames == 36);
+    assert(budget.used_frames == 100);
+    assert(pager_open_with_options(files[2], &options) == NULL);
+
+    // Both pagers stay usable within their share
+    for (uint32_t i = 0; i < 200; i++) {
+        sprintf(pager_get_page_for_write(first, i), "first %u", i);
+        sprintf(pager_get_page_for_write(second, i), "second %u", i);
+    }
+    assert(strcmp(pager_get_page(first, 3), "first 3") == 0);
+    assert(strcmp(pager_get_page(second, 3), "second 3") == 0);
+
+    pager_close(first);
+    assert(budget.used_frames == 36);
+    Pager* third = pager_open_with_options(files[2], &options);
+    assert(third != NULL && third->num_frames == 64);
+    pager_close(second);
+    pager_close(third);
+    assert(budget.used_frames == 0);
+
+    for (int i = 0; i < 3; i++) {
+        remove(files[i]);
+    }
+    printf("Passed!\n");
+}
+
 int main() {
     test_pager_open_close();
     test_pager_read_write();
+    test_pager_direct_io();
+    test_pager_checksum();
+    test_pager_pin();
+    test_pager_budget();
     printf("All Pager tests passed!\n");
     return 0;
 }
@@ -50,8 +50,54 @@ void test_wal() {
     printf("Passed!\n");
 }
 
+// Pages of a transaction are recovered together, or not at all when the
+// log ends before its last frame
+void test_wal_transaction() {
+    printf("Testing WAL transactions...\n");
+    const char* db_file = "test_wal_txn.db";
+    remove("test_wal_txn.db.wal");
+
+    char page[PAGE_SIZE];
+    char read_back[PAGE_SIZE];
+    WAL* wal = wal_open(db_file);
+    assert(wal != NULL);
+    assert(wal_begin(wal) == 0);
+    memset(page, 'a', PAGE_SIZE);
+    assert(wal_log_page(wal, 1, page) == 0);
+    memset(page, 'b', PAGE_SIZE);
+    assert(wal_log_page(wal, 2, page) == 0);
+    // The last page is held back, but still readable
+    assert(wal_read_page(wal, 2, read_back) == 1 && read_back[0] == 'b');
+    assert(wal_read_page(wal, 1, read_back) == 1 && read_back[0] == 'a');
+    wal_close(wal); // Crash before commit: only page 1 reached the log
+
+    wal = wal_open(db_file);
+    assert(wal != NULL);
+    assert(wal->num_frames == 0);
+    assert(wal_read_page(wal, 1, read_back) == 0);
+
+    assert(wal_begin(wal) == 0);
+    memset(page, 'c', PAGE_SIZE);
+    assert(wal_log_page(wal, 1, page) == 0);
+    memset(page, 'd', PAGE_SIZE);
+    assert(wal_log_page(wal, 2, page) == 0);
+    assert(wal_commit(wal) == 0);
+    wal_close(wal);
+
+    wal = wal_open(db_file);
+    assert(wal != NULL);
+    assert(wal->num_frames == 2);
+    assert(wal_read_page(wal, 1, read_back) == 1 && read_back[0] == 'c');
+    assert(wal_read_page(wal, 2, read_back) == 1 && read_back[0] == 'd');
+    wal_close(wal);
+
+    remove("test_wal_txn.db.wal");
+    printf("Passed!\n");
+}
+
 int main() {
     test_wal();
+    test_wal_transaction();
     printf("All WAL tests passed!\n");
     return 0;
 }